@@ -35,6 +35,8 @@ namespace {
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 const static Niflib::Color3 empty_color3(0.0f, 0.0f, 0.0f);
 
@@ -72,22 +74,33 @@ AlphaBlendModeType ConvertAlphaBlendMode(bool BlendState, AlphaBlendFunc BlendFu
 #define READ_VALUE(dst, x)  if (!ReadObject(src, ##dst . ##x, #x)) goto error;
 #define SAVE_VALUE(src, x)  if (!SaveObject(dst, ##src . ##x, #x)) goto error;
 
+// Bounds checked cursor over a binary material file held in memory
+struct MtlReader
+{
+	const char *p;
+	const char *end;
+};
+
 template <typename T>
-bool ReadObject(FILE* file, T& x, const char *name) {
-	return (fread(&x, sizeof(x), 1, file) == 1);
+bool ReadObject(MtlReader& src, T& x, const char *name) {
+	if (size_t(src.end - src.p) < sizeof(x)) return false;
+	memcpy(&x, src.p, sizeof(x));
+	src.p += sizeof(x);
+	return true;
 }
 
 template <>
-bool ReadObject<tstring>(FILE* src, tstring& x, const char *name) {
+bool ReadObject<tstring>(MtlReader& src, tstring& x, const char *name) {
 	USES_CONVERSION;
 	int len = 0;
-	char *ptr = nullptr;
 	if (!ReadObject(src, len, "")) goto error;
-	if (len >= MAX_PATH) goto error;
+	if (len < 0 || len >= MAX_PATH || src.end - src.p < len) goto error;
 
-	ptr = static_cast<char*>(_alloca(len));
-	if (fread(ptr, 1, len, src) != len) goto error;
-	x = A2T(ptr);
+	{
+		string str(src.p, strnlen(src.p, len));
+		src.p += len;
+		x = A2T(str.c_str());
+	}
 	return true;
 error: return false;
 }
@@ -121,6 +134,7 @@ bool ReadObject(const rapidjson::Value& value, T& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, int& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsInt()) return false;
 		x = value.GetInt();
 		return true;
 	} else {
@@ -134,6 +148,7 @@ bool ReadObject(const rapidjson::Value& value, int& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, float& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsNumber()) return false;
 		x = value.GetDouble();
 		return true;
 	}
@@ -148,6 +163,7 @@ bool ReadObject(const rapidjson::Value& value, float& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, double& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsNumber()) return false;
 		x = value.GetDouble();
 		return true;
 	}
@@ -162,6 +178,7 @@ bool ReadObject(const rapidjson::Value& value, double& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, bool& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsBool()) return false;
 		x = value.GetBool();
 		return true;
 	}
@@ -176,7 +193,7 @@ bool ReadObject(const rapidjson::Value& value, bool& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, Niflib::Color3& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
-		const char *str = value.GetString();
+		const char *str = value.IsString() ? value.GetString() : nullptr;
 		if (str && str[0] == '#') {
 			int ival = strtol(str + 1, nullptr, 16);
 			x.r = NifConvertByteToFloatCompat((ival & 0xFF0000) >> 16, 0);
@@ -196,6 +213,7 @@ bool ReadObject(const rapidjson::Value& value, Niflib::Color3& x, const char *na
 template <>
 bool ReadObject(const rapidjson::Value& value, wstring& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsString()) return false;
 		USES_CONVERSION;
 		const char *str = value.GetString();
 		x = A2W(str);
@@ -212,6 +230,7 @@ bool ReadObject(const rapidjson::Value& value, wstring& x, const char *name) {
 template <>
 bool ReadObject(const rapidjson::Value& value, string& x, const char *name) {
 	if (name == nullptr || name[0] == 0) {
+		if (!value.IsString()) return false;
 		x = value.GetString();
 		return true;
 	}
@@ -231,7 +250,7 @@ bool ReadObject<AlphaBlendModeType>(const rapidjson::Value& value, AlphaBlendMod
 	return true;
 }
 
-static bool ReadMtlHeader(FILE* src, MaterialHeader& hdr)
+static bool ReadMtlHeader(MtlReader& src, MaterialHeader& hdr)
 {
 	READ_VALUE(hdr,Signature);
 	READ_VALUE(hdr,Version);
@@ -247,7 +266,7 @@ static bool SaveMtlHeader(FILE* dst, MaterialHeader& hdr)
 error: return false;
 }
 
-static bool ReadBaseMaterial(FILE* src, const MaterialHeader& hdr, BaseMaterial& mtl)
+static bool ReadBaseMaterial(MtlReader& src, const MaterialHeader& hdr, BaseMaterial& mtl)
 {
 	int tile_uv;
 	if (!ReadObject(src, tile_uv, "")) goto error;
@@ -316,7 +335,7 @@ static bool SaveBaseMaterial(FILE* dst, const MaterialHeader& hdr, const BaseMat
 error: return false;
 }
 
-static bool ReadBGSM(FILE* src, const MaterialHeader& hdr, BGSMFile& mtl)
+static bool ReadBGSM(MtlReader& src, const MaterialHeader& hdr, BGSMFile& mtl)
 {
 	if (!ReadBaseMaterial(src, hdr, mtl)) goto error;
 	READ_VALUE(mtl,DiffuseTexture);
@@ -454,7 +473,7 @@ error: return false;
 
 #define READ_VALUE(dst, x, def)  if (!ReadObject(src, ##dst . ##x, #x)) goto error;
 
-static bool ReadBGEM(FILE* src, const MaterialHeader& hdr, BGEMFile& mtl)
+static bool ReadBGEM(MtlReader& src, const MaterialHeader& hdr, BGEMFile& mtl)
 {
 	if (!ReadBaseMaterial(src, hdr, mtl)) goto error;
 	READ_VALUE(mtl, BaseTexture, TEXT(""));
@@ -649,49 +668,159 @@ error: return false;
 }
 
 
+namespace {
+
+	// Whole material file read with one ReadFile into a private buffer, so
+	//   the json parser can decode strings in place.  Materials are a few
+	//   hundred bytes; mapping a view of them costs more than reading them.
+	class MaterialFileData
+	{
+	public:
+		explicit MaterialFileData(const tstring& filename)
+		{
+			LARGE_INTEGER fileSize;
+			HANDLE hFile = CreateFile(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (hFile == INVALID_HANDLE_VALUE)
+				return;
+			if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart <= 0x1000000) {
+				DWORD bytesRead = 0;
+				buffer.resize(size_t(fileSize.QuadPart));
+				if (!ReadFile(hFile, &buffer[0], DWORD(buffer.size()), &bytesRead, nullptr) || bytesRead != buffer.size())
+					buffer.clear();
+			}
+			CloseHandle(hFile);
+		}
+
+		char *Data() { return buffer.empty() ? nullptr : &buffer[0]; }
+		size_t Size() const { return buffer.size(); }
+		MtlReader Reader() { MtlReader src = { Data(), Data() + buffer.size() }; return src; }
+
+	private:
+		std::vector<char> buffer;
+	};
+
+	// In situ json source that stops at the end of the buffer instead of
+	//   relying on a terminating null
+	struct MaterialInsituStream
+	{
+		typedef char Ch;
+
+		MaterialInsituStream(char *src, size_t len) : src_(src), dst_(nullptr), head_(src), end_(src + len) {}
+
+		Ch Peek() const { return src_ < end_ ? *src_ : '\0'; }
+		Ch Take() { return src_ < end_ ? *src_++ : '\0'; }
+		size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+		void Put(Ch c) { *dst_++ = c; }
+		Ch* PutBegin() { return dst_ = src_; }
+		size_t PutEnd(Ch* begin) { return static_cast<size_t>(dst_ - begin); }
+		void Flush() {}
+
+		Ch* src_;
+		Ch* dst_;
+		Ch* head_;
+		Ch* end_;
+	};
+
+	struct MaterialStamp
+	{
+		unsigned long long writeTime;
+		unsigned long long size;
+
+		bool operator==(const MaterialStamp& rhs) const { return writeTime == rhs.writeTime && size == rhs.size; }
+	};
+
+	bool GetMaterialStamp(const tstring& filename, MaterialStamp& stamp)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attr;
+		if (!GetFileAttributesEx(filename.c_str(), GetFileExInfoStandard, &attr) || (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			return false;
+		stamp.writeTime = ((unsigned long long)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+		stamp.size = ((unsigned long long)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+		return true;
+	}
+
+	// Materials already read by this process.  Hundreds of shapes in one
+	//   import usually share a handful of materials; an entry is used only
+	//   while the file keeps the size and write time it was read with.
+	template <typename T>
+	class MaterialCache
+	{
+	public:
+		bool Find(const tstring& filename, const MaterialStamp& stamp, T& mtl)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			typename EntryMap::const_iterator itr = entries.find(filename);
+			if (itr == entries.end() || !(itr->second.stamp == stamp))
+				return false;
+			mtl = itr->second.mtl;
+			return true;
+		}
+		void Store(const tstring& filename, const MaterialStamp& stamp, const T& mtl)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			Entry& entry = entries[filename];
+			entry.stamp = stamp;
+			entry.mtl = mtl;
+		}
+		void Remove(const tstring& filename)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			entries.erase(filename);
+		}
+
+	private:
+		struct Entry
+		{
+			MaterialStamp stamp;
+			T mtl;
+		};
+		typedef std::map<tstring, Entry, ltstr> EntryMap;
+
+		std::mutex lock;
+		EntryMap entries;
+	};
+
+	MaterialCache<BGSMFile> BGSMCache;
+	MaterialCache<BGEMFile> BGEMCache;
+
+	bool ParseJsonMaterial(MaterialFileData& file, rapidjson::Document& d)
+	{
+		MaterialInsituStream json(file.Data(), file.Size());
+		d.ParseStream<rapidjson::kParseInsituFlag>(json);
+		return !d.HasParseError() && d.IsObject();
+	}
+}
+
 bool ReadBGSMFile(const tstring& filename, BGSMFile& bgsm)
 {
-	FILE *file = _tfopen(filename.c_str(), TEXT("rb"));
-	if (file == nullptr) return false;
+	MaterialStamp stamp;
+	if (!GetMaterialStamp(filename, stamp)) return false;
+	if (BGSMCache.Find(filename, stamp, bgsm)) return true;
+
+	MaterialFileData file(filename);
+	if (file.Data() == nullptr) return false;
 
 	bool result = false;
 	MaterialHeader hdr;
-	if (!ReadMtlHeader(file, hdr)) goto error;
+	MtlReader src = file.Reader();
+	if (!ReadMtlHeader(src, hdr)) return false;
 	if (strncmp(hdr.Signature, "BGSM", 4) == 0) {
-		if (!ReadBGSM(file, hdr, bgsm)) goto error;
-		result = true;
+		result = ReadBGSM(src, hdr, bgsm);
 	}
 	else if (strncmp(hdr.Signature, "BGEM", 4) == 0) {
 		return false;
 	} else {
-		// read as JSON files
-		fseek(file, 0, SEEK_SET);
-		struct _stat filestat;
-		_tstat(filename.c_str(), &filestat);
-		char * json = static_cast<char*>(malloc(filestat.st_size+1));
-		try
-		{
-			if (fread(json, sizeof(char), filestat.st_size, file) == filestat.st_size)
-			{
-				json[filestat.st_size] = 0;
-				rapidjson::Document d;
-				d.Parse(json);
-
-				strncpy(hdr.Signature, "BGSM", 4);
-				hdr.Version = 1;
-			}
-			result = true;
-		}
-		catch(...)
-		{
+		// read as JSON files, parsed in place in the private buffer
+		rapidjson::Document d;
+		if (ParseJsonMaterial(file, d)) {
+			strncpy(hdr.Signature, "BGSM", 4);
+			hdr.Version = 1;
+			result = ReadBGSM(d, hdr, bgsm);
 		}
-		free(json);
 	}
-	goto exit;
-error:
-	result = false;
-exit:
-	fclose(file);
+	if (result)
+		BGSMCache.Store(filename, stamp, bgsm);
 	return result;
 }
 
@@ -712,53 +841,40 @@ error:
 	result = false;
 exit:
 	fclose(file);
+	BGSMCache.Remove(filename);
 	return result;
 }
 
 bool ReadBGEMFile(const tstring& filename, BGEMFile& BGEM)
 {
-	FILE *file = _tfopen(filename.c_str(), TEXT("rb"));
-	if (file == nullptr) return false;
+	MaterialStamp stamp;
+	if (!GetMaterialStamp(filename, stamp)) return false;
+	if (BGEMCache.Find(filename, stamp, BGEM)) return true;
+
+	MaterialFileData file(filename);
+	if (file.Data() == nullptr) return false;
 
 	bool result = false;
 	MaterialHeader hdr;
-	if (!ReadMtlHeader(file, hdr)) goto error;
+	MtlReader src = file.Reader();
+	if (!ReadMtlHeader(src, hdr)) return false;
 	if (strncmp(hdr.Signature, "BGEM", 4) == 0) {
-		if (!ReadBGEM(file, hdr, BGEM)) goto error;
-		result = true;
+		result = ReadBGEM(src, hdr, BGEM);
 	}
-	else if (strncmp(hdr.Signature, "BGEM", 4) == 0) {
+	else if (strncmp(hdr.Signature, "BGSM", 4) == 0) {
 		return false;
 	}
 	else {
-		// read as JSON files
-		fseek(file, 0, SEEK_SET);
-		struct _stat filestat;
-		_tstat(filename.c_str(), &filestat);
-		char * json = static_cast<char*>(malloc(filestat.st_size + 1));
-		try
-		{
-			if (fread(json, sizeof(char), filestat.st_size, file) == filestat.st_size)
-			{
-				json[filestat.st_size] = 0;
-				rapidjson::Document d;
-				d.Parse(json);
-
-				strncpy(hdr.Signature, "BGEM", 4);
-				hdr.Version = 1;
-			}
-			result = true;
-		}
-		catch (...)
-		{
+		// read as JSON files, parsed in place in the private buffer
+		rapidjson::Document d;
+		if (ParseJsonMaterial(file, d)) {
+			strncpy(hdr.Signature, "BGEM", 4);
+			hdr.Version = 1;
+			result = ReadBGEM(d, hdr, BGEM);
 		}
-		free(json);
 	}
-	goto exit;
-error:
-	result = false;
-exit:
-	fclose(file);
+	if (result)
+		BGEMCache.Store(filename, stamp, BGEM);
 	return result;
 }
 
@@ -780,6 +896,7 @@ error:
 	result = false;
 exit:
 	fclose(file);
+	BGEMCache.Remove(filename);
 	return result;
 }
 
@@ -3,9 +3,12 @@
 #include <tchar.h>
 #include "AppSettings.h"
 #include "IniSection.h"
+#include "IniStore.h"
+#include "TextureIndex.h"
 
 AppSettingsMap TheAppSettings;
 static bool TheAppSettingsInitialized = false;
+static std::shared_ptr<const IniStore> TheAppSettingsIni;
 bool AppSettings::Initialized()
 {
 	return TheAppSettingsInitialized;
@@ -16,13 +19,16 @@ void AppSettings::Initialize(Interface *gi)
 	TCHAR iniName[MAX_PATH];
 	GetIniFileName(iniName);
 	if (-1 != _taccess(iniName, 0)) {
-		bool reparse = GetIniValue<bool>(TEXT("System"), TEXT("Reparse"), false, iniName);
-		if (reparse || TheAppSettings.empty()) {
+		std::shared_ptr<const IniStore> ini = IniStore::Get(iniName);
+		bool reparse = ini->GetValue<bool>(TEXT("System"), TEXT("Reparse"), false);
+		// an edited ini file invalidates the applications read from it
+		if (reparse || TheAppSettings.empty() || ini != TheAppSettingsIni) {
 			TheAppSettings.clear();
+			TheAppSettingsIni = ini;
 		}
 		TheAppSettingsInitialized = true;
 
-		tstring Applications = GetIniValue<tstring>(TEXT("System"), TEXT("KnownApplications"), TEXT(""), iniName);
+		tstring Applications = ini->GetValue<tstring>(TEXT("System"), TEXT("KnownApplications"), TEXT(""));
 		tstringlist apps = TokenizeString(Applications.c_str(), TEXT(";"));
 		apps.push_back(tstring(TEXT("User"))); // always ensure that user is present
 		for (tstringlist::iterator appstr = apps.begin(); appstr != apps.end(); ++appstr) {
@@ -37,15 +43,9 @@ void AppSettings::Initialize(Interface *gi)
 
 void AppSettings::ReadSettings(tstring iniFile)
 {
-	NameValueCollection settings = ReadIniSection(Name.c_str(), iniFile.c_str());
-
-	// expand indirect values first
-	for (NameValueCollection::iterator itr = settings.begin(), end = settings.end(); itr != end; ++itr)
-		itr->second = GetIndirectValue(itr->second.c_str());
-
-	// next expand qualifiers
-	for (NameValueCollection::iterator itr = settings.begin(), end = settings.end(); itr != end; ++itr)
-		itr->second = ExpandQualifiers(itr->second.c_str(), settings);
+	// indirect values and qualifiers come expanded from the store
+	std::shared_ptr<const IniStore> ini = IniStore::Get(iniFile.c_str());
+	NameValueCollection settings = ini->ExpandedSection(Name.c_str());
 
 	// finally expand environment variables, last because it clobbers my custom qualifier expansion
 	for (NameValueCollection::iterator itr = settings.begin(), end = settings.end(); itr != end; ++itr)
@@ -79,6 +79,24 @@ void AppSettings::ReadSettings(tstring iniFile)
 	doNotReuseExistingBones = GetSetting<bool>(TEXT("DoNotReuseExistingBones"), doNotReuseExistingBones);
 
 	skeletonCheck = GetSetting<tstring>(TEXT("SkeletonCheck"));
+
+	// persistent texture index, one file per application named after the section
+	textureIndexFile.clear();
+	if (ini->GetValue<bool>(TEXT("System"), TEXT("UseTextureIndex"), true)) {
+		tstring indexDir = ExpandEnvironment(ini->GetValue<tstring>(TEXT("System"), TEXT("TextureIndexDir"), TEXT("")));
+		if (indexDir.empty()) {
+			indexDir = iniFile;
+			indexDir.erase(indexDir.size() - _tcslen(PathFindFileName(iniFile.c_str())));
+		}
+		tstring indexName = TEXT("MaxNifTools_") + Name + TEXT(".texindex");
+		for (tstring::iterator c = indexName.begin(); c != indexName.end(); ++c) {
+			if (_tcschr(TEXT("\\/:*?\"<>|"), *c) != nullptr)
+				*c = '_';
+		}
+		TCHAR indexPath[MAX_PATH];
+		if (PathCombine(indexPath, indexDir.c_str(), indexName.c_str()) != nullptr)
+			textureIndexFile = indexPath;
+	}
 }
 
 void AppSettings::WriteSettings(Interface *gi)
@@ -97,7 +115,16 @@ void AppSettings::WriteSettings(Interface *gi)
 void AppSettings::CacheImages()
 {
 	if (!parsedImages) {
-		FindImages(imgTable, rootPath, searchPaths, extensions);
+		if (textureIndexFile.empty()) {
+			FindImages(imgTable, rootPath, searchPaths, extensions);
+		}
+		else {
+			TextureIndex index(rootPath, extensions);
+			index.Load(textureIndexFile);
+			if (index.Refresh(searchPaths))
+				index.Save(textureIndexFile);
+			index.Fill(imgTable);
+		}
 		parsedImages = true;
 	}
 }
@@ -55,6 +55,7 @@ public:
    bool supportPrnStrings;
    bool doNotReuseExistingBones;
    tstring skeletonCheck;
+   tstring textureIndexFile;
 
    static bool Initialized();
    static void Initialize(Interface *gi);
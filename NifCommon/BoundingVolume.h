@@ -0,0 +1,272 @@
+/**********************************************************************
+*<
+FILE: BoundingVolume.h
+
+DESCRIPTION:	Axis aligned box and minimal bounding sphere of a point set.
+               Works on any point type laid out as three packed floats
+               (niflib Vector3, Max Point3).
+
+               The box and the sphere are not found in one pass.  A call
+               reads the points at least three times: one SSE pass for the
+               box, Welzl's solver over a shuffled index order (expected
+               linear, but it revisits earlier points each time the sphere
+               grows), and a final pass measuring the radius from the
+               rounded center.  Exporter::CalcBoundingBox walks Max nodes
+               and does not use this kernel.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#  define BOUNDS_SSE 1
+#  include <emmintrin.h>
+#endif
+
+struct BoundingVolume
+{
+	float lows[3];
+	float highs[3];
+	float center[3];
+	float radius;
+};
+
+namespace BoundsDetail {
+
+struct Sphere
+{
+	double c[3];
+	double r2;
+};
+
+inline double Dist2(const double a[3], const float *p)
+{
+	double dx = p[0] - a[0], dy = p[1] - a[1], dz = p[2] - a[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// Points within a small relative tolerance count as inside so rounding
+//   does not make the incremental solver restart needlessly.
+inline bool Contains(const Sphere& s, const float *p)
+{
+	return Dist2(s.c, p) <= s.r2 * (1.0 + 1e-7) + 1e-12;
+}
+
+inline Sphere FromPoint(const float *a)
+{
+	Sphere s = { { a[0], a[1], a[2] }, 0.0 };
+	return s;
+}
+
+inline Sphere FromTwo(const float *a, const float *b)
+{
+	Sphere s;
+	for (int i = 0; i < 3; ++i)
+		s.c[i] = (double(a[i]) + double(b[i])) * 0.5;
+	s.r2 = Dist2(s.c, a);
+	return s;
+}
+
+// Smallest sphere with all three points on its surface
+inline Sphere FromThree(const float *a, const float *b, const float *c)
+{
+	double u[3], v[3], w[3];
+	for (int i = 0; i < 3; ++i) {
+		u[i] = double(b[i]) - a[i];
+		v[i] = double(c[i]) - a[i];
+	}
+	w[0] = u[1] * v[2] - u[2] * v[1];
+	w[1] = u[2] * v[0] - u[0] * v[2];
+	w[2] = u[0] * v[1] - u[1] * v[0];
+	double ww = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+	double uu = u[0] * u[0] + u[1] * u[1] + u[2] * u[2];
+	double vv = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	if (ww <= 1e-18 * uu * vv) {
+		// collinear so the farthest pair spans the sphere
+		Sphere ab = FromTwo(a, b), ac = FromTwo(a, c), bc = FromTwo(b, c);
+		if (ab.r2 >= ac.r2 && ab.r2 >= bc.r2) return ab;
+		return (ac.r2 >= bc.r2) ? ac : bc;
+	}
+	// center = a + ((uu * v - vv * u) x w) / (2 * ww)
+	double t[3];
+	for (int i = 0; i < 3; ++i)
+		t[i] = uu * v[i] - vv * u[i];
+	Sphere s;
+	s.c[0] = a[0] + (t[1] * w[2] - t[2] * w[1]) / (2.0 * ww);
+	s.c[1] = a[1] + (t[2] * w[0] - t[0] * w[2]) / (2.0 * ww);
+	s.c[2] = a[2] + (t[0] * w[1] - t[1] * w[0]) / (2.0 * ww);
+	s.r2 = Dist2(s.c, a);
+	return s;
+}
+
+// Sphere with all four points on its surface
+inline Sphere FromFour(const float *a, const float *b, const float *c, const float *d)
+{
+	double m[3][3], rhs[3];
+	const float *p[3] = { b, c, d };
+	for (int r = 0; r < 3; ++r) {
+		for (int i = 0; i < 3; ++i)
+			m[r][i] = double(p[r][i]) - a[i];
+		rhs[r] = 0.5 * (m[r][0] * m[r][0] + m[r][1] * m[r][1] + m[r][2] * m[r][2]);
+	}
+	double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		- m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+		+ m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	double scale = (rhs[0] + rhs[1] + rhs[2]);
+	if (fabs(det) <= 1e-12 * scale * sqrt(scale)) {
+		// coplanar so use the smallest triangle sphere that holds all four
+		const float *q[4] = { a, b, c, d };
+		Sphere best = { { 0.0, 0.0, 0.0 }, DBL_MAX };
+		for (int skip = 0; skip < 4; ++skip) {
+			const float *t[3]; int n = 0;
+			for (int i = 0; i < 4; ++i) if (i != skip) t[n++] = q[i];
+			Sphere s = FromThree(t[0], t[1], t[2]);
+			if (s.r2 < best.r2 && Contains(s, q[skip]))
+				best = s;
+		}
+		return (best.r2 != DBL_MAX) ? best : FromThree(a, b, c);
+	}
+	// Cramer's rule
+	double x[3];
+	for (int k = 0; k < 3; ++k) {
+		double n[3][3];
+		for (int r = 0; r < 3; ++r)
+			for (int i = 0; i < 3; ++i)
+				n[r][i] = (i == k) ? rhs[r] : m[r][i];
+		x[k] = (n[0][0] * (n[1][1] * n[2][2] - n[1][2] * n[2][1])
+			- n[0][1] * (n[1][0] * n[2][2] - n[1][2] * n[2][0])
+			+ n[0][2] * (n[1][0] * n[2][1] - n[1][1] * n[2][0])) / det;
+	}
+	Sphere s;
+	for (int i = 0; i < 3; ++i)
+		s.c[i] = a[i] + x[i];
+	s.r2 = Dist2(s.c, a);
+	return s;
+}
+
+// Streams the points once, tracking min and max of all three axes together.
+//   With SSE four packed points are read as three 16 byte loads.
+inline void CalcBox(const float *pts, size_t n, BoundingVolume& bv)
+{
+	float lo[3] = { pts[0], pts[1], pts[2] };
+	float hi[3] = { pts[0], pts[1], pts[2] };
+	size_t i = 0;
+#ifdef BOUNDS_SSE
+	if (n >= 4) {
+		// lanes hold [x y z x] [y z x y] [z x y z] of each group of four points
+		__m128 mn0 = _mm_loadu_ps(pts), mn1 = _mm_loadu_ps(pts + 4), mn2 = _mm_loadu_ps(pts + 8);
+		__m128 mx0 = mn0, mx1 = mn1, mx2 = mn2;
+		for (i = 4; i + 4 <= n; i += 4) {
+			const float *p = pts + i * 3;
+			__m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+			mn0 = _mm_min_ps(mn0, a); mx0 = _mm_max_ps(mx0, a);
+			mn1 = _mm_min_ps(mn1, b); mx1 = _mm_max_ps(mx1, b);
+			mn2 = _mm_min_ps(mn2, c); mx2 = _mm_max_ps(mx2, c);
+		}
+		float m[12], x[12];
+		_mm_storeu_ps(m, mn0); _mm_storeu_ps(m + 4, mn1); _mm_storeu_ps(m + 8, mn2);
+		_mm_storeu_ps(x, mx0); _mm_storeu_ps(x + 4, mx1); _mm_storeu_ps(x + 8, mx2);
+		for (int k = 0; k < 12; ++k) {
+			if (m[k] < lo[k % 3]) lo[k % 3] = m[k];
+			if (x[k] > hi[k % 3]) hi[k % 3] = x[k];
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		const float *p = pts + i * 3;
+		for (int k = 0; k < 3; ++k) {
+			if (p[k] < lo[k]) lo[k] = p[k];
+			if (p[k] > hi[k]) hi[k] = p[k];
+		}
+	}
+	for (int k = 0; k < 3; ++k) {
+		bv.lows[k] = lo[k];
+		bv.highs[k] = hi[k];
+	}
+}
+
+// Minimal enclosing sphere by Welzl's algorithm in its incremental form.
+//   Points are visited in a fixed pseudo random order, which keeps the
+//   expected cost linear and the result reproducible between exports.
+inline void CalcSphere(const float *pts, size_t n, BoundingVolume& bv)
+{
+	std::vector<unsigned> order(n);
+	for (size_t i = 0; i < n; ++i)
+		order[i] = unsigned(i);
+	unsigned seed = 0x9E3779B9u;
+	for (size_t i = n; i > 1; --i) {
+		seed = seed * 1664525u + 1013904223u;
+		size_t j = size_t(seed >> 8) % i;
+		unsigned t = order[i - 1]; order[i - 1] = order[j]; order[j] = t;
+	}
+
+#define BOUNDS_PT(k) (pts + size_t(order[k]) * 3)
+	Sphere s = FromPoint(BOUNDS_PT(0));
+	for (size_t i = 1; i < n; ++i) {
+		if (Contains(s, BOUNDS_PT(i))) continue;
+		s = FromPoint(BOUNDS_PT(i));
+		for (size_t j = 0; j < i; ++j) {
+			if (Contains(s, BOUNDS_PT(j))) continue;
+			s = FromTwo(BOUNDS_PT(i), BOUNDS_PT(j));
+			for (size_t k = 0; k < j; ++k) {
+				if (Contains(s, BOUNDS_PT(k))) continue;
+				s = FromThree(BOUNDS_PT(i), BOUNDS_PT(j), BOUNDS_PT(k));
+				for (size_t l = 0; l < k; ++l) {
+					if (Contains(s, BOUNDS_PT(l))) continue;
+					s = FromFour(BOUNDS_PT(i), BOUNDS_PT(j), BOUNDS_PT(k), BOUNDS_PT(l));
+				}
+			}
+		}
+	}
+#undef BOUNDS_PT
+
+	// measure the radius from the rounded center so no point is left outside
+	for (int k = 0; k < 3; ++k)
+		bv.center[k] = float(s.c[k]);
+	float r2 = 0.0f;
+	for (size_t i = 0; i < n; ++i) {
+		const float *p = pts + i * 3;
+		float dx = p[0] - bv.center[0], dy = p[1] - bv.center[1], dz = p[2] - bv.center[2];
+		float d2 = dx * dx + dy * dy + dz * dz;
+		if (d2 > r2) r2 = d2;
+	}
+	bv.radius = sqrtf(r2);
+}
+
+} // namespace BoundsDetail
+
+// Computes the axis aligned box and minimal bounding sphere of the points.
+//   When sphere is false only the box pass runs and the center is its middle.
+template<typename P>
+void CalcBoundingVolume(const P* pts, size_t n, BoundingVolume& bv, bool sphere = true)
+{
+	static_assert(sizeof(P) == 3 * sizeof(float), "points must be three packed floats");
+	if (n == 0) {
+		for (int k = 0; k < 3; ++k)
+			bv.lows[k] = bv.highs[k] = bv.center[k] = 0.0f;
+		bv.radius = 0.0f;
+		return;
+	}
+	const float *fp = reinterpret_cast<const float*>(pts);
+	BoundsDetail::CalcBox(fp, n, bv);
+	if (sphere) {
+		BoundsDetail::CalcSphere(fp, n, bv);
+	}
+	else {
+		for (int k = 0; k < 3; ++k)
+			bv.center[k] = (bv.lows[k] + bv.highs[k]) / 2.0f;
+		bv.radius = 0.0f;
+	}
+}
+
+template<typename P>
+void CalcBoundingVolume(const std::vector<P>& pts, BoundingVolume& bv, bool sphere = true)
+{
+	CalcBoundingVolume(pts.empty() ? (const P*)nullptr : &pts[0], pts.size(), bv, sphere);
+}
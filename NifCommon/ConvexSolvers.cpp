@@ -0,0 +1,975 @@
+/**********************************************************************
+*<
+FILE: ConvexSolvers.cpp
+
+DESCRIPTION:	Convex hull, oriented box, capsule and mass property solvers
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "ConvexSolvers.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+struct Vec3
+{
+	double x, y, z;
+
+	Vec3() : x(0.0), y(0.0), z(0.0) {}
+	Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+	explicit Vec3(const float *p) : x(p[0]), y(p[1]), z(p[2]) {}
+
+	Vec3 operator+(const Vec3 &o) const { return Vec3(x + o.x, y + o.y, z + o.z); }
+	Vec3 operator-(const Vec3 &o) const { return Vec3(x - o.x, y - o.y, z - o.z); }
+	Vec3 operator*(double s) const { return Vec3(x * s, y * s, z * s); }
+	double operator[](int k) const { return (k == 0) ? x : (k == 1) ? y : z; }
+};
+
+inline double Dot(const Vec3 &a, const Vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3 &a, const Vec3 &b) { return Vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+inline double Length(const Vec3 &a) { return sqrt(Dot(a, a)); }
+inline Vec3 Normalize(const Vec3 &a) { double l = Length(a); return (l > 0.0) ? a * (1.0 / l) : Vec3(0.0, 0.0, 1.0); }
+
+// Any two unit vectors completing a right handed basis with n
+void MakeBasis(const Vec3 &n, Vec3 &u, Vec3 &v)
+{
+	u = (fabs(n.x) < 0.6) ? Vec3(1.0, 0.0, 0.0) : (fabs(n.y) < 0.6) ? Vec3(0.0, 1.0, 0.0) : Vec3(0.0, 0.0, 1.0);
+	u = Normalize(u - n * Dot(u, n));
+	v = Cross(n, u);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Quickhull
+
+// Points are snapped to a grid of this many bits per axis for the plane
+//   tests.  Coordinates then differ by less than 2^20, plane normals stay
+//   below 2^42 and the side tests below 3 * 2^61, so they are exact in 64
+//   bit integers and the hull never sees an inconsistent answer.
+const int HullGridBits = 20;
+
+struct HullFace
+{
+	int v[3];
+	long long normal[3];
+	std::vector<int> outside;
+	int furthest;
+	long long furthestDist;
+	bool alive;
+};
+
+class QuickHull
+{
+public:
+	QuickHull(const float *pts, size_t n);
+
+	bool Build(std::vector<int> &tris, size_t maxVerts);
+
+private:
+	typedef unsigned long long EdgeKey;
+	static EdgeKey Key(int a, int b) { return (EdgeKey(unsigned(a)) << 32) | unsigned(b); }
+
+	const long long *Grid(int i) const { return &grid[size_t(i) * 3]; }
+	long long Side(const HullFace &f, int i) const;
+	double Distance(const HullFace &f, int i) const;
+	void Normal(int a, int b, int c, long long normal[3]) const;
+	int AddFace(int a, int b, int c);
+	void Assign(int i, const int *candidates, size_t count);
+
+	const float *pts;
+	size_t n;
+	std::vector<long long> grid;
+	std::vector<HullFace> faces;
+	std::unordered_map<EdgeKey, int> edges; // directed edge to the face that owns it
+};
+
+// The snap is per axis; it is affine so it does not change which points
+//   form the hull, only how finely they are told apart.
+QuickHull::QuickHull(const float *pts, size_t n) : pts(pts), n(n), grid(n * 3)
+{
+	if (n == 0)
+		return;
+	double lo[3], hi[3];
+	for (int k = 0; k < 3; ++k)
+		lo[k] = hi[k] = pts[k];
+	for (size_t i = 1; i < n; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = std::min(lo[k], double(pts[i * 3 + k]));
+			hi[k] = std::max(hi[k], double(pts[i * 3 + k]));
+		}
+	}
+	for (int k = 0; k < 3; ++k) {
+		// a power of two scale keeps inputs that already sit on a coarser grid
+		//   exact, so their collinear and coplanar points stay that way
+		double scale = 0.0;
+		if (hi[k] > lo[k]) {
+			int e;
+			frexp(double((1 << HullGridBits) - 1) / (hi[k] - lo[k]), &e);
+			scale = ldexp(1.0, e - 1);
+		}
+		for (size_t i = 0; i < n; ++i)
+			grid[i * 3 + k] = (long long)floor((pts[i * 3 + k] - lo[k]) * scale + 0.5);
+	}
+}
+
+void QuickHull::Normal(int a, int b, int c, long long normal[3]) const
+{
+	const long long *pa = Grid(a), *pb = Grid(b), *pc = Grid(c);
+	long long u[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+	long long v[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+	normal[0] = u[1] * v[2] - u[2] * v[1];
+	normal[1] = u[2] * v[0] - u[0] * v[2];
+	normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// Positive above the face, proportional to the distance
+long long QuickHull::Side(const HullFace &f, int i) const
+{
+	const long long *p = Grid(i), *a = Grid(f.v[0]);
+	return f.normal[0] * (p[0] - a[0]) + f.normal[1] * (p[1] - a[1]) + f.normal[2] * (p[2] - a[2]);
+}
+
+// Distance above the face in the original coordinates
+double QuickHull::Distance(const HullFace &f, int i) const
+{
+	Vec3 a(pts + f.v[0] * 3), b(pts + f.v[1] * 3), c(pts + f.v[2] * 3);
+	return Dot(Normalize(Cross(b - a, c - a)), Vec3(pts + size_t(i) * 3) - a);
+}
+
+int QuickHull::AddFace(int a, int b, int c)
+{
+	HullFace f;
+	f.v[0] = a; f.v[1] = b; f.v[2] = c;
+	Normal(a, b, c, f.normal);
+	f.furthest = -1;
+	f.furthestDist = 0;
+	f.alive = true;
+	int idx = int(faces.size());
+	faces.push_back(f);
+	edges[Key(a, b)] = idx;
+	edges[Key(b, c)] = idx;
+	edges[Key(c, a)] = idx;
+	return idx;
+}
+
+// Gives the point to the first face it lies outside of; points inside all
+//   of them are interior to the hull and dropped.
+void QuickHull::Assign(int i, const int *candidates, size_t count)
+{
+	for (size_t j = 0; j < count; ++j) {
+		HullFace &f = faces[candidates[j]];
+		long long d = Side(f, i);
+		if (d > 0) {
+			f.outside.push_back(i);
+			if (d > f.furthestDist) {
+				f.furthestDist = d;
+				f.furthest = i;
+			}
+			return;
+		}
+	}
+}
+
+bool QuickHull::Build(std::vector<int> &tris, size_t maxVerts)
+{
+	tris.clear();
+	if (n < 4)
+		return false;
+
+	// initial tetrahedron from the extreme points
+	int ext[6] = { 0, 0, 0, 0, 0, 0 };
+	for (size_t i = 1; i < n; ++i) {
+		const long long *p = Grid(int(i));
+		for (int k = 0; k < 3; ++k) {
+			if (p[k] < Grid(ext[k])[k]) ext[k] = int(i);
+			if (p[k] > Grid(ext[k + 3])[k]) ext[k + 3] = int(i);
+		}
+	}
+	int i0 = 0, i1 = 0;
+	long long best = 0;
+	for (int k = 0; k < 3; ++k) {
+		const long long *a = Grid(ext[k]), *b = Grid(ext[k + 3]);
+		long long d = (b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]);
+		if (d > best) { best = d; i0 = ext[k]; i1 = ext[k + 3]; }
+	}
+	if (best == 0)
+		return false;
+
+	int i2 = -1;
+	double area = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		long long nrm[3];
+		Normal(i0, i1, int(i), nrm);
+		double a = double(nrm[0]) * nrm[0] + double(nrm[1]) * nrm[1] + double(nrm[2]) * nrm[2];
+		if (a > area) { area = a; i2 = int(i); }
+	}
+	if (i2 < 0)
+		return false;
+
+	HullFace base;
+	base.v[0] = i0; base.v[1] = i1; base.v[2] = i2;
+	Normal(i0, i1, i2, base.normal);
+	int i3 = -1;
+	long long height = 0, side = 0;
+	for (size_t i = 0; i < n; ++i) {
+		long long d = Side(base, int(i));
+		if (d > height || -d > height) { height = (d > 0) ? d : -d; i3 = int(i); side = d; }
+	}
+	if (i3 < 0)
+		return false;
+
+	// orient the base away from the apex; the other three faces share its
+	//   edges in reverse so the whole tetrahedron winds consistently
+	if (side > 0)
+		std::swap(i1, i2);
+	faces.reserve(n * 2);
+	AddFace(i0, i1, i2);
+	AddFace(i1, i0, i3);
+	AddFace(i2, i1, i3);
+	AddFace(i0, i2, i3);
+
+	int initial[4] = { 0, 1, 2, 3 };
+	for (size_t i = 0; i < n; ++i) {
+		if (int(i) != i0 && int(i) != i1 && int(i) != i2 && int(i) != i3)
+			Assign(int(i), initial, 4);
+	}
+
+	std::vector<int> pending;
+	for (int f = 0; f < 4; ++f) {
+		if (!faces[f].outside.empty())
+			pending.push_back(f);
+	}
+
+	std::vector<char> state; // 0 untested, 1 visible, 2 hidden
+	std::vector<int> visible, touched, horizon, created, orphans;
+	std::unordered_map<int, int> loop;
+	size_t numVerts = 4;
+	while (!pending.empty() && (maxVerts == 0 || numVerts < maxVerts)) {
+		if (maxVerts != 0) {
+			// with a budget take the point furthest from the hull first, so
+			//   stopping early leaves the closest approximation
+			size_t pick = pending.size() - 1;
+			double furthest = -1.0;
+			for (size_t j = 0; j < pending.size(); ++j) {
+				const HullFace &f = faces[pending[j]];
+				if (!f.alive || f.outside.empty())
+					continue;
+				double d = Distance(f, f.furthest);
+				if (d > furthest) { furthest = d; pick = j; }
+			}
+			std::swap(pending[pick], pending.back());
+		}
+		int fi = pending.back();
+		pending.pop_back();
+		if (!faces[fi].alive || faces[fi].outside.empty())
+			continue;
+		int eye = faces[fi].furthest;
+
+		// flood the faces the eye can see and collect the horizon edges,
+		//   each in the winding of its visible face.  Faces in the plane of
+		//   the eye are replaced too; keeping one would join a horizon edge
+		//   to an eye on its line in a face of zero area
+		state.resize(faces.size(), 0);
+		visible.clear(); touched.clear(); horizon.clear();
+		visible.push_back(fi);
+		touched.push_back(fi);
+		state[fi] = 1;
+		for (size_t q = 0; q < visible.size(); ++q) {
+			const HullFace &f = faces[visible[q]];
+			for (int k = 0; k < 3; ++k) {
+				int a = f.v[k], b = f.v[(k + 1) % 3];
+				int nb = edges[Key(b, a)];
+				if (state[nb] == 0) {
+					state[nb] = (Side(faces[nb], eye) >= 0) ? 1 : 2;
+					touched.push_back(nb);
+					if (state[nb] == 1)
+						visible.push_back(nb);
+				}
+				if (state[nb] == 2) {
+					horizon.push_back(a);
+					horizon.push_back(b);
+				}
+			}
+		}
+		for (size_t q = 0; q < touched.size(); ++q)
+			state[touched[q]] = 0;
+
+		// with exact tests the horizon is one simple loop; check anyway
+		//   rather than corrupt the mesh
+		bool simple = true;
+		loop.clear();
+		for (size_t h = 0; h < horizon.size() && simple; h += 2)
+			simple = loop.insert(std::make_pair(horizon[h], horizon[h + 1])).second;
+		if (simple) {
+			size_t steps = 0;
+			int v = horizon[0];
+			do {
+				std::unordered_map<int, int>::const_iterator next = loop.find(v);
+				if (next == loop.end())
+					break;
+				v = next->second;
+				++steps;
+			} while (v != horizon[0] && steps <= loop.size());
+			simple = (v == horizon[0] && steps == loop.size());
+		}
+		if (!simple)
+			return false;
+
+		orphans.clear();
+		for (size_t q = 0; q < visible.size(); ++q) {
+			HullFace &f = faces[visible[q]];
+			f.alive = false;
+			for (int k = 0; k < 3; ++k)
+				edges.erase(Key(f.v[k], f.v[(k + 1) % 3]));
+			for (size_t j = 0; j < f.outside.size(); ++j) {
+				if (f.outside[j] != eye)
+					orphans.push_back(f.outside[j]);
+			}
+			std::vector<int>().swap(f.outside);
+		}
+
+		created.clear();
+		for (size_t h = 0; h < horizon.size(); h += 2)
+			created.push_back(AddFace(horizon[h], horizon[h + 1], eye));
+		for (size_t j = 0; j < orphans.size(); ++j)
+			Assign(orphans[j], &created[0], created.size());
+		for (size_t j = 0; j < created.size(); ++j) {
+			if (!faces[created[j]].outside.empty())
+				pending.push_back(created[j]);
+		}
+		++numVerts;
+	}
+
+	// every face is kept, so each edge has its twin.  A face whose corners
+	//   round onto one line in the input has zero area there but not on the
+	//   grid; dropping it would open the surface at a T junction
+	for (size_t f = 0; f < faces.size(); ++f) {
+		const HullFace &face = faces[f];
+		if (face.alive)
+			tris.insert(tris.end(), face.v, face.v + 3);
+	}
+	return !tris.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Principal axes
+
+// Cyclic Jacobi rotations on a symmetric 3x3 matrix.  Columns of vec are
+//   the eigenvectors, sorted by decreasing eigenvalue.
+void SymmetricEigen(double a[3][3], double val[3], Vec3 vec[3])
+{
+	double v[3][3] = { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } };
+	for (int sweep = 0; sweep < 32; ++sweep) {
+		double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+		if (off <= 1e-15 * (fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2])) + DBL_MIN)
+			break;
+		for (int p = 0; p < 2; ++p) {
+			for (int q = p + 1; q < 3; ++q) {
+				if (a[p][q] == 0.0)
+					continue;
+				double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				double t = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+				double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+				for (int k = 0; k < 3; ++k) {
+					double akp = a[k][p], akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for (int k = 0; k < 3; ++k) {
+					double apk = a[p][k], aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for (int k = 0; k < 3; ++k) {
+					double vkp = v[k][p], vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+	int order[3] = { 0, 1, 2 };
+	std::sort(order, order + 3, [&](int i, int j) { return a[i][i] > a[j][j]; });
+	for (int k = 0; k < 3; ++k) {
+		val[k] = a[order[k]][order[k]];
+		vec[k] = Normalize(Vec3(v[0][order[k]], v[1][order[k]], v[2][order[k]]));
+	}
+}
+
+// Point set held as separate coordinate arrays so the projection loops
+//   below run over contiguous floats.
+struct PointSoA
+{
+	std::vector<float> x, y, z;
+
+	size_t size() const { return x.size(); }
+	Vec3 operator[](size_t i) const { return Vec3(x[i], y[i], z[i]); }
+};
+
+// The hull vertices, or all points when they do not span a volume
+void GatherHullPoints(const float *pts, size_t n, PointSoA &soa, std::vector<int> &tris)
+{
+	std::vector<int> used;
+	if (ComputeConvexHull(pts, n, tris)) {
+		used = tris;
+		std::sort(used.begin(), used.end());
+		used.erase(std::unique(used.begin(), used.end()), used.end());
+	} else {
+		used.resize(n);
+		for (size_t i = 0; i < n; ++i)
+			used[i] = int(i);
+	}
+	soa.x.resize(used.size()); soa.y.resize(used.size()); soa.z.resize(used.size());
+	for (size_t i = 0; i < used.size(); ++i) {
+		soa.x[i] = pts[used[i] * 3];
+		soa.y[i] = pts[used[i] * 3 + 1];
+		soa.z[i] = pts[used[i] * 3 + 2];
+	}
+}
+
+void PrincipalAxes(const PointSoA &soa, Vec3 axes[3])
+{
+	double mean[3] = { 0.0, 0.0, 0.0 };
+	size_t m = soa.size();
+	for (size_t i = 0; i < m; ++i) {
+		mean[0] += soa.x[i]; mean[1] += soa.y[i]; mean[2] += soa.z[i];
+	}
+	for (int k = 0; k < 3; ++k)
+		mean[k] /= double(m);
+	double c[3][3] = { { 0.0 } };
+	for (size_t i = 0; i < m; ++i) {
+		double d[3] = { soa.x[i] - mean[0], soa.y[i] - mean[1], soa.z[i] - mean[2] };
+		for (int r = 0; r < 3; ++r)
+			for (int s = r; s < 3; ++s)
+				c[r][s] += d[r] * d[s];
+	}
+	c[1][0] = c[0][1]; c[2][0] = c[0][2]; c[2][1] = c[1][2];
+	double val[3];
+	SymmetricEigen(c, val, axes);
+}
+
+// Projects the points onto the u v plane and the n axis
+void Project(const PointSoA &soa, const Vec3 &u, const Vec3 &v, const Vec3 &n,
+	std::vector<double> &pu, std::vector<double> &pv, double &nmin, double &nmax)
+{
+	size_t m = soa.size();
+	pu.resize(m); pv.resize(m);
+	nmin = DBL_MAX; nmax = -DBL_MAX;
+	for (size_t i = 0; i < m; ++i) {
+		double x = soa.x[i], y = soa.y[i], z = soa.z[i];
+		pu[i] = u.x * x + u.y * y + u.z * z;
+		pv[i] = v.x * x + v.y * y + v.z * z;
+		double t = n.x * x + n.y * y + n.z * z;
+		nmin = std::min(nmin, t);
+		nmax = std::max(nmax, t);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Oriented box
+
+struct Rect2
+{
+	double area;
+	double dir[2];        // unit direction of the first side
+	double center[2];
+	double size[2];
+};
+
+// Monotone chain, counter clockwise without collinear points
+void ConvexHull2(const std::vector<double> &pu, const std::vector<double> &pv, std::vector<double> &hull)
+{
+	size_t m = pu.size();
+	std::vector<int> order(m);
+	for (size_t i = 0; i < m; ++i)
+		order[i] = int(i);
+	std::sort(order.begin(), order.end(), [&](int a, int b) {
+		return (pu[a] != pu[b]) ? pu[a] < pu[b] : pv[a] < pv[b];
+	});
+	auto turn = [&](int o, int a, int b) {
+		return (pu[a] - pu[o]) * (pv[b] - pv[o]) - (pv[a] - pv[o]) * (pu[b] - pu[o]);
+	};
+	std::vector<int> h(2 * m);
+	size_t k = 0;
+	for (size_t i = 0; i < m; ++i) {
+		while (k >= 2 && turn(h[k - 2], h[k - 1], order[i]) <= 0.0) --k;
+		h[k++] = order[i];
+	}
+	for (size_t i = m - 1, lower = k + 1; i-- > 0; ) {
+		while (k >= lower && turn(h[k - 2], h[k - 1], order[i]) <= 0.0) --k;
+		h[k++] = order[i];
+	}
+	if (k > 1)
+		--k; // the last point repeats the first
+	hull.resize(k * 2);
+	for (size_t i = 0; i < k; ++i) {
+		hull[i * 2] = pu[h[i]];
+		hull[i * 2 + 1] = pv[h[i]];
+	}
+}
+
+// Minimum area rectangle of a convex polygon by rotating calipers.  Each
+//   edge in turn is flush with one side and the three other supporting
+//   vertices only ever advance, so the sweep is linear.
+void MinAreaRect(const std::vector<double> &hull, Rect2 &rect)
+{
+	size_t m = hull.size() / 2;
+	const double *q = &hull[0];
+	if (m < 3) {
+		double dx = (m == 2) ? q[2] - q[0] : 1.0, dy = (m == 2) ? q[3] - q[1] : 0.0;
+		double len = sqrt(dx * dx + dy * dy);
+		if (len <= 0.0) { dx = 1.0; dy = 0.0; len = 1.0; }
+		rect.area = 0.0;
+		rect.dir[0] = dx / len; rect.dir[1] = dy / len;
+		rect.size[0] = (m == 2) ? len : 0.0; rect.size[1] = 0.0;
+		rect.center[0] = (m == 2) ? (q[0] + q[2]) / 2.0 : q[0];
+		rect.center[1] = (m == 2) ? (q[1] + q[3]) / 2.0 : q[1];
+		return;
+	}
+
+	auto along = [&](size_t i, const double e[2]) { return q[i * 2] * e[0] + q[i * 2 + 1] * e[1]; };
+	rect.area = DBL_MAX;
+	size_t right = 0, top = 0, left = 0;
+	for (size_t i = 0; i < m; ++i) {
+		size_t j = (i + 1) % m;
+		double e[2] = { q[j * 2] - q[i * 2], q[j * 2 + 1] - q[i * 2 + 1] };
+		double len = sqrt(e[0] * e[0] + e[1] * e[1]);
+		if (len <= 0.0)
+			continue;
+		e[0] /= len; e[1] /= len;
+		double p[2] = { -e[1], e[0] };  // inward for counter clockwise winding
+		if (i == 0) {
+			for (size_t k = 1; k < m; ++k) {
+				if (along(k, e) > along(right, e)) right = k;
+				if (along(k, p) > along(top, p)) top = k;
+				if (along(k, e) < along(left, e)) left = k;
+			}
+		} else {
+			for (size_t s = 0; s < m && along((right + 1) % m, e) >= along(right, e); ++s) right = (right + 1) % m;
+			for (size_t s = 0; s < m && along((top + 1) % m, p) >= along(top, p); ++s) top = (top + 1) % m;
+			for (size_t s = 0; s < m && along((left + 1) % m, e) <= along(left, e); ++s) left = (left + 1) % m;
+		}
+		double base = along(i, p);
+		double w = along(right, e) - along(left, e), h = along(top, p) - base;
+		if (w * h < rect.area) {
+			double cu = (along(right, e) + along(left, e)) / 2.0, cp = base + h / 2.0;
+			rect.area = w * h;
+			rect.dir[0] = e[0]; rect.dir[1] = e[1];
+			rect.size[0] = w; rect.size[1] = h;
+			rect.center[0] = e[0] * cu + p[0] * cp;
+			rect.center[1] = e[1] * cu + p[1] * cp;
+		}
+	}
+}
+
+// Largest hull faces tried as box faces, and how close to parallel two of
+//   them may be before the second is skipped.  Coplanar points leave many
+//   slivers in the same plane and the remaining small faces rarely win.
+const size_t MaxBoxCandidates = 512;
+const double ParallelCosine = 0.99999;
+
+bool FitBox(const float *pts, const PointSoA &soa, const std::vector<int> &tris, OrientedBox &box)
+{
+	// candidate normals: principal axes, then hull faces by decreasing area
+	std::vector<Vec3> normals(3);
+	PrincipalAxes(soa, &normals[0]);
+	std::vector<std::pair<double, Vec3> > faces;
+	faces.reserve(tris.size() / 3);
+	for (size_t t = 0; t < tris.size(); t += 3) {
+		Vec3 a(pts + tris[t] * 3), b(pts + tris[t + 1] * 3), c(pts + tris[t + 2] * 3);
+		Vec3 cr = Cross(b - a, c - a);
+		double area = Length(cr);
+		if (area > 0.0)
+			faces.push_back(std::make_pair(area, cr * (1.0 / area)));
+	}
+	std::sort(faces.begin(), faces.end(),
+		[](const std::pair<double, Vec3> &a, const std::pair<double, Vec3> &b) { return a.first > b.first; });
+	for (size_t f = 0; f < faces.size() && normals.size() < MaxBoxCandidates + 3; ++f) {
+		bool parallel = false;
+		for (size_t c = 3; c < normals.size() && !parallel; ++c)
+			parallel = fabs(Dot(normals[c], faces[f].second)) > ParallelCosine;
+		if (!parallel)
+			normals.push_back(faces[f].second);
+	}
+
+	double bestVolume = DBL_MAX;
+	std::vector<double> pu, pv, hull2;
+	for (size_t c = 0; c < normals.size(); ++c) {
+		const Vec3 &nrm = normals[c];
+		Vec3 u, v;
+		MakeBasis(nrm, u, v);
+		double nmin, nmax;
+		Project(soa, u, v, nrm, pu, pv, nmin, nmax);
+		ConvexHull2(pu, pv, hull2);
+		Rect2 rect = {};
+		MinAreaRect(hull2, rect);
+		double volume = rect.area * (nmax - nmin);
+		// flat input has zero volume for several axes so prefer the larger area
+		if (volume < bestVolume || (volume == bestVolume && rect.area > 0.0)) {
+			bestVolume = volume;
+			Vec3 ax0 = Normalize(u * rect.dir[0] + v * rect.dir[1]);
+			Vec3 ax1 = Normalize(Cross(nrm, ax0));
+			Vec3 center = u * rect.center[0] + v * rect.center[1] + nrm * ((nmin + nmax) / 2.0);
+			const Vec3 axes[3] = { ax0, ax1, nrm };
+			const double size[3] = { rect.size[0], rect.size[1], nmax - nmin };
+			for (int k = 0; k < 3; ++k) {
+				box.center[k] = float(center[k]);
+				box.size[k] = float(size[k]);
+				for (int j = 0; j < 3; ++j)
+					box.axis[k][j] = float(axes[k][j]);
+			}
+		}
+	}
+	return bestVolume != DBL_MAX;
+}
+
+} // namespace
+
+bool ComputeConvexHull(const float *pts, size_t n, std::vector<int> &tris, size_t maxVerts)
+{
+	QuickHull hull(pts, n);
+	return hull.Build(tris, maxVerts);
+}
+
+bool ComputeOrientedBox(const float *pts, size_t n, OrientedBox &box)
+{
+	if (n == 0)
+		return false;
+
+	PointSoA soa;
+	std::vector<int> tris;
+	GatherHullPoints(pts, n, soa, tris);
+	return FitBox(pts, soa, tris, box);
+}
+
+// Hull triangles whose normals are within about half a degree of the first
+//   triangle of a facet join that facet.  Comparing with the first rather
+//   than with the neighbour keeps finely tessellated curves from merging.
+const double FacetCosine = 0.99996;
+
+// Triangles lower than this fraction of the largest coordinate are slivers
+//   along an edge or across a flat hull; float rounding of their corners
+//   decides their normal, so they join no facet.
+const double SliverHeight = 1.0 / 65536.0;
+
+namespace {
+
+// Corners and faces of the oriented box
+bool BoxPolytope(const float *pts, size_t n, std::vector<float> &verts, std::vector<float> &planes)
+{
+	verts.clear();
+	planes.clear();
+	OrientedBox box;
+	if (!ComputeOrientedBox(pts, n, box))
+		return false;
+	for (int c = 0; c < 8; ++c) {
+		for (int k = 0; k < 3; ++k) {
+			float p = box.center[k];
+			for (int a = 0; a < 3; ++a)
+				p += box.axis[a][k] * box.size[a] * (((c >> a) & 1) ? 0.5f : -0.5f);
+			verts.push_back(p);
+		}
+	}
+	for (int a = 0; a < 3; ++a) {
+		for (int sign = -1; sign <= 1; sign += 2) {
+			Vec3 nrm = Vec3(box.axis[a]) * double(sign);
+			planes.push_back(float(nrm.x));
+			planes.push_back(float(nrm.y));
+			planes.push_back(float(nrm.z));
+			planes.push_back(float(-(Dot(nrm, Vec3(box.center)) + box.size[a] / 2.0)));
+		}
+	}
+	return true;
+}
+
+bool BuildConvexPolytope(const float *pts, size_t n, size_t maxVerts, std::vector<float> &verts, std::vector<float> &planes)
+{
+	verts.clear();
+	planes.clear();
+	std::vector<int> tris;
+	if (!ComputeConvexHull(pts, n, tris, maxVerts))
+		return BoxPolytope(pts, n, verts, planes);
+
+	double magnitude = 0.0;
+	for (size_t i = 0; i < tris.size(); ++i) {
+		const float *p = pts + tris[i] * 3;
+		magnitude = std::max(magnitude, double(std::max(fabs(p[0]), std::max(fabs(p[1]), fabs(p[2])))));
+	}
+	double minHeight = magnitude * SliverHeight;
+
+	size_t ntris = tris.size() / 3;
+	std::vector<Vec3> normal(ntris);
+	std::vector<double> area(ntris);
+	std::unordered_map<unsigned long long, int> edges;
+	std::vector<int> order(ntris);
+	for (size_t t = 0; t < ntris; ++t) {
+		Vec3 a(pts + tris[t * 3] * 3), b(pts + tris[t * 3 + 1] * 3), c(pts + tris[t * 3 + 2] * 3);
+		Vec3 cr = Cross(b - a, c - a);
+		double edge = std::max(Length(b - a), std::max(Length(c - b), Length(a - c)));
+		area[t] = Length(cr);
+		if (area[t] <= minHeight * edge)
+			area[t] = 0.0;
+		normal[t] = Normalize(cr);
+		for (int k = 0; k < 3; ++k)
+			edges[(unsigned long long)unsigned(tris[t * 3 + k]) << 32 | unsigned(tris[t * 3 + (k + 1) % 3])] = int(t);
+		order[t] = int(t);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return area[a] > area[b]; });
+
+	// grow facets from the largest triangles across shared edges.  Triangles
+	//   without area have no direction of their own and stay out of them
+	std::vector<int> facet(ntris, -1);
+	std::vector<Vec3> facetNormals;
+	std::vector<int> stack;
+	for (size_t i = 0; i < ntris; ++i) {
+		int seed = order[i];
+		if (facet[seed] >= 0 || area[seed] == 0.0)
+			continue;
+		int id = int(facetNormals.size());
+		Vec3 sum;
+		facet[seed] = id;
+		stack.push_back(seed);
+		while (!stack.empty()) {
+			int t = stack.back();
+			stack.pop_back();
+			sum = sum + normal[t] * area[t];
+			for (int k = 0; k < 3; ++k) {
+				int a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+				std::unordered_map<unsigned long long, int>::const_iterator nb = edges.find((unsigned long long)unsigned(b) << 32 | unsigned(a));
+				if (nb != edges.end() && facet[nb->second] < 0 && area[nb->second] > 0.0
+					&& Dot(normal[nb->second], normal[seed]) > FacetCosine) {
+					facet[nb->second] = id;
+					stack.push_back(nb->second);
+				}
+			}
+		}
+		facetNormals.push_back(Normalize(sum));
+	}
+	// fewer facets cannot enclose anything; the hull is flat but for rounding
+	if (facetNormals.size() < 4)
+		return BoxPolytope(pts, n, verts, planes);
+
+	// a vertex is a corner when three or more facets meet there; the others
+	//   lie inside a facet or along an edge between two
+	std::unordered_map<int, std::vector<int> > vertexFacets;
+	for (size_t t = 0; t < ntris; ++t) {
+		if (facet[t] < 0)
+			continue;
+		for (int k = 0; k < 3; ++k) {
+			std::vector<int> &list = vertexFacets[tris[t * 3 + k]];
+			if (std::find(list.begin(), list.end(), facet[t]) == list.end())
+				list.push_back(facet[t]);
+		}
+	}
+	std::vector<int> hullVerts(tris), corners;
+	std::sort(hullVerts.begin(), hullVerts.end());
+	hullVerts.erase(std::unique(hullVerts.begin(), hullVerts.end()), hullVerts.end());
+	for (std::unordered_map<int, std::vector<int> >::const_iterator itr = vertexFacets.begin(); itr != vertexFacets.end(); ++itr) {
+		if (itr->second.size() >= 3)
+			corners.push_back(itr->first);
+	}
+	std::sort(corners.begin(), corners.end());
+	if (corners.size() < 4)
+		corners = hullVerts;
+	for (size_t i = 0; i < corners.size(); ++i)
+		verts.insert(verts.end(), pts + corners[i] * 3, pts + corners[i] * 3 + 3);
+
+	// the averaged normal is pushed out until no hull vertex is left outside
+	for (size_t f = 0; f < facetNormals.size(); ++f) {
+		const Vec3 &nrm = facetNormals[f];
+		double offset = -DBL_MAX;
+		for (size_t i = 0; i < hullVerts.size(); ++i)
+			offset = std::max(offset, Dot(nrm, Vec3(pts + hullVerts[i] * 3)));
+		planes.push_back(float(nrm.x));
+		planes.push_back(float(nrm.y));
+		planes.push_back(float(nrm.z));
+		planes.push_back(float(-offset));
+	}
+	return true;
+}
+
+} // namespace
+
+bool ComputeConvexPolytope(const float *pts, size_t n, size_t maxVerts, std::vector<float> &verts, std::vector<float> &planes)
+{
+	return BuildConvexPolytope(pts, n, maxVerts, verts, planes);
+}
+
+bool ComputeCapsule(const float *pts, size_t n, CapsuleFit &capsule)
+{
+	if (n == 0)
+		return false;
+
+	PointSoA soa;
+	std::vector<int> tris;
+	GatherHullPoints(pts, n, soa, tris);
+
+	Vec3 axes[3];
+	PrincipalAxes(soa, axes);
+	std::vector<Vec3> candidates(1, axes[0]);
+	OrientedBox box;
+	if (FitBox(pts, soa, tris, box)) {
+		int longest = (box.size[0] >= box.size[1] && box.size[0] >= box.size[2]) ? 0 : (box.size[1] >= box.size[2]) ? 1 : 2;
+		candidates.push_back(Vec3(box.axis[longest]));
+	}
+
+	double bestVolume = DBL_MAX;
+	std::vector<double> pu, pv;
+	size_t m = soa.size();
+	for (size_t c = 0; c < candidates.size(); ++c) {
+		const Vec3 &d = candidates[c];
+		Vec3 u, v;
+		MakeBasis(d, u, v);
+		double tmin, tmax;
+		Project(soa, u, v, d, pu, pv, tmin, tmax);
+
+		// minimal circle of the projection, incremental Welzl in a fixed
+		//   pseudo random order as in BoundingVolume.h
+		std::vector<unsigned> order(m);
+		for (size_t i = 0; i < m; ++i)
+			order[i] = unsigned(i);
+		unsigned seed = 0x9E3779B9u;
+		for (size_t i = m; i > 1; --i) {
+			seed = seed * 1664525u + 1013904223u;
+			size_t j = size_t(seed >> 8) % i;
+			std::swap(order[i - 1], order[j]);
+		}
+		auto inside = [&](double cx, double cy, double r2, unsigned i) {
+			double dx = pu[i] - cx, dy = pv[i] - cy;
+			return dx * dx + dy * dy <= r2 * (1.0 + 1e-7) + 1e-12;
+		};
+		double cx = pu[order[0]], cy = pv[order[0]], r2 = 0.0;
+		for (size_t i = 1; i < m; ++i) {
+			unsigned a = order[i];
+			if (inside(cx, cy, r2, a)) continue;
+			cx = pu[a]; cy = pv[a]; r2 = 0.0;
+			for (size_t j = 0; j < i; ++j) {
+				unsigned b = order[j];
+				if (inside(cx, cy, r2, b)) continue;
+				cx = (pu[a] + pu[b]) / 2.0; cy = (pv[a] + pv[b]) / 2.0;
+				r2 = (pu[a] - cx) * (pu[a] - cx) + (pv[a] - cy) * (pv[a] - cy);
+				for (size_t k = 0; k < j; ++k) {
+					unsigned e = order[k];
+					if (inside(cx, cy, r2, e)) continue;
+					double bx = pu[b] - pu[a], by = pv[b] - pv[a];
+					double ex = pu[e] - pu[a], ey = pv[e] - pv[a];
+					double den = 2.0 * (bx * ey - by * ex);
+					if (fabs(den) <= DBL_MIN)
+						continue;
+					double bb = bx * bx + by * by, ee = ex * ex + ey * ey;
+					double ox = (ey * bb - by * ee) / den, oy = (bx * ee - ex * bb) / den;
+					cx = pu[a] + ox; cy = pv[a] + oy; r2 = ox * ox + oy * oy;
+				}
+			}
+		}
+		double r = 0.0;
+		for (size_t i = 0; i < m; ++i)
+			r = std::max(r, (pu[i] - cx) * (pu[i] - cx) + (pv[i] - cy) * (pv[i] - cy));
+		r = sqrt(r);
+
+		// a point beyond an end must fit in its cap: |t - end| <= sqrt(r^2 - rho^2)
+		double lo = DBL_MAX, hi = -DBL_MAX;
+		for (size_t i = 0; i < m; ++i) {
+			double rho2 = (pu[i] - cx) * (pu[i] - cx) + (pv[i] - cy) * (pv[i] - cy);
+			double s = sqrt(std::max(r * r - rho2, 0.0));
+			double t = d.x * soa.x[i] + d.y * soa.y[i] + d.z * soa.z[i];
+			lo = std::min(lo, t + s);
+			hi = std::max(hi, t - s);
+		}
+		if (hi < lo)
+			lo = hi = (lo + hi) / 2.0;
+
+		const double pi = 3.14159265358979323846;
+		double volume = pi * r * r * (hi - lo) + 4.0 / 3.0 * pi * r * r * r;
+		if (volume < bestVolume) {
+			bestVolume = volume;
+			Vec3 base = u * cx + v * cy;
+			Vec3 p1 = base + d * lo, p2 = base + d * hi;
+			for (int k = 0; k < 3; ++k) {
+				capsule.pt1[k] = float(p1[k]);
+				capsule.pt2[k] = float(p2[k]);
+			}
+			capsule.radius = float(r);
+		}
+	}
+	return bestVolume != DBL_MAX;
+}
+
+// Polyhedral mass properties, D. Eberly.  Integrates 1, x, y, z, x^2, y^2,
+//   z^2, xy, yz and zx over the solid by the divergence theorem.
+bool ComputeMassProperties(const float *pts, size_t n, const int *tris, size_t ntris, bool bodyCoords, MassProperties &props)
+{
+	const double mult[10] = { 1.0 / 6.0, 1.0 / 24.0, 1.0 / 24.0, 1.0 / 24.0, 1.0 / 60.0, 1.0 / 60.0, 1.0 / 60.0, 1.0 / 120.0, 1.0 / 120.0, 1.0 / 120.0 };
+	double integral[10] = { 0.0 };
+
+	auto subexpressions = [](double w0, double w1, double w2, double &f1, double &f2, double &f3, double &g0, double &g1, double &g2) {
+		double temp0 = w0 + w1;
+		f1 = temp0 + w2;
+		double temp1 = w0 * w0;
+		double temp2 = temp1 + w1 * temp0;
+		f2 = temp2 + w2 * f1;
+		f3 = w0 * temp1 + w1 * temp2 + w2 * f2;
+		g0 = f2 + w0 * (f1 + w0);
+		g1 = f2 + w1 * (f1 + w1);
+		g2 = f2 + w2 * (f1 + w2);
+	};
+
+	for (size_t t = 0; t < ntris; ++t) {
+		const int *tri = tris + t * 3;
+		if (tri[0] < 0 || tri[1] < 0 || tri[2] < 0 || size_t(tri[0]) >= n || size_t(tri[1]) >= n || size_t(tri[2]) >= n)
+			return false;
+		Vec3 p0(pts + tri[0] * 3), p1(pts + tri[1] * 3), p2(pts + tri[2] * 3);
+		Vec3 d = Cross(p1 - p0, p2 - p0);
+
+		double f1x, f2x, f3x, g0x, g1x, g2x;
+		double f1y, f2y, f3y, g0y, g1y, g2y;
+		double f1z, f2z, f3z, g0z, g1z, g2z;
+		subexpressions(p0.x, p1.x, p2.x, f1x, f2x, f3x, g0x, g1x, g2x);
+		subexpressions(p0.y, p1.y, p2.y, f1y, f2y, f3y, g0y, g1y, g2y);
+		subexpressions(p0.z, p1.z, p2.z, f1z, f2z, f3z, g0z, g1z, g2z);
+
+		integral[0] += d.x * f1x;
+		integral[1] += d.x * f2x;
+		integral[2] += d.y * f2y;
+		integral[3] += d.z * f2z;
+		integral[4] += d.x * f3x;
+		integral[5] += d.y * f3y;
+		integral[6] += d.z * f3z;
+		integral[7] += d.x * (p0.y * g0x + p1.y * g1x + p2.y * g2x);
+		integral[8] += d.y * (p0.z * g0y + p1.z * g1y + p2.z * g2y);
+		integral[9] += d.z * (p0.x * g0z + p1.x * g1z + p2.x * g2z);
+	}
+	for (int i = 0; i < 10; ++i)
+		integral[i] *= mult[i];
+	if (integral[0] < 0.0) {
+		for (int i = 0; i < 10; ++i)
+			integral[i] = -integral[i];
+	}
+
+	double mass = integral[0];
+	if (mass <= 0.0)
+		return false;
+	double c[3] = { integral[1] / mass, integral[2] / mass, integral[3] / mass };
+	double xx = integral[5] + integral[6], yy = integral[4] + integral[6], zz = integral[4] + integral[5];
+	double xy = -integral[7], yz = -integral[8], xz = -integral[9];
+	if (bodyCoords) {
+		xx -= mass * (c[1] * c[1] + c[2] * c[2]);
+		yy -= mass * (c[2] * c[2] + c[0] * c[0]);
+		zz -= mass * (c[0] * c[0] + c[1] * c[1]);
+		xy += mass * c[0] * c[1];
+		yz += mass * c[1] * c[2];
+		xz += mass * c[2] * c[0];
+	}
+
+	props.mass = float(mass);
+	for (int k = 0; k < 3; ++k)
+		props.center[k] = float(c[k]);
+	props.inertia[0][0] = float(xx); props.inertia[0][1] = float(xy); props.inertia[0][2] = float(xz);
+	props.inertia[1][0] = float(xy); props.inertia[1][1] = float(yy); props.inertia[1][2] = float(yz);
+	props.inertia[2][0] = float(xz); props.inertia[2][1] = float(yz); props.inertia[2][2] = float(zz);
+	return true;
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+*<
+FILE: ConvexSolvers.h
+
+DESCRIPTION:	Convex hull, oriented box, capsule and mass property
+               solvers for collision authoring.  They work on packed
+               x y z float arrays, keep no global state and may be
+               called from several threads at once.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+struct OrientedBox
+{
+	float center[3];
+	float axis[3][3];    // right handed orthonormal axes
+	float size[3];       // full length along each axis
+};
+
+struct CapsuleFit
+{
+	float pt1[3];
+	float pt2[3];
+	float radius;
+};
+
+struct MassProperties
+{
+	float mass;          // volume at unit density
+	float center[3];
+	float inertia[3][3];
+};
+
+// Quickhull.  Writes three point indices per triangle, counter clockwise
+//   seen from outside, forming a closed surface.  A triangle has zero area
+//   only when its corners are exactly collinear in the input.  Returns false
+//   when the points do not span a volume.
+//   A non zero maxVerts stops the hull after that many vertices, adding the
+//   points furthest out first; the remaining points may lie outside it.
+bool ComputeConvexHull(const float *pts, size_t n, std::vector<int> &tris, size_t maxVerts = 0);
+
+// Hull reduced to its corner vertices and one plane per flat facet, as
+//   havok convex vertices shapes want them.  Planes are a b c d with
+//   a x + b y + c z + d <= 0 for every hull vertex.  Flat input gives the
+//   corners and faces of its oriented box.  maxVerts is as for the hull.
+bool ComputeConvexPolytope(const float *pts, size_t n, size_t maxVerts, std::vector<float> &verts, std::vector<float> &planes);
+
+// Minimum volume box from the hull face normals and principal axes, each
+//   paired with the minimum area rectangle of the projected hull found by
+//   rotating calipers.  Flat input gives a box of zero thickness.
+bool ComputeOrientedBox(const float *pts, size_t n, OrientedBox &box);
+
+// Capsule around the principal axis or the longest box axis, whichever is
+//   smaller.  The radius is the minimal circle of the points projected
+//   across the axis and the end points are pulled in as far as the caps allow.
+bool ComputeCapsule(const float *pts, size_t n, CapsuleFit &capsule);
+
+// Exact integrals over a closed triangle mesh (three indices per triangle).
+//   With bodyCoords the inertia is taken about the center of mass,
+//   otherwise about the origin.  Inward winding is corrected for.
+bool ComputeMassProperties(const float *pts, size_t n, const int *tris, size_t ntris, bool bodyCoords, MassProperties &props);
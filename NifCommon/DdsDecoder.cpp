@@ -0,0 +1,1074 @@
+/**********************************************************************
+*<
+FILE: DdsDecoder.cpp
+
+DESCRIPTION:	DDS header reader and BC1 to BC7 block decoder
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "DdsDecoder.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if !defined(NIF_DDS_NO_SSE) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+#  define NIF_DDS_SSE 1
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+const unsigned DDS_MAGIC = 0x20534444;   // "DDS "
+const unsigned DDS_HEADER_SIZE = 128;
+const unsigned DDS_DX10_HEADER_SIZE = 20;
+
+const unsigned DDSD_MIPMAPCOUNT = 0x20000;
+const unsigned DDPF_ALPHAPIXELS = 0x1;
+const unsigned DDPF_ALPHA = 0x2;
+const unsigned DDPF_FOURCC = 0x4;
+const unsigned DDPF_RGB = 0x40;
+const unsigned DDPF_LUMINANCE = 0x20000;
+
+inline unsigned MakeFourCC(char a, char b, char c, char d)
+{
+	return unsigned((unsigned char)a) | (unsigned((unsigned char)b) << 8)
+		| (unsigned((unsigned char)c) << 16) | (unsigned((unsigned char)d) << 24);
+}
+
+inline unsigned ReadU32(const unsigned char* p)
+{
+	return unsigned(p[0]) | (unsigned(p[1]) << 8) | (unsigned(p[2]) << 16) | (unsigned(p[3]) << 24);
+}
+
+inline unsigned long long ReadU64(const unsigned char* p)
+{
+	return (unsigned long long)ReadU32(p) | ((unsigned long long)ReadU32(p + 4) << 32);
+}
+
+inline unsigned char ClampByte(int v)
+{
+	return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Reads a 128 bit BC6H or BC7 block from the least significant bit up
+class BlockBits
+{
+public:
+	explicit BlockBits(const unsigned char* block) : lo(ReadU64(block)), hi(ReadU64(block + 8)), pos(0) {}
+
+	unsigned Read(unsigned count) {
+		if (count == 0)
+			return 0;
+		unsigned long long v;
+		if (pos >= 64)
+			v = hi >> (pos - 64);
+		else if (pos + count <= 64)
+			v = lo >> pos;
+		else
+			v = (lo >> pos) | (hi << (64 - pos));
+		pos += count;
+		return unsigned(v) & ((1u << count) - 1);
+	}
+
+	// Reads count bits with the first bit read as the most significant
+	unsigned ReadReversed(unsigned count) {
+		unsigned v = 0;
+		for (unsigned i = 0; i < count; ++i)
+			v = (v << 1) | Read(1);
+		return v;
+	}
+
+private:
+	unsigned long long lo, hi;
+	unsigned pos;
+};
+
+const int Weights2[4] = { 0, 21, 43, 64 };
+const int Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+const int Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline const int* WeightTable(unsigned indexBits)
+{
+	return indexBits == 2 ? Weights2 : (indexBits == 3 ? Weights3 : Weights4);
+}
+
+inline int Interpolate(int e0, int e1, int weight)
+{
+	return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// Bit i is set when pixel i belongs to the second subset
+const unsigned short Partitions2[64] = {
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+	0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+	0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+	0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+	0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+const unsigned char Partitions3[64][16] = {
+	{ 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 },
+	{ 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+	{ 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 },
+	{ 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+	{ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 },
+	{ 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+	{ 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 },
+	{ 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+	{ 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 },
+	{ 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+	{ 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 },
+	{ 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+	{ 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 },
+	{ 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+	{ 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 },
+	{ 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+	{ 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 },
+	{ 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+	{ 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 },
+	{ 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+	{ 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 },
+	{ 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+	{ 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 },
+	{ 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+	{ 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 },
+	{ 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+	{ 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 },
+	{ 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+	{ 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 },
+	{ 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+	{ 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 },
+	{ 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 },
+};
+
+// Pixels whose index is stored with one bit less: the second subset of a
+//   two subset partition, and the second and third of a three subset one.
+//   The first pixel is always an anchor.
+const unsigned char Anchors2[64] = {
+	15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15,
+	15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+	15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,
+	 6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15,
+};
+
+const unsigned char Anchors3a[64] = {
+	 3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,
+	 3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+	 8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,
+	 3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3,
+};
+
+const unsigned char Anchors3b[64] = {
+	15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8,
+	15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+	15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8,
+	15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8,
+};
+
+inline unsigned SubsetOf(unsigned subsets, unsigned partition, unsigned pixel)
+{
+	if (subsets == 2)
+		return (Partitions2[partition] >> pixel) & 1;
+	if (subsets == 3)
+		return Partitions3[partition][pixel];
+	return 0;
+}
+
+inline bool IsAnchor(unsigned subsets, unsigned partition, unsigned pixel)
+{
+	if (pixel == 0)
+		return true;
+	if (subsets == 2)
+		return pixel == Anchors2[partition];
+	if (subsets == 3)
+		return pixel == Anchors3a[partition] || pixel == Anchors3b[partition];
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC1 to BC5
+
+inline void Expand565(unsigned c, int rgb[3])
+{
+	int r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The colour half of BC1 to BC3.  Only BC1 switches to three colours and
+//   transparent black when the first endpoint is not the larger one.
+void DecodeColorBlock(const unsigned char* block, unsigned char* out, bool allowPunchThrough)
+{
+	unsigned c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+	int palette[4][4];
+	Expand565(c0, palette[0]);
+	Expand565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+	if (c0 > c1 || !allowPunchThrough) {
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+	else {
+		for (int c = 0; c < 3; ++c) {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[3][3] = 0;
+	}
+	unsigned indices = ReadU32(block + 4);
+#ifdef NIF_DDS_SSE
+	// Four pixels at a time: each lane masks out its own 2 bit index and
+	//   is compared against every palette slot shifted to the same place.
+	__m128i colors[4];
+	for (int k = 0; k < 4; ++k)
+		colors[k] = _mm_set1_epi32(palette[k][0] | (palette[k][1] << 8) | (palette[k][2] << 16) | (palette[k][3] << 24));
+	const __m128i slot1 = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+	const __m128i slot2 = _mm_setr_epi32(2, 2 << 2, 2 << 4, 2 << 6);
+	const __m128i slot3 = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+	for (int q = 0; q < 4; ++q, indices >>= 8) {
+		__m128i idx = _mm_and_si128(_mm_set1_epi32(int(indices)), slot3);
+		__m128i px = _mm_and_si128(_mm_cmpeq_epi32(idx, _mm_setzero_si128()), colors[0]);
+		px = _mm_or_si128(px, _mm_and_si128(_mm_cmpeq_epi32(idx, slot1), colors[1]));
+		px = _mm_or_si128(px, _mm_and_si128(_mm_cmpeq_epi32(idx, slot2), colors[2]));
+		px = _mm_or_si128(px, _mm_and_si128(_mm_cmpeq_epi32(idx, slot3), colors[3]));
+		_mm_storeu_si128((__m128i*)(out + q * 16), px);
+	}
+#else
+	for (int i = 0; i < 16; ++i, indices >>= 2) {
+		const int* p = palette[indices & 3];
+		out[i * 4 + 0] = (unsigned char)p[0];
+		out[i * 4 + 1] = (unsigned char)p[1];
+		out[i * 4 + 2] = (unsigned char)p[2];
+		out[i * 4 + 3] = (unsigned char)p[3];
+	}
+#endif
+}
+
+// The eight values of a BC3 alpha or BC4/BC5 channel block
+void DecodeAlphaPalette(const unsigned char* block, bool isSigned, int palette[8])
+{
+	if (isSigned) {
+		palette[0] = std::max(-127, int((signed char)block[0]));
+		palette[1] = std::max(-127, int((signed char)block[1]));
+	}
+	else {
+		palette[0] = block[0];
+		palette[1] = block[1];
+	}
+	if (palette[0] > palette[1]) {
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+	}
+	else {
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+		palette[6] = isSigned ? -127 : 0;
+		palette[7] = isSigned ? 127 : 255;
+	}
+	if (isSigned) {
+		for (int i = 0; i < 8; ++i)
+			palette[i] = ((palette[i] + 127) * 255 + 127) / 254;
+	}
+}
+
+#ifdef NIF_DDS_SSE
+// The 16 values of an alpha block packed into one register, ready to be
+//   spread over the pixels.  SSE2 has no byte shuffle, so the 3 bit
+//   lookups stay scalar; they are packed four to a word rather than
+//   stored as bytes and reloaded, which would stall store forwarding.
+__m128i DecodeAlphaValues(const unsigned char* block, bool isSigned)
+{
+	int palette[8];
+	DecodeAlphaPalette(block, isSigned, palette);
+	unsigned long long indices = ReadU64(block) >> 16;
+	int words[4];
+	for (int q = 0; q < 4; ++q) {
+		unsigned w = 0;
+		for (int i = 0; i < 4; ++i, indices >>= 3)
+			w |= unsigned(palette[indices & 7] & 0xFF) << (i * 8);
+		words[q] = int(w);
+	}
+	return _mm_setr_epi32(words[0], words[1], words[2], words[3]);
+}
+
+// Widens four bytes to the high byte of four 32 bit lanes
+inline __m128i SpreadToAlpha(__m128i values)
+{
+	__m128i zero = _mm_setzero_si128();
+	return _mm_unpacklo_epi16(zero, _mm_unpacklo_epi8(zero, values));
+}
+#else
+// BC3 alpha and BC4/BC5 channels: writes 16 values 4 bytes apart
+void DecodeAlphaBlock(const unsigned char* block, unsigned char* out, bool isSigned)
+{
+	int palette[8];
+	DecodeAlphaPalette(block, isSigned, palette);
+	unsigned long long indices = ReadU64(block) >> 16;
+	for (int i = 0; i < 16; ++i, indices >>= 3)
+		out[i * 4] = (unsigned char)palette[indices & 7];
+}
+#endif
+
+void DecodeBC1(const unsigned char* block, unsigned char* out)
+{
+	DecodeColorBlock(block, out, true);
+}
+
+void DecodeBC2(const unsigned char* block, unsigned char* out)
+{
+	DecodeColorBlock(block + 8, out, false);
+	for (int i = 0; i < 16; ++i) {
+		int a = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+		out[i * 4 + 3] = (unsigned char)((a << 4) | a);
+	}
+}
+
+void DecodeBC3(const unsigned char* block, unsigned char* out)
+{
+	DecodeColorBlock(block + 8, out, false);
+#ifdef NIF_DDS_SSE
+	__m128i alpha = DecodeAlphaValues(block, false);
+	const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+	for (int q = 0; q < 4; ++q, alpha = _mm_srli_si128(alpha, 4)) {
+		__m128i* px = (__m128i*)(out + q * 16);
+		_mm_storeu_si128(px, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(px), rgbMask), SpreadToAlpha(alpha)));
+	}
+#else
+	DecodeAlphaBlock(block, out + 3, false);
+#endif
+}
+
+void DecodeBC4(const unsigned char* block, unsigned char* out, bool isSigned)
+{
+#ifdef NIF_DDS_SSE
+	__m128i red = DecodeAlphaValues(block, isSigned);
+	__m128i rr = _mm_unpacklo_epi8(red, red), rr2 = _mm_unpackhi_epi8(red, red);
+	__m128i ga = _mm_or_si128(rr, _mm_set1_epi16(short(0xFF00))), ga2 = _mm_or_si128(rr2, _mm_set1_epi16(short(0xFF00)));
+	_mm_storeu_si128((__m128i*)(out + 0), _mm_unpacklo_epi16(rr, ga));
+	_mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi16(rr, ga));
+	_mm_storeu_si128((__m128i*)(out + 32), _mm_unpacklo_epi16(rr2, ga2));
+	_mm_storeu_si128((__m128i*)(out + 48), _mm_unpackhi_epi16(rr2, ga2));
+#else
+	DecodeAlphaBlock(block, out, isSigned);
+	for (int i = 0; i < 16; ++i) {
+		out[i * 4 + 1] = out[i * 4 + 2] = out[i * 4];
+		out[i * 4 + 3] = 255;
+	}
+#endif
+}
+
+// Two channel normal maps: blue is rebuilt as the unit Z of the normal.
+//   The SSE path uses the same single precision operations in the same
+//   order, so both builds give the same bytes.
+void DecodeBC5(const unsigned char* block, unsigned char* out, bool isSigned)
+{
+#ifdef NIF_DDS_SSE
+	__m128i red = DecodeAlphaValues(block, isSigned);
+	__m128i green = DecodeAlphaValues(block + 8, isSigned);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(2.0f / 255.0f), one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f), full = _mm_set1_ps(255.0f);
+	for (int q = 0; q < 4; ++q, red = _mm_srli_si128(red, 4), green = _mm_srli_si128(green, 4)) {
+		__m128i r = _mm_unpacklo_epi16(_mm_unpacklo_epi8(red, zero), zero);
+		__m128i g = _mm_unpacklo_epi16(_mm_unpacklo_epi8(green, zero), zero);
+		__m128 x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(r), scale), one);
+		__m128 y = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(g), scale), one);
+		__m128 zz = _mm_sub_ps(_mm_sub_ps(one, _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+		__m128 z = _mm_sqrt_ps(_mm_max_ps(_mm_setzero_ps(), zz));
+		__m128i b = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, half), half), full), half));
+		__m128i px = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_slli_epi32(b, 16));
+		_mm_storeu_si128((__m128i*)(out + q * 16), _mm_or_si128(px, _mm_set1_epi32(int(0xFF000000))));
+	}
+#else
+	DecodeAlphaBlock(block, out, isSigned);
+	DecodeAlphaBlock(block + 8, out + 1, isSigned);
+	for (int i = 0; i < 16; ++i) {
+		float x = out[i * 4 + 0] * (2.0f / 255.0f) - 1.0f;
+		float y = out[i * 4 + 1] * (2.0f / 255.0f) - 1.0f;
+		float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+		out[i * 4 + 2] = ClampByte(int((z * 0.5f + 0.5f) * 255.0f + 0.5f));
+		out[i * 4 + 3] = 255;
+	}
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC6H
+
+inline int SignExtend(int v, unsigned bits)
+{
+	int shift = 32 - int(bits);
+	return int(unsigned(v) << shift) >> shift;
+}
+
+float HalfToFloat(unsigned short h)
+{
+	unsigned sign = (h >> 15) & 1, exponent = (h >> 10) & 0x1F, mantissa = h & 0x3FF;
+	float v;
+	if (exponent == 0)
+		v = std::ldexp(float(mantissa), -24);
+	else if (exponent == 31)
+		v = 65504.0f;
+	else {
+		unsigned bits = ((exponent + 112) << 23) | (mantissa << 13);
+		memcpy(&v, &bits, sizeof(v));
+	}
+	return sign ? -v : v;
+}
+
+int UnquantizeBC6H(int comp, unsigned bits, bool isSigned)
+{
+	if (!isSigned) {
+		if (bits >= 15) return comp;
+		if (comp == 0) return 0;
+		if (comp == (1 << bits) - 1) return 0xFFFF;
+		return ((comp << 16) + 0x8000) >> bits;
+	}
+	if (bits >= 16) return comp;
+	bool negative = comp < 0;
+	if (negative) comp = -comp;
+	int unq;
+	if (comp == 0) unq = 0;
+	else if (comp >= (1 << (bits - 1)) - 1) unq = 0x7FFF;
+	else unq = ((comp << 15) + 0x4000) >> (bits - 1);
+	return negative ? -unq : unq;
+}
+
+unsigned short FinishBC6H(int comp, bool isSigned)
+{
+	if (!isSigned)
+		return (unsigned short)((comp * 31) >> 6);
+	if (comp < 0)
+		return (unsigned short)(0x8000 | (((-comp) * 31) >> 5));
+	return (unsigned short)((comp * 31) >> 5);
+}
+
+void DecodeBC6H(const unsigned char* block, unsigned char* out, bool isSigned)
+{
+	BlockBits bits(block);
+	unsigned mode = bits.Read(2);
+	if (mode > 1)
+		mode |= bits.Read(3) << 2;
+
+	int r[4] = { 0 }, g[4] = { 0 }, b[4] = { 0 };
+	auto take = [&](int& dst, unsigned count, unsigned shift) { dst |= int(bits.Read(count)) << shift; };
+	auto takeReversed = [&](int& dst, unsigned count, unsigned shift) { dst |= int(bits.ReadReversed(count)) << shift; };
+
+	// Endpoint bits are scattered differently in each mode; the layouts
+	//   follow the BC6H format description.
+	unsigned precision, deltaBits[3] = { 0, 0, 0 };
+	bool transformed = true;
+	switch (mode) {
+	case 0x00:
+		take(g[2], 1, 4); take(b[2], 1, 4); take(b[3], 1, 4);
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 5, 0); take(g[3], 1, 4); take(g[2], 4, 0);
+		take(g[1], 5, 0); take(b[3], 1, 0); take(g[3], 4, 0);
+		take(b[1], 5, 0); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 5, 0); take(b[3], 1, 2); take(r[3], 5, 0); take(b[3], 1, 3);
+		precision = 10, deltaBits[0] = 5, deltaBits[1] = 5, deltaBits[2] = 5;
+		break;
+	case 0x01:
+		take(g[2], 1, 5); take(g[3], 1, 4); take(g[3], 1, 5);
+		take(r[0], 7, 0); take(b[3], 1, 0); take(b[3], 1, 1); take(b[2], 1, 4);
+		take(g[0], 7, 0); take(b[2], 1, 5); take(b[3], 1, 2); take(g[2], 1, 4);
+		take(b[0], 7, 0); take(b[3], 1, 3); take(b[3], 1, 5); take(b[3], 1, 4);
+		take(r[1], 6, 0); take(g[2], 4, 0); take(g[1], 6, 0); take(g[3], 4, 0);
+		take(b[1], 6, 0); take(b[2], 4, 0); take(r[2], 6, 0); take(r[3], 6, 0);
+		precision = 7, deltaBits[0] = 6, deltaBits[1] = 6, deltaBits[2] = 6;
+		break;
+	case 0x02:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 5, 0); take(r[0], 1, 10); take(g[2], 4, 0);
+		take(g[1], 4, 0); take(g[0], 1, 10); take(b[3], 1, 0); take(g[3], 4, 0);
+		take(b[1], 4, 0); take(b[0], 1, 10); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 5, 0); take(b[3], 1, 2); take(r[3], 5, 0); take(b[3], 1, 3);
+		precision = 11, deltaBits[0] = 5, deltaBits[1] = 4, deltaBits[2] = 4;
+		break;
+	case 0x06:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 4, 0); take(r[0], 1, 10); take(g[3], 1, 4); take(g[2], 4, 0);
+		take(g[1], 5, 0); take(g[0], 1, 10); take(g[3], 4, 0);
+		take(b[1], 4, 0); take(b[0], 1, 10); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 4, 0); take(b[3], 1, 0); take(b[3], 1, 2); take(r[3], 4, 0);
+		take(g[2], 1, 4); take(b[3], 1, 3);
+		precision = 11, deltaBits[0] = 4, deltaBits[1] = 5, deltaBits[2] = 4;
+		break;
+	case 0x0A:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 4, 0); take(r[0], 1, 10); take(b[2], 1, 4); take(g[2], 4, 0);
+		take(g[1], 4, 0); take(g[0], 1, 10); take(b[3], 1, 0); take(g[3], 4, 0);
+		take(b[1], 5, 0); take(b[0], 1, 10); take(b[2], 4, 0);
+		take(r[2], 4, 0); take(b[3], 1, 1); take(b[3], 1, 2); take(r[3], 4, 0);
+		take(b[3], 1, 4); take(b[3], 1, 3);
+		precision = 11, deltaBits[0] = 4, deltaBits[1] = 4, deltaBits[2] = 5;
+		break;
+	case 0x0E:
+		take(r[0], 9, 0); take(b[2], 1, 4); take(g[0], 9, 0); take(g[2], 1, 4);
+		take(b[0], 9, 0); take(b[3], 1, 4); take(r[1], 5, 0); take(g[3], 1, 4);
+		take(g[2], 4, 0); take(g[1], 5, 0); take(b[3], 1, 0); take(g[3], 4, 0);
+		take(b[1], 5, 0); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 5, 0); take(b[3], 1, 2); take(r[3], 5, 0); take(b[3], 1, 3);
+		precision = 9, deltaBits[0] = 5, deltaBits[1] = 5, deltaBits[2] = 5;
+		break;
+	case 0x12:
+		take(r[0], 8, 0); take(g[3], 1, 4); take(b[2], 1, 4);
+		take(g[0], 8, 0); take(b[3], 1, 2); take(g[2], 1, 4);
+		take(b[0], 8, 0); take(b[3], 1, 3); take(b[3], 1, 4);
+		take(r[1], 6, 0); take(g[2], 4, 0); take(g[1], 5, 0); take(b[3], 1, 0);
+		take(g[3], 4, 0); take(b[1], 5, 0); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 6, 0); take(r[3], 6, 0);
+		precision = 8, deltaBits[0] = 6, deltaBits[1] = 5, deltaBits[2] = 5;
+		break;
+	case 0x16:
+		take(r[0], 8, 0); take(b[3], 1, 0); take(b[2], 1, 4);
+		take(g[0], 8, 0); take(g[2], 1, 5); take(g[2], 1, 4);
+		take(b[0], 8, 0); take(g[3], 1, 5); take(b[3], 1, 4);
+		take(r[1], 5, 0); take(g[3], 1, 4); take(g[2], 4, 0); take(g[1], 6, 0);
+		take(g[3], 4, 0); take(b[1], 5, 0); take(b[3], 1, 1); take(b[2], 4, 0);
+		take(r[2], 5, 0); take(b[3], 1, 2); take(r[3], 5, 0); take(b[3], 1, 3);
+		precision = 8, deltaBits[0] = 5, deltaBits[1] = 6, deltaBits[2] = 5;
+		break;
+	case 0x1A:
+		take(r[0], 8, 0); take(b[3], 1, 1); take(b[2], 1, 4);
+		take(g[0], 8, 0); take(b[2], 1, 5); take(g[2], 1, 4);
+		take(b[0], 8, 0); take(b[3], 1, 5); take(b[3], 1, 4);
+		take(r[1], 5, 0); take(g[3], 1, 4); take(g[2], 4, 0); take(g[1], 5, 0);
+		take(b[3], 1, 0); take(g[3], 4, 0); take(b[1], 6, 0); take(b[2], 4, 0);
+		take(r[2], 5, 0); take(b[3], 1, 2); take(r[3], 5, 0); take(b[3], 1, 3);
+		precision = 8, deltaBits[0] = 5, deltaBits[1] = 5, deltaBits[2] = 6;
+		break;
+	case 0x1E:
+		take(r[0], 6, 0); take(g[3], 1, 4); take(b[3], 1, 0); take(b[3], 1, 1);
+		take(b[2], 1, 4); take(g[0], 6, 0); take(g[2], 1, 5); take(b[2], 1, 5);
+		take(b[3], 1, 2); take(g[2], 1, 4); take(b[0], 6, 0); take(g[3], 1, 5);
+		take(b[3], 1, 3); take(b[3], 1, 5); take(b[3], 1, 4);
+		take(r[1], 6, 0); take(g[2], 4, 0); take(g[1], 6, 0); take(g[3], 4, 0);
+		take(b[1], 6, 0); take(b[2], 4, 0); take(r[2], 6, 0); take(r[3], 6, 0);
+		precision = 6, transformed = false;
+		break;
+	case 0x03:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 10, 0); take(g[1], 10, 0); take(b[1], 10, 0);
+		precision = 10, transformed = false;
+		break;
+	case 0x07:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 9, 0); take(r[0], 1, 10);
+		take(g[1], 9, 0); take(g[0], 1, 10);
+		take(b[1], 9, 0); take(b[0], 1, 10);
+		precision = 11, deltaBits[0] = 9, deltaBits[1] = 9, deltaBits[2] = 9;
+		break;
+	case 0x0B:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 8, 0); takeReversed(r[0], 2, 10);
+		take(g[1], 8, 0); takeReversed(g[0], 2, 10);
+		take(b[1], 8, 0); takeReversed(b[0], 2, 10);
+		precision = 12, deltaBits[0] = 8, deltaBits[1] = 8, deltaBits[2] = 8;
+		break;
+	case 0x0F:
+		take(r[0], 10, 0); take(g[0], 10, 0); take(b[0], 10, 0);
+		take(r[1], 4, 0); takeReversed(r[0], 6, 10);
+		take(g[1], 4, 0); takeReversed(g[0], 6, 10);
+		take(b[1], 4, 0); takeReversed(b[0], 6, 10);
+		precision = 16, deltaBits[0] = 4, deltaBits[1] = 4, deltaBits[2] = 4;
+		break;
+	default:
+		// reserved modes decode to black
+		memset(out, 0, 64);
+		for (int i = 0; i < 16; ++i)
+			out[i * 4 + 3] = 255;
+		return;
+	}
+
+	bool twoRegions = (mode & 3) != 3;
+	unsigned endpoints = twoRegions ? 4 : 2;
+	unsigned partition = twoRegions ? bits.Read(5) : 0;
+
+	int* channels[3] = { r, g, b };
+	for (int c = 0; c < 3; ++c) {
+		int* e = channels[c];
+		if (isSigned)
+			e[0] = SignExtend(e[0], precision);
+		for (unsigned i = 1; i < endpoints; ++i) {
+			if (transformed) {
+				e[i] = (e[0] + SignExtend(e[i], deltaBits[c])) & ((1 << precision) - 1);
+				if (isSigned)
+					e[i] = SignExtend(e[i], precision);
+			}
+			else if (isSigned) {
+				e[i] = SignExtend(e[i], precision);
+			}
+		}
+		for (unsigned i = 0; i < endpoints; ++i)
+			e[i] = UnquantizeBC6H(e[i], precision, isSigned);
+	}
+
+	unsigned indexBits = twoRegions ? 3 : 4;
+	const int* weights = WeightTable(indexBits);
+	for (unsigned i = 0; i < 16; ++i) {
+		unsigned subsets = twoRegions ? 2 : 1;
+		unsigned index = bits.Read(indexBits - (IsAnchor(subsets, partition, i) ? 1 : 0));
+		unsigned s = SubsetOf(subsets, partition, i);
+		for (int c = 0; c < 3; ++c) {
+			int v = Interpolate(channels[c][s * 2], channels[c][s * 2 + 1], weights[index]);
+			float f = HalfToFloat(FinishBC6H(v, isSigned));
+			out[i * 4 + c] = ClampByte(int(std::min(std::max(f, 0.0f), 1.0f) * 255.0f + 0.5f));
+		}
+		out[i * 4 + 3] = 255;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// BC7
+
+struct BC7Mode
+{
+	unsigned subsets;
+	unsigned partitionBits;
+	unsigned rotationBits;
+	unsigned selectionBits;
+	unsigned colorBits;
+	unsigned alphaBits;
+	unsigned endpointPBits;   // one p-bit per endpoint
+	unsigned sharedPBits;     // one p-bit per subset
+	unsigned indexBits;
+	unsigned index2Bits;
+};
+
+const BC7Mode BC7Modes[8] = {
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+};
+
+void DecodeBC7(const unsigned char* block, unsigned char* out)
+{
+	unsigned mode = 0;
+	while (mode < 8 && (block[0] & (1 << mode)) == 0)
+		++mode;
+	if (mode == 8) {
+		// reserved mode decodes to transparent black
+		memset(out, 0, 64);
+		return;
+	}
+
+	const BC7Mode& m = BC7Modes[mode];
+	BlockBits bits(block);
+	bits.Read(mode + 1);
+	unsigned partition = bits.Read(m.partitionBits);
+	unsigned rotation = bits.Read(m.rotationBits);
+	unsigned selection = bits.Read(m.selectionBits);
+
+	int endpoints[3][2][4];
+	for (int c = 0; c < 3; ++c)
+		for (unsigned s = 0; s < m.subsets; ++s)
+			for (int e = 0; e < 2; ++e)
+				endpoints[s][e][c] = int(bits.Read(m.colorBits));
+	for (unsigned s = 0; s < m.subsets; ++s)
+		for (int e = 0; e < 2; ++e)
+			endpoints[s][e][3] = m.alphaBits ? int(bits.Read(m.alphaBits)) : 255;
+
+	unsigned colorBits = m.colorBits, alphaBits = m.alphaBits;
+	if (m.endpointPBits || m.sharedPBits) {
+		for (unsigned s = 0; s < m.subsets; ++s) {
+			unsigned shared = m.sharedPBits ? bits.Read(1) : 0;
+			for (int e = 0; e < 2; ++e) {
+				unsigned p = m.endpointPBits ? bits.Read(1) : shared;
+				for (int c = 0; c < (m.alphaBits ? 4 : 3); ++c)
+					endpoints[s][e][c] = (endpoints[s][e][c] << 1) | int(p);
+			}
+		}
+		++colorBits;
+		if (alphaBits) ++alphaBits;
+	}
+	for (unsigned s = 0; s < m.subsets; ++s) {
+		for (int e = 0; e < 2; ++e) {
+			for (int c = 0; c < 4; ++c) {
+				unsigned n = (c < 3) ? colorBits : alphaBits;
+				if (n == 0)
+					continue;
+				int v = endpoints[s][e][c] << (8 - n);
+				endpoints[s][e][c] = v | (v >> n);
+			}
+		}
+	}
+
+	unsigned colorIndex[16], alphaIndex[16];
+	for (unsigned i = 0; i < 16; ++i)
+		colorIndex[i] = bits.Read(m.indexBits - (IsAnchor(m.subsets, partition, i) ? 1 : 0));
+	if (m.index2Bits) {
+		for (unsigned i = 0; i < 16; ++i)
+			alphaIndex[i] = bits.Read(m.index2Bits - (i == 0 ? 1 : 0));
+	}
+	else {
+		memcpy(alphaIndex, colorIndex, sizeof(colorIndex));
+	}
+
+	const int* colorWeights = WeightTable(m.indexBits);
+	const int* alphaWeights = WeightTable(m.index2Bits ? m.index2Bits : m.indexBits);
+	const unsigned* colorSource = colorIndex;
+	const unsigned* alphaSource = alphaIndex;
+	if (selection) {
+		std::swap(colorWeights, alphaWeights);
+		std::swap(colorSource, alphaSource);
+	}
+
+#ifdef NIF_DDS_SSE
+	// Two pixels per register as 16 bit lanes.  The rotation is applied up
+	//   front by swapping the endpoint channels and moving the alpha weight
+	//   to the rotated channel.
+	unsigned alphaSlot = rotation ? rotation - 1 : 3;
+	short ends[3][2][4];
+	for (unsigned s = 0; s < m.subsets; ++s) {
+		for (int e = 0; e < 2; ++e) {
+			for (int c = 0; c < 4; ++c)
+				ends[s][e][c] = short(endpoints[s][e][c]);
+			std::swap(ends[s][e][3], ends[s][e][alphaSlot]);
+		}
+	}
+	short weights[16][4];
+	for (unsigned i = 0; i < 16; ++i) {
+		short w = short(colorWeights[colorSource[i]]);
+		weights[i][0] = weights[i][1] = weights[i][2] = weights[i][3] = w;
+		weights[i][alphaSlot] = short(alphaWeights[alphaSource[i]]);
+	}
+	const __m128i round = _mm_set1_epi16(32), sixtyFour = _mm_set1_epi16(64);
+	__m128i pairs[2];
+	for (unsigned i = 0; i < 16; i += 2) {
+		const short (&e)[2][4] = ends[SubsetOf(m.subsets, partition, i)];
+		const short (&f)[2][4] = ends[SubsetOf(m.subsets, partition, i + 1)];
+		__m128i e0 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)e[0]), _mm_loadl_epi64((const __m128i*)f[0]));
+		__m128i e1 = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)e[1]), _mm_loadl_epi64((const __m128i*)f[1]));
+		__m128i w = _mm_loadu_si128((const __m128i*)weights[i]);
+		__m128i v = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(sixtyFour, w), e0), _mm_mullo_epi16(w, e1));
+		pairs[(i / 2) & 1] = _mm_srli_epi16(_mm_add_epi16(v, round), 6);
+		if ((i / 2) & 1)
+			_mm_storeu_si128((__m128i*)(out + (i - 2) * 4), _mm_packus_epi16(pairs[0], pairs[1]));
+	}
+#else
+	for (unsigned i = 0; i < 16; ++i) {
+		const int (&e)[2][4] = endpoints[SubsetOf(m.subsets, partition, i)];
+		unsigned char* px = out + i * 4;
+		for (int c = 0; c < 3; ++c)
+			px[c] = (unsigned char)Interpolate(e[0][c], e[1][c], colorWeights[colorSource[i]]);
+		px[3] = (unsigned char)Interpolate(e[0][3], e[1][3], alphaWeights[alphaSource[i]]);
+		if (rotation)
+			std::swap(px[3], px[rotation - 1]);
+	}
+#endif
+}
+
+void DecodeBlock(DdsFormat format, const unsigned char* block, unsigned char* out)
+{
+	switch (format) {
+	case DDS_FMT_BC1: DecodeBC1(block, out); break;
+	case DDS_FMT_BC2: DecodeBC2(block, out); break;
+	case DDS_FMT_BC3: DecodeBC3(block, out); break;
+	case DDS_FMT_BC4: DecodeBC4(block, out, false); break;
+	case DDS_FMT_BC4S: DecodeBC4(block, out, true); break;
+	case DDS_FMT_BC5: DecodeBC5(block, out, false); break;
+	case DDS_FMT_BC5S: DecodeBC5(block, out, true); break;
+	case DDS_FMT_BC6H: DecodeBC6H(block, out, false); break;
+	case DDS_FMT_BC6HS: DecodeBC6H(block, out, true); break;
+	case DDS_FMT_BC7: DecodeBC7(block, out); break;
+	default: memset(out, 0, 64); break;
+	}
+}
+
+unsigned BlockBytes(DdsFormat format)
+{
+	switch (format) {
+	case DDS_FMT_BC1:
+	case DDS_FMT_BC4:
+	case DDS_FMT_BC4S:
+		return 8;
+	case DDS_FMT_MASKED:
+	case DDS_FMT_UNKNOWN:
+		return 0;
+	default:
+		return 16;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Uncompressed
+
+struct ChannelMask
+{
+	unsigned mask;
+	unsigned shift;
+	unsigned long long max;
+};
+
+ChannelMask MakeChannelMask(unsigned mask)
+{
+	ChannelMask cm = { mask, 0, 0 };
+	if (mask != 0) {
+		while ((mask & 1) == 0)
+			mask >>= 1, ++cm.shift;
+		cm.max = mask;
+	}
+	return cm;
+}
+
+inline unsigned char ExtractChannel(unsigned pixel, const ChannelMask& cm, unsigned char missing)
+{
+	if (cm.max == 0)
+		return missing;
+	unsigned long long v = (pixel & cm.mask) >> cm.shift;
+	return (unsigned char)((v * 255 + cm.max / 2) / cm.max);
+}
+
+// DXGI formats handled by the decoder
+enum
+{
+	DXGI_R10G10B10A2_UNORM = 24,
+	DXGI_R8G8B8A8_TYPELESS = 27,
+	DXGI_R8G8B8A8_UNORM = 28,
+	DXGI_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_R8G8_UNORM = 49,
+	DXGI_R8_UNORM = 61,
+	DXGI_A8_UNORM = 65,
+	DXGI_BC1_TYPELESS = 70,
+	DXGI_BC1_UNORM = 71,
+	DXGI_BC1_UNORM_SRGB = 72,
+	DXGI_BC2_TYPELESS = 73,
+	DXGI_BC2_UNORM = 74,
+	DXGI_BC2_UNORM_SRGB = 75,
+	DXGI_BC3_TYPELESS = 76,
+	DXGI_BC3_UNORM = 77,
+	DXGI_BC3_UNORM_SRGB = 78,
+	DXGI_BC4_TYPELESS = 79,
+	DXGI_BC4_UNORM = 80,
+	DXGI_BC4_SNORM = 81,
+	DXGI_BC5_TYPELESS = 82,
+	DXGI_BC5_UNORM = 83,
+	DXGI_BC5_SNORM = 84,
+	DXGI_B5G6R5_UNORM = 85,
+	DXGI_B5G5R5A1_UNORM = 86,
+	DXGI_B8G8R8A8_UNORM = 87,
+	DXGI_B8G8R8X8_UNORM = 88,
+	DXGI_B8G8R8A8_TYPELESS = 90,
+	DXGI_B8G8R8A8_UNORM_SRGB = 91,
+	DXGI_B8G8R8X8_TYPELESS = 92,
+	DXGI_B8G8R8X8_UNORM_SRGB = 93,
+	DXGI_BC6H_TYPELESS = 94,
+	DXGI_BC6H_UF16 = 95,
+	DXGI_BC6H_SF16 = 96,
+	DXGI_BC7_TYPELESS = 97,
+	DXGI_BC7_UNORM = 98,
+	DXGI_BC7_UNORM_SRGB = 99,
+	DXGI_B4G4R4A4_UNORM = 115,
+};
+
+} // namespace
+
+DdsImage::DdsImage()
+	: width(0), height(0), mipCount(0), format(DDS_FMT_UNKNOWN), bitCount(0), luminance(false), dataOffset(0)
+{
+	masks[0] = masks[1] = masks[2] = masks[3] = 0;
+}
+
+bool DdsImage::ReadHeader(const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	*this = DdsImage();
+	if (p == nullptr || size < DDS_HEADER_SIZE || ReadU32(p) != DDS_MAGIC || ReadU32(p + 4) != 124)
+		return false;
+
+	unsigned flags = ReadU32(p + 8);
+	height = ReadU32(p + 12);
+	width = ReadU32(p + 16);
+	mipCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(1u, ReadU32(p + 28)) : 1;
+	unsigned pfFlags = ReadU32(p + 80);
+	unsigned fourCC = ReadU32(p + 84);
+	dataOffset = DDS_HEADER_SIZE;
+
+	auto setMasked = [this](unsigned bits, unsigned r, unsigned g, unsigned b, unsigned a) {
+		format = DDS_FMT_MASKED;
+		bitCount = bits;
+		masks[0] = r, masks[1] = g, masks[2] = b, masks[3] = a;
+	};
+
+	if (pfFlags & DDPF_FOURCC) {
+		if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+			format = DDS_FMT_BC1;
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '2') || fourCC == MakeFourCC('D', 'X', 'T', '3'))
+			format = DDS_FMT_BC2;
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5'))
+			format = DDS_FMT_BC3;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U'))
+			format = DDS_FMT_BC4;
+		else if (fourCC == MakeFourCC('B', 'C', '4', 'S'))
+			format = DDS_FMT_BC4S;
+		else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+			format = DDS_FMT_BC5;
+		else if (fourCC == MakeFourCC('B', 'C', '5', 'S'))
+			format = DDS_FMT_BC5S;
+		else if (fourCC == MakeFourCC('D', 'X', '1', '0')) {
+			if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE)
+				return false;
+			dataOffset += DDS_DX10_HEADER_SIZE;
+			switch (ReadU32(p + DDS_HEADER_SIZE)) {
+			case DXGI_BC1_TYPELESS: case DXGI_BC1_UNORM: case DXGI_BC1_UNORM_SRGB:
+				format = DDS_FMT_BC1; break;
+			case DXGI_BC2_TYPELESS: case DXGI_BC2_UNORM: case DXGI_BC2_UNORM_SRGB:
+				format = DDS_FMT_BC2; break;
+			case DXGI_BC3_TYPELESS: case DXGI_BC3_UNORM: case DXGI_BC3_UNORM_SRGB:
+				format = DDS_FMT_BC3; break;
+			case DXGI_BC4_TYPELESS: case DXGI_BC4_UNORM:
+				format = DDS_FMT_BC4; break;
+			case DXGI_BC4_SNORM:
+				format = DDS_FMT_BC4S; break;
+			case DXGI_BC5_TYPELESS: case DXGI_BC5_UNORM:
+				format = DDS_FMT_BC5; break;
+			case DXGI_BC5_SNORM:
+				format = DDS_FMT_BC5S; break;
+			case DXGI_BC6H_TYPELESS: case DXGI_BC6H_UF16:
+				format = DDS_FMT_BC6H; break;
+			case DXGI_BC6H_SF16:
+				format = DDS_FMT_BC6HS; break;
+			case DXGI_BC7_TYPELESS: case DXGI_BC7_UNORM: case DXGI_BC7_UNORM_SRGB:
+				format = DDS_FMT_BC7; break;
+			case DXGI_R8G8B8A8_TYPELESS: case DXGI_R8G8B8A8_UNORM: case DXGI_R8G8B8A8_UNORM_SRGB:
+				setMasked(32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000); break;
+			case DXGI_B8G8R8A8_TYPELESS: case DXGI_B8G8R8A8_UNORM: case DXGI_B8G8R8A8_UNORM_SRGB:
+				setMasked(32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000); break;
+			case DXGI_B8G8R8X8_TYPELESS: case DXGI_B8G8R8X8_UNORM: case DXGI_B8G8R8X8_UNORM_SRGB:
+				setMasked(32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0); break;
+			case DXGI_R10G10B10A2_UNORM:
+				setMasked(32, 0x000003FF, 0x000FFC00, 0x3FF00000, 0xC0000000); break;
+			case DXGI_B5G6R5_UNORM:
+				setMasked(16, 0xF800, 0x07E0, 0x001F, 0); break;
+			case DXGI_B5G5R5A1_UNORM:
+				setMasked(16, 0x7C00, 0x03E0, 0x001F, 0x8000); break;
+			case DXGI_B4G4R4A4_UNORM:
+				setMasked(16, 0x0F00, 0x00F0, 0x000F, 0xF000); break;
+			case DXGI_R8G8_UNORM:
+				setMasked(16, 0x00FF, 0xFF00, 0, 0); break;
+			case DXGI_R8_UNORM:
+				setMasked(8, 0xFF, 0, 0, 0); luminance = true; break;
+			case DXGI_A8_UNORM:
+				setMasked(8, 0, 0, 0, 0xFF); break;
+			}
+		}
+	}
+	else if (pfFlags & (DDPF_RGB | DDPF_LUMINANCE | DDPF_ALPHA)) {
+		unsigned bits = ReadU32(p + 88);
+		unsigned alphaMask = (pfFlags & (DDPF_ALPHAPIXELS | DDPF_ALPHA)) ? ReadU32(p + 104) : 0;
+		if (pfFlags & DDPF_ALPHA)
+			setMasked(bits, 0, 0, 0, alphaMask);
+		else
+			setMasked(bits, ReadU32(p + 92), ReadU32(p + 96), ReadU32(p + 100), alphaMask);
+		luminance = (pfFlags & DDPF_LUMINANCE) != 0;
+		if (bits == 0 || bits > 32 || (bits % 8) != 0)
+			format = DDS_FMT_UNKNOWN;
+	}
+
+	return format != DDS_FMT_UNKNOWN && width > 0 && height > 0;
+}
+
+bool DdsImage::HasAlpha() const
+{
+	switch (format) {
+	case DDS_FMT_BC1:
+	case DDS_FMT_BC2:
+	case DDS_FMT_BC3:
+	case DDS_FMT_BC7:
+		return true;
+	case DDS_FMT_MASKED:
+		return masks[3] != 0;
+	default:
+		return false;
+	}
+}
+
+bool DdsImage::GetMipLevel(unsigned level, unsigned& w, unsigned& h, size_t& offset, size_t& size) const
+{
+	if (format == DDS_FMT_UNKNOWN || level >= mipCount)
+		return false;
+	unsigned blockBytes = BlockBytes(format);
+	offset = dataOffset;
+	for (unsigned i = 0; ; ++i) {
+		w = std::max(1u, width >> i);
+		h = std::max(1u, height >> i);
+		if (blockBytes)
+			size = size_t((w + 3) / 4) * size_t((h + 3) / 4) * blockBytes;
+		else
+			size = size_t(w) * (bitCount / 8) * h;
+		if (i == level)
+			return true;
+		offset += size;
+	}
+}
+
+unsigned DdsImage::FindMipLevel(unsigned maxSize) const
+{
+	unsigned level = 0;
+	while (level + 1 < mipCount && std::max(width >> level, height >> level) > maxSize)
+		++level;
+	return level;
+}
+
+bool DdsImage::Decode(const void* data, size_t size, unsigned level, std::vector<unsigned char>& rgba, int maxThreads) const
+{
+	unsigned w, h;
+	size_t offset, levelSize;
+	if (!GetMipLevel(level, w, h, offset, levelSize) || offset > size || levelSize > size - offset)
+		return false;
+
+	const unsigned char* src = (const unsigned char*)data + offset;
+	rgba.resize(size_t(w) * h * 4);
+	unsigned char* dst = &rgba[0];
+
+	if (format == DDS_FMT_MASKED) {
+		ChannelMask channels[4];
+		for (int c = 0; c < 4; ++c)
+			channels[c] = MakeChannelMask(masks[c]);
+		unsigned bytes = bitCount / 8;
+		for (size_t i = 0, n = size_t(w) * h; i < n; ++i, src += bytes) {
+			unsigned pixel = 0;
+			for (unsigned b = 0; b < bytes; ++b)
+				pixel |= unsigned(src[b]) << (b * 8);
+			unsigned char* px = dst + i * 4;
+			px[0] = ExtractChannel(pixel, channels[0], 0);
+			px[1] = luminance ? px[0] : ExtractChannel(pixel, channels[1], 0);
+			px[2] = luminance ? px[0] : ExtractChannel(pixel, channels[2], 0);
+			px[3] = ExtractChannel(pixel, channels[3], 255);
+		}
+		return true;
+	}
+
+	// Each job decodes one row of blocks into its own rows of the image,
+	//   so jobs never share output.  Small levels stay on this thread.
+	unsigned blockBytes = BlockBytes(format);
+	unsigned blocksWide = (w + 3) / 4, blocksHigh = (h + 3) / 4;
+	int threads = (size_t(blocksWide) * blocksHigh >= 4096) ? maxThreads : 1;
+	DdsFormat fmt = format;
+	ParallelFor(blocksHigh, [=](size_t by) {
+		unsigned char pixels[64];
+		const unsigned char* block = src + by * blocksWide * blockBytes;
+		unsigned rows = std::min(4u, h - unsigned(by) * 4);
+		for (unsigned bx = 0; bx < blocksWide; ++bx, block += blockBytes) {
+			DecodeBlock(fmt, block, pixels);
+			unsigned cols = std::min(4u, w - bx * 4);
+			for (unsigned y = 0; y < rows; ++y)
+				memcpy(dst + ((by * 4 + y) * size_t(w) + bx * 4) * 4, pixels + y * 16, cols * 4);
+		}
+	}, threads);
+	return true;
+}
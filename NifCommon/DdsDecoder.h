@@ -0,0 +1,75 @@
+/**********************************************************************
+*<
+FILE: DdsDecoder.h
+
+DESCRIPTION:	DDS header reader and BC1 to BC7 block decoder.  Any
+               single mip level can be decoded to 8 bit RGBA.  The
+               decoder keeps no global state so several images may be
+               decoded from different threads at once.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+enum DdsFormat
+{
+	DDS_FMT_UNKNOWN,
+	DDS_FMT_BC1,      // DXT1
+	DDS_FMT_BC2,      // DXT2, DXT3
+	DDS_FMT_BC3,      // DXT4, DXT5
+	DDS_FMT_BC4,      // ATI1
+	DDS_FMT_BC4S,
+	DDS_FMT_BC5,      // ATI2
+	DDS_FMT_BC5S,
+	DDS_FMT_BC6H,
+	DDS_FMT_BC6HS,
+	DDS_FMT_BC7,
+	DDS_FMT_MASKED,   // uncompressed with channel bit masks
+};
+
+class DdsImage
+{
+public:
+	DdsImage();
+
+	// Reads the file header including the DX10 extension.  Only the first
+	//   148 bytes of the file are needed.  Returns false for files that are
+	//   not DDS or use a pixel format the decoder does not handle.
+	bool ReadHeader(const void* data, size_t size);
+
+	unsigned Width() const { return width; }
+	unsigned Height() const { return height; }
+	unsigned MipCount() const { return mipCount; }
+	DdsFormat Format() const { return format; }
+
+	// True if the pixel format can store alpha
+	bool HasAlpha() const;
+
+	// Size and file offset of a mip level of the first surface
+	bool GetMipLevel(unsigned level, unsigned& w, unsigned& h, size_t& offset, size_t& size) const;
+
+	// The first mip level no larger than maxSize in either direction, or
+	//   the smallest level if none is.
+	unsigned FindMipLevel(unsigned maxSize) const;
+
+	// Decodes one mip level to RGBA rows from the top down.  data is the
+	//   whole file.  BC5 fills blue with the normal Z rebuilt from red and
+	//   green; BC6H is clamped to [0,1].  Large levels are split by block
+	//   row over up to maxThreads workers (0 for all cores).
+	bool Decode(const void* data, size_t size, unsigned level, std::vector<unsigned char>& rgba, int maxThreads = 0) const;
+
+private:
+	unsigned width;
+	unsigned height;
+	unsigned mipCount;
+	DdsFormat format;
+	unsigned bitCount;
+	unsigned masks[4];      // r g b a
+	bool luminance;
+	size_t dataOffset;
+};
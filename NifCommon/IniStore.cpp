@@ -0,0 +1,193 @@
+/**********************************************************************
+*<
+FILE: IniStore.cpp
+
+DESCRIPTION:	Single pass ini file parser and change checked cache
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "IniStore.h"
+#include <mutex>
+
+namespace {
+
+struct CachedIni
+{
+	unsigned long long stamp;
+	unsigned long long size;
+	std::shared_ptr<const IniStore> store;
+};
+
+std::mutex IniCacheLock;
+std::map<tstring, CachedIni, ltstr> IniCache;
+
+void TrimString(tstring& s)
+{
+	size_t first = 0, last = s.size();
+	while (first < last && _istspace(s[first])) ++first;
+	while (last > first && _istspace(s[last - 1])) --last;
+	s = s.substr(first, last - first);
+}
+
+// Decodes the raw bytes the way the profile api does: utf-16 or utf-8 when
+//   the file has a byte order mark, otherwise the ansi code page.
+tstring DecodeIniText(const std::vector<char>& data)
+{
+	std::wstring wide;
+	const unsigned char *p = (const unsigned char*)(data.empty() ? nullptr : &data[0]);
+	size_t size = data.size();
+	if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+		wide.assign((const wchar_t*)(p + 2), (size - 2) / sizeof(wchar_t));
+	}
+	else {
+		UINT codePage = CP_ACP;
+		if (size >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) {
+			codePage = CP_UTF8;
+			p += 3, size -= 3;
+		}
+		int len = (size > 0) ? MultiByteToWideChar(codePage, 0, (LPCSTR)p, int(size), nullptr, 0) : 0;
+		if (len > 0) {
+			wide.resize(len);
+			MultiByteToWideChar(codePage, 0, (LPCSTR)p, int(size), &wide[0], len);
+		}
+	}
+#ifdef UNICODE
+	return wide;
+#else
+	std::string narrow;
+	int len = wide.empty() ? 0 : WideCharToMultiByte(CP_ACP, 0, wide.c_str(), int(wide.size()), nullptr, 0, nullptr, nullptr);
+	if (len > 0) {
+		narrow.resize(len);
+		WideCharToMultiByte(CP_ACP, 0, wide.c_str(), int(wide.size()), &narrow[0], len, nullptr, nullptr);
+	}
+	return narrow;
+#endif
+}
+
+} // namespace
+
+size_t IniStore::NoCaseHash::operator()(const tstring& s) const
+{
+	size_t h = 2166136261U;
+	for (size_t i = 0; i < s.size(); ++i)
+		h = (h ^ size_t(_totlower(s[i]))) * 16777619U;
+	return h;
+}
+
+// Lines are split at the first '=' and trimmed.  Comments, lines without a
+//   '=' and lines before the first section are ignored.  A section named
+//   twice continues the first one.
+IniStore::IniStore(const tstring& text)
+{
+	Section *current = nullptr;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		size_t eol = text.find_first_of(TEXT("\r\n"), pos);
+		if (eol == tstring::npos)
+			eol = text.size();
+		tstring line = text.substr(pos, eol - pos);
+		pos = eol + 1;
+		TrimString(line);
+		if (line.empty() || line[0] == ';')
+			continue;
+		if (line[0] == '[') {
+			size_t close = line.find(']');
+			tstring name = line.substr(1, (close == tstring::npos ? line.size() : close) - 1);
+			TrimString(name);
+			current = &sections[name];
+			continue;
+		}
+		size_t equals = line.find('=');
+		if (current == nullptr || equals == tstring::npos)
+			continue;
+		tstring key = line.substr(0, equals), value = line.substr(equals + 1);
+		TrimString(key), TrimString(value);
+		current->index.insert(KeyIndex::value_type(key, current->entries.size()));
+		current->entries.push_back(KeyValuePair(key, value));
+		if (value.size() >= 2 && value[0] == value[value.size() - 1] && (value[0] == '"' || value[0] == '\''))
+			value = value.substr(1, value.size() - 2);
+		current->values.push_back(value);
+	}
+
+	// same order as AppSettings used to apply by hand: registry values first
+	//   so that qualifiers can refer to them
+	for (SectionMap::iterator itr = sections.begin(), end = sections.end(); itr != end; ++itr) {
+		Section& section = itr->second;
+		for (size_t i = 0; i < section.entries.size(); ++i)
+			section.expanded[section.entries[i].first] = section.entries[i].second;
+		for (NameValueCollection::iterator kvp = section.expanded.begin(); kvp != section.expanded.end(); ++kvp)
+			kvp->second = GetIndirectValue(kvp->second.c_str());
+		NameValueCollection qualified = section.expanded;
+		for (NameValueCollection::iterator kvp = qualified.begin(); kvp != qualified.end(); ++kvp)
+			kvp->second = ExpandQualifiers(kvp->second, section.expanded);
+		section.expanded.swap(qualified);
+	}
+}
+
+std::shared_ptr<const IniStore> IniStore::Get(LPCTSTR iniFile)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	unsigned long long stamp = 0, size = 0;
+	if (GetFileAttributesEx(iniFile, GetFileExInfoStandard, &attr)) {
+		stamp = ((unsigned long long)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+		size = ((unsigned long long)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+	}
+
+	std::lock_guard<std::mutex> lock(IniCacheLock);
+	CachedIni& cached = IniCache[iniFile];
+	if (cached.store && cached.stamp == stamp && cached.size == size)
+		return cached.store;
+
+	std::vector<char> data;
+	if (FILE *fp = _tfopen(iniFile, TEXT("rb"))) {
+		data.resize(size_t(size));
+		if (!data.empty())
+			data.resize(fread(&data[0], 1, data.size(), fp));
+		fclose(fp);
+	}
+	cached.stamp = stamp;
+	cached.size = size;
+	cached.store = std::make_shared<IniStore>(DecodeIniText(data));
+	return cached.store;
+}
+
+const IniStore::Section* IniStore::FindSection(LPCTSTR section) const
+{
+	SectionMap::const_iterator itr = sections.find(section);
+	return (itr != sections.end()) ? &itr->second : nullptr;
+}
+
+bool IniStore::HasSection(LPCTSTR section) const
+{
+	return FindSection(section) != nullptr;
+}
+
+const tstring* IniStore::Find(LPCTSTR section, LPCTSTR key) const
+{
+	const Section *s = FindSection(section);
+	if (s == nullptr)
+		return nullptr;
+	KeyIndex::const_iterator itr = s->index.find(key);
+	if (itr == s->index.end())
+		return nullptr;
+	return &s->values[itr->second];
+}
+
+const NameValueCollection& IniStore::ExpandedSection(LPCTSTR section) const
+{
+	static const NameValueCollection empty;
+	const Section *s = FindSection(section);
+	return (s != nullptr) ? s->expanded : empty;
+}
+
+// GetPrivateProfileInt reads a leading decimal number, or hex with 0x
+void IniStore::ParseValue(const tstring& s, int& v)
+{
+	const TCHAR *p = s.c_str();
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+		v = int(_tcstoul(p + 2, nullptr, 16));
+	else
+		v = int(_tcstol(p, nullptr, 10));
+}
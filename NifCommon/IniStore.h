@@ -0,0 +1,83 @@
+/**********************************************************************
+*<
+FILE: IniStore.h
+
+DESCRIPTION:	Read only view of a whole ini file parsed in one pass.
+               Lookups are hashed and case insensitive like the
+               profile api, and each section is also kept with its
+               registry and ${Name} references already expanded.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include "niutils.h"
+#include <memory>
+#include <unordered_map>
+
+class IniStore
+{
+public:
+	// Returns the parsed contents of iniFile.  The file is parsed again only
+	//   when its size or last write time has changed since the previous call,
+	//   so callers should fetch the store once per read of their settings.
+	//   A missing file gives an empty store.
+	static std::shared_ptr<const IniStore> Get(LPCTSTR iniFile);
+
+	// Parses ini text; normally only used by Get
+	explicit IniStore(const tstring& text);
+
+	bool HasSection(LPCTSTR section) const;
+
+	// The first value for key with surrounding quotes removed, as
+	//   GetPrivateProfileString returns it.  nullptr if the key is absent.
+	const tstring* Find(LPCTSTR section, LPCTSTR key) const;
+
+	// The section as ReadIniSection returns it with GetIndirectValue and
+	//   ExpandQualifiers applied to every value.  Environment variables are
+	//   left for the caller to expand.
+	const NameValueCollection& ExpandedSection(LPCTSTR section) const;
+
+	// Same results as GetIniValue on the file the store was read from
+	template<typename T>
+	T GetValue(LPCTSTR section, LPCTSTR key, T Default) const {
+		const tstring* value = Find(section, key);
+		if (value == nullptr || value->empty())
+			return Default;
+		T v{};
+		ParseValue(*value, v);
+		return v;
+	}
+
+private:
+	struct NoCaseHash {
+		size_t operator()(const tstring& s) const;
+	};
+	struct NoCaseEqual {
+		bool operator()(const tstring& a, const tstring& b) const { return 0 == _tcsicmp(a.c_str(), b.c_str()); }
+	};
+	typedef std::unordered_map<tstring, size_t, NoCaseHash, NoCaseEqual> KeyIndex;
+
+	struct Section
+	{
+		std::vector<KeyValuePair> entries;   // raw lines in file order
+		std::vector<tstring> values;         // entry values without quotes
+		KeyIndex index;                      // first entry for each key
+		NameValueCollection expanded;
+	};
+	typedef std::unordered_map<tstring, Section, NoCaseHash, NoCaseEqual> SectionMap;
+
+	template<typename T>
+	static void ParseValue(const tstring& s, T& v) {
+		tstringstream sstr(s);
+		sstr >> v;
+	}
+	static void ParseValue(const tstring& s, int& v);
+	static void ParseValue(const tstring& s, tstring& v) { v = s; }
+
+	const Section* FindSection(LPCTSTR section) const;
+
+	SectionMap sections;
+};
@@ -0,0 +1,234 @@
+/**********************************************************************
+*<
+FILE: MoppBuilder.cpp
+
+DESCRIPTION:	Portable MOPP bounding volume tree encoder
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "MoppBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+enum MoppOpcode
+{
+	MOPP_JUMP8 = 0x05,
+	MOPP_JUMP16 = 0x06,
+	MOPP_JUMP24 = 0x07,
+	MOPP_SPLIT_X = 0x10,       // + axis: upper plane of first child, lower plane of second, jump8 to second
+	MOPP_DOUBLE_CUT_X = 0x26,  // + axis: skip the branch unless the query overlaps [lower, upper]
+	MOPP_TERM4 = 0x30,         // + key for keys below 32
+	MOPP_TERM8 = 0x50,
+	MOPP_TERM16 = 0x51,
+	MOPP_TERM24 = 0x52,
+	MOPP_TERM32 = 0x53,
+};
+
+// Quantized coordinates use 24 bits; split planes compare the top 8 of them.
+const int MoppCoordBits = 24;
+const int MoppPlaneShift = 16;
+
+struct TriBounds
+{
+	unsigned char lo[3];
+	unsigned char hi[3];
+	float         centroid[3];
+};
+
+typedef std::vector<unsigned char> Code;
+
+inline void AppendBigEndian(Code &code, unsigned value, int bytes)
+{
+	for (int i = bytes - 1; i >= 0; --i)
+		code.push_back((unsigned char)(value >> (i * 8)));
+}
+
+void EmitTerminal(Code &code, unsigned key)
+{
+	if (key < 0x20) {
+		code.push_back((unsigned char)(MOPP_TERM4 + key));
+	} else if (key < 0x100) {
+		code.push_back(MOPP_TERM8);
+		AppendBigEndian(code, key, 1);
+	} else if (key < 0x10000) {
+		code.push_back(MOPP_TERM16);
+		AppendBigEndian(code, key, 2);
+	} else if (key < 0x1000000) {
+		code.push_back(MOPP_TERM24);
+		AppendBigEndian(code, key, 3);
+	} else {
+		code.push_back(MOPP_TERM32);
+		AppendBigEndian(code, key, 4);
+	}
+}
+
+class NativeMoppBuilder : public IMoppBuilder
+{
+public:
+	const char *Name() const { return "native"; }
+	bool Build(const MoppGeometry &geom, MoppCode &result);
+
+private:
+	static bool BuildNode(const std::vector<TriBounds> &bounds, unsigned *begin, unsigned *end, Code &code);
+};
+
+// Splits the triangles at the median centroid of the longest axis until each
+//   leaf holds one triangle.  The first child holds the lower half; its
+//   planes are widened by one step so rounding of the query never culls a
+//   triangle it touches.
+bool NativeMoppBuilder::BuildNode(const std::vector<TriBounds> &bounds, unsigned *begin, unsigned *end, Code &code)
+{
+	if (end - begin == 1) {
+		EmitTerminal(code, *begin);
+		return true;
+	}
+
+	float cmin[3], cmax[3];
+	for (int k = 0; k < 3; ++k) {
+		cmin[k] = cmax[k] = bounds[*begin].centroid[k];
+	}
+	for (unsigned *i = begin + 1; i != end; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			cmin[k] = std::min(cmin[k], bounds[*i].centroid[k]);
+			cmax[k] = std::max(cmax[k], bounds[*i].centroid[k]);
+		}
+	}
+	int axis = 0;
+	for (int k = 1; k < 3; ++k) {
+		if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+			axis = k;
+	}
+
+	unsigned *mid = begin + (end - begin) / 2;
+	std::nth_element(begin, mid, end, [&](unsigned a, unsigned b) {
+		const TriBounds &ta = bounds[a], &tb = bounds[b];
+		if (ta.centroid[axis] != tb.centroid[axis])
+			return ta.centroid[axis] < tb.centroid[axis];
+		return a < b;
+	});
+
+	int upper = 0, lower = 255;
+	for (unsigned *i = begin; i != mid; ++i)
+		upper = std::max(upper, int(bounds[*i].hi[axis]));
+	for (unsigned *i = mid; i != end; ++i)
+		lower = std::min(lower, int(bounds[*i].lo[axis]));
+	upper = std::min(upper + 1, 255);
+	lower = std::max(lower - 1, 0);
+
+	Code first, second;
+	if (!BuildNode(bounds, begin, mid, first) || !BuildNode(bounds, mid, end, second))
+		return false;
+
+	code.push_back((unsigned char)(MOPP_SPLIT_X + axis));
+	code.push_back((unsigned char)upper);
+	code.push_back((unsigned char)lower);
+	if (first.size() <= 0xFF) {
+		code.push_back((unsigned char)first.size());
+		code.insert(code.end(), first.begin(), first.end());
+		code.insert(code.end(), second.begin(), second.end());
+	} else {
+		// the first child no longer fits an 8 bit offset so it is reached by a
+		//   jump placed in front of the second: [split][jump][second][first]
+		size_t len = second.size();
+		Code jump;
+		if (len <= 0xFF) {
+			jump.push_back(MOPP_JUMP8);
+			AppendBigEndian(jump, unsigned(len), 1);
+		} else if (len <= 0xFFFF) {
+			jump.push_back(MOPP_JUMP16);
+			AppendBigEndian(jump, unsigned(len), 2);
+		} else if (len <= 0xFFFFFF) {
+			jump.push_back(MOPP_JUMP24);
+			AppendBigEndian(jump, unsigned(len), 3);
+		} else {
+			return false;
+		}
+		code.push_back((unsigned char)jump.size());
+		code.insert(code.end(), jump.begin(), jump.end());
+		code.insert(code.end(), second.begin(), second.end());
+		code.insert(code.end(), first.begin(), first.end());
+	}
+	return true;
+}
+
+bool NativeMoppBuilder::Build(const MoppGeometry &geom, MoppCode &result)
+{
+	result.code.clear();
+	if (geom.keyedByChunk || geom.numSubshapes > 1)
+		return false;
+	if (geom.numVerts == 0 || geom.numTris == 0)
+		return false;
+
+	float lo[3], hi[3];
+	for (int k = 0; k < 3; ++k)
+		lo[k] = hi[k] = geom.verts[k];
+	for (size_t i = 1; i < geom.numVerts; ++i) {
+		const float *p = geom.verts + i * 3;
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = std::min(lo[k], p[k]);
+			hi[k] = std::max(hi[k], p[k]);
+		}
+	}
+
+	// same framing as havok: a small margin around the box and the longest
+	//   side mapped to 254 of the 256 top level plane steps
+	float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+	for (int k = 0; k < 3; ++k)
+		result.origin[k] = lo[k] - 0.1f;
+	result.scale = float(254 << MoppPlaneShift) / (extent + 0.2f);
+
+	const int maxCoord = (1 << MoppCoordBits) - 1;
+	std::vector<int> quantized(geom.numVerts * 3);
+	for (size_t i = 0; i < geom.numVerts * 3; ++i) {
+		double q = floor(double(geom.verts[i] - result.origin[i % 3]) * double(result.scale));
+		quantized[i] = (q < 0.0) ? 0 : (q > maxCoord) ? maxCoord : int(q);
+	}
+
+	std::vector<TriBounds> bounds(geom.numTris);
+	for (size_t t = 0; t < geom.numTris; ++t) {
+		const unsigned short *tri = geom.tris + t * 3;
+		if (tri[0] >= geom.numVerts || tri[1] >= geom.numVerts || tri[2] >= geom.numVerts)
+			return false;
+		TriBounds &b = bounds[t];
+		for (int k = 0; k < 3; ++k) {
+			int q0 = quantized[tri[0] * 3 + k], q1 = quantized[tri[1] * 3 + k], q2 = quantized[tri[2] * 3 + k];
+			b.lo[k] = (unsigned char)(std::min(q0, std::min(q1, q2)) >> MoppPlaneShift);
+			b.hi[k] = (unsigned char)(std::max(q0, std::max(q1, q2)) >> MoppPlaneShift);
+			b.centroid[k] = (geom.verts[tri[0] * 3 + k] + geom.verts[tri[1] * 3 + k] + geom.verts[tri[2] * 3 + k]) / 3.0f;
+		}
+	}
+
+	std::vector<unsigned> order(geom.numTris);
+	for (size_t t = 0; t < geom.numTris; ++t)
+		order[t] = unsigned(t);
+
+	Code tree;
+	if (!BuildNode(bounds, &order[0], &order[0] + order.size(), tree))
+		return false;
+
+	// reject queries outside the whole shape before walking the tree
+	for (int k = 0; k < 3; ++k) {
+		int qlo = quantized[k], qhi = quantized[k];
+		for (size_t i = 1; i < geom.numVerts; ++i) {
+			qlo = std::min(qlo, quantized[i * 3 + k]);
+			qhi = std::max(qhi, quantized[i * 3 + k]);
+		}
+		result.code.push_back((unsigned char)(MOPP_DOUBLE_CUT_X + k));
+		result.code.push_back((unsigned char)std::max((qlo >> MoppPlaneShift) - 1, 0));
+		result.code.push_back((unsigned char)std::min((qhi >> MoppPlaneShift) + 1, 255));
+	}
+	result.code.insert(result.code.end(), tree.begin(), tree.end());
+	return true;
+}
+
+} // namespace
+
+IMoppBuilder *GetNativeMoppBuilder()
+{
+	static NativeMoppBuilder builder;
+	return &builder;
+}
@@ -0,0 +1,58 @@
+/**********************************************************************
+*<
+FILE: MoppBuilder.h
+
+DESCRIPTION:	Interface for building havok MOPP bounding volume trees
+               and a portable encoder that needs neither havok nor
+               NifMopp.dll.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Triangle soup handed to a builder.  The arrays belong to the caller and
+//   must stay alive for the duration of Build; nothing is copied.
+struct MoppGeometry
+{
+	MoppGeometry() : verts(NULL), numVerts(0), tris(NULL), numTris(0)
+		, subshapeVerts(NULL), numSubshapes(0), keyedByChunk(false) {}
+
+	const float          *verts;         // x y z of each vertex
+	size_t                numVerts;
+	const unsigned short *tris;          // three vertex indices per triangle
+	size_t                numTris;
+	const int            *subshapeVerts; // vertex count of each subshape or NULL
+	size_t                numSubshapes;
+	bool                  keyedByChunk;  // compressed mesh shape whose keys encode the chunk
+};
+
+// Output of a builder.  Coordinates are quantized as (p - origin) * scale.
+struct MoppCode
+{
+	std::vector<unsigned char> code;
+	float                      origin[3];
+	float                      scale;
+};
+
+// A MOPP code generator.  Implementations must allow Build to be called
+//   from several threads at once.
+class IMoppBuilder
+{
+public:
+	virtual ~IMoppBuilder() {}
+
+	virtual const char *Name() const = 0;
+	// returns false and leaves result.code empty if the geometry is not supported
+	virtual bool Build(const MoppGeometry &geom, MoppCode &result) = 0;
+};
+
+// Encoder written against the documented opcode subset: axis splits with
+//   8 bit planes, bound cuts, jumps and terminals.  It never rescales so
+//   culling is coarser than havok's for very large shapes, and it declines
+//   geometry whose shape keys need subshape or chunk bits.  Stateless.
+IMoppBuilder *GetNativeMoppBuilder();
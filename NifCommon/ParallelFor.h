@@ -0,0 +1,78 @@
+/**********************************************************************
+*<
+FILE: ParallelFor.h
+
+DESCRIPTION:	Runs independent jobs on all cores.  There is no
+               persistent pool: every call starts its own threads and
+               joins them before returning, so it only pays off for
+               batches that take well over the thread start-up cost.
+               Jobs must not call into the Max SDK or modify shared
+               niflib objects.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Calls fn(i) for every i in [0, count) using up to maxThreads workers.
+//   maxThreads <= 0 uses the number of hardware threads.  The calling thread
+//   takes part in the work.  The first exception thrown by a job is rethrown
+//   once all workers have finished; remaining jobs are skipped.  If a thread
+//   cannot be started the ones already running share the work instead.
+template<typename Fn>
+void ParallelFor(size_t count, Fn fn, int maxThreads = 0)
+{
+	if (count == 0)
+		return;
+
+	size_t nthreads = (maxThreads > 0) ? size_t(maxThreads) : size_t(std::thread::hardware_concurrency());
+	if (nthreads == 0) nthreads = 1;
+	if (nthreads > count) nthreads = count;
+	if (nthreads == 1) {
+		for (size_t i = 0; i < count; ++i)
+			fn(i);
+		return;
+	}
+
+	std::atomic<size_t> nextIndex(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+	std::mutex errorLock;
+
+	auto worker = [&]() {
+		for (size_t i = nextIndex++; i < count && !failed; i = nextIndex++) {
+			try {
+				fn(i);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(errorLock);
+				if (!error) error = std::current_exception();
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nthreads - 1);
+	for (size_t i = 1; i < nthreads; ++i) {
+		try {
+			threads.push_back(std::thread(worker));
+		}
+		catch (...) {
+			break;
+		}
+	}
+	worker();
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
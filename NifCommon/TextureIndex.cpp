@@ -0,0 +1,321 @@
+/**********************************************************************
+*<
+FILE: TextureIndex.cpp
+
+DESCRIPTION:	Persistent texture search path index
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "TextureIndex.h"
+#include "ParallelFor.h"
+
+namespace {
+
+// bump when the file layout changes
+const unsigned int TextureIndexMagic = 0x58444954; // "TIDX"
+const unsigned int TextureIndexVersion = 1;
+
+unsigned long long HashBytes(const void *data, size_t size)
+{
+	unsigned long long h = 0xCBF29CE484222325ULL;
+	const unsigned char *p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 0x100000001B3ULL;
+	return h;
+}
+
+struct IndexWriter
+{
+	std::vector<char> data;
+
+	void Put(const void *p, size_t size) {
+		data.insert(data.end(), (const char*)p, (const char*)p + size);
+	}
+	void Put(unsigned int value) { Put(&value, sizeof(value)); }
+	void Put(unsigned long long value) { Put(&value, sizeof(value)); }
+	void Put(const tstring& value) {
+		Put(unsigned(value.size()));
+		Put(value.data(), value.size() * sizeof(TCHAR));
+	}
+};
+
+struct IndexReader
+{
+	const char *p, *end;
+
+	IndexReader(const char *data, size_t size) : p(data), end(data + size) {}
+
+	bool Get(void *out, size_t size) {
+		if (size_t(end - p) < size)
+			return false;
+		memcpy(out, p, size);
+		p += size;
+		return true;
+	}
+	bool Get(unsigned int& value) { return Get(&value, sizeof(value)); }
+	bool Get(unsigned long long& value) { return Get(&value, sizeof(value)); }
+	bool Get(tstring& value) {
+		unsigned int len;
+		if (!Get(len) || size_t(end - p) / sizeof(TCHAR) < len)
+			return false;
+		value.assign((const TCHAR*)p, len);
+		p += len * sizeof(TCHAR);
+		return true;
+	}
+};
+
+// search paths resolve the same way as in FindImages; each directory is keyed
+//   by its canonical path with a trailing backslash
+tstring DirectoryKey(LPCTSTR path)
+{
+	TCHAR buffer[MAX_PATH];
+	if (!PathCanonicalize(buffer, path))
+		return tstring();
+	PathAddBackslash(buffer);
+	return tstring(buffer);
+}
+
+} // namespace
+
+TextureIndex::TextureIndex(const tstring& rootPath, const tstringlist& extensions)
+	: rootPath(rootPath), extensions(extensions)
+{
+}
+
+bool TextureIndex::Load(const tstring& file)
+{
+	dirs.clear();
+
+	FILE *fp = _tfopen(file.c_str(), TEXT("rb"));
+	if (fp == nullptr)
+		return false;
+	std::vector<char> data;
+	unsigned int header[3];
+	unsigned long long size = 0, checksum = 0;
+	bool ok = fread(header, sizeof(header), 1, fp) == 1
+		&& header[0] == TextureIndexMagic && header[1] == TextureIndexVersion && header[2] == sizeof(TCHAR)
+		&& fread(&size, sizeof(size), 1, fp) == 1 && size > 0 && size < 0x40000000ULL;
+	if (ok) {
+		data.resize(size_t(size));
+		ok = fread(&data[0], 1, data.size(), fp) == data.size()
+			&& fread(&checksum, sizeof(checksum), 1, fp) == 1
+			&& checksum == HashBytes(&data[0], data.size());
+	}
+	fclose(fp);
+	if (!ok)
+		return false;
+
+	ltstr less;
+	IndexReader in(&data[0], data.size());
+	tstring root;
+	unsigned int count = 0;
+	ok = in.Get(root) && !less(root, rootPath) && !less(rootPath, root) && in.Get(count) && count == extensions.size();
+	for (tstringlist::const_iterator itr = extensions.begin(), end = extensions.end(); ok && itr != end; ++itr) {
+		tstring ext;
+		ok = in.Get(ext) && ext == *itr;
+	}
+
+	DirectoryMap loaded;
+	ok = ok && in.Get(count);
+	for (unsigned int i = 0; ok && i < count; ++i) {
+		tstring path;
+		unsigned int nsubdirs = 0, nfiles = 0;
+		Directory entry;
+		ok = in.Get(path) && in.Get(entry.stamp) && in.Get(nsubdirs);
+		for (unsigned int j = 0; ok && j < nsubdirs; ++j) {
+			entry.subdirs.push_back(tstring());
+			ok = in.Get(entry.subdirs.back());
+		}
+		ok = ok && in.Get(nfiles);
+		for (unsigned int j = 0; ok && j < nfiles; ++j) {
+			entry.files.push_back(KeyValuePair());
+			ok = in.Get(entry.files.back().first) && in.Get(entry.files.back().second);
+		}
+		if (ok)
+			std::swap(loaded[path], entry);
+	}
+	if (!ok)
+		return false;
+	dirs.swap(loaded);
+	return true;
+}
+
+bool TextureIndex::Save(const tstring& file) const
+{
+	IndexWriter out;
+	out.Put(rootPath);
+	out.Put(unsigned(extensions.size()));
+	for (tstringlist::const_iterator itr = extensions.begin(), end = extensions.end(); itr != end; ++itr)
+		out.Put(*itr);
+	out.Put(unsigned(dirs.size()));
+	for (DirectoryMap::const_iterator itr = dirs.begin(), end = dirs.end(); itr != end; ++itr) {
+		const Directory& entry = itr->second;
+		out.Put(itr->first);
+		out.Put(entry.stamp);
+		out.Put(unsigned(entry.subdirs.size()));
+		for (tstringlist::const_iterator sub = entry.subdirs.begin(); sub != entry.subdirs.end(); ++sub)
+			out.Put(*sub);
+		out.Put(unsigned(entry.files.size()));
+		for (size_t i = 0; i < entry.files.size(); ++i) {
+			out.Put(entry.files[i].first);
+			out.Put(entry.files[i].second);
+		}
+	}
+
+	// written to a private file and renamed into place so that another max
+	//   session never reads a partial index
+	tstring temp = FormatString(TEXT("%s.%lu.tmp"), file.c_str(), GetCurrentProcessId());
+	FILE *fp = _tfopen(temp.c_str(), TEXT("wb"));
+	if (fp == nullptr)
+		return false;
+	unsigned int header[3] = { TextureIndexMagic, TextureIndexVersion, unsigned(sizeof(TCHAR)) };
+	unsigned long long size = out.data.size();
+	unsigned long long checksum = HashBytes(&out.data[0], out.data.size());
+	bool ok = fwrite(header, sizeof(header), 1, fp) == 1
+		&& fwrite(&size, sizeof(size), 1, fp) == 1
+		&& fwrite(&out.data[0], 1, out.data.size(), fp) == out.data.size()
+		&& fwrite(&checksum, sizeof(checksum), 1, fp) == 1;
+	ok = (fclose(fp) == 0) && ok;
+	if (ok)
+		ok = MoveFileEx(temp.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+	if (!ok)
+		DeleteFile(temp.c_str());
+	return ok;
+}
+
+// Lists one directory the way BuildFileNameMap does: hidden and dot entries
+//   are skipped and files are named relative to the root path when possible.
+void TextureIndex::List(const tstring& dir, Directory& entry) const
+{
+	TCHAR buffer[MAX_PATH], relative[MAX_PATH];
+	WIN32_FIND_DATA FindFileData;
+	entry.subdirs.clear();
+	entry.files.clear();
+
+	tstring search = dir + TEXT("*");
+	HANDLE hFind = FindFirstFileEx(search.c_str(), FindExInfoBasic, &FindFileData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+	if (hFind == INVALID_HANDLE_VALUE)
+		return;
+	for (BOOL ok = TRUE; ok; ok = FindNextFile(hFind, &FindFileData)) {
+		if (FindFileData.cFileName[0] == '.' || (FindFileData.dwFileAttributes & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)))
+			continue;
+		if (FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			PathCombine(buffer, dir.c_str(), FindFileData.cFileName);
+			PathAddBackslash(buffer);
+			entry.subdirs.push_back(buffer);
+			continue;
+		}
+		LPCTSTR ext = PathFindExtension(FindFileData.cFileName);
+		bool match = false;
+		for (tstringlist::const_iterator itr = extensions.begin(), end = extensions.end(); !match && itr != end; ++itr)
+			match = (0 == _tcscmp(ext, itr->c_str()));
+		if (!match)
+			continue;
+
+		PathCombine(buffer, dir.c_str(), FindFileData.cFileName);
+		GetLongPathName(buffer, buffer, MAX_PATH);
+		PathRemoveExtension(FindFileData.cFileName);
+		if (PathRelativePathTo(relative, rootPath.c_str(), FILE_ATTRIBUTE_DIRECTORY, buffer, FILE_ATTRIBUTE_NORMAL)) {
+			TCHAR *p = relative; while (*p == '\\') ++p;
+			entry.files.push_back(KeyValuePair(FindFileData.cFileName, p));
+		}
+		else {
+			entry.files.push_back(KeyValuePair(FindFileData.cFileName, buffer));
+		}
+	}
+	FindClose(hFind);
+}
+
+// A directory's timestamp changes when entries are added, removed or renamed
+//   directly inside it, so an unchanged one keeps its listing but its
+//   subdirectories are still checked.
+void TextureIndex::Scan(const tstring& dir, DirectoryMap& scanned, bool& changed) const
+{
+	if (scanned.find(dir) != scanned.end())
+		return;
+	WIN32_FILE_ATTRIBUTE_DATA attr;
+	if (!GetFileAttributesEx(dir.c_str(), GetFileExInfoStandard, &attr) || !(attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		return;
+	unsigned long long stamp = ((unsigned long long)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+
+	Directory& entry = scanned[dir];
+	DirectoryMap::const_iterator prev = dirs.find(dir);
+	if (prev != dirs.end() && prev->second.stamp == stamp) {
+		entry = prev->second;
+	}
+	else {
+		entry.stamp = stamp;
+		List(dir, entry);
+		changed = true;
+	}
+	for (tstringlist::const_iterator itr = entry.subdirs.begin(), end = entry.subdirs.end(); itr != end; ++itr)
+		Scan(*itr, scanned, changed);
+}
+
+bool TextureIndex::Refresh(const tstringlist& searchPaths)
+{
+	ltstr less;
+	roots.clear();
+	for (tstringlist::const_iterator itr = searchPaths.begin(), end = searchPaths.end(); itr != end; ++itr) {
+		if (itr->empty())
+			continue;
+		tstring key;
+		if (PathIsRelative(itr->c_str())) {
+			TCHAR texPath[MAX_PATH];
+			PathCombine(texPath, rootPath.c_str(), itr->c_str());
+			key = DirectoryKey(texPath);
+		}
+		else {
+			key = DirectoryKey(itr->c_str());
+		}
+		// a repeated search path adds nothing new
+		bool seen = key.empty();
+		for (tstringlist::const_iterator root = roots.begin(); !seen && root != roots.end(); ++root)
+			seen = !less(*root, key) && !less(key, *root);
+		if (!seen)
+			roots.push_back(key);
+	}
+
+	// each root is walked against the loaded index, which stays read only until
+	//   all walks are done.  Directories that are no longer reachable drop out.
+	std::vector<tstring> rootList(roots.begin(), roots.end());
+	std::vector<DirectoryMap> scanned(rootList.size());
+	std::vector<char> rootChanged(rootList.size(), 0);
+	ParallelFor(rootList.size(), [&](size_t i) {
+		bool changed = false;
+		Scan(rootList[i], scanned[i], changed);
+		rootChanged[i] = changed;
+	});
+
+	DirectoryMap merged;
+	bool changed = false;
+	for (size_t i = 0; i < scanned.size(); ++i) {
+		changed = changed || rootChanged[i] != 0;
+		merged.insert(scanned[i].begin(), scanned[i].end());
+	}
+	changed = changed || merged.size() != dirs.size();
+	dirs.swap(merged);
+	return changed;
+}
+
+void TextureIndex::FillDirectory(const tstring& dir, NameValueCollection& images) const
+{
+	DirectoryMap::const_iterator itr = dirs.find(dir);
+	if (itr == dirs.end())
+		return;
+	const Directory& entry = itr->second;
+	for (size_t i = 0; i < entry.files.size(); ++i) {
+		if (images.find(entry.files[i].first) == images.end())
+			images.insert(entry.files[i]);
+	}
+	for (tstringlist::const_iterator sub = entry.subdirs.begin(), end = entry.subdirs.end(); sub != end; ++sub)
+		FillDirectory(*sub, images);
+}
+
+void TextureIndex::Fill(NameValueCollection& images) const
+{
+	for (tstringlist::const_iterator itr = roots.begin(), end = roots.end(); itr != end; ++itr)
+		FillDirectory(*itr, images);
+}
@@ -0,0 +1,54 @@
+/**********************************************************************
+*<
+FILE: TextureIndex.h
+
+DESCRIPTION:	Persistent index of the textures below the search paths.
+               Every directory is stored with its last write time so a
+               refresh only lists the directories whose entries changed.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#pragma once
+
+#include "niutils.h"
+
+class TextureIndex
+{
+public:
+	TextureIndex(const tstring& rootPath, const tstringlist& extensions);
+
+	// Reads an index written by Save.  Returns false and leaves the index
+	//   empty if the file is missing, damaged or was built for a different
+	//   root path or extension list.
+	bool Load(const tstring& file);
+	bool Save(const tstring& file) const;
+
+	// Brings the index up to date with the search paths, walking them in
+	//   parallel.  Unchanged directories cost one timestamp query each.
+	//   Returns true if the index differs from what was loaded.
+	bool Refresh(const tstringlist& searchPaths);
+
+	// Adds name to path pairs in the same order as FindImages so the first
+	//   file found for a name wins.
+	void Fill(NameValueCollection& images) const;
+
+private:
+	struct Directory
+	{
+		unsigned long long stamp;   // last write time
+		tstringlist subdirs;        // full paths in listing order
+		std::vector<KeyValuePair> files;
+	};
+	typedef std::map<tstring, Directory, ltstr> DirectoryMap;
+
+	void Scan(const tstring& dir, DirectoryMap& scanned, bool& changed) const;
+	void List(const tstring& dir, Directory& entry) const;
+	void FillDirectory(const tstring& dir, NameValueCollection& images) const;
+
+	tstring rootPath;
+	tstringlist extensions;
+	tstringlist roots;
+	DirectoryMap dirs;
+};
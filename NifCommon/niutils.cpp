@@ -305,18 +305,44 @@ wstring JoinCommandLine(wstringlist args)
 	return str.str();
 }
 
-// Parse and ini file section and return the results as s NameValueCollection.
-NameValueCollectionA ReadIniSection(LPCSTR Section, LPCSTR iniFileName)
+// Read a whole ini file section.  The profile api reports a full buffer as
+//   its size less two, so grow geometrically until the section fits.
+//   Returns a double null terminated buffer to be released with free.
+static LPSTR ReadIniSectionBuffer(LPCSTR Section, LPCSTR iniFileName)
 {
-	NameValueCollectionA map;
-	DWORD len = 2048 * sizeof(char);
-	LPSTR buf = (LPSTR)calloc(len + 2, 1);
+	DWORD len = 4096;
+	LPSTR buf = (LPSTR)calloc(len + 2, sizeof(char));
 	while (nullptr != buf) {
 		DWORD rlen = GetPrivateProfileSectionA(Section, buf, len, iniFileName);
 		if (rlen != (len - 2)) break;
-		len += 2;
-		buf = (LPSTR)realloc(buf, len);
+		len *= 2;
+		LPSTR grown = (LPSTR)realloc(buf, (len + 2) * sizeof(char));
+		if (nullptr == grown) free(buf);
+		buf = grown;
+	}
+	return buf;
+}
+
+static LPWSTR ReadIniSectionBuffer(LPCWSTR Section, LPCWSTR iniFileName)
+{
+	DWORD len = 4096;
+	LPWSTR buf = (LPWSTR)calloc(len + 2, sizeof(wchar_t));
+	while (nullptr != buf) {
+		DWORD rlen = MaxSDK::Util::GetPrivateProfileSectionW(Section, buf, len, iniFileName);
+		if (rlen != (len - 2)) break;
+		len *= 2;
+		LPWSTR grown = (LPWSTR)realloc(buf, (len + 2) * sizeof(wchar_t));
+		if (nullptr == grown) free(buf);
+		buf = grown;
 	}
+	return buf;
+}
+
+// Parse and ini file section and return the results as s NameValueCollection.
+NameValueCollectionA ReadIniSection(LPCSTR Section, LPCSTR iniFileName)
+{
+	NameValueCollectionA map;
+	LPSTR buf = ReadIniSectionBuffer(Section, iniFileName);
 	if (nullptr != buf) {
 		for (LPSTR line = buf, next = line + strlen(line) + 1; *line; line = next, next = line + strlen(line) + 1) {
 			Trim(line);
@@ -328,6 +354,7 @@ NameValueCollectionA ReadIniSection(LPCSTR Section, LPCSTR iniFileName)
 				map[string(line)] = string(equals);
 			}
 		}
+		free(buf);
 	}
 	return map;
 }
@@ -335,14 +362,7 @@ NameValueCollectionA ReadIniSection(LPCSTR Section, LPCSTR iniFileName)
 NameValueCollectionW ReadIniSection(LPCWSTR Section, LPCWSTR iniFileName)
 {
 	NameValueCollectionW map;
-	DWORD len = 2048 * sizeof(wchar_t);
-	LPWSTR buf = (LPWSTR)calloc(len + 2, 1);
-	while (nullptr != buf) {
-		DWORD rlen = MaxSDK::Util::GetPrivateProfileSectionW(Section, buf, len, iniFileName);
-		if (rlen != (len - 2)) break;
-		len += 2;
-		buf = (LPWSTR)realloc(buf, len*sizeof(wchar_t));
-	}
+	LPWSTR buf = ReadIniSectionBuffer(Section, iniFileName);
 	if (nullptr != buf) {
 		for (LPWSTR line = buf, next = line + wcslen(line) + 1; *line; line = next, next = line + wcslen(line) + 1) {
 			Trim(line);
@@ -354,6 +374,7 @@ NameValueCollectionW ReadIniSection(LPCWSTR Section, LPCWSTR iniFileName)
 				map[wstring(line)] = wstring(equals);
 			}
 		}
+		free(buf);
 	}
 	return map;
 }
@@ -363,14 +384,7 @@ NameValueCollectionW ReadIniSection(LPCWSTR Section, LPCWSTR iniFileName)
 bool ReadIniSectionAsList(LPCSTR Section, LPCSTR iniFileName, NameValueListA& map)
 {
 	
-	DWORD len = 2048 * sizeof(char);
-	LPSTR buf = (LPSTR)calloc(len + 2, 1);
-	while (nullptr != buf) {
-		DWORD rlen = GetPrivateProfileSectionA(Section, buf, len, iniFileName);
-		if (rlen != (len - 2)) break;
-		len += 2;
-		buf = (LPSTR)realloc(buf, len);
-	}
+	LPSTR buf = ReadIniSectionBuffer(Section, iniFileName);
 	if (nullptr == buf) 
 		return false;
 
@@ -384,19 +398,13 @@ bool ReadIniSectionAsList(LPCSTR Section, LPCSTR iniFileName, NameValueListA& ma
 			map.push_back(KeyValuePairA(line, equals));
 		}
 	}
+	free(buf);
 	return true;
 }
 
 bool ReadIniSectionAsList(LPCWSTR Section, LPCWSTR iniFileName, NameValueListW& map)
 {
-	DWORD len = 2048 * sizeof(wchar_t);
-	LPWSTR buf = (LPWSTR)calloc(len + 2, 1);
-	while (nullptr != buf) {
-		DWORD rlen = MaxSDK::Util::GetPrivateProfileSectionW(Section, buf, len, iniFileName);
-		if (rlen != (len - 2)) break;
-		len += 2;
-		buf = (LPWSTR)realloc(buf, len*sizeof(wchar_t));
-	}
+	LPWSTR buf = ReadIniSectionBuffer(Section, iniFileName);
 	if (nullptr == buf)
 		return false;
 	for (LPWSTR line = buf, next = line + wcslen(line) + 1; *line; line = next, next = line + wcslen(line) + 1) {
@@ -409,6 +417,7 @@ bool ReadIniSectionAsList(LPCWSTR Section, LPCWSTR iniFileName, NameValueListW&
 			map.push_back(KeyValuePairW(line,equals));
 		}
 	}
+	free(buf);
 	return true;
 }
 
@@ -1427,13 +1436,13 @@ void CalcAxisAlignedSphere(const vector<Vector3>& vertices, Vector3& center, flo
 		const Vector3 & v = vertices[i];
 
 		if (v.x > highs.x) highs.x = v.x;
-		else if (v.x < lows.x) lows.x = v.x;
+		if (v.x < lows.x) lows.x = v.x;
 
 		if (v.y > highs.y) highs.y = v.y;
-		else if (v.y < lows.y) lows.y = v.y;
+		if (v.y < lows.y) lows.y = v.y;
 
 		if (v.z > highs.z) highs.z = v.z;
-		else if (v.z < lows.z) lows.z = v.z;
+		if (v.z < lows.z) lows.z = v.z;
 	}
 
 	//Now we know the extent of the shape, so the center will be the average
@@ -19,6 +19,8 @@ HISTORY:
 #include "NifExport.h"
 #include "niutils.h"
 #include "AnimKey.h"
+#include "KeyReduction.h"
+#include "ParallelFor.h"
 #ifdef USE_BIPED
 #  include <cs/BipedApi.h>
 #endif
@@ -57,6 +59,15 @@ enum {
 static void GetTimeRange(Control *c, Interval& range);
 static Interval GetTimeRange(INode *node);
 
+// Sampled keys waiting for reduction before they are set on their data
+struct SampledTrack
+{
+	NiKeyframeDataRef data;
+	vector<Vector3Key> posKeys;
+	vector<QuatKey> rotKeys;
+	vector<FloatKey> scaleKeys;
+};
+
 struct AnimationExport
 {
 	AnimationExport(Exporter& parent) : ne(parent) { }
@@ -70,6 +81,8 @@ struct AnimationExport
 	NiTimeControllerRef exportController(INode *node, Interval range, bool setTM);
 
 	bool SampleAnimation(INode * node, Interval &range, PosRotScale prs, NiKeyframeDataRef data);
+	void queueSampledKeys(NiKeyframeDataRef data, vector<Vector3Key> &posKeys, vector<QuatKey> &rotKeys, vector<FloatKey> &scaleKeys);
+	void flushSampledKeys();
 	bool GetTextKeys(INode *node, vector<StringKey>& textKeys);
 	bool splitAccum(NiTransformDataRef base, NiTransformDataRef accum, Exporter::AccumType accumType);
 	void GetTimeRange(Control *c, Interval& range);
@@ -81,6 +94,7 @@ struct AnimationExport
 
 	set<NiAVObjectRef> objRefs;
 	map<NiControllerSequenceRef, Interval> ranges;
+	vector<SampledTrack> sampledTracks;
 };
 
 float QuatDot(const Quaternion& q, const Quaternion&p)
@@ -251,12 +265,14 @@ NiNodeRef Exporter::createAccumNode(NiNodeRef parent, INode *node)
 
 Exporter::Result Exporter::doAnimExport(NiControllerSequenceRef root)
 {
+	ProfileScope profile(ExportProfiler::Animation);
 	AnimationExport animExporter(*this);
 	return animExporter.doExport(root) ? Exporter::Ok : Exporter::Abort;
 }
 
 Exporter::Result Exporter::doAnimExport(NiControllerManagerRef mgr, INode *node)
 {
+	ProfileScope profile(ExportProfiler::Animation);
 	AnimationExport animExporter(*this);
 	return animExporter.doExport(mgr, node) ? Exporter::Ok : Exporter::Abort;
 }
@@ -538,7 +554,9 @@ bool AnimationExport::doExport(NiControllerSequenceRef seq)
 
 	// Now let the fun begin.
 
-	return exportController(node, accumType);
+	bool ok = exportController(node, accumType);
+	flushSampledKeys();
+	return ok;
 }
 
 bool AnimationExport::doExport(NiControllerManagerRef mgr, INode *node)
@@ -718,6 +736,7 @@ bool AnimationExport::doExport(NiControllerManagerRef mgr, INode *node)
 		// Now let the fun begin.
 		bool ok = exportController(node, accumType);
 	}
+	flushSampledKeys();
 
 	// Set objects with animation
 	vector<NiAVObjectRef> objs;
@@ -942,10 +961,9 @@ NiTimeControllerRef Exporter::CreateController(INode *node, Interval range)
 			textKeyData->SetKeys(textKeys);
 		}
 	}
-	if (NiTimeControllerRef tc = ae.exportController(node, range, false)) {
-		return tc;
-	}
-	return NiTimeControllerRef();
+	NiTimeControllerRef tc = ae.exportController(node, range, false);
+	ae.flushSampledKeys();
+	return tc;
 }
 
 NiTimeControllerRef AnimationExport::exportController(INode *node, Interval range, bool setTM)
@@ -1077,11 +1095,10 @@ NiTimeControllerRef AnimationExport::exportController(INode *node, Interval rang
 				}
 
 				// Dont really know what else to use since I cant get anything but the raw data.
+				vector<FloatKey> scaleKeys;
 				data->SetTranslateType(LINEAR_KEY);
-				data->SetTranslateKeys(posKeys);
 				data->SetRotateType(LINEAR_KEY);
-				data->SetQuatRotateKeys(rotKeys);
-				//data->SetScaleKeys();
+				queueSampledKeys(data, posKeys, rotKeys, scaleKeys);
 				if (iNumKeys != 0) { // if no changes set the base transform
 					keepData = true;
 				}
@@ -1135,11 +1152,12 @@ NiTimeControllerRef AnimationExport::exportController(INode *node, Interval rang
 					rotKeys.push_back(qk);
 				}
 				// Dont really know what else to use since I cant get anything but the raw data.
+				vector<FloatKey> scaleKeys;
+				bool hasKeys = (posKeys.size() != 0 || rotKeys.size() != 0);
 				data->SetTranslateType(LINEAR_KEY);
-				data->SetTranslateKeys(posKeys);
 				data->SetRotateType(LINEAR_KEY);
-				data->SetQuatRotateKeys(rotKeys);
-				if (posKeys.size() != 0 || rotKeys.size() != 0) { // if no changes set the base transform
+				queueSampledKeys(data, posKeys, rotKeys, scaleKeys);
+				if (hasKeys) { // if no changes set the base transform
 					keepData = true;
 				}
 
@@ -1518,6 +1536,8 @@ bool AnimationExport::exportController(INode *node, Exporter::AccumType accumTyp
 						}
 						else {
 							accinterp->SetData(accumData);
+							// the split reads the final keys of the root
+							flushSampledKeys();
 							splitAccum(interp->GetData(), accumData, accumType);
 						}
 					}
@@ -1552,14 +1572,18 @@ bool AnimationExport::SampleAnimation(INode * node, Interval &range, PosRotScale
 
 	vector<Vector3Key> posKeys;
 	vector<QuatKey> rotKeys;
+	vector<FloatKey> scaleKeys;
 	TimeValue interval = (range.Duration()) / TicksPerFrame;
 	Quaternion prevq;
+	bool scaled = false;
+	float scaleThresh = max(Exporter::mKeyScaleTolerance, 1.0e-5f);
 	for (TimeValue t = range.Start(); t <= range.End(); t += interval)
 	{
 		Matrix3 tm = ne.getNodeTransform(node, t, true);
 		Vector3Key p;
 		QuatKey q;
-		q.time = p.time = FrameToTime(t);
+		FloatKey s;
+		s.time = q.time = p.time = FrameToTime(t);
 		p.data = TOVECTOR3(tm.GetTrans());
 		q.data = TOQUAT(Quat(tm), true);
 
@@ -1571,27 +1595,92 @@ bool AnimationExport::SampleAnimation(INode * node, Interval &range, PosRotScale
 
 		posKeys.push_back(p);
 		rotKeys.push_back(q);
+		if (prs & prsScale) {
+			s.data = Average(GetScale(tm));
+			scaled |= (fabs(s.data - 1.0f) > scaleThresh);
+			scaleKeys.push_back(s);
+		}
 	}
 
 	// Dont really know what else to use since I cant get anything but the raw data.
 	if (prs & prsPos && !posKeys.empty())
 	{
 		data->SetTranslateType(LINEAR_KEY);
-		data->SetTranslateKeys(posKeys);
 		keepData = true;
 	}
+	else
+	{
+		posKeys.clear();
+	}
 	if (prs & prsRot && !rotKeys.empty())
 	{
 		data->SetRotateType(LINEAR_KEY);
-		data->SetQuatRotateKeys(rotKeys);
 		keepData = true;
 	}
-	if (prs & prsScale)
+	else
+	{
+		rotKeys.clear();
+	}
+	// scale stays on the interpolator unless it actually changes
+	if (scaled)
+	{
+		data->SetScaleType(LINEAR_KEY);
+		keepData = true;
+	}
+	else
 	{
-		//data->SetScaleKeys();
+		scaleKeys.clear();
 	}
+	queueSampledKeys(data, posKeys, rotKeys, scaleKeys);
 	return keepData;
 }
+
+void AnimationExport::queueSampledKeys(NiKeyframeDataRef data, vector<Vector3Key> &posKeys, vector<QuatKey> &rotKeys, vector<FloatKey> &scaleKeys)
+{
+	if (posKeys.empty() && rotKeys.empty() && scaleKeys.empty())
+		return;
+	sampledTracks.push_back(SampledTrack());
+	SampledTrack &track = sampledTracks.back();
+	track.data = data;
+	track.posKeys.swap(posKeys);
+	track.rotKeys.swap(rotKeys);
+	track.scaleKeys.swap(scaleKeys);
+}
+
+// Reduces the queued tracks in parallel and sets the remaining keys on their data
+void AnimationExport::flushSampledKeys()
+{
+	if (sampledTracks.empty())
+		return;
+
+	size_t before = 0, after = 0;
+	for (size_t i = 0; i < sampledTracks.size(); ++i) {
+		const SampledTrack &track = sampledTracks[i];
+		before += track.posKeys.size() + track.rotKeys.size() + track.scaleKeys.size();
+	}
+
+	float rotTolerance = TORAD(Exporter::mKeyRotTolerance);
+	ParallelFor(sampledTracks.size(), [&](size_t i) {
+		SampledTrack &track = sampledTracks[i];
+		ReduceLinearKeys(track.posKeys, Exporter::mKeyPosTolerance);
+		ReduceLinearKeys(track.rotKeys, rotTolerance);
+		ReduceLinearKeys(track.scaleKeys, Exporter::mKeyScaleTolerance);
+	});
+
+	for (size_t i = 0; i < sampledTracks.size(); ++i) {
+		SampledTrack &track = sampledTracks[i];
+		if (!track.posKeys.empty())
+			track.data->SetTranslateKeys(track.posKeys);
+		if (!track.rotKeys.empty())
+			track.data->SetQuatRotateKeys(track.rotKeys);
+		if (!track.scaleKeys.empty())
+			track.data->SetScaleKeys(track.scaleKeys);
+		after += track.posKeys.size() + track.rotKeys.size() + track.scaleKeys.size();
+	}
+	if (Exporter::mDebugEnabled)
+		OutputDebugStringA(FormatString("Key reduction: %d tracks, %d -> %d keys\n", int(sampledTracks.size()), int(before), int(after)).c_str());
+	sampledTracks.clear();
+}
 Exporter::Result Exporter::exportGeomMorpherControl(Modifier* mod, vector<Vector3>& baseVerts, vector<int>& baseVertIdx, NiObjectNETRef owner)
 {
 	USES_CONVERSION;
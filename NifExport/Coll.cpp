@@ -13,6 +13,11 @@
 #include "..\NifProps\bhkHelperFuncs.h"
 #include "..\NifProps\bhkHelperInterface.h"
 #include "vectorstream.hpp"
+#include "..\NifCommon\MoppBuilder.h"
+#include "..\NifCommon\ConvexSolvers.h"
+#include "MoppCache.h"
+#include "ParallelFor.h"
+#include <mutex>
 static Class_ID SCUBA_CLASS_ID(0x6d3d77ac, 0x79c939a9);
 extern Class_ID BHKRIGIDBODYMODIFIER_CLASS_ID;
 extern Class_ID BHKLISTOBJECT_CLASS_ID;
@@ -37,7 +42,10 @@ inline int GetPBValue(IParamBlock2 *pb, int id, int defaultValue)
 }
 
 extern HINSTANCE hInstance;
-class HavokMoppCode
+
+// NifMopp.dll backend.  The dll keeps the last generated code in globals until
+//   it is retrieved, so generation is serialized.
+class HavokMoppCode : public IMoppBuilder
 {
 private:
 	struct RemoteCommand
@@ -60,6 +68,7 @@ private:
 	fnRetrieveMoppOrigin RetrieveMoppOrigin;
 	fnGenerateMoppCodeWithSubshapes GenerateMoppCodeWithSubshapes;
 	fnExecuteCommand ExecuteCommand;
+	std::mutex lock;
 
 public:
 	HavokMoppCode() : hMoppLib(nullptr), GenerateMoppCode(nullptr), RetrieveMoppCode(nullptr)
@@ -95,150 +104,38 @@ public:
 			);
 	}
 
-	vector<Niflib::byte> CalculateMoppCode(vector<Niflib::Vector3> const & verts, vector<Niflib::Triangle> const & tris, Niflib::Vector3* origin, float* scale)
-	{
-		vector<Niflib::byte> code;
-		if (Initialize())
-		{
-			int len = GenerateMoppCode(verts.size(), &verts[0], tris.size(), &tris[0]);
-			if (len > 0)
-			{
-				code.resize(len);
-				if (0 != RetrieveMoppCode(len, &code[0]))
-				{
-					if (NULL != scale)
-						RetrieveMoppScale(scale);
-					if (NULL != origin)
-						RetrieveMoppOrigin(origin);
-				}
-				else
-				{
-					code.clear();
-				}
-			}
-		}
-		return code;
-	}
+	const char *Name() const { return "NifMopp.dll"; }
 
-	vector<Niflib::byte> CalculateMoppCode(vector<OblivionSubShape> const & shapes
-		, vector<Niflib::Vector3> const & verts
-		, vector<Niflib::Triangle> const & tris
-		, Niflib::Vector3* origin, float* scale)
+	bool Build(const MoppGeometry &geom, MoppCode &result)
 	{
-		vector<Niflib::byte> code;
-		if (Initialize())
-		{
-			vector<int> subshapeverts;
-			for (vector<OblivionSubShape>::const_iterator itr = shapes.begin(); itr != shapes.end(); ++itr)
-				subshapeverts.push_back(itr->numVertices);
+		std::lock_guard<std::mutex> guard(lock);
+		result.code.clear();
+		if (!Initialize() || geom.numTris == 0)
+			return false;
 
-			int len = 0;
-			if (GenerateMoppCodeWithSubshapes != NULL)
-				len = GenerateMoppCodeWithSubshapes(subshapeverts.size(), &subshapeverts[0], verts.size(), &verts[0], tris.size(), &tris[0]);
-			else
-				len = GenerateMoppCode(verts.size(), &verts[0], tris.size(), &tris[0]);
-			if (len > 0)
-			{
-				code.resize(len);
-				if (0 != RetrieveMoppCode(len, &code[0]))
-				{
-					if (NULL != scale)
-						RetrieveMoppScale(scale);
-					if (NULL != origin)
-						RetrieveMoppOrigin(origin);
-				}
-				else
-				{
-					code.clear();
-				}
-			}
-		}
-		return code;
-	}
+		const Vector3 *verts = reinterpret_cast<const Vector3*>(geom.verts);
+		const Triangle *tris = reinterpret_cast<const Triangle*>(geom.tris);
+		int len = 0;
+		if (geom.numSubshapes > 0 && GenerateMoppCodeWithSubshapes != NULL)
+			len = GenerateMoppCodeWithSubshapes(geom.numSubshapes, geom.subshapeVerts, geom.numVerts, verts, geom.numTris, tris);
+		else
+			len = GenerateMoppCode(geom.numVerts, verts, geom.numTris, tris);
+		if (len <= 0)
+			return false;
 
-	vector<Niflib::byte> CalculateMoppCode(Ref<bhkCompressedMeshShapeData> const & data, Niflib::Vector3* origin, float* scale)
-	{
-		vector<Niflib::byte> code;
-		if (Initialize())
+		result.code.resize(len);
+		if (0 == RetrieveMoppCode(len, &result.code[0]))
 		{
-			vector<int> subshapeverts;
-			const vector<bhkCMSDBigTris>& bigTris = data->GetBigTris();
-			const vector<Vector4>& bigVerts = data->GetBigVerts();
-			const vector<bhkCMSDChunk>& chunks = data->GetChunks();
-
-			int totalVerts = bigVerts.size();
-			int totalTris = bigTris.size();
-			for (const bhkCMSDChunk& chunk : chunks) {
-				totalVerts += chunk.numVertices / 3;
-				totalTris += chunk.numStrips;
-			}
-			vector<Vector3> verts; verts.reserve(totalVerts);
-			vector<Triangle> tris; tris.reserve(totalTris);
-
-			int voffset = 0;
-			if (!bigVerts.empty())
-			{
-				int numVerts = data->GetBigVerts().size();
-				subshapeverts.push_back(numVerts);
-				for (int i = 0; i < bigVerts.size(); i++)
-					verts.push_back(TOVECTOR3(bigVerts[i]));
-				for (int i = 0; i < bigTris.size(); i++)
-					tris.push_back(Niflib::Triangle(bigTris[i].triangle1, bigTris[i].triangle2, bigTris[i].triangle3));
-				voffset += numVerts;
-			}
-
-			for (const bhkCMSDChunk& chunk : chunks) {
-				auto chunkOrigin = TOVECTOR3(chunk.translation);
-				int numVerts = chunk.numVertices / 3;
-				int numIndices = chunk.numIndices;
-				int numStrips = chunk.numStrips;
-				const auto& offsets = chunk.vertices;
-				const auto& indices = chunk.indices;
-				const auto& strips = chunk.strips;
-
-				for (auto n = 0; n < numVerts; n++) {
-					verts.push_back(chunkOrigin + Vector3(offsets[3 * n], offsets[3 * n + 1], offsets[3 * n + 2]) / 1000.0f);
-				}
-				// Stripped tris
-				int offset = 0;
-				for (auto s = 0; s < numStrips; s++) {
-					for (auto f = 0; f < strips[s] - 2; f++) {
-						if ((f + 1) % 2 == 0)
-							tris.push_back(Triangle(voffset + indices[offset + f + 2], voffset + indices[offset + f + 1], voffset + indices[offset + f + 0]));
-						else
-							tris.push_back(Triangle(voffset + indices[offset + f + 0], voffset + indices[offset + f + 1], voffset + indices[offset + f + 2]));
-					}
-					offset += strips[s];
-				}
-				// Non-stripped tris
-				for (auto f = 0; f < (numIndices - offset); f += 3) {
-					tris.push_back(Triangle(voffset + indices[offset + f + 0], voffset + indices[offset + f + 1], voffset + indices[offset + f + 2]));
-				}
-				subshapeverts.push_back(numVerts);
-			}
-
-			int len = 0;
-			if (GenerateMoppCodeWithSubshapes != nullptr)
-				len = GenerateMoppCodeWithSubshapes(subshapeverts.size(), &subshapeverts[0], verts.size(), &verts[0], tris.size(), &tris[0]);
-			else
-				len = GenerateMoppCode(verts.size(), &verts[0], tris.size(), &tris[0]);
-			if (len > 0)
-			{
-				code.resize(len);
-				if (0 != RetrieveMoppCode(len, &code[0]))
-				{
-					if (NULL != scale)
-						RetrieveMoppScale(scale);
-					if (NULL != origin)
-						RetrieveMoppOrigin(origin);
-				}
-				else
-				{
-					code.clear();
-				}
-			}
+			result.code.clear();
+			return false;
 		}
-		return code;
+		Vector3 origin;
+		RetrieveMoppScale(&result.scale);
+		RetrieveMoppOrigin(&origin);
+		result.origin[0] = origin.x;
+		result.origin[1] = origin.y;
+		result.origin[2] = origin.z;
+		return true;
 	}
 
 	struct VectorStreams : RemoteCommand
@@ -293,10 +190,80 @@ public:
 	}
 } TheHavokCode;
 
+// Runs the configured builder first and the other one if it declines.  The
+//   native encoder is only used when MoppBuilder asks for it since its output
+//   has not been checked against NifMopp.dll yet.  Cache entries are keyed by
+//   the builder that made them, so code from a fallback is not served once
+//   the preferred builder becomes available.
+static bool BuildMoppCode(const MoppGeometry &geom, const MoppCacheKey &key, MoppCode &result)
+{
+	IMoppBuilder *builders[2] = { &TheHavokCode, nullptr };
+	if (Exporter::mMoppBuilder == 1) {
+		builders[0] = GetNativeMoppBuilder();
+		builders[1] = &TheHavokCode;
+	}
+	else if (Exporter::mMoppBuilder == 2) {
+		builders[1] = GetNativeMoppBuilder();
+	}
+	for (int i = 0; i < 2 && builders[i] != nullptr; ++i)
+	{
+		const char *name = builders[i]->Name();
+		MoppCacheKey builderKey = key;
+		builderKey.Add(name, strlen(name));
+		if (MoppCache::Load(Exporter::mMoppCacheDir, builderKey, result))
+		{
+			if (Exporter::mDebugEnabled)
+				OutputDebugStringA(FormatString("MOPP by %s loaded from cache: %d triangles, %d bytes\n"
+					, name, int(geom.numTris), int(result.code.size())).c_str());
+			return true;
+		}
+		if (builders[i]->Build(geom, result))
+		{
+			if (Exporter::mDebugEnabled)
+				OutputDebugStringA(FormatString("MOPP built by %s: %d triangles, %d bytes\n"
+					, name, int(geom.numTris), int(result.code.size())).c_str());
+			MoppCache::Store(Exporter::mMoppCacheDir, builderKey, result);
+			return true;
+		}
+	}
+	return false;
+}
+
+// key holds the material and layer data of the shape; the geometry and the
+//   settings that change the generated code are added here
+static vector<Niflib::byte> ConstructHKMesh(const MoppGeometry &geom, MoppCacheKey key, Niflib::Vector3& origin, float& scale)
+{
+	key.Add(geom);
+	key.Add(unsigned(Exporter::mNifVersionInt));
+	key.Add(unsigned(Exporter::mNifUserVersion));
+	key.Add(unsigned(Exporter::mNifUserVersion2));
+
+	MoppCode result;
+	if (!BuildMoppCode(geom, key, result))
+		return vector<Niflib::byte>();
+	origin = Vector3(result.origin[0], result.origin[1], result.origin[2]);
+	scale = result.scale;
+	return result.code;
+}
+
+static MoppGeometry MakeMoppGeometry(const vector<Vector3> &verts, const vector<Triangle> &tris)
+{
+	static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be three packed floats");
+	static_assert(sizeof(Triangle) == 3 * sizeof(unsigned short), "Triangle must be three packed indices");
+	MoppGeometry geom;
+	geom.verts = verts.empty() ? NULL : &verts[0].x;
+	geom.numVerts = verts.size();
+	geom.tris = tris.empty() ? NULL : &tris[0].v1;
+	geom.numTris = tris.size();
+	return geom;
+}
+
 static vector<Niflib::byte> ConstructHKMesh(NiTriBasedGeomRef shape, Niflib::Vector3& origin, float& scale)
 {
 	NiTriBasedGeomDataRef data = shape->GetData();
-	return TheHavokCode.CalculateMoppCode(data->GetVertices(), data->GetTriangles(), &origin, &scale);
+	vector<Vector3> verts = data->GetVertices();
+	vector<Triangle> tris = data->GetTriangles();
+	return ConstructHKMesh(MakeMoppGeometry(verts, tris), MoppCacheKey(), origin, scale);
 }
 
 static vector<Niflib::byte> ConstructHKMesh(bhkShapeRef shape, Niflib::Vector3& origin, float& scale)
@@ -304,11 +271,97 @@ static vector<Niflib::byte> ConstructHKMesh(bhkShapeRef shape, Niflib::Vector3&
 	if (bhkPackedNiTriStripsShapeRef mesh = DynamicCast<bhkPackedNiTriStripsShape>(shape))
 	{
 		hkPackedNiTriStripsDataRef data = mesh->GetData();
-		return TheHavokCode.CalculateMoppCode(mesh->GetSubShapes(), data->GetVertices(), data->GetTriangles(), &origin, &scale);
+		vector<Vector3> verts = data->GetVertices();
+		vector<Triangle> tris = data->GetTriangles();
+		vector<OblivionSubShape> shapes = mesh->GetSubShapes();
+		vector<int> subshapeverts;
+		MoppCacheKey key;
+		for (vector<OblivionSubShape>::const_iterator itr = shapes.begin(); itr != shapes.end(); ++itr)
+		{
+			subshapeverts.push_back(itr->numVertices);
+			key.Add(unsigned(itr->layer));
+			key.Add(unsigned(itr->colFilter));
+			key.Add(unsigned(itr->material));
+		}
+
+		MoppGeometry geom = MakeMoppGeometry(verts, tris);
+		geom.subshapeVerts = subshapeverts.empty() ? NULL : &subshapeverts[0];
+		geom.numSubshapes = subshapeverts.size();
+		return ConstructHKMesh(geom, key, origin, scale);
 	}
 	else if (bhkCompressedMeshShapeRef cmsd = DynamicCast<bhkCompressedMeshShape>(shape))
 	{
-		return TheHavokCode.CalculateMoppCode(cmsd->GetData(), &origin, &scale);
+		Ref<bhkCompressedMeshShapeData> data = cmsd->GetData();
+		vector<int> subshapeverts;
+		const vector<bhkCMSDBigTris>& bigTris = data->GetBigTris();
+		const vector<Vector4>& bigVerts = data->GetBigVerts();
+		const vector<bhkCMSDChunk>& chunks = data->GetChunks();
+
+		int totalVerts = bigVerts.size();
+		int totalTris = bigTris.size();
+		for (const bhkCMSDChunk& chunk : chunks) {
+			totalVerts += chunk.numVertices / 3;
+			totalTris += chunk.numStrips;
+		}
+		vector<Vector3> verts; verts.reserve(totalVerts);
+		vector<Triangle> tris; tris.reserve(totalTris);
+
+		int voffset = 0;
+		if (!bigVerts.empty())
+		{
+			int numVerts = data->GetBigVerts().size();
+			subshapeverts.push_back(numVerts);
+			for (int i = 0; i < bigVerts.size(); i++)
+				verts.push_back(TOVECTOR3(bigVerts[i]));
+			for (int i = 0; i < bigTris.size(); i++)
+				tris.push_back(Niflib::Triangle(bigTris[i].triangle1, bigTris[i].triangle2, bigTris[i].triangle3));
+			voffset += numVerts;
+		}
+
+		for (const bhkCMSDChunk& chunk : chunks) {
+			auto chunkOrigin = TOVECTOR3(chunk.translation);
+			int numVerts = chunk.numVertices / 3;
+			int numIndices = chunk.numIndices;
+			int numStrips = chunk.numStrips;
+			const auto& offsets = chunk.vertices;
+			const auto& indices = chunk.indices;
+			const auto& strips = chunk.strips;
+
+			for (auto n = 0; n < numVerts; n++) {
+				verts.push_back(chunkOrigin + Vector3(offsets[3 * n], offsets[3 * n + 1], offsets[3 * n + 2]) / 1000.0f);
+			}
+			// Stripped tris
+			int offset = 0;
+			for (auto s = 0; s < numStrips; s++) {
+				for (auto f = 0; f < strips[s] - 2; f++) {
+					if ((f + 1) % 2 == 0)
+						tris.push_back(Triangle(voffset + indices[offset + f + 2], voffset + indices[offset + f + 1], voffset + indices[offset + f + 0]));
+					else
+						tris.push_back(Triangle(voffset + indices[offset + f + 0], voffset + indices[offset + f + 1], voffset + indices[offset + f + 2]));
+				}
+				offset += strips[s];
+			}
+			// Non-stripped tris
+			for (auto f = 0; f < (numIndices - offset); f += 3) {
+				tris.push_back(Triangle(voffset + indices[offset + f + 0], voffset + indices[offset + f + 1], voffset + indices[offset + f + 2]));
+			}
+			subshapeverts.push_back(numVerts);
+		}
+
+		MoppCacheKey key;
+		const vector<bhkCMSDMaterial>& materials = data->GetChunkMaterials();
+		for (const bhkCMSDMaterial& material : materials) {
+			key.Add(unsigned(material.skyrimMaterial));
+			key.Add(unsigned(material.skyrimLayer));
+		}
+		for (const bhkCMSDChunk& chunk : chunks)
+			key.Add(chunk.materialIndex);
+
+		MoppGeometry geom = MakeMoppGeometry(verts, tris);
+		geom.subshapeVerts = subshapeverts.empty() ? NULL : &subshapeverts[0];
+		geom.numSubshapes = subshapeverts.size();
+		geom.keyedByChunk = true;
+		return ConstructHKMesh(geom, key, origin, scale);
 	}
 	return vector<Niflib::byte>();
 }
@@ -401,22 +454,46 @@ To mimic the "Align to world" behavior, the following code snippet should help:
 
 */
 
-int Exporter::addVertex(vector<Vector3> &verts, vector<Vector3> &vnorms, const Point3 &pt, const Point3 &norm)
+// Returns the lowest vertex within thresh of pt (and with the same normal when
+//   vnorms is given) or -1.  Only the cells around pt are searched, which finds
+//   the same vertex a scan over all of verts would.
+int Exporter::findWeldedVertex(const WeldGrid &weld, const vector<Vector3> &verts, const vector<Vector3> *vnorms,
+	const Point3 &pt, const Point3 &norm, float thresh)
 {
-	for (unsigned int i = 0; i < verts.size(); i++)
-	{
-		if (equal(verts[i], pt, mWeldThresh) &&
-			equal(vnorms[i], norm, 0))
-			return i;
+	long long cell[3];
+	weld.cellOf(pt, cell);
+	int best = -1;
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dz = -1; dz <= 1; ++dz) {
+				WeldGrid::CellKey key = WeldGrid::keyOf(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+				for (int i = weld.first(key); i >= 0; i = weld.next[i]) {
+					if ((best < 0 || i < best) && equal(verts[i], pt, thresh)
+						&& (vnorms == NULL || equal((*vnorms)[i], norm, 0)))
+						best = i;
+				}
+			}
+		}
 	}
+	return best;
+}
+
+int Exporter::addVertex(WeldGrid &weld, vector<Vector3> &verts, vector<Vector3> &vnorms, const Point3 &pt, const Point3 &norm)
+{
+	if (weld.cellSize <= 0.0f)
+		weld.init(mWeldThresh);
+	int match = findWeldedVertex(weld, verts, &vnorms, pt, norm, mWeldThresh);
+	if (match >= 0)
+		return match;
 
 	verts.push_back(Vector3(pt.x, pt.y, pt.z));
 	vnorms.push_back(Vector3(norm.x, norm.y, norm.z));
+	weld.insert(pt, verts.size() - 1);
 
 	return verts.size() - 1;
 }
 
-void Exporter::addFace(Triangles &tris, vector<Vector3> &verts, vector<Vector3> &vnorms,
+void Exporter::addFace(WeldGrid &weld, Triangles &tris, vector<Vector3> &verts, vector<Vector3> &vnorms,
 	int face, const int vi[3], Mesh *mesh, Matrix3& tm)
 {
 	Triangle tri;
@@ -424,13 +501,37 @@ void Exporter::addFace(Triangles &tris, vector<Vector3> &verts, vector<Vector3>
 	{
 		Point3 pt = mesh->verts[mesh->faces[face].v[vi[i]]] * tm;
 		Point3 norm = getVertexNormal(mesh, face, mesh->getRVertPtr(mesh->faces[face].v[vi[i]])) * tm;
-		tri[i] = addVertex(verts, vnorms, pt, norm);
+		tri[i] = addVertex(weld, verts, vnorms, pt, norm);
 	}
 	tris.push_back(tri);
 }
 
+// Appends the mesh vertices in havok units to verts, merging those within the
+//   weld threshold.  vmap receives the index in verts of each mesh vertex.
+void Exporter::weldCollisionVerts(Mesh &mesh, Matrix3 &tm, vector<Vector3> &verts, vector<int> &vmap)
+{
+	float thresh = mWeldThresh / bhkAppScaleFactor;
+	WeldGrid weld;
+	weld.init(thresh);
+	int nvert = mesh.getNumVerts();
+	vmap.resize(nvert);
+	verts.reserve(verts.size() + nvert);
+	for (int i = 0; i < nvert; ++i)
+	{
+		Point3 pt = (mesh.getVert(i) * tm) / bhkAppScaleFactor;
+		int match = findWeldedVertex(weld, verts, NULL, pt, pt, thresh);
+		if (match < 0) {
+			match = verts.size();
+			verts.push_back(TOVECTOR3(pt));
+			weld.insert(pt, match);
+		}
+		vmap[i] = match;
+	}
+}
+
 Exporter::Result Exporter::exportCollision(NiNodeRef &parent, INode *node)
 {
+	ProfileScope profile(ExportProfiler::Collision);
 	if (isHandled(node) || (node->IsHidden() && !mExportHidden))
 		return Exporter::Skip;
 
@@ -626,6 +727,7 @@ bhkNiTriStripsShapeRef Exporter::makeTriStripsShape(Mesh& mesh, Matrix3& sm, int
 	vector<Vector3> verts;
 	vector<Vector3> vnorms;
 	Triangles		tris;
+	WeldGrid		weld;
 
 	int vi[3];
 	if (TMNegParity(sm)) {
@@ -636,7 +738,7 @@ bhkNiTriStripsShapeRef Exporter::makeTriStripsShape(Mesh& mesh, Matrix3& sm, int
 	}
 
 	for (int i = 0; i < mesh.getNumFaces(); i++)
-		addFace(tris, verts, vnorms, i, vi, &mesh, sm);
+		addFace(weld, tris, verts, vnorms, i, vi, &mesh, sm);
 
 	NiTriStripsDataRef data = new NiTriStripsData(tris, Exporter::mUseAlternateStripper);
 	data->SetVertices(verts);
@@ -659,7 +761,18 @@ bhkNiTriStripsShapeRef Exporter::makeTriStripsShape(Mesh& mesh, Matrix3& sm, int
 
 static bhkMoppBvTreeShapeRef makeTreeShape(bhkShapeRef shape, int mtlDefault)
 {
-	if (!TheHavokCode.Initialize()) return shape;
+	Niflib::Vector3 offset;
+	float scale = 1.0f;
+	vector<Niflib::byte> moppcode;
+	try
+	{
+		moppcode = ConstructHKMesh(shape, offset, scale);
+	}
+	catch (...)
+	{
+	}
+	// no builder could handle the shape
+	if (moppcode.empty()) return shape;
 
 	HavokMaterial material; SkyrimHavokMaterial skyrimMaterial;
 	GetHavokMaterialsFromIndex(mtlDefault, (int*)&material, (int*)&skyrimMaterial);
@@ -668,19 +781,9 @@ static bhkMoppBvTreeShapeRef makeTreeShape(bhkShapeRef shape, int mtlDefault)
 	mopp->SetMaterial(material);
 	mopp->SetSkyrimMaterial(skyrimMaterial);
 	mopp->SetShape(shape);
-
-	try
-	{
-		Niflib::Vector3 offset;
-		float scale;
-		vector<Niflib::byte> moppcode = ConstructHKMesh(shape, offset, scale);
-		mopp->SetMoppCode(moppcode);
-		mopp->SetMoppOrigin(offset);
-		mopp->SetMoppScale(scale);
-	}
-	catch (...)
-	{
-	}
+	mopp->SetMoppCode(moppcode);
+	mopp->SetMoppOrigin(offset);
+	mopp->SetMoppScale(scale);
 	return mopp;
 }
 
@@ -702,26 +805,22 @@ bhkPackedNiTriStripsShapeRef Exporter::makePackedTriStripsShape(Mesh& mesh, Matr
 		vi[0] = 0; vi[1] = 1; vi[2] = 2;
 	}
 
-	int nvert = mesh.getNumVerts();
 	int nface = mesh.getNumFaces();
 	mesh.buildNormals();
 
+	vector<int> vmap;
+	weldCollisionVerts(mesh, sm, verts, vmap);
+
 	tris.resize(nface);
-	verts.resize(nvert);
 	norms.resize(nface);
-	for (int i = 0; i < nvert; ++i)
-	{
-		Point3 vert = (mesh.getVert(i) * sm) / bhkAppScaleFactor;
-		verts[i] = TOVECTOR3(vert);
-	}
 	for (int i = 0; i < nface; ++i)
 	{
 		Triangle& tri = tris[i];
 		norms[i] = TOVECTOR3(mesh.getFaceNormal(i));
 		Face& face = mesh.faces[i];
-		tri[0] = (USHORT)face.getVert(0);
-		tri[1] = (USHORT)face.getVert(1);
-		tri[2] = (USHORT)face.getVert(2);
+		tri[0] = (USHORT)vmap[face.getVert(0)];
+		tri[1] = (USHORT)vmap[face.getVert(1)];
+		tri[2] = (USHORT)vmap[face.getVert(2)];
 	}
 
 	hkPackedNiTriStripsDataRef data = new hkPackedNiTriStripsData();
@@ -761,31 +860,27 @@ bhkConvexVerticesShapeRef Exporter::makeConvexShape(Mesh& mesh, Matrix3& tm, int
 	CalcCenteredSphere(mesh, center, radius);
 	radius /= bhkAppScaleFactor;
 	shape->SetRadius(radius);
-	vector<Vector3> verts;
-	vector<Vector4> norms;
 	int nvert = mesh.getNumVerts();
-	int nface = mesh.getNumFaces();
-	mesh.checkNormals(FALSE);
-	mesh.buildNormals();
-
-	verts.resize(nvert);
-	norms.resize(nface);
+	vector<float> pts(nvert * 3);
 	for (int i = 0; i < nvert; ++i)
 	{
 		Point3 vert = (mesh.getVert(i) * tm) / bhkAppScaleFactor;
-		verts[i] = TOVECTOR3(vert);
-	}
-	for (int i = 0; i < nface; ++i)
-	{
-		Vector4 &value = norms[i];
-		Point3 &pt = mesh.getFaceNormal(i);
-		value[0] = pt.x;
-		value[1] = pt.y;
-		value[2] = pt.z;
-		value[3] = -(mesh.FaceCenter(i) * tm).Length() / bhkAppScaleFactor;
-	}
-	sortVector3(verts);
-	sortVector4(norms);
+		pts[i * 3 + 0] = vert.x;
+		pts[i * 3 + 1] = vert.y;
+		pts[i * 3 + 2] = vert.z;
+	}
+
+	// only the hull corners and one plane per flat side are needed
+	vector<float> hullVerts, planes;
+	if (!ComputeConvexPolytope(pts.empty() ? nullptr : &pts[0], pts.size() / 3, size_t(max(mConvexMaxVerts, 0)), hullVerts, planes))
+		return bhkConvexVerticesShapeRef();
+
+	vector<Vector3> verts(hullVerts.size() / 3);
+	for (size_t i = 0; i < verts.size(); ++i)
+		verts[i] = Vector3(hullVerts[i * 3], hullVerts[i * 3 + 1], hullVerts[i * 3 + 2]);
+	vector<Vector4> norms(planes.size() / 4);
+	for (size_t i = 0; i < norms.size(); ++i)
+		norms[i] = Vector4(planes[i * 4], planes[i * 4 + 1], planes[i * 4 + 2], planes[i * 4 + 3]);
 	shape->SetVertices(verts);
 	shape->SetNormalsAndDist(norms);
 
@@ -1790,7 +1885,7 @@ bhkShapeRef	Exporter::makeModSphereShape(INode *node, Modifier* mod, Mesh& mesh,
 
 	Point3 center = Point3::Origin;
 	float radius = 0.0f;
-	CalcCenteredSphere(mesh, center, radius);
+	CalcMinimalSphere(mesh, center, radius);
 
 	if (bhkSphereShapeRef shape = new bhkSphereShape())
 	{
@@ -2018,15 +2113,14 @@ bhkShapeRef	Exporter::makeModPackedTriStripShape(INodeTab &map, Matrix3& tm, int
 			vi[0] = 0; vi[1] = 1; vi[2] = 2;
 		}
 
-		int nvert = mesh->getNumVerts();
 		int nface = mesh->getNumFaces();
 		mesh->buildNormals();
 
-		for (int i = 0; i < nvert; ++i)
-		{
-			Point3 vert = (mesh->getVert(i) * ltm) / bhkAppScaleFactor;
-			verts.push_back(TOVECTOR3(vert));
-		}
+		// vmap holds indices into the shared verts so no offset is needed
+		vector<int> vmap;
+		weldCollisionVerts(*mesh, ltm, verts, vmap);
+		int nvert = verts.size() - voff;
+
 		for (int i = 0; i < nface; ++i)
 		{
 			Point3 norm = (mesh->getFaceNormal(i) * ltm) / bhkAppScaleFactor;
@@ -2034,9 +2128,9 @@ bhkShapeRef	Exporter::makeModPackedTriStripShape(INodeTab &map, Matrix3& tm, int
 
 			Triangle tri;
 			Face& face = mesh->faces[i];
-			tri[0] = (USHORT)face.getVert(0) + voff;
-			tri[1] = (USHORT)face.getVert(1) + voff;
-			tri[2] = (USHORT)face.getVert(2) + voff;
+			tri[0] = (USHORT)vmap[face.getVert(0)];
+			tri[1] = (USHORT)vmap[face.getVert(1)];
+			tri[2] = (USHORT)vmap[face.getVert(2)];
 			tris.push_back(tri);
 		}
 		voff += nvert;
@@ -2191,6 +2285,133 @@ struct bhkCMSDMaterial_equal
 	}
 };
 
+// Chunk vertices are stored as unsigned short millimetres from the chunk
+//   translation, so no chunk may span more than 65.535 havok units.  Keep a
+//   small margin for rounding.
+static const float CMSDChunkExtent = 65.0f;
+// Triangles per chunk.  Smaller chunks give the MOPP tree more to cull.
+static const size_t CMSDChunkTris = 4096;
+
+static void CalcChunkBounds(const vector<Vector3> &verts, const vector<int> &indices, const int *tris, size_t count, Vector3 &lo, Vector3 &hi)
+{
+	lo = hi = verts[indices[tris[0] * 3]];
+	for (size_t i = 0; i < count; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			const Vector3 &v = verts[indices[tris[i] * 3 + j]];
+			lo.x = min(lo.x, v.x); lo.y = min(lo.y, v.y); lo.z = min(lo.z, v.z);
+			hi.x = max(hi.x, v.x); hi.y = max(hi.y, v.y); hi.z = max(hi.z, v.z);
+		}
+	}
+}
+
+// Splits the triangles (three entries of indices each) into chunks that fit the
+//   compressed vertex range.  Triangles that are too large for any chunk go to
+//   the big triangle list.  Chunks are quantized and stripped in parallel.
+void Exporter::addCompressedMeshChunks(const vector<Vector3> &verts, const vector<int> &indices, unsigned int materialIndex,
+	unsigned short transformIndex, vector<bhkCMSDChunk> &chunks, vector<Vector4> &bigVerts, vector<bhkCMSDBigTris> &bigTris)
+{
+	int ntris = int(indices.size() / 3);
+	vector<int> small;
+	small.reserve(ntris);
+	std::map<int, unsigned short> bigMap;
+	for (int t = 0; t < ntris; ++t) {
+		Vector3 lo, hi;
+		CalcChunkBounds(verts, indices, &t, 1, lo, hi);
+		if (hi.x - lo.x <= CMSDChunkExtent && hi.y - lo.y <= CMSDChunkExtent && hi.z - lo.z <= CMSDChunkExtent) {
+			small.push_back(t);
+			continue;
+		}
+		bhkCMSDBigTris big;
+		unsigned short *corner[3] = { &big.triangle1, &big.triangle2, &big.triangle3 };
+		for (int j = 0; j < 3; ++j) {
+			int v = indices[t * 3 + j];
+			std::map<int, unsigned short>::iterator itr = bigMap.find(v);
+			if (itr == bigMap.end()) {
+				itr = bigMap.insert(std::make_pair(v, (unsigned short)bigVerts.size())).first;
+				bigVerts.push_back(Vector4(verts[v].x, verts[v].y, verts[v].z, 0.0f));
+			}
+			*corner[j] = (*itr).second;
+		}
+		big.material = materialIndex;
+		big.weldingInfo = 0;
+		bigTris.push_back(big);
+	}
+	if (small.empty())
+		return;
+
+	// median splits on the longest side until every part fits a chunk
+	vector< std::pair<int, int> > parts;
+	vector< std::pair<int, int> > pending(1, std::make_pair(0, int(small.size())));
+	while (!pending.empty()) {
+		std::pair<int, int> part = pending.back();
+		pending.pop_back();
+		Vector3 lo, hi;
+		CalcChunkBounds(verts, indices, &small[part.first], part.second - part.first, lo, hi);
+		Vector3 size = hi - lo;
+		if (size_t(part.second - part.first) <= CMSDChunkTris
+			&& size.x <= CMSDChunkExtent && size.y <= CMSDChunkExtent && size.z <= CMSDChunkExtent) {
+			parts.push_back(part);
+			continue;
+		}
+		int axis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z) ? 1 : 2;
+		int mid = (part.first + part.second) / 2;
+		std::nth_element(small.begin() + part.first, small.begin() + mid, small.begin() + part.second, [&](int a, int b) {
+			float ca = verts[indices[a * 3]][axis] + verts[indices[a * 3 + 1]][axis] + verts[indices[a * 3 + 2]][axis];
+			float cb = verts[indices[b * 3]][axis] + verts[indices[b * 3 + 1]][axis] + verts[indices[b * 3 + 2]][axis];
+			return (ca != cb) ? ca < cb : a < b;
+		});
+		pending.push_back(std::make_pair(mid, part.second));
+		pending.push_back(std::make_pair(part.first, mid));
+	}
+
+	size_t first = chunks.size();
+	chunks.resize(first + parts.size());
+	ParallelFor(parts.size(), [&](size_t p) {
+		const int *tris = &small[parts[p].first];
+		size_t count = parts[p].second - parts[p].first;
+		Vector3 lo, hi;
+		CalcChunkBounds(verts, indices, tris, count, lo, hi);
+
+		// chunk local vertices in first use order
+		std::unordered_map<int, unsigned short> local;
+		vector<Vector3> chunkVerts;
+		vector<Vector3> chunkNorms;
+		Triangles chunkTris(count);
+		for (size_t i = 0; i < count; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				int v = indices[tris[i] * 3 + j];
+				std::unordered_map<int, unsigned short>::iterator itr = local.find(v);
+				if (itr == local.end()) {
+					itr = local.insert(std::make_pair(v, (unsigned short)chunkVerts.size())).first;
+					chunkVerts.push_back(verts[v]);
+				}
+				chunkTris[i][j] = (*itr).second;
+			}
+		}
+		TriStrips strips;
+		strippify(strips, chunkVerts, chunkNorms, chunkTris);
+
+		bhkCMSDChunk& chunk = chunks[first + p];
+		chunk.translation = Vector4(lo.x, lo.y, lo.z, 0.0f);
+		chunk.materialIndex = materialIndex;
+		chunk.transformIndex = transformIndex;
+		chunk.vertices.reserve(chunkVerts.size() * 3);
+		for (auto itr = chunkVerts.begin(); itr != chunkVerts.end(); ++itr) {
+			Vector3 d = ((*itr) - lo) * 1000.0f;
+			chunk.vertices.push_back(static_cast<unsigned short>(min(d.x + 0.5f, 65535.0f)));
+			chunk.vertices.push_back(static_cast<unsigned short>(min(d.y + 0.5f, 65535.0f)));
+			chunk.vertices.push_back(static_cast<unsigned short>(min(d.z + 0.5f, 65535.0f)));
+		}
+		chunk.numVertices = chunk.vertices.size();
+		for (auto itr = strips.begin(); itr != strips.end(); ++itr) {
+			chunk.strips.push_back((unsigned short)(*itr).size());
+			chunk.indices.insert(chunk.indices.end(), (*itr).begin(), (*itr).end());
+		}
+		chunk.numStrips = chunk.strips.size();
+		chunk.numIndices = chunk.indices.size();
+	});
+}
+
 bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 {
 	// Need to separate the vertices based on material.  
@@ -2200,6 +2421,8 @@ bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 	vector<bhkCMSDChunk> subshapes; subshapes.reserve(map.Count());
 	vector<bhkCMSDTransform> transforms; transforms.reserve(map.Count());
 	vector<bhkCMSDMaterial> materials; materials.reserve(map.Count());
+	vector<Vector4> bigVerts;
+	vector<bhkCMSDBigTris> bigTris;
 	Box3 bounds;
 
 	for (int i = 0; i < map.Count(); ++i) {
@@ -2261,55 +2484,24 @@ bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 		if (mesh == NULL)
 			continue;
 
-		// Need to separate the vertices based on material.  
-		typedef vector<Triangle> Triangles;
-
 		// setup shape data
 		vector<Vector3> verts;
-		vector<Vector3> norms;
-		Triangles		tris;
+		vector<int> indices;
 
 		Matrix3 ltm = (node->GetObjTMAfterWSM(0) * tm);
-		int vi[3];
-		if (TMNegParity(ltm)) {
-			vi[0] = 2; vi[1] = 1; vi[2] = 0;
-		}
-		else {
-			vi[0] = 0; vi[1] = 1; vi[2] = 2;
-		}
 
-		int nvert = mesh->getNumVerts();
 		int nface = mesh->getNumFaces();
-		mesh->buildNormals();
-		mesh->buildBoundingBox();
-		Box3 aabb = mesh->getBoundingBox();
-		Vector3 ptoffset = TOVECTOR3(aabb.Min()) / bhkAppScaleFactor;
-		bounds += aabb;
+		vector<int> vmap;
+		weldCollisionVerts(*mesh, ltm, verts, vmap);
+		for (auto itr = verts.begin(); itr != verts.end(); ++itr)
+			bounds += Point3((*itr).x, (*itr).y, (*itr).z);
 
-		tris.resize(nface);
-		verts.resize(nvert);
-		norms.resize(nface);
-		for (int i = 0; i < nvert; ++i) {
-			verts[i] = TOVECTOR3((mesh->getVert(i) * ltm) / bhkAppScaleFactor);
-		}
+		indices.resize(nface * 3);
 		for (int i = 0; i < nface; ++i)
 		{
-			Triangle& tri = tris[i];
-			norms[i] = TOVECTOR3(mesh->getFaceNormal(i));
 			Face& face = mesh->faces[i];
-			tri[0] = (USHORT)face.getVert(0);
-			tri[1] = (USHORT)face.getVert(1);
-			tri[2] = (USHORT)face.getVert(2);
-		}
-		TriStrips strips;
-		strippify(strips, verts, norms, tris);
-		vector<unsigned short > indices;
-		indices.reserve(nface * 3);
-		for (auto itr = strips.begin(); itr != strips.end(); ++itr) {
-			auto& strip = (*itr);
-			for (int j = 0; j < strip.size(); ++j) {
-				indices.push_back(strip[j]);
-			}
+			for (int j = 0; j < 3; ++j)
+				indices[i * 3 + j] = vmap[face.getVert(j)];
 		}
 
 		HavokMaterial material; SkyrimHavokMaterial skyrimMaterial;
@@ -2318,47 +2510,24 @@ bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 		OblivionLayer oblivlayer; SkyrimLayer skyrimLayer;
 		GetHavokLayersFromIndex(layer, (int*)&oblivlayer, (int*)&skyrimLayer);
 		
-		auto subshapeitr = subshapes.insert(subshapes.end(), bhkCMSDChunk());
-		bhkCMSDChunk& subshape = (*subshapeitr);
-
-		//auto transitr = transforms.insert(transforms.end(), bhkCMSDTransform());
-		//bhkCMSDTransform& subtrans = (*transitr);
-
-		subshape.transformIndex = 0;
-
+		unsigned int materialIndex = 0;
 		bhkCMSDMaterial cmsdMaterial;
 		cmsdMaterial.skyrimMaterial = skyrimMaterial;
 		cmsdMaterial.skyrimLayer = skyrimLayer;
 		const auto& itr = std::find_if(materials.begin(), materials.end(), bhkCMSDMaterial_equal(cmsdMaterial));
 		if (itr == materials.end()) {
-			subshape.materialIndex = materials.size();
+			materialIndex = materials.size();
 			materials.push_back(cmsdMaterial);
 
 			bhkCMSDTransform trans;
 			trans.translation = TOVECTOR4(Point3());
 			trans.rotation = TOQUATXYZW(Quat());
 			transforms.push_back(trans);
-			subshape.transformIndex = subshape.materialIndex;
 		} else {
-			subshape.materialIndex = std::distance(materials.begin(), itr);
-			subshape.transformIndex = subshape.materialIndex;
+			materialIndex = std::distance(materials.begin(), itr);
 		}
 
-		subshape.translation = ptoffset;
-		subshape.numVertices = verts.size();
-		subshape.vertices.reserve(subshape.numVertices * 3);
-		for (auto itr = verts.begin(); itr != verts.end(); ++itr) {
-			const auto& v = (*itr);
-			subshape.vertices.push_back(static_cast<unsigned short>((v.x - ptoffset.x) * 1000.0f));
-			subshape.vertices.push_back(static_cast<unsigned short>((v.y - ptoffset.y) * 1000.0f));
-			subshape.vertices.push_back(static_cast<unsigned short>((v.z - ptoffset.z) * 1000.0f));
-		}
-		subshape.numIndices = indices.size();
-		subshape.indices = indices;
-		subshape.numStrips = strips.size();
-		subshape.strips.reserve(subshape.numStrips);
-		for (auto itr = strips.begin(); itr != strips.end(); ++itr)
-			subshape.strips.push_back((*itr).size());
+		addCompressedMeshChunks(verts, indices, materialIndex, (unsigned short)materialIndex, subshapes, bigVerts, bigTris);
 	}
 
 	bhkCompressedMeshShapeRef shape = new bhkCompressedMeshShape();
@@ -2366,8 +2535,11 @@ bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 	data->SetChunkTransforms(transforms);
 	data->SetChunkMaterials(materials);
 	data->SetChunks(subshapes);
-	data->SetBoundsMin(TOVECTOR4(bounds.Min(), 0.0f) / bhkAppScaleFactor);
-	data->SetBoundsMax(TOVECTOR4(bounds.Max(), bhkAppScaleFactor) / bhkAppScaleFactor);
+	data->SetBigVerts(bigVerts);
+	data->SetBigTris(bigTris);
+	// bounds are already in havok units
+	data->SetBoundsMin(TOVECTOR4(bounds.Min(), 0.0f));
+	data->SetBoundsMax(TOVECTOR4(bounds.Max(), 1.0f));
 	shape->SetData(data);
 
 	return StaticCast<bhkShape>(makeTreeShape(shape, mtlDefault));
@@ -2376,55 +2548,24 @@ bhkShapeRef Exporter::makeModCMSD(INodeTab &map, Matrix3& tm, int mtlDefault)
 // returns partially construted Compessed Mesh Shape.  Will be passed to NifMopp later to fully compress with MOPP
 bhkCompressedMeshShapeRef Exporter::makeCompressedMeshShape(Mesh& mesh, Matrix3& sm, int mtlDefault, int lyrDefault, int colFilter)
 {
-	// Need to separate the vertices based on material.  
-	typedef vector<Triangle> Triangles;
-
 	// setup shape data
 	vector<Vector3> verts;
-	vector<Vector3> norms;
-	Triangles		tris;
-
-	int vi[3];
-	if (TMNegParity(sm)) {
-		vi[0] = 2; vi[1] = 1; vi[2] = 0;
-	}
-	else {
-		vi[0] = 0; vi[1] = 1; vi[2] = 2;
-	}
+	vector<int> indices;
 
-	int nvert = mesh.getNumVerts();
 	int nface = mesh.getNumFaces();
-	mesh.buildNormals();
-	mesh.buildBoundingBox();
-	Box3 aabb = mesh.getBoundingBox();
-	Vector3 ptoffset = TOVECTOR3(aabb.Min()) / bhkAppScaleFactor;
+	vector<int> vmap;
+	weldCollisionVerts(mesh, sm, verts, vmap);
+	Box3 bounds;
+	for (auto itr = verts.begin(); itr != verts.end(); ++itr)
+		bounds += Point3((*itr).x, (*itr).y, (*itr).z);
 
-	tris.resize(nface);
-	verts.resize(nvert);
-	norms.resize(nface);
-	for (int i = 0; i < nvert; ++i) {
-		verts[i] = TOVECTOR3((mesh.getVert(i) * sm) / bhkAppScaleFactor);
-	}
+	indices.resize(nface * 3);
 	for (int i = 0; i < nface; ++i)
 	{
-		Triangle& tri = tris[i];
-		norms[i] = TOVECTOR3(mesh.getFaceNormal(i));
 		Face& face = mesh.faces[i];
-		tri[0] = (USHORT)face.getVert(0);
-		tri[1] = (USHORT)face.getVert(1);
-		tri[2] = (USHORT)face.getVert(2);
+		for (int j = 0; j < 3; ++j)
+			indices[i * 3 + j] = vmap[face.getVert(j)];
 	}
-	TriStrips strips;
-	strippify(strips, verts, norms, tris);
-	vector<unsigned short > indices;
-	indices.reserve(nface * 3);
-	for (auto itr = strips.begin(); itr != strips.end(); ++itr) {
-		auto& strip = (*itr);
-		for (int j = 0; j < strip.size(); ++j) {
-			indices.push_back(strip[j]);
-		}
-	}
-	
 
 	bhkCompressedMeshShapeDataRef data = new bhkCompressedMeshShapeData();
 	HavokMaterial material; SkyrimHavokMaterial skyrimMaterial;
@@ -2437,35 +2578,28 @@ bhkCompressedMeshShapeRef Exporter::makeCompressedMeshShape(Mesh& mesh, Matrix3&
 	bhkCompressedMeshShapeRef shape = new bhkCompressedMeshShape();
 	shape->SetData(data);
 
-	vector<bhkCMSDChunk> subshapes; subshapes.resize(1);
+	vector<bhkCMSDChunk> subshapes;
 	vector<bhkCMSDTransform> transforms; transforms.resize(1);
 	vector<bhkCMSDMaterial> materials; materials.resize(1);
-	bhkCMSDChunk& subshape = subshapes.front();
+	vector<Vector4> bigVerts;
+	vector<bhkCMSDBigTris> bigTris;
 	bhkCMSDTransform& subtrans = transforms.front();
 	bhkCMSDMaterial& submat = materials.front();
-	subtrans.translation = ptoffset;
+	subtrans.translation = TOVECTOR4(Point3());
 	subtrans.rotation = TOQUATXYZW(Quat());
 
 	submat.skyrimMaterial = skyrimMaterial;
 	submat.skyrimLayer = skyrimLayer;
 
-	data->SetChunkTransforms(transforms);
+	addCompressedMeshChunks(verts, indices, 0, 0, subshapes, bigVerts, bigTris);
 
-	subshape.numVertices = verts.size();
-	subshape.vertices.reserve(subshape.numVertices * 3);
-	for (auto itr = verts.begin(); itr != verts.end(); ++itr) {
-		const auto& v = (*itr);
-		subshape.vertices.push_back(static_cast<unsigned short>((v.x - ptoffset.x) * 1000.0f));
-		subshape.vertices.push_back(static_cast<unsigned short>((v.y - ptoffset.y) * 1000.0f));
-		subshape.vertices.push_back(static_cast<unsigned short>((v.z - ptoffset.z) * 1000.0f));
-	}
-	subshape.numIndices = indices.size();
-	subshape.indices = indices;
-	subshape.numStrips = strips.size();
-	subshape.strips.reserve(subshape.numStrips);
-	for (auto itr = strips.begin(); itr != strips.end(); ++itr)
-		subshape.strips.push_back(strips.size());
+	data->SetChunkTransforms(transforms);
+	data->SetChunkMaterials(materials);
 	data->SetChunks(subshapes);
+	data->SetBigVerts(bigVerts);
+	data->SetBigTris(bigTris);
+	data->SetBoundsMin(TOVECTOR4(bounds.Min(), 0.0f));
+	data->SetBoundsMax(TOVECTOR4(bounds.Max(), 1.0f));
 	return shape;
 }
 
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "AppSettings.h"
+#include "IniStore.h"
 #include "niutils.h"
 
 #define REGPATH TEXT("Software\\NifTools\\MaxPlugins")
@@ -58,6 +59,7 @@ void Exporter::writeConfig(Interface *i)
       SetIniValue(NifExportSection, TEXT("TexturePrefix"), mTexPrefix, iniName);
       SetIniValue(NifExportSection, TEXT("ExportCollision"), mExportCollision, iniName);
       SetIniValue(NifExportSection, TEXT("RemapIndices"), mRemapIndices, iniName);
+      SetIniValue(NifExportSection, TEXT("OptimizeVertexCache"), mOptimizeVertexCache, iniName);
 
       SetIniValue(NifExportSection, TEXT("ExportExtraNodes"), mExportExtraNodes, iniName);
       SetIniValue(NifExportSection, TEXT("ExportSkin"), mExportSkin, iniName);
@@ -72,6 +74,9 @@ void Exporter::writeConfig(Interface *i)
       SetIniValue(NifExportSection, TEXT("ExportTransforms"), mExportTransforms, iniName);
       SetIniValue<int>(NifExportSection, TEXT("ExportType"), mExportType, iniName);     
       SetIniValue<float>(KfExportSection, TEXT("Priority"), mDefaultPriority, iniName);
+      SetIniValue<float>(KfExportSection, TEXT("PositionTolerance"), mKeyPosTolerance, iniName);
+      SetIniValue<float>(KfExportSection, TEXT("RotationTolerance"), mKeyRotTolerance, iniName);
+      SetIniValue<float>(KfExportSection, TEXT("ScaleTolerance"), mKeyScaleTolerance, iniName);
 
       SetIniValue(NifExportSection, TEXT("MultiplePartitions"), mMultiplePartitions, iniName);
       SetIniValue<int>(NifExportSection, TEXT("BonesPerVertex"), mBonesPerVertex, iniName);     
@@ -90,6 +95,7 @@ void Exporter::writeConfig(Interface *i)
 
       SetIniValue<tstring>(NifExportSection, TEXT("Creator"), mCreatorName, iniName);
       SetIniValue(NifExportSection, TEXT("GeneratePartitionStrips"), mTriPartStrips, iniName);
+      SetIniValue(NifExportSection, TEXT("OptimizeSkinPartitions"), mOptimizeSkinPartitions, iniName);
 
       SetIniValue(NifExportSection, TEXT("WeldVertexThresh"), mWeldThresh, iniName);
       SetIniValue(NifExportSection, TEXT("WeldVertexThresh"), mNormThresh, iniName);
@@ -128,62 +134,71 @@ void Exporter::readConfig(Interface *i)
    {
       TCHAR iniName[MAX_PATH];
       GetIniFileName(iniName);
+      std::shared_ptr<const IniStore> ini = IniStore::Get(iniName);
 
       //mVersion = GetIniValue<int>(NifExportSection, TEXT("Version"), 013, iniName);
-      mTriStrips = GetIniValue<bool>(NifExportSection, TEXT("GenerateStrips"), true, iniName);
-      mExportHidden = GetIniValue<bool>(NifExportSection, TEXT("IncludeHidden"), false, iniName);
-      mExportFurn = GetIniValue<bool>(NifExportSection, TEXT("FurnatureMarkers"), true, iniName);
-      mExportLights = GetIniValue<bool>(NifExportSection, TEXT("Lights"), false, iniName);
-      mVertexColors = GetIniValue<bool>(NifExportSection, TEXT("VertexColors"), true, iniName);
-      mWeldThresh = GetIniValue<float>(NifExportSection, TEXT("WeldVertexThresh"), 0.01f, iniName);
-      mNormThresh = GetIniValue<float>(NifExportSection, TEXT("WeldNormThresh"), 0.01f, iniName);
-      mUVWThresh = GetIniValue<float>(NifExportSection, TEXT("WeldUVWThresh"), 0.01f, iniName);
-
-      mTexPrefix = GetIniValue<tstring>(NifExportSection, TEXT("TexturePrefix"), TEXT("textures"), iniName);
-      mExportCollision = GetIniValue<bool>(NifExportSection, TEXT("ExportCollision"), true, iniName);
-      mRemapIndices = GetIniValue(NifExportSection, TEXT("RemapIndices"), true, iniName);
-
-      mExportExtraNodes = GetIniValue(NifExportSection, TEXT("ExportExtraNodes"), false, iniName);
-      mExportSkin = GetIniValue(NifExportSection, TEXT("ExportSkin"), false, iniName);
-      mUserPropBuffer = GetIniValue(NifExportSection, TEXT("UserPropBuffer"), false, iniName);
-      mFlattenHierarchy = GetIniValue(NifExportSection, TEXT("FlattenHierarchy"), false, iniName);
-      mRemoveUnreferencedBones = GetIniValue(NifExportSection, TEXT("RemoveUnreferencedBones"), false, iniName);
-      mSortNodesToEnd = GetIniValue(NifExportSection, TEXT("SortNodesToEnd"), false, iniName);
-      mSkeletonOnly = GetIniValue(NifExportSection, TEXT("SkeletonOnly"), false, iniName);
-      mExportCameras = GetIniValue(NifExportSection, TEXT("Cameras"), false, iniName);
-      mGenerateBoneCollision = GetIniValue(NifExportSection, TEXT("GenerateBoneCollision"), false, iniName);
-
-      mExportTransforms = GetIniValue(KfExportSection, TEXT("Transforms"), true, iniName);
-      mDefaultPriority = GetIniValue<float>(KfExportSection, TEXT("Priority"), 0.0f, iniName);
-      mExportType = ExportType(GetIniValue<int>(NifExportSection, TEXT("ExportType"), NIF_WO_ANIM, iniName));
-
-      mMultiplePartitions = GetIniValue(NifExportSection, TEXT("MultiplePartitions"), false, iniName);
-      mBonesPerVertex = GetIniValue<int>(NifExportSection, TEXT("BonesPerVertex"), 4, iniName);     
-      mBonesPerPartition = GetIniValue<int>(NifExportSection, TEXT("BonesPerPartition"), 20, iniName);
+      mTriStrips = ini->GetValue<bool>(NifExportSection, TEXT("GenerateStrips"), true);
+      mExportHidden = ini->GetValue<bool>(NifExportSection, TEXT("IncludeHidden"), false);
+      mExportFurn = ini->GetValue<bool>(NifExportSection, TEXT("FurnatureMarkers"), true);
+      mExportLights = ini->GetValue<bool>(NifExportSection, TEXT("Lights"), false);
+      mVertexColors = ini->GetValue<bool>(NifExportSection, TEXT("VertexColors"), true);
+      mWeldThresh = ini->GetValue<float>(NifExportSection, TEXT("WeldVertexThresh"), 0.01f);
+      mNormThresh = ini->GetValue<float>(NifExportSection, TEXT("WeldNormThresh"), 0.01f);
+      mUVWThresh = ini->GetValue<float>(NifExportSection, TEXT("WeldUVWThresh"), 0.01f);
+
+      mTexPrefix = ini->GetValue<tstring>(NifExportSection, TEXT("TexturePrefix"), TEXT("textures"));
+      mExportCollision = ini->GetValue<bool>(NifExportSection, TEXT("ExportCollision"), true);
+      mRemapIndices = ini->GetValue(NifExportSection, TEXT("RemapIndices"), true);
+      mOptimizeVertexCache = ini->GetValue(NifExportSection, TEXT("OptimizeVertexCache"), true);
+
+      mExportExtraNodes = ini->GetValue(NifExportSection, TEXT("ExportExtraNodes"), false);
+      mExportSkin = ini->GetValue(NifExportSection, TEXT("ExportSkin"), false);
+      mUserPropBuffer = ini->GetValue(NifExportSection, TEXT("UserPropBuffer"), false);
+      mFlattenHierarchy = ini->GetValue(NifExportSection, TEXT("FlattenHierarchy"), false);
+      mRemoveUnreferencedBones = ini->GetValue(NifExportSection, TEXT("RemoveUnreferencedBones"), false);
+      mSortNodesToEnd = ini->GetValue(NifExportSection, TEXT("SortNodesToEnd"), false);
+      mSkeletonOnly = ini->GetValue(NifExportSection, TEXT("SkeletonOnly"), false);
+      mExportCameras = ini->GetValue(NifExportSection, TEXT("Cameras"), false);
+      mGenerateBoneCollision = ini->GetValue(NifExportSection, TEXT("GenerateBoneCollision"), false);
+
+      mExportTransforms = ini->GetValue(KfExportSection, TEXT("Transforms"), true);
+      mDefaultPriority = ini->GetValue<float>(KfExportSection, TEXT("Priority"), 0.0f);
+      mKeyPosTolerance = ini->GetValue<float>(KfExportSection, TEXT("PositionTolerance"), 0.01f);
+      mKeyRotTolerance = ini->GetValue<float>(KfExportSection, TEXT("RotationTolerance"), 0.1f);
+      mKeyScaleTolerance = ini->GetValue<float>(KfExportSection, TEXT("ScaleTolerance"), 0.001f);
+      mExportType = ExportType(ini->GetValue<int>(NifExportSection, TEXT("ExportType"), NIF_WO_ANIM));
+
+      mMultiplePartitions = ini->GetValue(NifExportSection, TEXT("MultiplePartitions"), false);
+      mBonesPerVertex = ini->GetValue<int>(NifExportSection, TEXT("BonesPerVertex"), 4);     
+      mBonesPerPartition = ini->GetValue<int>(NifExportSection, TEXT("BonesPerPartition"), 20);
 
       //mUseTimeTags = GetIniValue(NifExportSection, TEXT("UseTimeTags"), false, iniName);
-      mAllowAccum = GetIniValue(NifExportSection, TEXT("AllowAccum"), true, iniName);
-      mCollapseTransforms = GetIniValue(NifExportSection, TEXT("CollapseTransforms"), false, iniName);
-      mZeroTransforms = GetIniValue(NifExportSection, TEXT("ZeroTransforms"), false, iniName);
-      mFixNormals = GetIniValue(NifExportSection, TEXT("FixNormals"), false, iniName);
-      mTangentAndBinormalExtraData = GetIniValue(NifExportSection, TEXT("TangentAndBinormalExtraData"), false, iniName);
-      mTangentAndBinormalMethod = GetIniValue<int>(NifExportSection, TEXT("TangentAndBinormalMethod"), 0, iniName);
-
-      mUseAlternateStripper = GetIniValue(NifExportSection, TEXT("UseAlternateStripper"), false, iniName);
-      mCreatorName = GetIniValue<tstring>(NifExportSection, TEXT("Creator"), TEXT(""), iniName);
-
-      bhkScaleFactor = GetIniValue<float>(CollisionSection, TEXT("bhkScaleFactor"), 7.0f, iniName);
-
-      mStartNifskopeAfterStart = GetIniValue(NifExportSection, TEXT("StartNifskopeAfterStart"), false, iniName);
-      mNifskopeDir = ExpandEnvironment(GetIndirectValue(GetIniValue<tstring>(TEXT("System"), TEXT("NifskopeDir"), TEXT(""), iniName).c_str()));
+      mAllowAccum = ini->GetValue(NifExportSection, TEXT("AllowAccum"), true);
+      mCollapseTransforms = ini->GetValue(NifExportSection, TEXT("CollapseTransforms"), false);
+      mZeroTransforms = ini->GetValue(NifExportSection, TEXT("ZeroTransforms"), false);
+      mFixNormals = ini->GetValue(NifExportSection, TEXT("FixNormals"), false);
+      mTangentAndBinormalExtraData = ini->GetValue(NifExportSection, TEXT("TangentAndBinormalExtraData"), false);
+      mTangentAndBinormalMethod = ini->GetValue<int>(NifExportSection, TEXT("TangentAndBinormalMethod"), 0);
+
+      mUseAlternateStripper = ini->GetValue(NifExportSection, TEXT("UseAlternateStripper"), false);
+      mCreatorName = ini->GetValue<tstring>(NifExportSection, TEXT("Creator"), TEXT(""));
+
+      bhkScaleFactor = ini->GetValue<float>(CollisionSection, TEXT("bhkScaleFactor"), 7.0f);
+      mMoppBuilder = ini->GetValue<int>(CollisionSection, TEXT("MoppBuilder"), 0);
+      mMoppCacheDir = ExpandEnvironment(ini->GetValue<tstring>(CollisionSection, TEXT("MoppCacheDir"), TEXT("")));
+      mConvexMaxVerts = ini->GetValue<int>(CollisionSection, TEXT("ConvexMaxVerts"), 0);
+
+      mStartNifskopeAfterStart = ini->GetValue(NifExportSection, TEXT("StartNifskopeAfterStart"), false);
+      mNifskopeDir = ExpandEnvironment(GetIndirectValue(ini->GetValue<tstring>(TEXT("System"), TEXT("NifskopeDir"), TEXT("")).c_str()));
       if (mNifskopeDir.empty())
-          mNifskopeDir = ExpandEnvironment(GetIndirectValue(GetIniValue<tstring>(TEXT("System"), TEXT("AltNifskopeDir"), TEXT(""), iniName).c_str()));
-      mTriPartStrips = GetIniValue<bool>(NifExportSection, TEXT("GeneratePartitionStrips"), true, iniName);
+          mNifskopeDir = ExpandEnvironment(GetIndirectValue(ini->GetValue<tstring>(TEXT("System"), TEXT("AltNifskopeDir"), TEXT("")).c_str()));
+      mTriPartStrips = ini->GetValue<bool>(NifExportSection, TEXT("GeneratePartitionStrips"), true);
+      mOptimizeSkinPartitions = ini->GetValue<bool>(NifExportSection, TEXT("OptimizeSkinPartitions"), true);
 
-	  mRootType = GetIniValue<tstring>(NifExportSection, TEXT("RootType"), TEXT("NiNode"), iniName);
-	  mRootTypes = TokenizeString(GetIniValue<tstring>(NifExportSection, TEXT("RootTypes"), TEXT("NiNode;BSFadeNode"), iniName).c_str(), TEXT(";"));
+	  mRootType = ini->GetValue<tstring>(NifExportSection, TEXT("RootType"), TEXT("NiNode"));
+	  mRootTypes = TokenizeString(ini->GetValue<tstring>(NifExportSection, TEXT("RootTypes"), TEXT("NiNode;BSFadeNode")).c_str(), TEXT(";"));
 
-	  mDebugEnabled = GetIniValue(NifExportSection, TEXT("EnableDebug"), false, iniName);
+	  mDebugEnabled = ini->GetValue(NifExportSection, TEXT("EnableDebug"), false);
   }
 }
 
@@ -198,6 +213,9 @@ void Exporter::readKfConfig(Interface *i)
    mExportCameras = GetIniValue(KfExportSection, TEXT("Cameras"), false, iniName);
    mExportTransforms = GetIniValue(KfExportSection, TEXT("Transforms"), true, iniName);
    mDefaultPriority = GetIniValue<float>(KfExportSection, TEXT("Priority"), 0.0f, iniName);
+   mKeyPosTolerance = GetIniValue<float>(KfExportSection, TEXT("PositionTolerance"), 0.01f, iniName);
+   mKeyRotTolerance = GetIniValue<float>(KfExportSection, TEXT("RotationTolerance"), 0.1f, iniName);
+   mKeyScaleTolerance = GetIniValue<float>(KfExportSection, TEXT("ScaleTolerance"), 0.001f, iniName);
 }
 
 void Exporter::writeKfConfig(Interface *i)
@@ -211,6 +229,9 @@ void Exporter::writeKfConfig(Interface *i)
    SetIniValue(KfExportSection, TEXT("Cameras"), mExportCameras, iniName);
    SetIniValue(KfExportSection, TEXT("Transforms"), mExportTransforms, iniName);
    SetIniValue<float>(KfExportSection, TEXT("Priority"), mDefaultPriority, iniName);
+   SetIniValue<float>(KfExportSection, TEXT("PositionTolerance"), mKeyPosTolerance, iniName);
+   SetIniValue<float>(KfExportSection, TEXT("RotationTolerance"), mKeyRotTolerance, iniName);
+   SetIniValue<float>(KfExportSection, TEXT("ScaleTolerance"), mKeyScaleTolerance, iniName);
 }
 
 
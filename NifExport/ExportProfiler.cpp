@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "ExportProfiler.h"
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#include "rapidjson/rapidjson.h"
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
+
+bool ExportProfiler::enabled = false;
+long long ExportProfiler::startTicks = 0;
+ExportProfiler::Counters ExportProfiler::counters[ExportProfiler::PhaseCount];
+
+static const char *PhaseNames[ExportProfiler::PhaseCount] = {
+	"splitMesh",
+	"addVertex",
+	"strippify",
+	"tangents",
+	"skin",
+	"collision",
+	"animation",
+	"nifWrite",
+};
+
+// open scopes of each phase on the current thread
+static thread_local int phaseDepth[ExportProfiler::PhaseCount];
+
+void ExportProfiler::Begin(bool enable)
+{
+	for (int i = 0; i < PhaseCount; ++i) {
+		counters[i].calls = 0;
+		counters[i].ticks = 0;
+		counters[i].bytes = 0;
+	}
+	enabled = enable;
+	startTicks = Ticks();
+}
+
+void ExportProfiler::Record(Phase phase, long long ticks, long long bytes, bool outermost)
+{
+	Counters& c = counters[phase];
+	++c.calls;
+	if (outermost) {
+		c.ticks += ticks;
+		c.bytes += bytes;
+	}
+}
+
+long long ExportProfiler::Ticks()
+{
+	LARGE_INTEGER li;
+	QueryPerformanceCounter(&li);
+	return li.QuadPart;
+}
+
+// Private commit of the process.  Growth across a scope approximates what the
+//   phase allocated and kept; phases running on workers see the whole process.
+long long ExportProfiler::PrivateBytes()
+{
+	PROCESS_MEMORY_COUNTERS_EX pmc;
+	memset(&pmc, 0, sizeof(pmc));
+	pmc.cb = sizeof(pmc);
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)))
+		return 0;
+	return (long long)pmc.PrivateUsage;
+}
+
+std::string ExportProfiler::ToJson(const char *file)
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	double msPerTick = 1000.0 / double(freq.QuadPart);
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+	writer.StartObject();
+	writer.Key("file");
+	writer.String(file ? file : "");
+	writer.Key("totalMs");
+	writer.Double(double(Ticks() - startTicks) * msPerTick);
+	writer.Key("phases");
+	writer.StartObject();
+	for (int i = 0; i < PhaseCount; ++i) {
+		writer.Key(PhaseNames[i]);
+		writer.StartObject();
+		writer.Key("calls");
+		writer.Int64(counters[i].calls);
+		writer.Key("ms");
+		writer.Double(double(counters[i].ticks) * msPerTick);
+		writer.Key("privateBytes");
+		writer.Int64(counters[i].bytes);
+		writer.EndObject();
+	}
+	writer.EndObject();
+	writer.EndObject();
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+bool ExportProfiler::Dump(const TCHAR *path, const char *file)
+{
+	std::string json = ToJson(file);
+	OutputDebugStringA(json.c_str());
+	OutputDebugStringA("\n");
+
+	FILE *fp = _tfopen(path, TEXT("wb"));
+	if (fp == nullptr)
+		return false;
+	bool ok = fwrite(json.data(), 1, json.size(), fp) == json.size();
+	fclose(fp);
+	return ok;
+}
+
+ProfileScope::ProfileScope(ExportProfiler::Phase p, bool trackMemory)
+	: phase(p), active(ExportProfiler::IsEnabled()), outermost(false), startTicks(0), startBytes(-1)
+{
+	if (!active)
+		return;
+	outermost = (phaseDepth[phase]++ == 0);
+	if (outermost && trackMemory)
+		startBytes = ExportProfiler::PrivateBytes();
+	startTicks = ExportProfiler::Ticks();
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (!active)
+		return;
+	long long ticks = ExportProfiler::Ticks() - startTicks;
+	long long bytes = (startBytes >= 0) ? ExportProfiler::PrivateBytes() - startBytes : 0;
+	--phaseDepth[phase];
+	ExportProfiler::Record(phase, ticks, bytes, outermost);
+}
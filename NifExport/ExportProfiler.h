@@ -0,0 +1,69 @@
+#ifndef __EXPORTPROFILER_H__
+#define __EXPORTPROFILER_H__
+
+#include <atomic>
+#include <string>
+
+// Collects wall time, call counts and memory growth per export phase.  Only
+//   active while Exporter::mDebugEnabled is set; the results are written as
+//   JSON next to the exported file.  Counters are atomic because several
+//   phases also run on ParallelFor workers.
+class ExportProfiler
+{
+public:
+	enum Phase
+	{
+		SplitMesh,
+		AddVertex,
+		Strippify,
+		Tangents,
+		Skin,
+		Collision,
+		Animation,
+		NifWrite,
+		PhaseCount
+	};
+
+	static void Begin(bool enabled);
+	static bool IsEnabled() { return enabled; }
+	static void Record(Phase phase, long long ticks, long long bytes, bool outermost);
+	static long long Ticks();
+	static long long PrivateBytes();
+
+	// returns the report as a JSON document
+	static std::string ToJson(const char *file);
+	// writes the report to path and the debug output.  returns false if path cannot be written
+	static bool Dump(const TCHAR *path, const char *file);
+
+private:
+	struct Counters
+	{
+		std::atomic<long long> calls;
+		std::atomic<long long> ticks;
+		std::atomic<long long> bytes;
+	};
+	static bool enabled;
+	static long long startTicks;
+	static Counters counters[PhaseCount];
+};
+
+// Times the enclosing block as one call of the phase.  Nested or recursive
+//   scopes of the same phase on one thread only count their calls so time is
+//   not added twice.  Memory is sampled only when trackMemory is set since it
+//   costs a system call; leave it off for per vertex scopes.
+class ProfileScope
+{
+public:
+	ProfileScope(ExportProfiler::Phase phase, bool trackMemory = true);
+	~ProfileScope();
+
+private:
+	ExportProfiler::Phase phase;
+	bool active, outermost;
+	long long startTicks, startBytes;
+
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "AppSettings.h"
 #include "niutils.h"
+#include "ParallelFor.h"
 
 #include "obj/BSXFlags.h"
 #include "obj/BSBound.h"
@@ -18,6 +19,7 @@ float	Exporter::mUVWThresh=0.01f;
 tstring Exporter::mTexPrefix=TEXT("textures");
 bool Exporter::mExportCollision=true;
 bool Exporter::mRemapIndices=true;
+bool Exporter::mOptimizeVertexCache=true;
 bool Exporter::mUseRegistry=false;
 bool Exporter::mExportExtraNodes=false;
 bool Exporter::mExportSkin=false;
@@ -35,6 +37,9 @@ bool Exporter::mExportCameras=false;
 bool Exporter::mGenerateBoneCollision=false;
 bool Exporter::mExportTransforms=true;
 float Exporter::mDefaultPriority=0.0f;
+float Exporter::mKeyPosTolerance=0.01f;
+float Exporter::mKeyRotTolerance=0.1f;
+float Exporter::mKeyScaleTolerance=0.001f;
 Exporter::ExportType Exporter::mExportType = NIF_WO_ANIM;
 bool Exporter::mMultiplePartitions=false;
 int Exporter::mBonesPerVertex = 4;
@@ -52,10 +57,14 @@ tstringlist Exporter::mRotate90Degrees;
 bool Exporter::mSuppressPrompts = false;
 bool Exporter::mUseAlternateStripper = false;
 float Exporter::bhkScaleFactor = 6.9969f;
+int Exporter::mMoppBuilder = 0;
+tstring Exporter::mMoppCacheDir;
+int Exporter::mConvexMaxVerts = 0;
 int Exporter::mTangentAndBinormalMethod = 0;
 bool Exporter::mStartNifskopeAfterStart = false;
 tstring Exporter::mNifskopeDir;
 bool Exporter::mTriPartStrips = true;
+bool Exporter::mOptimizeSkinPartitions = true;
 tstring Exporter::mRootType;
 tstringlist Exporter::mRootTypes;
 bool Exporter::mDebugEnabled = false;
@@ -236,8 +245,12 @@ Exporter::Result Exporter::doExport(NiNodeRef &root, INode *node)
 		}
 	}
 
-	// handle post export callbacks (like skin)
+	// handle post export callbacks (like skin).  Every shape and bone exists by now
+	//   so the callbacks' own work runs side by side; the results are then
+	//   committed to the nif one callback at a time in registration order.
 	progressMax[Skin] = mPostExportCallbacks.size();
+	vector<NiCallback*> callbacks(mPostExportCallbacks.begin(), mPostExportCallbacks.end());
+	ParallelFor(callbacks.size(), [&](size_t i) { callbacks[i]->prepare(); });
 	for (CallbackList::iterator cb = mPostExportCallbacks.begin(); cb != mPostExportCallbacks.end(); cb = mPostExportCallbacks.erase(cb)) {
 		ProgressUpdate(Skin, NULL);
 		(*cb)->execute();
@@ -67,6 +67,9 @@ public:
 	{
 		NiCallback() {};
 		virtual ~NiCallback() {};
+		// Runs for all callbacks at once on worker threads before any execute.
+		//   Must only touch data owned by the callback, not Max or niflib objects.
+		virtual void prepare() {};
 		virtual Result execute() = 0;
 	};
 
@@ -90,6 +93,7 @@ public:
 	static float        mUVWThresh;
 	static bool         mExportCollision;
 	static bool         mRemapIndices;
+	static bool         mOptimizeVertexCache;
 	static bool         mExportExtraNodes;
 	static bool         mExportSkin;
 	static bool         mUserPropBuffer;
@@ -106,6 +110,9 @@ public:
 	static bool         mGenerateBoneCollision;
 	static bool         mExportTransforms;
 	static float        mDefaultPriority;
+	static float        mKeyPosTolerance;
+	static float        mKeyRotTolerance;
+	static float        mKeyScaleTolerance;
 	static ExportType   mExportType;
 	static bool         mMultiplePartitions;
 	static int          mBonesPerVertex;
@@ -123,10 +130,14 @@ public:
 	static bool         mSuppressPrompts;
 	static bool         mUseAlternateStripper;
 	static float        bhkScaleFactor;
+	static int          mMoppBuilder;
+	static tstring      mMoppCacheDir;
+	static int          mConvexMaxVerts;
 	static int          mTangentAndBinormalMethod;
 	static bool         mStartNifskopeAfterStart;
 	static tstring      mNifskopeDir;
 	static bool         mTriPartStrips;
+	static bool         mOptimizeSkinPartitions;
 	static tstring      mRootType;
 	static tstringlist  mRootTypes;
 	static bool         mDebugEnabled;
@@ -162,6 +173,7 @@ public:
 	typedef list<TriStrip> TriStrips;
 	typedef vector<Triangle> Triangles;
 	typedef vector<TexCoord> TexCoords;
+	// a candidate vertex while it is compared against the welded ones
 	struct VertexGroup
 	{
 		int        idx;
@@ -171,22 +183,53 @@ public:
 		Color4     color;
 	};
 
+	// spatial hash over welded vertex positions so addVertex only compares
+	//   against vertices in neighbouring cells instead of the whole group
+	struct WeldGrid
+	{
+		typedef unsigned long long CellKey;
+
+		WeldGrid() : cellSize(0.0f), invCellSize(0.0f) {}
+
+		void                 init(float thresh);
+		void                 clear();
+		void                 cellOf(const Point3 &pt, long long cell[3]) const;
+		static CellKey       keyOf(long long x, long long y, long long z);
+		int                  first(CellKey key) const;
+		void                 insert(const Point3 &pt, int idx);
+
+		float                          cellSize;
+		float                          invCellSize;
+		std::unordered_map<CellKey, int> cells; // cell key -> most recently added vertex
+		vector<int>                    next;    // vertex -> previous vertex in the same cell or -1
+	};
+
 	struct FaceGroup
 	{
-		vector<VertexGroup> vgrp;
-		vector<int>            vmap;
+		FaceGroup() : mtlID(0), hasTangents(false), prepared(false) {}
+
+		int                 mtlID;    // sub material of the faces; groups over the index limit share it
+		VertexGroup         vscratch; // reused by addVertex so candidates do not allocate
 		vector<Vector3>      verts;
 		vector<Vector3>      vnorms;
 		Triangles            faces;
 		vector<TexCoords>      uvs;
-		std::map<int, int>  uvMapping; // first = Max index, second = Nif index
+		vector<int>         uvChannels; // Max map channel of each Nif uv set
 		vector<Color4>      vcolors;
 		vector<int>         vidx;
 		vector<int>         fidx;
-		TriStrips           strips;
+		WeldGrid            weld;
+
+		// filled by prepareFaceGroup before any niflib blocks are created
+		TriStrips           shapeStrips; // strips in original vertex order for NiTriStripsData
+		vector<Vector3>     tangents;
+		vector<Vector3>     binormals;
+		bool                hasTangents;
+		bool                prepared;
 	};
 
-	// maps face groups to material ID
+	// face groups in material order.  a material whose faces need more vertices than
+	//   16 bit indices can address is spread over several groups
 	typedef std::map<int, FaceGroup>    FaceGroups;
 	typedef std::set<INode*> INodeMap;
 	typedef std::map<tstring, NiNodeRef>    NodeMap;
@@ -251,8 +294,15 @@ public:
 
 	/* tristrips */
 	void                 strippify(TriStrips &strips, vector<Vector3> &verts, vector<Vector3> &norms, const Triangles &tris);
-	void                 strippify(FaceGroup &grp);
 	NiTriStripsDataRef   makeTriStripsData(const TriStrips &strips);
+	// reorders triangles for the post-transform cache and vertices for fetch locality
+	void                 optimizeVertexCache(FaceGroup &grp);
+	// reorders a triangle list in place for the post-transform cache
+	static void          optimizeTriangleOrder(Triangles &tris, int nverts);
+	// moves vertex i to newIndex[i] in every vertex stream, face and strip of the group
+	void                 remapVertices(FaceGroup &grp, const vector<int> &newIndex);
+	// renumbers the vertices of the group in the order its shape strips first use them
+	void                 remapStripVertices(FaceGroup &grp);
 
 	/* mesh export */
 	// adds a vertex to a face group if it doesn't exist yet. returns new or previous index into the
@@ -260,6 +310,12 @@ public:
 	int                  addVertex(FaceGroup &grp, int face, int vi, Mesh *mesh, const Matrix3 &texm, vector<Color4>& vertColors);
 	// creates face groups from faces with same sub material id
 	bool                 splitMesh(INode *node, Mesh &, FaceGroups &grps, TimeValue t, vector<Color4>& vertColors, bool noSplit);
+	// adds the given faces of one material to a group.  returns false once the group
+	//   needs more vertices than 16 bit indices can address
+	bool                 addFaces(FaceGroup &grp, INode *node, Mesh &mesh, int mtlID, const vector<int> &faces, const int vi[3], vector<Color4>& vertColors);
+	// computes strips and tangents for a face group.  touches neither Max nor niflib
+	//   objects so it is run for all face groups of a mesh concurrently
+	void                 prepareFaceGroup(FaceGroup &grp, bool exportStrips);
 	// creates a NiTriStrips or NiTriShape hierarchy from a face group
     NiAVObjectRef        makeMesh(NiNodeRef &parent, INode*node, Mtl *mtl, FaceGroup &grp, bool exportStrips);
 	// creates a BSTriShape hierarchy from a face group
@@ -278,8 +334,10 @@ public:
 	void                 updateSkinnedMaterial(NiGeometryRef shape);
 
 	/* havok & collision */
-	int                  addVertex(vector<Vector3> &verts, vector<Vector3> &vnorms, const Point3 &pt, const Point3 &norm);
-	void                 addFace(Triangles &tris, vector<Vector3> &verts, vector<Vector3> &vnorms, int face, const int vi[3], Mesh *mesh, Matrix3& tm);
+	int                  findWeldedVertex(const WeldGrid &weld, const vector<Vector3> &verts, const vector<Vector3> *vnorms, const Point3 &pt, const Point3 &norm, float thresh);
+	int                  addVertex(WeldGrid &weld, vector<Vector3> &verts, vector<Vector3> &vnorms, const Point3 &pt, const Point3 &norm);
+	void                 addFace(WeldGrid &weld, Triangles &tris, vector<Vector3> &verts, vector<Vector3> &vnorms, int face, const int vi[3], Mesh *mesh, Matrix3& tm);
+	void                 weldCollisionVerts(Mesh &mesh, Matrix3 &tm, vector<Vector3> &verts, vector<int> &vmap);
 	bool                 makeCollisionHierarchy(NiNodeRef &parent, INode *node, TimeValue t);
 
 	/* creates a bhkRigidBody */
@@ -302,6 +360,8 @@ public:
 	Ref<bhkNiTriStripsShape>    makeTriStripsShape(Mesh& mesh, Matrix3& sm, int mtlDefault);
 	Ref<bhkPackedNiTriStripsShape>    makePackedTriStripsShape(Mesh& mesh, Matrix3& sm, int mtlDefault, int layer, int colFilter);
 	Ref<bhkCompressedMeshShape> makeCompressedMeshShape(Mesh& mesh, Matrix3& sm, int mtlDefault, int layer, int colFilter);
+	void                 addCompressedMeshChunks(const vector<Vector3> &verts, const vector<int> &indices, unsigned int materialIndex,
+		unsigned short transformIndex, vector<bhkCMSDChunk> &chunks, vector<Vector4> &bigVerts, vector<bhkCMSDBigTris> &bigTris);
 	
 
 	bhkShapeRef          makeProxyShape(INode *node, Object *obj, Matrix3& tm, int mtlDefault);
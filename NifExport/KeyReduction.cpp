@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "KeyReduction.h"
+
+namespace {
+
+float Fraction(float time, float start, float end)
+{
+	return (end > start) ? (time - start) / (end - start) : 0.0f;
+}
+
+struct PositionError
+{
+	float operator()(const Vector3Key &a, const Vector3Key &b, const Vector3Key &k) const {
+		float t = Fraction(k.time, a.time, b.time);
+		float dx = a.data.x + (b.data.x - a.data.x) * t - k.data.x;
+		float dy = a.data.y + (b.data.y - a.data.y) * t - k.data.y;
+		float dz = a.data.z + (b.data.z - a.data.z) * t - k.data.z;
+		return sqrtf(dx * dx + dy * dy + dz * dz);
+	}
+};
+
+struct ScaleError
+{
+	float operator()(const FloatKey &a, const FloatKey &b, const FloatKey &k) const {
+		float t = Fraction(k.time, a.time, b.time);
+		return fabsf(a.data + (b.data - a.data) * t - k.data);
+	}
+};
+
+// angle between the key and the slerp of its neighbours
+struct RotationError
+{
+	float operator()(const QuatKey &a, const QuatKey &b, const QuatKey &k) const {
+		double t = Fraction(k.time, a.time, b.time);
+		const Quaternion &p = a.data, &q = b.data;
+		double cosom = double(p.w) * q.w + double(p.x) * q.x + double(p.y) * q.y + double(p.z) * q.z;
+		double sign = (cosom < 0.0) ? -1.0 : 1.0;
+		cosom *= sign;
+		double s0 = 1.0 - t, s1 = t;
+		if (cosom < 0.9999) {
+			double omega = acos(cosom), sinom = sin(omega);
+			s0 = sin((1.0 - t) * omega) / sinom;
+			s1 = sin(t * omega) / sinom;
+		}
+		s1 *= sign;
+		double w = s0 * p.w + s1 * q.w, x = s0 * p.x + s1 * q.x;
+		double y = s0 * p.y + s1 * q.y, z = s0 * p.z + s1 * q.z;
+		double len = sqrt(w * w + x * x + y * y + z * z);
+		double klen = sqrt(double(k.data.w) * k.data.w + double(k.data.x) * k.data.x + double(k.data.y) * k.data.y + double(k.data.z) * k.data.z);
+		if (len <= 0.0 || klen <= 0.0)
+			return 0.0f;
+		double dot = fabs(w * k.data.w + x * k.data.x + y * k.data.y + z * k.data.z) / (len * klen);
+		return float(2.0 * acos(dot < 1.0 ? dot : 1.0));
+	}
+};
+
+template<typename K, typename Error>
+int ReduceKeys(vector<K> &keys, float tolerance, Error error)
+{
+	int n = int(keys.size());
+	if (n <= 2 || !(tolerance > 0.0f))
+		return 0;
+
+	vector<bool> keep(n, false);
+	keep[0] = keep[n - 1] = true;
+	vector<std::pair<int, int> > spans;
+	spans.push_back(std::make_pair(0, n - 1));
+	while (!spans.empty()) {
+		int a = spans.back().first, b = spans.back().second;
+		spans.pop_back();
+		int worst = -1;
+		float worstError = tolerance;
+		for (int i = a + 1; i < b; ++i) {
+			float e = error(keys[a], keys[b], keys[i]);
+			if (e > worstError) {
+				worstError = e;
+				worst = i;
+			}
+		}
+		if (worst < 0)
+			continue;
+		keep[worst] = true;
+		if (worst - a > 1)
+			spans.push_back(std::make_pair(a, worst));
+		if (b - worst > 1)
+			spans.push_back(std::make_pair(worst, b));
+	}
+
+	int kept = 0;
+	for (int i = 0; i < n; ++i) {
+		if (keep[i])
+			keys[kept++] = keys[i];
+	}
+	keys.resize(kept);
+	return n - kept;
+}
+
+} // namespace
+
+int ReduceLinearKeys(vector<Vector3Key> &keys, float tolerance)
+{
+	return ReduceKeys(keys, tolerance, PositionError());
+}
+
+int ReduceLinearKeys(vector<QuatKey> &keys, float tolerance)
+{
+	return ReduceKeys(keys, tolerance, RotationError());
+}
+
+int ReduceLinearKeys(vector<FloatKey> &keys, float tolerance)
+{
+	return ReduceKeys(keys, tolerance, ScaleError());
+}
@@ -0,0 +1,16 @@
+#ifndef __KEYREDUCTION_H__
+#define __KEYREDUCTION_H__
+
+#include "AnimKey.h"
+
+// Drops linear keys that interpolating between the keys kept around them
+//   reproduces within tolerance, splitting at the worst key first in the
+//   manner of Douglas-Peucker.  The first and last keys are always kept.
+//   Positions and scales are compared by distance, rotations by the angle
+//   in radians to the slerp of their neighbours.  A tolerance of zero or
+//   less keeps every key.  Returns the number of keys removed.
+int ReduceLinearKeys(vector<Vector3Key> &keys, float tolerance);
+int ReduceLinearKeys(vector<QuatKey> &keys, float tolerance);
+int ReduceLinearKeys(vector<FloatKey> &keys, float tolerance);
+
+#endif
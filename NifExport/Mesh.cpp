@@ -16,6 +16,9 @@
 #include "obj/bhkSphereShape.h"
 #include "obj/bhkCapsuleShape.h"
 #include "obj/BSDismemberSkinInstance.h"
+#include "obj/NiSkinData.h"
+#include "obj/NiSkinPartition.h"
+#include "obj/NiBinaryExtraData.h"
 #include "ObjectRegistry.h"
 #if __has_include(<obj/BSTriShape.h>)
 #include <obj/BSTriShape.h>
@@ -26,6 +29,14 @@
 #include <obj/BSSubIndexTriShape.h>
 #endif
 #include <gen/SphereBV.h>
+#include "ParallelFor.h"
+#include "BoundingVolume.h"
+#include "SkinPartition.h"
+#include "SkinWeights.h"
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#  define NIF_TANGENT_SSE 1
+#  include <emmintrin.h>
+#endif
 
 #pragma region Comparison Utilities
 inline bool equals(float a, float b, float thresh) {
@@ -127,20 +138,114 @@ struct VertexCompare
 		if ((d = compare(a.b, b.b, thresh)) != 0) return d;
 		return 0;
 	}
+	// vertices already in the group are read straight from its attribute streams
 	inline int compare(int lhs, const VertexGroup& rhs) const {
-		return compare(grp.vgrp[lhs], rhs);
+		int d;
+		if ((d = compare(grp.verts[lhs], rhs.pt, thresh)) != 0) return d;
+		if ((d = compare(grp.vnorms[lhs], rhs.norm, normthresh)) != 0) return d;
+		if ((d = compare(grp.vcolors[lhs], rhs.color, vthresh)) != 0) return d;
+		if ((d = int(grp.uvs.size()) - int(rhs.uvs.size())) != 0) return d;
+		for (int i = 0; i < rhs.uvs.size(); ++i) {
+			if ((d = compare(grp.uvs[i][lhs], rhs.uvs[i], vthresh)) != 0) return d;
+		}
+		return 0;
 	}
 	inline int compare(const VertexGroup& lhs, int rhs) const {
-		return compare(lhs, grp.vgrp[rhs]);
+		return -compare(rhs, lhs);
 	}
 	inline int compare(int lhs, int rhs) const {
-		return compare(grp.vgrp[lhs], grp.vgrp[rhs]);
+		int d;
+		if ((d = compare(grp.verts[lhs], grp.verts[rhs], thresh)) != 0) return d;
+		if ((d = compare(grp.vnorms[lhs], grp.vnorms[rhs], normthresh)) != 0) return d;
+		if ((d = compare(grp.vcolors[lhs], grp.vcolors[rhs], vthresh)) != 0) return d;
+		for (int i = 0; i < grp.uvs.size(); ++i) {
+			if ((d = compare(grp.uvs[i][lhs], grp.uvs[i][rhs], vthresh)) != 0) return d;
+		}
+		return 0;
 	}
 	FaceGroup& grp;
 	float thresh, normthresh, vthresh;
 };
 typedef std::pair< std::vector<int>::iterator, std::vector<int>::iterator > IntRange;
 
+// Cells are twice the weld threshold so any two points within the threshold
+//   are at most one cell apart even after rounding of pt * invCellSize
+void Exporter::WeldGrid::init(float thresh)
+{
+	cellSize = max(thresh * 2.0f, 1.0e-4f);
+	invCellSize = 1.0f / cellSize;
+	cells.clear();
+	next.clear();
+}
+
+void Exporter::WeldGrid::clear()
+{
+	cellSize = invCellSize = 0.0f;
+	std::unordered_map<CellKey, int>().swap(cells);
+	vector<int>().swap(next);
+}
+
+void Exporter::WeldGrid::cellOf(const Point3 &pt, long long cell[3]) const
+{
+	const double limit = 1.0e15;
+	for (int i = 0; i < 3; ++i) {
+		double d = floor(double(pt[i]) * double(invCellSize));
+		if (!(d == d)) d = 0.0; // NaN never welds, any cell will do
+		cell[i] = (long long)((d < -limit) ? -limit : (d > limit) ? limit : d);
+	}
+}
+
+Exporter::WeldGrid::CellKey Exporter::WeldGrid::keyOf(long long x, long long y, long long z)
+{
+	// 21 bits per axis; distant cells that alias only cost an extra compare
+	const CellKey mask = (1ULL << 21) - 1;
+	return ((CellKey(x) & mask) << 42) | ((CellKey(y) & mask) << 21) | (CellKey(z) & mask);
+}
+
+int Exporter::WeldGrid::first(CellKey key) const
+{
+	std::unordered_map<CellKey, int>::const_iterator itr = cells.find(key);
+	return (itr != cells.end()) ? (*itr).second : -1;
+}
+
+void Exporter::WeldGrid::insert(const Point3 &pt, int idx)
+{
+	long long cell[3];
+	cellOf(pt, cell);
+	CellKey key = keyOf(cell[0], cell[1], cell[2]);
+	if (int(next.size()) <= idx)
+		next.resize(idx + 1, -1);
+	std::unordered_map<CellKey, int>::iterator itr = cells.find(key);
+	if (itr == cells.end()) {
+		next[idx] = -1;
+		cells.insert(std::make_pair(key, idx));
+	} else {
+		next[idx] = (*itr).second;
+		(*itr).second = idx;
+	}
+}
+
+// Returns the lowest index in the group that compares equal to vg or -1.
+//   Matches the result of a linear scan over the group's vertices.
+static int FindWeldedVertex(const Exporter::WeldGrid &weld, const VertexCompare &vc, const Exporter::VertexGroup &vg)
+{
+	long long cell[3];
+	weld.cellOf(vg.pt, cell);
+	int best = -1;
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dz = -1; dz <= 1; ++dz) {
+				Exporter::WeldGrid::CellKey key = Exporter::WeldGrid::keyOf(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+				for (int i = weld.first(key); i >= 0; i = weld.next[i]) {
+					if ((best < 0 || i < best) && vc.compare(vg, i) == 0)
+						best = i;
+				}
+			}
+		}
+	}
+	return best;
+}
+
 
 
 	namespace std
@@ -189,7 +294,53 @@ inline Triangle& rotate(Triangle &t)
 	}
 	return t;
 }
-typedef std::map<Triangle, int> FaceMap;
+
+// Open addressing table from a triangle in any of its rotations to its index
+class TriangleIndex
+{
+public:
+	explicit TriangleIndex(const vector<Triangle> &tris) {
+		size_t size = 16;
+		while (size < tris.size() * 2)
+			size <<= 1;
+		mask = size - 1;
+		keys.assign(size, (unsigned long long)EmptyKey);
+		values.resize(size);
+		for (int i = 0; i < int(tris.size()); ++i) {
+			unsigned long long key = Key(tris[i]);
+			size_t slot = Slot(key);
+			while (keys[slot] != EmptyKey && keys[slot] != key)
+				slot = (slot + 1) & mask;
+			keys[slot] = key;
+			values[slot] = i; // the last duplicate wins
+		}
+	}
+
+	// returns -1 if the triangle is not in the table
+	int find(const Triangle &tri) const {
+		unsigned long long key = Key(tri);
+		for (size_t slot = Slot(key); keys[slot] != EmptyKey; slot = (slot + 1) & mask) {
+			if (keys[slot] == key)
+				return values[slot];
+		}
+		return -1;
+	}
+
+private:
+	static const unsigned long long EmptyKey = ~0ULL;
+
+	static unsigned long long Key(Triangle tri) {
+		rotate(tri);
+		return (unsigned long long)tri[0] | ((unsigned long long)tri[1] << 16) | ((unsigned long long)tri[2] << 32);
+	}
+	size_t Slot(unsigned long long key) const {
+		return size_t((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+	}
+
+	vector<unsigned long long> keys;
+	vector<int>                values;
+	size_t                     mask;
+};
 
 
 #pragma endregion
@@ -304,6 +455,14 @@ Exporter::Result Exporter::exportMesh(NiNodeRef &ninode, INode *node, TimeValue
 		}
 		bool exportStrips = mTriStrips && (Exporter::mNifVersionInt > VER_4_2_2_0);
 
+		// per material work that needs neither Max nor niflib runs on all cores,
+		//   the blocks themselves are then created and attached in order below
+		vector<FaceGroup*> work;
+		work.reserve(grps.size());
+		for (FaceGroups::iterator itr = grps.begin(); itr != grps.end(); ++itr)
+			work.push_back(&(*itr).second);
+		ParallelFor(work.size(), [&](size_t i) { prepareFaceGroup(*work[i], exportStrips); });
+
 		Matrix44 tm = Matrix44::IDENTITY;
 		if (mExportExtraNodes || (mExportType != NIF_WO_ANIM && isNodeKeyed(node))) {
 			tm = TOMATRIX4(getObjectTransform(node, t, false) * Inverse(getNodeTransform(node, t, false)));
@@ -324,7 +483,7 @@ Exporter::Result Exporter::exportMesh(NiNodeRef &ninode, INode *node, TimeValue
 		for (grp = grps.begin(); grp != grps.end(); ++grp, ++i)
 		{
 			string name = FormatString(format, basename.data(), i);
-			NiAVObjectRef shape = makeMesh(ninode, node, getMaterial(node, grp->first), grp->second, exportStrips);
+			NiAVObjectRef shape = makeMesh(ninode, node, getMaterial(node, grp->second.mtlID), grp->second, exportStrips);
 			if (shape == nullptr)
 			{
 				result = Error;
@@ -372,6 +531,34 @@ Exporter::Result Exporter::exportMesh(NiNodeRef &ninode, INode *node, TimeValue
 	return result;
 }
 
+// Stores precomputed tangents and binormals where UpdateTangentSpace puts its
+//   own: in the geometry data when the tspace flag is set, otherwise in the
+//   binary extra data Oblivion reads, tangents first.
+static void SetTangentSpace(NiTriBasedGeomRef shape, NiTriBasedGeomDataRef data, const vector<Vector3>& tangents, const vector<Vector3>& binormals)
+{
+	if (data->GetTspaceFlag() != 0) {
+		data->SetTangents(tangents);
+		data->SetBitangents(binormals);
+		return;
+	}
+	size_t nverts = tangents.size();
+	vector<Niflib::byte> binData(2 * sizeof(float) * 3 * nverts);
+	float *tan_xyz = reinterpret_cast<float*>(binData.data());
+	float *bin_xyz = tan_xyz + 3 * nverts;
+	for (size_t i = 0; i < nverts; ++i) {
+		tan_xyz[i * 3 + 0] = tangents[i].x;
+		tan_xyz[i * 3 + 1] = tangents[i].y;
+		tan_xyz[i * 3 + 2] = tangents[i].z;
+		bin_xyz[i * 3 + 0] = binormals[i].x;
+		bin_xyz[i * 3 + 1] = binormals[i].y;
+		bin_xyz[i * 3 + 2] = binormals[i].z;
+	}
+	NiBinaryExtraDataRef tspace = new NiBinaryExtraData();
+	tspace->SetName("Tangent space (binormal & tangent vectors)");
+	tspace->SetData(binData);
+	shape->AddExtraData(StaticCast<NiExtraData>(tspace), Exporter::mNifVersionInt);
+}
+
 NiAVObjectRef Exporter::makeMesh(NiNodeRef &parent, INode* node, Mtl *mtl, FaceGroup &grp, bool exportStrips)
 {
 	if (IsFallout4()) {
@@ -393,6 +580,8 @@ NiAVObjectRef Exporter::makeMesh(NiNodeRef &parent, INode* node, Mtl *mtl, FaceG
       shape = (exportStrips) ? (NiTriBasedGeom*)new NiTriStrips() : (NiTriBasedGeom*)new NiTriShape();
    if ( node->GetUserPropString(TEXT("ShapeDataType"), shapeDataType) )
       data = DynamicCast<NiTriBasedGeomData>(Niflib::ObjectRegistry::CreateObject(T2A(shapeDataType)));
+   if (data == NULL && exportStrips && grp.prepared && !mUseAlternateStripper)
+      data = StaticCast<NiTriBasedGeomData>(makeTriStripsData(grp.shapeStrips));
    if (data == NULL)
       data = (exportStrips) ? (NiTriBasedGeomData*)new NiTriStripsData(grp.faces, !mUseAlternateStripper) : (NiTriBasedGeomData*)new NiTriShapeData(grp.faces);
 
@@ -402,7 +591,10 @@ NiAVObjectRef Exporter::makeMesh(NiNodeRef &parent, INode* node, Mtl *mtl, FaceG
 	data->SetVertices(grp.verts);
 	data->SetNormals(grp.vnorms);
 	data->SetVertexIndices(grp.vidx);
-	data->SetUVSetMap(grp.uvMapping);
+	std::map<int, int> uvMapping; // first = Max index, second = Nif index
+	for (int i = 0, n = grp.uvChannels.size(); i < n; ++i)
+		uvMapping[grp.uvChannels[i]] = i;
+	data->SetUVSetMap(uvMapping);
 
 	int nUVs = grp.uvs.size();
 	if (IsFallout3() || IsSkyrim())
@@ -440,7 +632,16 @@ NiAVObjectRef Exporter::makeMesh(NiNodeRef &parent, INode* node, Mtl *mtl, FaceG
 		// enable traditional tangents and binormals for non-oblivion meshes
 		if (!IsOblivion() && (Exporter::mNifVersionInt >= VER_10_0_1_0))
 			data->SetTspaceFlag(0x01);
-		shape->UpdateTangentSpace(Exporter::mTangentAndBinormalMethod);
+		// niflib only implements the NifSkope and Obsidian methods, MikkTSpace
+		//   tangents come from prepareFaceGroup
+		ProfileScope profile(ExportProfiler::Tangents);
+		if (Exporter::mTangentAndBinormalMethod == 2) {
+			if (grp.hasTangents)
+				SetTangentSpace(shape, data, grp.tangents, grp.binormals);
+		}
+		else {
+			shape->UpdateTangentSpace(Exporter::mTangentAndBinormalMethod);
+		}
 	}
 
 	parent->AddChild(DynamicCast<NiAVObject>(shape));
@@ -453,177 +654,355 @@ NiAVObjectRef Exporter::makeMesh(NiNodeRef &parent, INode* node, Mtl *mtl, FaceG
 }
 
 
-static bool CalcTangentSpace(const Exporter::Triangles& tris, const vector<Vector3>& verts, const vector<Vector3>& norms, 
-	const vector<TexCoord>& uvs, vector<Vector3>& tangents, vector<Vector3>& binormals)
+// Four-wide float helpers for the tangent space kernels.  Only plain IEEE
+//   add/sub/mul/div/sqrt are used, in the same order as the Vector3 operators,
+//   so the SSE and scalar builds produce bit-identical results.
+#ifdef NIF_TANGENT_SSE
+struct Float4
 {
-	const int method = 0;
-	if (verts.empty() || uvs.empty() || norms.empty()) return false;
+	__m128 v;
+	Float4() {}
+	Float4(__m128 a) : v(a) {}
+	explicit Float4(float f) : v(_mm_set1_ps(f)) {}
+	Float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+	static Float4 Load(const float *p) { return _mm_loadu_ps(p); }
+	void Store(float *p) const { _mm_storeu_ps(p, v); }
+};
+struct Mask4
+{
+	__m128 v;
+	Mask4(__m128 a) : v(a) {}
+};
+inline Float4 operator+(const Float4& a, const Float4& b) { return _mm_add_ps(a.v, b.v); }
+inline Float4 operator-(const Float4& a, const Float4& b) { return _mm_sub_ps(a.v, b.v); }
+inline Float4 operator*(const Float4& a, const Float4& b) { return _mm_mul_ps(a.v, b.v); }
+inline Float4 operator/(const Float4& a, const Float4& b) { return _mm_div_ps(a.v, b.v); }
+inline Float4 Sqrt(const Float4& a) { return _mm_sqrt_ps(a.v); }
+inline Mask4 operator&(const Mask4& a, const Mask4& b) { return _mm_and_ps(a.v, b.v); }
+inline Mask4 operator|(const Mask4& a, const Mask4& b) { return _mm_or_ps(a.v, b.v); }
+inline Mask4 CmpEq(const Float4& a, const Float4& b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline Mask4 CmpGe(const Float4& a, const Float4& b) { return _mm_cmpge_ps(a.v, b.v); }
+inline Mask4 CmpGt(const Float4& a, const Float4& b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline Float4 Select(const Mask4& m, const Float4& a, const Float4& b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+#else
+struct Float4
+{
+	float v[4];
+	Float4() {}
+	explicit Float4(float f) { v[0] = v[1] = v[2] = v[3] = f; }
+	Float4(float a, float b, float c, float d) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+	static Float4 Load(const float *p) { return Float4(p[0], p[1], p[2], p[3]); }
+	void Store(float *p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+};
+struct Mask4
+{
+	bool v[4];
+};
+#define FLOAT4_OP(expr) Float4 r; for (int k = 0; k < 4; ++k) r.v[k] = (expr); return r
+#define MASK4_OP(expr) Mask4 r; for (int k = 0; k < 4; ++k) r.v[k] = (expr); return r
+inline Float4 operator+(const Float4& a, const Float4& b) { FLOAT4_OP(a.v[k] + b.v[k]); }
+inline Float4 operator-(const Float4& a, const Float4& b) { FLOAT4_OP(a.v[k] - b.v[k]); }
+inline Float4 operator*(const Float4& a, const Float4& b) { FLOAT4_OP(a.v[k] * b.v[k]); }
+inline Float4 operator/(const Float4& a, const Float4& b) { FLOAT4_OP(a.v[k] / b.v[k]); }
+inline Float4 Sqrt(const Float4& a) { FLOAT4_OP(sqrtf(a.v[k])); }
+inline Mask4 operator&(const Mask4& a, const Mask4& b) { MASK4_OP(a.v[k] && b.v[k]); }
+inline Mask4 operator|(const Mask4& a, const Mask4& b) { MASK4_OP(a.v[k] || b.v[k]); }
+inline Mask4 CmpEq(const Float4& a, const Float4& b) { MASK4_OP(a.v[k] == b.v[k]); }
+inline Mask4 CmpGe(const Float4& a, const Float4& b) { MASK4_OP(a.v[k] >= b.v[k]); }
+inline Mask4 CmpGt(const Float4& a, const Float4& b) { MASK4_OP(a.v[k] > b.v[k]); }
+inline Float4 Select(const Mask4& m, const Float4& a, const Float4& b) { FLOAT4_OP(m.v[k] ? a.v[k] : b.v[k]); }
+#undef FLOAT4_OP
+#undef MASK4_OP
+#endif
 
-	tangents.resize(verts.size());
-	binormals.resize(verts.size());
-	if (method == 0) // Nifskope algorithm
-	{
-		for (int t = 0; t < (int)tris.size(); t++) {
-			const Triangle & tri = tris[t];
+// Structure-of-arrays vectors, padded to a multiple of four elements so the
+//   kernels never need a scalar tail.
+struct Vec3SoA
+{
+	vector<float> x, y, z;
 
-			int i1 = tri[0];
-			int i2 = tri[1];
-			int i3 = tri[2];
+	void resize(size_t n) {
+		n = (n + 3) & ~size_t(3);
+		x.assign(n, 0.0f); y.assign(n, 0.0f); z.assign(n, 0.0f);
+	}
+};
 
-			const Vector3 v1 = verts[i1];
-			const Vector3 v2 = verts[i2];
-			const Vector3 v3 = verts[i3];
+struct Float4x3
+{
+	Float4 x, y, z;
 
-			const TexCoord w1 = uvs[i1];
-			const TexCoord w2 = uvs[i2];
-			const TexCoord w3 = uvs[i3];
+	Float4x3() {}
+	Float4x3(const Float4& a, const Float4& b, const Float4& c) : x(a), y(b), z(c) {}
 
-			Vector3 v2v1 = v2 - v1;
-			Vector3 v3v1 = v3 - v1;
+	static Float4x3 Load(const Vec3SoA& s, size_t i) {
+		return Float4x3(Float4::Load(&s.x[i]), Float4::Load(&s.y[i]), Float4::Load(&s.z[i]));
+	}
+	void Store(Vec3SoA& s, size_t i) const {
+		x.Store(&s.x[i]); y.Store(&s.y[i]); z.Store(&s.z[i]);
+	}
+	Float4x3 operator+(const Float4x3& o) const { return Float4x3(x + o.x, y + o.y, z + o.z); }
+	Float4x3 operator-(const Float4x3& o) const { return Float4x3(x - o.x, y - o.y, z - o.z); }
+	Float4x3 operator*(const Float4& s) const { return Float4x3(x * s, y * s, z * s); }
+	Float4 Dot(const Float4x3& o) const { return x * o.x + y * o.y + z * o.z; }
+	Float4x3 Cross(const Float4x3& o) const {
+		return Float4x3(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x);
+	}
+	// Same as Vector3::Normalized, including its lack of a zero length guard
+	Float4x3 Normalized() const {
+		Float4 m = Sqrt(x * x + y * y + z * z);
+		return Float4x3(x / m, y / m, z / m);
+	}
+	Mask4 IsZero() const {
+		Float4 zero(0.0f);
+		return CmpEq(x, zero) & CmpEq(y, zero) & CmpEq(z, zero);
+	}
+	static Float4x3 Select(const Mask4& m, const Float4x3& a, const Float4x3& b) {
+		return Float4x3(::Select(m, a.x, b.x), ::Select(m, a.y, b.y), ::Select(m, a.z, b.z));
+	}
+};
 
-			TexCoord w2w1(w2.u - w1.u, w2.v - w1.v);
-			TexCoord w3w1(w3.u - w1.u, w3.v - w1.v);
+// Gathers the vertices and uvs used by corner c of faces [f, f+4).  Lanes past
+//   the end of the face list repeat face 0 and are discarded by the caller.
+static void GatherCorner(const Exporter::Triangles& tris, size_t f, int c,
+	const vector<Vector3>& verts, const vector<TexCoord>& uvs, Float4x3& p, Float4& u, Float4& v)
+{
+	int idx[4];
+	for (int k = 0; k < 4; ++k)
+		idx[k] = (f + k < tris.size()) ? tris[f + k][c] : tris[0][c];
+	const Vector3 &a = verts[idx[0]], &b = verts[idx[1]], &d = verts[idx[2]], &e = verts[idx[3]];
+	p = Float4x3(Float4(a.x, b.x, d.x, e.x), Float4(a.y, b.y, d.y, e.y), Float4(a.z, b.z, d.z, e.z));
+	u = Float4(uvs[idx[0]].u, uvs[idx[1]].u, uvs[idx[2]].u, uvs[idx[3]].u);
+	v = Float4(uvs[idx[0]].v, uvs[idx[1]].v, uvs[idx[2]].v, uvs[idx[3]].v);
+}
 
-			float r = w2w1.u * w3w1.v - w3w1.u * w2w1.v;
+static void LoadVec3SoA(Vec3SoA& s, const vector<Vector3>& src)
+{
+	s.resize(src.size());
+	for (size_t i = 0; i < src.size(); ++i) {
+		s.x[i] = src[i].x; s.y[i] = src[i].y; s.z[i] = src[i].z;
+	}
+}
 
-			r = (r >= 0.0f ? +1.0f : -1.0f);
+static void StoreVec3SoA(const Vec3SoA& s, vector<Vector3>& dst)
+{
+	for (size_t i = 0; i < dst.size(); ++i)
+		dst[i] = Vector3(s.x[i], s.y[i], s.z[i]);
+}
 
-			Vector3 sdir(
-				(w3w1.v * v2v1.x - w2w1.v * v3v1.x) * r,
-				(w3w1.v * v2v1.y - w2w1.v * v3v1.y) * r,
-				(w3w1.v * v2v1.z - w2w1.v * v3v1.z) * r
-				);
+// Adds the per face vectors to each of the face's vertices.  Kept scalar and in
+//   face order so the sums match the original per triangle loop exactly.
+static void AccumulateFaceVectors(const Exporter::Triangles& tris, const Vec3SoA& fv, Vec3SoA& acc)
+{
+	for (size_t t = 0; t < tris.size(); ++t) {
+		const Triangle & tri = tris[t];
+		for (int j = 0; j < 3; j++) {
+			int i = tri[j];
+			acc.x[i] += fv.x[t];
+			acc.y[i] += fv.y[t];
+			acc.z[i] += fv.z[t];
+		}
+	}
+}
 
-			Vector3 tdir(
-				(w2w1.u * v3v1.x - w3w1.u * v2v1.x) * r,
-				(w2w1.u * v3v1.y - w3w1.u * v2v1.y) * r,
-				(w2w1.u * v3v1.z - w3w1.u * v2v1.z) * r
-				);
-			sdir = sdir.Normalized();
-			tdir = tdir.Normalized();
+static Vector3 SafeNormalized(const Vector3& v)
+{
+	float m = v.Magnitude();
+	return (m > FLT_MIN) ? v * (1.0f / m) : Vector3();
+}
+
+// Per face tangent space used by the MikkTSpace compatible method
+static void CalcMikkFaceVectors(const Exporter::Triangles& tris, const vector<Vector3>& verts,
+	const vector<TexCoord>& uvs, Vec3SoA& fs, vector<float>& orient)
+{
+	Float4 zero(0.0f), one(1.0f), minusOne(-1.0f), tiny(FLT_MIN);
+	for (size_t f = 0; f < tris.size(); f += 4) {
+		Float4x3 p1, p2, p3;
+		Float4 u1, v1, u2, v2, u3, v3;
+		GatherCorner(tris, f, 0, verts, uvs, p1, u1, v1);
+		GatherCorner(tris, f, 1, verts, uvs, p2, u2, v2);
+		GatherCorner(tris, f, 2, verts, uvs, p3, u3, v3);
+
+		Float4 t21x = u2 - u1, t21y = v2 - v1;
+		Float4 t31x = u3 - u1, t31y = v3 - v1;
+		Float4x3 d1 = p2 - p1, d2 = p3 - p1;
+
+		Float4 area = t21x * t31y - t21y * t31x;
+		Float4 sign = Select(CmpGt(area, zero), one, minusOne);
+
+		Float4x3 os = d1 * t31y - d2 * t21y;
+
+		// orient the vector by the uv winding and leave degenerate ones alone
+		Float4 lenOs = Sqrt(os.Dot(os));
+		os = Float4x3::Select(CmpGt(lenOs, tiny), os * (sign / lenOs), os);
+
+		os.Store(fs, f);
+		sign.Store(&orient[f]);
+	}
+}
+
+// Calculates vertex tangents and binormals for the given triangles.
+//   method 0 is the NifSkope algorithm, 1 the Obsidian algorithm and 2 a
+//   MikkTSpace compatible one.  Following the first two methods, binormals
+//   receive the u direction and tangents the v direction.
+static bool CalcTangentSpace(const Exporter::Triangles& tris, const vector<Vector3>& verts, const vector<Vector3>& norms,
+	const vector<TexCoord>& uvs, vector<Vector3>& tangents, vector<Vector3>& binormals, int method)
+{
+	ProfileScope profile(ExportProfiler::Tangents, false);
+	if (verts.empty() || uvs.empty() || norms.empty()) return false;
+
+	tangents.assign(verts.size(), Vector3());
+	binormals.assign(verts.size(), Vector3());
+	if (tris.empty()) return true;
 
-			// no duplication, just smoothing
+	// face vectors and vertex sums are kept as structure of arrays so the
+	//   per face and per vertex math runs four at a time
+	Vec3SoA fs, ft, t, b, n;
+	fs.resize(tris.size());
+	ft.resize(tris.size());
+	t.resize(verts.size());
+	b.resize(verts.size());
+
+	if (method == 1) // Obsidian Algorithm
+	{
+		for (size_t f = 0; f < tris.size(); f += 4) {
+			Float4x3 p0, p1, p2;
+			Float4 u0, v0, u1, v1, u2, v2;
+			GatherCorner(tris, f, 0, verts, uvs, p0, u0, v0);
+			GatherCorner(tris, f, 1, verts, uvs, p1, u1, v1);
+			GatherCorner(tris, f, 2, verts, uvs, p2, u2, v2);
+
+			Float4x3 side_0 = p0 - p1;
+			Float4x3 side_1 = p2 - p1;
+
+			Float4 delta_U_0 = u0 - u1;
+			Float4 delta_U_1 = u2 - u1;
+			Float4 delta_V_0 = v0 - v1;
+			Float4 delta_V_1 = v2 - v1;
+
+			(side_0 * delta_V_1 - side_1 * delta_V_0).Normalized().Store(ft, f);
+			(side_0 * delta_U_1 - side_1 * delta_U_0).Normalized().Store(fs, f);
+		}
+		AccumulateFaceVectors(tris, ft, t);
+		AccumulateFaceVectors(tris, fs, b);
+
+		// for each vertex, normalize the Tangent and Binormal
+		for (size_t i = 0; i < verts.size(); i += 4) {
+			Float4x3::Load(b, i).Normalized().Store(b, i);
+			Float4x3::Load(t, i).Normalized().Store(t, i);
+		}
+	}
+	else if (method == 2) // MikkTSpace compatible
+	{
+		// MikkTSpace splits vertices whose faces disagree; the exporter has
+		//   already welded vertices by position, normal and uv so they are
+		//   averaged here and the handedness follows the dominant faces.
+		vector<float> orient((tris.size() + 3) & ~size_t(3));
+		vector<float> handedness(verts.size(), 0.0f);
+		CalcMikkFaceVectors(tris, verts, uvs, fs, orient);
+
+		for (size_t f = 0; f < tris.size(); ++f) {
+			const Triangle & tri = tris[f];
+			Vector3 fos(fs.x[f], fs.y[f], fs.z[f]);
 			for (int j = 0; j < 3; j++) {
 				int i = tri[j];
-				tangents[i] += tdir;
-				binormals[i] += sdir;
+				const Vector3 & vn = norms[i];
+				const Vector3 & p = verts[i];
+
+				// weight by the corner angle measured in the tangent plane
+				Vector3 e1 = verts[tri[(j + 2) % 3]] - p;
+				Vector3 e2 = verts[tri[(j + 1) % 3]] - p;
+				e1 = SafeNormalized(e1 - vn * vn.DotProduct(e1));
+				e2 = SafeNormalized(e2 - vn * vn.DotProduct(e2));
+				float cosAngle = e1.DotProduct(e2);
+				float angle = acosf(cosAngle > 1.0f ? 1.0f : (cosAngle < -1.0f ? -1.0f : cosAngle));
+
+				Vector3 os = SafeNormalized(fos - vn * vn.DotProduct(fos)) * angle;
+				b.x[i] += os.x; b.y[i] += os.y; b.z[i] += os.z;
+				handedness[i] += orient[f] * angle;
 			}
 		}
 
-		// for each vertex calculate tangent and binormal
-		for (unsigned i = 0; i < verts.size(); i++) {
-			const Vector3 & n = norms[i];
-
-			Vector3 & t = tangents[i];
-			Vector3 & b = binormals[i];
-
-			if (t == Vector3() || b == Vector3()) {
-				t.x = n.y;
-				t.y = n.z;
-				t.z = n.x;
-				b = n.CrossProduct(t);
+		for (size_t i = 0; i < verts.size(); ++i) {
+			const Vector3 & vn = norms[i];
+			Vector3 s = SafeNormalized(Vector3(b.x[i], b.y[i], b.z[i]));
+			Vector3 v;
+			if (s == Vector3()) {
+				v = Vector3(vn.y, vn.z, vn.x);
+				s = vn.CrossProduct(v);
 			}
 			else {
-				t = t.Normalized();
-				t = (t - n * n.DotProduct(t));
-				t = t.Normalized();
-
-				b = b.Normalized();
-				b = (b - n * n.DotProduct(b));
-				b = (b - t * t.DotProduct(b));
-				b = b.Normalized();
+				v = vn.CrossProduct(s) * (handedness[i] < 0.0f ? -1.0f : 1.0f);
 			}
+			t.x[i] = v.x; t.y[i] = v.y; t.z[i] = v.z;
+			b.x[i] = s.x; b.y[i] = s.y; b.z[i] = s.z;
 		}
 	}
-	else if (method == 1) // Obsidian Algorithm
+	else // Nifskope algorithm
 	{
-		for (unsigned int faceNo = 0; faceNo < tris.size(); ++faceNo)   // for each face
-		{
-			const Triangle & t = tris[faceNo];  // get face
-			int i0 = t[0], i1 = t[1], i2 = t[2];		// get vertex numbers
-			Vector3 side_0 = verts[i0] - verts[i1];
-			Vector3 side_1 = verts[i2] - verts[i1];
-
-			float delta_U_0 = uvs[i0].u - uvs[i1].u;
-			float delta_U_1 = uvs[i2].u - uvs[i1].u;
-			float delta_V_0 = uvs[i0].v - uvs[i1].v;
-			float delta_V_1 = uvs[i2].v - uvs[i1].v;
-
-			Vector3 face_tangent = (side_0 * delta_V_1 - side_1 * delta_V_0).Normalized();
-			Vector3 face_bi_tangent = (side_0 * delta_U_1 - side_1 * delta_U_0).Normalized();
-			Vector3 face_normal = (side_0 ^ side_1).Normalized();
-
-			// no duplication, just smoothing
-			for (int j = 0; j <= 2; j++) {
-				int i = t[j];
-				tangents[i] += face_tangent;
-				binormals[i] += face_bi_tangent;
-			}
+		Float4 zero(0.0f), one(1.0f), minusOne(-1.0f);
+		for (size_t f = 0; f < tris.size(); f += 4) {
+			Float4x3 v1, v2, v3;
+			Float4 w1u, w1v, w2u, w2v, w3u, w3v;
+			GatherCorner(tris, f, 0, verts, uvs, v1, w1u, w1v);
+			GatherCorner(tris, f, 1, verts, uvs, v2, w2u, w2v);
+			GatherCorner(tris, f, 2, verts, uvs, v3, w3u, w3v);
+
+			Float4x3 v2v1 = v2 - v1;
+			Float4x3 v3v1 = v3 - v1;
+
+			Float4 w2w1u = w2u - w1u, w2w1v = w2v - w1v;
+			Float4 w3w1u = w3u - w1u, w3w1v = w3v - w1v;
+
+			Float4 r = w2w1u * w3w1v - w3w1u * w2w1v;
+			r = Select(CmpGe(r, zero), one, minusOne);
+
+			Float4x3 sdir = (v2v1 * w3w1v - v3v1 * w2w1v) * r;
+			Float4x3 tdir = (v3v1 * w2w1u - v2v1 * w3w1u) * r;
+			sdir.Normalized().Store(fs, f);
+			tdir.Normalized().Store(ft, f);
 		}
+		// no duplication, just smoothing
+		AccumulateFaceVectors(tris, ft, t);
+		AccumulateFaceVectors(tris, fs, b);
 
-		// for each.getPosition(), normalize the Tangent and Binormal
-		for (unsigned int i = 0; i < verts.size(); i++) {
-			binormals[i] = binormals[i].Normalized();
-			tangents[i] = tangents[i].Normalized();
+		// for each vertex calculate tangent and binormal
+		LoadVec3SoA(n, norms);
+		for (size_t i = 0; i < verts.size(); i += 4) {
+			Float4x3 vn = Float4x3::Load(n, i);
+			Float4x3 vt = Float4x3::Load(t, i);
+			Float4x3 vb = Float4x3::Load(b, i);
+			Mask4 degenerate = vt.IsZero() | vb.IsZero();
+
+			Float4x3 altT(vn.y, vn.z, vn.x);
+			Float4x3 altB = vn.Cross(altT);
+
+			vt = vt.Normalized();
+			vt = vt - vn * vn.Dot(vt);
+			vt = vt.Normalized();
+
+			vb = vb.Normalized();
+			vb = vb - vn * vn.Dot(vb);
+			vb = vb - vt * vt.Dot(vb);
+			vb = vb.Normalized();
+
+			Float4x3::Select(degenerate, altT, vt).Store(t, i);
+			Float4x3::Select(degenerate, altB, vb).Store(b, i);
 		}
 	}
+	StoreVec3SoA(t, tangents);
+	StoreVec3SoA(b, binormals);
 	return true;
 }
 
-static void UpdateAABBBox(const Vector3& v, Vector3& lows, Vector3& highs)
+// Bounds of the vertices as their smallest enclosing sphere
+static void CalcMinimalSphere(const vector<Vector3>& vertices, SphereBV& bounds)
 {
-	if (v.x > highs.x) highs.x = v.x;
-	else if (v.x < lows.x) lows.x = v.x;
-	if (v.y > highs.y) highs.y = v.y;
-	else if (v.y < lows.y) lows.y = v.y;
-	if (v.z > highs.z) highs.z = v.z;
-	else if (v.z < lows.z) lows.z = v.z;
+	BoundingVolume bv;
+	CalcBoundingVolume(vertices, bv);
+	bounds.center = Vector3(bv.center[0], bv.center[1], bv.center[2]);
+	bounds.radius = bv.radius;
 }
 
-static void CalcAxisAlignedBox(const vector<Vector3>& vertices, SphereBV& bounds)
-{
-	//--Calculate center & radius--//
-
-	//Set lows and highs to first vertex
-	Vector3 lows = vertices[0];
-	Vector3 highs = vertices[0];
-
-	//Iterate through the vertices, adjusting the stored values
-	//if a vertex with lower or higher values is found
-	for (unsigned int i = 0; i < vertices.size(); ++i) {
-		UpdateAABBBox(vertices[i], lows, highs);
-	}
-
-	//Now we know the extent of the shape, so the center will be the average
-	//of the lows and highs
-	bounds.center = (highs + lows) / 2.0f;
-
-	//The radius will be the largest distance from the center
-	Vector3 diff;
-	float dist2(0.0f), maxdist2(0.0f);
-	for (unsigned int i = 0; i < vertices.size(); ++i) {
-		const Vector3 & v = vertices[i];
-
-		diff = bounds.center - v;
-		dist2 = diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
-		if (dist2 > maxdist2) maxdist2 = dist2;
-	};
-	bounds.radius = sqrt(maxdist2);
-}
-
-typedef std::pair<float, int> bone_weight;
-struct bone_weight_sort : std::less<bone_weight>
-{
-	bool operator()(const bone_weight& _Left, const bone_weight& _Right) const {
-		return std::less<bone_weight>()(_Right, _Left);
-	}
-};
-struct sum_weights {
-	float operator()(float total, bone_weight& w) const {
-		return total + w.first;
-	}
-};
-
 bool Exporter::UpdateBoneWeights(INode* node, Exporter::FaceGroup& grp, 
 	vector<NiNodeRef>& boneList, vector<BSVertexData>& vertData, vector<BSSkinBoneTrans>& boneTrans)
 {
@@ -636,14 +1015,11 @@ bool Exporter::UpdateBoneWeights(INode* node, Exporter::FaceGroup& grp,
 
 	ISkinContextData *skinData = skin->GetContextInterface(node);
 	if (!skinData) return false;
-	std::vector<Triangle> tris = grp.faces;
 	// Get bone references (may not actually exist in proper structure at this time)
 	//vector<bool> boneUsed;
-	vector<int> boneVertCount;
 	int totalBones = skin->GetNumBones();
 	boneList.resize(totalBones);
 	boneTrans.resize(totalBones);
-	boneVertCount.resize(totalBones);
 	//boneUsed.resize(totalBones);
 	for (int i = 0; i < totalBones; ++i) {
 		INode *bone = skin->GetBone(i);
@@ -654,70 +1030,24 @@ bool Exporter::UpdateBoneWeights(INode* node, Exporter::FaceGroup& grp,
 		bt.SetTransform(tm);
 	}
 
-	vector<Vector3> lows(totalBones, Vector3(FLT_MAX, FLT_MAX, FLT_MAX));
-	vector<Vector3> highs(totalBones, Vector3(-FLT_MAX,-FLT_MAX,-FLT_MAX));
-
-	vector<Vector3>& verts = grp.verts;
-	vector<int>& vidx = grp.vidx;
-	vector<int>& vmap = grp.vmap;
-	int nv = vidx.size();
+	// strongest four influences of each vertex; unweighted vertices go to the
+	//   first bone, assumed to be the most important one
+	SkinWeightTable weights;
+	weights.Build(skinData, totalBones, grp.vidx, grp.verts, true);
+	weights.CalcBoneSpheres(grp.verts);
+	int nv = weights.NumVertices();
 	for (int i = 0; i < nv; ++i)
 	{
 		BSVertexData& vd = vertData[i];
-		int vm_i = vmap[i];
-		int vi = vidx[i];
-		int nbones = skinData->GetNumAssignedBones(vi);
-		if (nbones == 0) {
-			vd.SetBoneWeight(0, 0, 1.0f);// assume first bone is most important bone
-		} else  {
-			vector<bone_weight> weights;
-			for (int j = 0; j < nbones; ++j) {
-				int boneIndex = skinData->GetAssignedBone(vi, j);
-				float weight = skinData->GetBoneWeight(vi, j);
-				weights.push_back(bone_weight(weight, boneIndex));
-			}
-			std::sort(weights.begin(), weights.end(), bone_weight_sort());
-			nbones = std::min(4, nbones);
-			vector<bone_weight>::iterator bwend = weights.begin();
-			std::advance(bwend, nbones);
-			float total = std::accumulate(weights.begin(), bwend, 0.0f, sum_weights());
-			for (int j = 0; j < nbones; ++j) {
-				int bi = weights[j].second;
-				vd.SetBoneWeight(j, bi, weights[j].first / total);
-
-				UpdateAABBBox(verts[vm_i], lows[bi], highs[bi]);
-				//BSSkinBoneTrans& bt = boneTrans[bi];
-				//bt.bsCenter += verts[vmap[i]]; // intermediate bounding sphere calc
-				boneVertCount[bi]++;
-			}
-		}
+		const SkinInfluence *sel = weights.Selected(i);
+		for (int j = 0, nbones = weights.NumSelected(i); j < nbones; ++j)
+			vd.SetBoneWeight(j, sel[j].bone, sel[j].weight);
 	}
 	for (int i = 0; i < totalBones; ++i) {
 		BSSkinBoneTrans& bt = boneTrans[i];
-		Vector3& btlows = lows[i];
-		Vector3& bthighs = highs[i];
-		int vc = boneVertCount[i];
-		if (vc){
-			bt.bounds.center = ((bthighs + btlows) / 2.0f);
-			bt.bounds.radius = 0.0f;
-		}else{
-			bt.bounds.center = Vector3(0.0f,0.0f,0.0f);
-			bt.bounds.radius = 0.0f;
-		}
-	}
-	float radsq = 0.0f;
-	for (int i = 0; i<nv; ++i) {
-		BSVertexData& vd = vertData[i];
-		
-		for (int j = 0; j < 4; ++j) {
-			int bi = vd.boneIndices[j];
-			float bw = vd.boneWeights[j];
-			if (bi == 0 && bw == 0.0f) break;
-
-			BSSkinBoneTrans& bt = boneTrans[bi];
-			float mag = (bt.bounds.center - verts[vmap[i]]).Magnitude();
-			bt.bounds.radius = max(bt.bounds.radius, mag);
-		}
+		const BoundingVolume& bv = weights.BoneBounds(i);
+		bt.bounds.center = Vector3(bv.center[0], bv.center[1], bv.center[2]);
+		bt.bounds.radius = bv.radius;
 	}
 	Matrix3 wm = node->GetNodeTM(0);
 	for (int i = 0; i < totalBones; ++i) {
@@ -878,8 +1208,11 @@ NiAVObjectRef Exporter::makeBSTriShape(NiNodeRef &parent, INode* node, Mtl *mtl,
 	has_vc = mVertexColors && !vcs.empty();
 	has_normal = !norms.empty();
 	
-	vector<Vector3> tangents, binormals;
-	has_tangent = CalcTangentSpace(tris, verts, norms, uvs, tangents, binormals);
+	if (!grp.prepared)
+		grp.hasTangents = CalcTangentSpace(tris, verts, norms, uvs, grp.tangents, grp.binormals, mTangentAndBinormalMethod);
+	const vector<Vector3>& tangents = grp.tangents;
+	const vector<Vector3>& binormals = grp.binormals;
+	has_tangent = grp.hasTangents;
 	
 	vector<BSVertexData> vertexData;
 	int nverts = verts.size();
@@ -916,7 +1249,7 @@ NiAVObjectRef Exporter::makeBSTriShape(NiNodeRef &parent, INode* node, Mtl *mtl,
 	}
 
 	SphereBV bounds;
-	CalcAxisAlignedBox(grp.verts, bounds);
+	CalcMinimalSphere(grp.verts, bounds);
 	shape->SetBounds(bounds);
 
 	shape->SetFlags(14);
@@ -933,9 +1266,38 @@ NiAVObjectRef Exporter::makeBSTriShape(NiNodeRef &parent, INode* node, Mtl *mtl,
 	return shape;
 }
 
+void Exporter::prepareFaceGroup(FaceGroup &grp, bool exportStrips)
+{
+	// triangle lists are drawn in face order so make that order cache friendly
+	if (mOptimizeVertexCache && (IsFallout4() || !exportStrips))
+		optimizeVertexCache(grp);
+
+	if (IsFallout4()) {
+		static TexCoords empty_uvs;
+		const TexCoords& uvs = grp.uvs.empty() ? empty_uvs : grp.uvs[0];
+		grp.hasTangents = CalcTangentSpace(grp.faces, grp.verts, grp.vnorms, uvs, grp.tangents, grp.binormals, mTangentAndBinormalMethod);
+	}
+	else {
+		if (exportStrips && !mUseAlternateStripper && !grp.faces.empty()) {
+			strippify(grp.shapeStrips, grp.verts, grp.vnorms, grp.faces);
+			// the vertex order is final once makeMesh writes the shape
+			if (mRemapIndices)
+				remapStripVertices(grp);
+		}
+		// niflib has no MikkTSpace method so makeMesh writes these itself
+		if (mTangentAndBinormalExtraData && mTangentAndBinormalMethod == 2) {
+			static TexCoords empty_uvs;
+			const TexCoords& uvs = grp.uvs.empty() ? empty_uvs : grp.uvs[0];
+			grp.hasTangents = CalcTangentSpace(grp.faces, grp.verts, grp.vnorms, uvs, grp.tangents, grp.binormals, mTangentAndBinormalMethod);
+		}
+	}
+	grp.prepared = true;
+}
+
 int Exporter::addVertex(FaceGroup &grp, int face, int vi, Mesh *mesh, const Matrix3 &texm, vector<Color4>& vertColors)
 {
-	VertexGroup vg;
+	ProfileScope profile(ExportProfiler::AddVertex, false);
+	VertexGroup& vg = grp.vscratch;
 	int vidx;
 	vidx = vg.idx = mesh->faces[face].v[vi];
 	vg.pt = mesh->verts[vidx];
@@ -949,14 +1311,12 @@ int Exporter::addVertex(FaceGroup &grp, int face, int vi, Mesh *mesh, const Matr
 		vg.norm = getVertexNormal(mesh, face, mesh->getRVertPtr(vidx));
 #endif
 
-	int nmaps = grp.uvMapping.size();
-	map<int, int>::iterator UVSetIter;
-	vg.uvs.resize(nmaps > 0 ? nmaps : 1);
+	int nmaps = grp.uvChannels.size();
+	vg.uvs.assign(nmaps > 0 ? nmaps : 1, TexCoord());
 	if (nmaps > 0) {
-		for (UVSetIter = grp.uvMapping.begin(); UVSetIter != grp.uvMapping.end(); UVSetIter++)
+		for (int nifUVIdx = 0; nifUVIdx < nmaps; nifUVIdx++)
 		{
-			int maxUVIdx = (*UVSetIter).first;
-			int nifUVIdx = (*UVSetIter).second;
+			int maxUVIdx = grp.uvChannels[nifUVIdx];
 			TexCoord& uvs = vg.uvs[nifUVIdx];
 			UVVert *uv = mesh->mapVerts(maxUVIdx);
 			TVFace *tv = mesh->mapFaces(maxUVIdx);
@@ -985,21 +1345,13 @@ int Exporter::addVertex(FaceGroup &grp, int face, int vi, Mesh *mesh, const Matr
 
 	VertexCompare vc(grp, Exporter::mWeldThresh, Exporter::mNormThresh, Exporter::mUVWThresh);
 	int n = grp.verts.size();
-#if 0
-	IntRange range = std::equal_range(grp.vmap.begin(), grp.vmap.end(), vg, vc);
-	if (range.first != range.second) {
-		return (*range.first);
-	}
-	grp.vmap.insert(range.first, n);
-#else
-	for (int i = 0; i < grp.vgrp.size(); i++) {
-		if (vc.compare(vg, i) == 0)
-			return i;
-	}
-	grp.vmap.push_back(n);
-#endif
+	if (grp.weld.cellSize <= 0.0f)
+		grp.weld.init(Exporter::mWeldThresh);
+	int match = FindWeldedVertex(grp.weld, vc, vg);
+	if (match >= 0)
+		return match;
+	grp.weld.insert(vg.pt, n);
 	grp.vidx.push_back(vidx);
-	grp.vgrp.push_back(vg);
 	grp.verts.push_back(TOVECTOR3(vg.pt));
 	grp.vnorms.push_back(TOVECTOR3(vg.norm));
 	for (int i = 0; i < grp.uvs.size(); ++i) {
@@ -1010,8 +1362,41 @@ int Exporter::addVertex(FaceGroup &grp, int face, int vi, Mesh *mesh, const Matr
 	return n;
 }
 
+// Splits faces at the median centroid along the longest axis of their centroid
+//   bounds.  Both halves keep mesh order.
+static void SplitFacesSpatially(Mesh& mesh, const vector<int>& faces, vector<int>& lo, vector<int>& hi)
+{
+	vector<Point3> centroids(faces.size());
+	Box3 box;
+	box.Init();
+	for (size_t i = 0; i < faces.size(); ++i) {
+		const Face& f = mesh.faces[faces[i]];
+		centroids[i] = (mesh.verts[f.v[0]] + mesh.verts[f.v[1]] + mesh.verts[f.v[2]]) / 3.0f;
+		box += centroids[i];
+	}
+	Point3 extent = box.Width();
+	int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	vector<int> order(faces.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = int(i);
+	vector<int>::iterator mid = order.begin() + order.size() / 2;
+	std::nth_element(order.begin(), mid, order.end(), [&](int a, int b) {
+		return (centroids[a][axis] < centroids[b][axis]) || (centroids[a][axis] == centroids[b][axis] && a < b);
+	});
+	std::sort(order.begin(), mid);
+	std::sort(mid, order.end());
+
+	lo.clear(); hi.clear();
+	for (vector<int>::iterator itr = order.begin(); itr != mid; ++itr)
+		lo.push_back(faces[*itr]);
+	for (vector<int>::iterator itr = mid; itr != order.end(); ++itr)
+		hi.push_back(faces[*itr]);
+}
+
 bool Exporter::splitMesh(INode *node, Mesh& mesh, FaceGroups &grps, TimeValue t, vector<Color4>& vertColors, bool noSplit)
 {
+	ProfileScope profile(ExportProfiler::SplitMesh);
 	Mtl* nodeMtl = node->GetMtl();
 	Matrix3 tm = node->GetObjTMAfterWSM(t);
 
@@ -1029,7 +1414,6 @@ bool Exporter::splitMesh(INode *node, Mesh& mesh, FaceGroups &grps, TimeValue t,
 	flip.IdentityMatrix();
 	flip.Scale(Point3(1, -1, 1));
 
-	int nv = mesh.getNumVerts();
 	int nf = mesh.getNumFaces();
 
 	if (noSplit)
@@ -1096,56 +1480,105 @@ bool Exporter::splitMesh(INode *node, Mesh& mesh, FaceGroups &grps, TimeValue t,
 	}
 	else
 	{
+		// faces of each sub material, in mesh order
 		int face, numSubMtls = nodeMtl ? nodeMtl->NumSubMtls() : 0;
-		for (face = 0; face < mesh.getNumFaces(); face++)
+		map<int, vector<int> > mtlFaces;
+		for (face = 0; face < nf; face++)
 		{
 			int mtlID = (numSubMtls != 0) ? (mesh.faces[face].getMatID() % numSubMtls) : 0;
-			Mtl *mtl = getMaterial(node, mtlID);
-			Matrix3 texm;
-			getTextureMatrix(texm, mtl);
-			texm *= flip;
-
-			FaceGroup& grp = grps[mtlID];
+			mtlFaces[mtlID].push_back(face);
+		}
 
-			if (grp.uvMapping.size() == 0) // Only needs to be done once per face group
+		int key = 0;
+		for (map<int, vector<int> >::iterator itr = mtlFaces.begin(); itr != mtlFaces.end(); ++itr)
+		{
+			int mtlID = (*itr).first;
+			vector< vector<int> > pending(1);
+			pending.back().swap((*itr).second);
+			while (!pending.empty())
 			{
-				int nmaps = 0;
-				int nmapsStart = max(1, mesh.getNumMaps() - (mesh.mapSupport(0) ? 1 : 0)); // Omit vertex color map.
-				for (int ii = 1; ii <= nmapsStart; ii++) // Winnow out the unsupported maps.
-				{
-					if (!mesh.mapSupport(ii)) continue;
-					grp.uvMapping[ii] = nmaps++;
+				vector<int> part;
+				part.swap(pending.back());
+				pending.pop_back();
+
+				FaceGroup& grp = grps[key];
+				if (addFaces(grp, node, mesh, mtlID, part, vi, vertColors) || part.size() < 2) {
+					++key;
+					continue;
 				}
-				grp.uvs.resize(nmaps == 0 ? 1 : nmaps);
-			}
-			if (nv > int(grp.verts.capacity()))
-			{
-				grp.vgrp.reserve(nv);
-				grp.verts.reserve(nv);
-				grp.vnorms.reserve(nv);
-				for (int i = 0; i < grp.uvs.size(); ++i)
-					grp.uvs[i].reserve(nv);
-				grp.vcolors.reserve(nv);
-				grp.vidx.reserve(nv);
-			}
-			if (nf > int(grp.faces.capacity()))
-			{
-				grp.faces.reserve(nf);
-				grp.fidx.reserve(nf);
+				// too many vertices for 16 bit indices so split the faces in two
+				//   spatially and try again with each half
+				grps.erase(key);
+				vector<int> lo, hi;
+				SplitFacesSpatially(mesh, part, lo, hi);
+				if (mDebugEnabled)
+					OutputDebugStringA(FormatString("splitMesh: splitting %d faces of material %d into %d and %d\n",
+						int(part.size()), mtlID, int(lo.size()), int(hi.size())).c_str());
+				pending.push_back(vector<int>());
+				pending.back().swap(hi);
+				pending.push_back(vector<int>());
+				pending.back().swap(lo);
 			}
+		}
+	}
+
+	return true;
+}
 
-			Triangle tri;
-			for (int i = 0; i < 3; i++)
-				tri[i] = addVertex(grp, face, vi[i], &mesh, texm, vertColors);
-			grp.faces.push_back(tri);
+bool Exporter::addFaces(FaceGroup &grp, INode *node, Mesh &mesh, int mtlID, const vector<int> &faces, const int vi[3], vector<Color4>& vertColors)
+{
+	int nv = mesh.getNumVerts();
+	int nf = mesh.getNumFaces();
 
-			if (grp.fidx.size() < nf)
-				grp.fidx.resize(nf, -1);
-			grp.fidx[face] = grp.faces.size() - 1;
+	Matrix3 flip;
+	flip.IdentityMatrix();
+	flip.Scale(Point3(1, -1, 1));
+
+	Mtl *mtl = getMaterial(node, mtlID);
+	Matrix3 texm;
+	getTextureMatrix(texm, mtl);
+	texm *= flip;
+
+	grp.mtlID = mtlID;
+	if (grp.uvChannels.empty()) // Only needs to be done once per face group
+	{
+		int nmapsStart = max(1, mesh.getNumMaps() - (mesh.mapSupport(0) ? 1 : 0)); // Omit vertex color map.
+		for (int ii = 1; ii <= nmapsStart; ii++) // Winnow out the unsupported maps.
+		{
+			if (!mesh.mapSupport(ii)) continue;
+			grp.uvChannels.push_back(ii);
 		}
+		int nmaps = grp.uvChannels.size();
+		grp.uvs.resize(nmaps == 0 ? 1 : nmaps);
+	}
+	int nreserve = min(nv, int(faces.size()) * 3);
+	grp.verts.reserve(nreserve);
+	grp.vnorms.reserve(nreserve);
+	for (int i = 0; i < grp.uvs.size(); ++i)
+		grp.uvs[i].reserve(nreserve);
+	grp.vcolors.reserve(nreserve);
+	grp.vidx.reserve(nreserve);
+	grp.faces.reserve(faces.size());
+	grp.fidx.resize(nf, -1);
+
+	bool fits = true;
+	for (vector<int>::const_iterator itr = faces.begin(); itr != faces.end(); ++itr)
+	{
+		int face = (*itr);
+		Triangle tri;
+		for (int i = 0; i < 3; i++)
+			tri[i] = addVertex(grp, face, vi[i], &mesh, texm, vertColors);
+		if (grp.verts.size() > 0xFFFF) { // 0xFFFF is reserved as the strip restart index
+			fits = false;
+			break;
+		}
+		grp.faces.push_back(tri);
+		grp.fidx[face] = grp.faces.size() - 1;
 	}
 
-	return true;
+	// weld index is only needed while the group is being built
+	grp.weld.clear();
+	return fits;
 }
 
 // Callback interface to register a Skin after entire structure is built due to contraints
@@ -1168,16 +1601,31 @@ struct SkinInstance : public Exporter::NiCallback
 	vector<BodyPartList> partitions;
 	vector<int> facePartList;
 
+	// copied by makeSkin so prepare can build the partitions without Max or niflib
+	Exporter::Triangles shapeFaces;      // triangles as the shape data returns them
+	int numVertices;
+
+	// hardware partitions built by prepare; empty to let niflib generate them
+	SkinPartitionList skinPartitions;
+
 	Matrix3 bone_init_tm;
 	Matrix3 node_init_tm;
 
-	SkinInstance(Exporter *Owner) : owner(Owner), SkinInstConstructor(NULL) {}
+	SkinInstance(Exporter *Owner) : owner(Owner), SkinInstConstructor(NULL), numVertices(0) {}
 	virtual ~SkinInstance() {}
+	virtual void prepare();
 	virtual Exporter::Result execute();
+
+	static bool UsePartitioner() {
+		return Exporter::mNifVersionInt > VER_4_0_0_2 && Exporter::mOptimizeSkinPartitions;
+	}
+	void partitionSkin();
+	void setSkinPartition();
 };
 
 bool Exporter::makeSkin(NiAVObjectRef shape, INode *node, FaceGroup &grp, TimeValue t)
 {
+	ProfileScope profile(ExportProfiler::Skin);
 	if (!mExportSkin)
 		return false;
 
@@ -1197,9 +1645,6 @@ bool Exporter::makeSkin(NiAVObjectRef shape, INode *node, FaceGroup &grp, TimeVa
 	if (!skinData)
 		return false;
 
-	if (grp.strips.empty())
-		strippify(grp);
-
 	// Create new call back to finish export
 	SkinInstance* si = new SkinInstance(this);
 	mPostExportCallbacks.push_back(si);
@@ -1217,23 +1662,9 @@ bool Exporter::makeSkin(NiAVObjectRef shape, INode *node, FaceGroup &grp, TimeVa
 		si->boneList[i] = getNode(skin->GetBone(i));
 	}
 
-	vector<int>& vidx = grp.vidx;
-	int nv = vidx.size();
-	for (int i = 0; i < nv; ++i)
-	{
-		int vi = vidx[i];
-		int nbones = skinData->GetNumAssignedBones(vi);
-		for (int j = 0; j < nbones; ++j)
-		{
-			SkinWeight sw;
-			sw.index = i;
-			sw.weight = skinData->GetBoneWeight(vi, j);
-			int boneIndex = skinData->GetAssignedBone(vi, j);
-
-			SkinInstance::SkinWeightList& weights = si->boneWeights[boneIndex];
-			weights.push_back(sw);
-		}
-	}
+	SkinWeightTable weights;
+	weights.Build(skinData, totalBones, grp.vidx, grp.verts, false);
+	weights.GetBoneWeights(si->boneWeights);
 
 	// remove unused bones
 	vector<NiNodeRef>::iterator bitr = si->boneList.begin();
@@ -1265,42 +1696,158 @@ bool Exporter::makeSkin(NiAVObjectRef shape, INode *node, FaceGroup &grp, TimeVa
 					Tab<BSDSPartitionData> &flags = bsdsmd->GetPartitionFlags();
 					GenericNamedSelSetList &fselSet = bsdsmd->GetFaceSelList();
 
-					FaceMap fmap;
-					NiTriBasedGeomDataRef data = DynamicCast<NiTriBasedGeomData>(triShape->GetData());
-					vector<Triangle> tris = data->GetTriangles();
-					for (int i = 0; i < tris.size(); ++i) {
-						Triangle tri = tris[i];
-						fmap[rotate(tri)] = i;
-					}
-					// Build up list of partitions and face to partition map
+					// Build up list of partitions and the partition of each face group
+					//   triangle straight from the Max face indices
+					vector<int> groupPartList(grp.faces.size(), -1);
 					si->partitions.resize(flags.Count());
-					si->facePartList.resize(grp.faces.size(), -1);
 					for (int i = 0; i < flags.Count(); ++i) {
 						BodyPartList& bp = si->partitions[i];
 						bp.bodyPart = (BSDismemberBodyPartType)flags[i].bodyPart;
 						bp.partFlag = (BSPartFlag)(flags[i].partFlag | PF_START_NET_BONESET);
 
 						BitArray& fSelect = fselSet[i];
-						for (int j = 0; j < fSelect.GetSize(); ++j) {
-							if (fSelect[j]) {
-								Triangle tri = grp.faces[grp.fidx[j]];
-								FaceMap::iterator fitr = fmap.find(rotate(tri));
-								if (fitr != fmap.end())
-									si->facePartList[(*fitr).second] = i;
-							}
+						int nsel = min(fSelect.GetSize(), (int)grp.fidx.size());
+						for (int j = 0; j < nsel; ++j) {
+							int f = grp.fidx[j];
+							if (fSelect[j] && f >= 0 && f < int(groupPartList.size()))
+								groupPartList[f] = i;
+						}
+					}
+
+					// NiTriShapeData keeps the face group triangles in order; strips
+					//   return them in strip order so they are matched by vertices
+					NiTriBasedGeomDataRef data = DynamicCast<NiTriBasedGeomData>(triShape->GetData());
+					if (DynamicCast<NiTriShapeData>(data) != NULL) {
+						si->facePartList.swap(groupPartList);
+					}
+					else if (data != NULL) {
+						Exporter::Triangles tris = data->GetTriangles();
+						TriangleIndex index(grp.faces);
+						si->facePartList.assign(tris.size(), -1);
+						for (int i = 0; i < int(tris.size()); ++i) {
+							int f = index.find(tris[i]);
+							if (f >= 0)
+								si->facePartList[i] = groupPartList[f];
 						}
+						if (SkinInstance::UsePartitioner())
+							si->shapeFaces.swap(tris);
 					}
 				}
 			}
 		}
 	}
 
+	// the partitioner works on the triangles as the shape data stores them
+	si->numVertices = int(grp.verts.size());
+	if (SkinInstance::UsePartitioner() && si->shapeFaces.empty()) {
+		NiTriBasedGeomRef triShape = DynamicCast<NiTriBasedGeom>(shape);
+		NiTriBasedGeomDataRef data;
+		if (triShape != NULL)
+			data = DynamicCast<NiTriBasedGeomData>(triShape->GetData());
+		if (data != NULL)
+			si->shapeFaces = data->GetTriangles();
+	}
 
 	return true;
 }
 
+void SkinInstance::prepare()
+{
+	if (shapeFaces.empty())
+		return;
+
+	ProfileScope profile(ExportProfiler::Skin, false);
+	if (UsePartitioner())
+		partitionSkin();
+	Exporter::Triangles().swap(shapeFaces);
+}
+
+// Groups the triangles by shared bones and orders each partition for the
+//   vertex cache.  Leaves skinPartitions empty if a triangle alone needs more
+//   bones than a partition may hold so that niflib splits the shape instead.
+void SkinInstance::partitionSkin()
+{
+	// without multiple partitions one partition holds every bone and every
+	//   influence, as GenHardwareSkinInfo(0, 0) makes it
+	int bonesPerPartition = Exporter::mBonesPerPartition, bonesPerVertex = Exporter::mBonesPerVertex;
+	vector<int> singlePart;
+	if (!Exporter::mMultiplePartitions) {
+		vector<int> influences(numVertices, 0);
+		for (BoneWeightList::const_iterator bitr = boneWeights.begin(); bitr != boneWeights.end(); ++bitr) {
+			for (SkinWeightList::const_iterator itr = bitr->begin(); itr != bitr->end(); ++itr) {
+				if (itr->index < influences.size() && itr->weight > 0.0f)
+					++influences[itr->index];
+			}
+		}
+		bonesPerPartition = int(boneWeights.size());
+		bonesPerVertex = influences.empty() ? 1 : max(1, *std::max_element(influences.begin(), influences.end()));
+	}
+	SkinPartitioner partitioner(bonesPerPartition, bonesPerVertex);
+	if (!partitioner.Build(shapeFaces, numVertices, boneWeights, Exporter::mMultiplePartitions ? facePartList : singlePart, skinPartitions)) {
+		skinPartitions.clear();
+		if (Exporter::mDebugEnabled) {
+			OutputDebugStringA(FormatString("Skin partitions: %d tris, %d bones do not fit %d bones per partition, using niflib\n"
+				, int(shapeFaces.size()), int(boneWeights.size()), bonesPerPartition).c_str());
+		}
+		return;
+	}
+	if (Exporter::mTriPartStrips) {
+		vector<Vector3> verts, norms;
+		for (size_t i = 0; i < skinPartitions.size(); ++i)
+			owner->strippify(skinPartitions[i].strips, verts, norms, skinPartitions[i].triangles);
+	}
+	if (Exporter::mDebugEnabled) {
+		string palettes;
+		for (size_t i = 0; i < skinPartitions.size(); ++i)
+			palettes += FormatString(i ? " %d" : "%d", int(skinPartitions[i].bones.size()));
+		OutputDebugStringA(FormatString("Skin partitions: %d tris, %d bones, %d partitions, palettes %s\n"
+			, int(shapeFaces.size()), int(boneWeights.size()), int(skinPartitions.size()), palettes.c_str()).c_str());
+	}
+}
+
+// Stores skinPartitions on the skin instance and skin data as GenHardwareSkinInfo
+//   would.  Partitions without strips are written as triangle lists.
+void SkinInstance::setSkinPartition()
+{
+	NiSkinPartitionRef skinPart = new NiSkinPartition();
+	skinPart->SetNumPartitions(int(skinPartitions.size()));
+	for (int p = 0; p < int(skinPartitions.size()); ++p) {
+		const SkinPartitionBlock &block = skinPartitions[p];
+		int nverts = int(block.vertexMap.size());
+		int wpv = block.weightsPerVertex;
+		skinPart->SetWeightsPerVertex(p, (unsigned short)wpv);
+		skinPart->SetNumVertices(p, (unsigned short)nverts);
+		skinPart->SetVertexMap(p, block.vertexMap);
+		skinPart->SetBoneMap(p, block.bones);
+		skinPart->EnableVertexWeights(p, true);
+		skinPart->EnableVertexBoneIndices(p, true);
+		for (int v = 0; v < nverts; ++v) {
+			skinPart->SetVertexWeights(p, v, vector<float>(block.weights.begin() + v * wpv, block.weights.begin() + (v + 1) * wpv));
+			skinPart->SetVertexBoneIndices(p, v, vector<unsigned short>(block.boneIndices.begin() + v * wpv, block.boneIndices.begin() + (v + 1) * wpv));
+		}
+		if (!block.strips.empty()) {
+			skinPart->SetStripCount(p, int(block.strips.size()));
+			int s = 0;
+			for (Exporter::TriStrips::const_iterator itr = block.strips.begin(); itr != block.strips.end(); ++itr, ++s)
+				skinPart->SetStrip(p, s, *itr);
+		}
+		else {
+			skinPart->SetTriangles(p, block.triangles);
+		}
+	}
+
+	NiSkinInstanceRef skinInst = shape->GetSkinInstance();
+	if (skinInst != NULL) {
+		skinInst->SetSkinPartition(skinPart);
+		NiSkinDataRef skinData = skinInst->GetSkinData();
+		if (skinData != NULL)
+			skinData->SetSkinPartition(skinPart);
+	}
+}
+
 Exporter::Result SkinInstance::execute()
 {
+	ProfileScope profile(ExportProfiler::Skin);
 	shape->BindSkinWith(boneList, SkinInstConstructor);
 	unsigned int bone = 0;
 	for (BoneWeightList::iterator bitr = boneWeights.begin(); bitr != boneWeights.end(); ++bitr, ++bone) {
@@ -1309,13 +1856,31 @@ Exporter::Result SkinInstance::execute()
 	int* faceMap = NULL;
 	if (partitions.size() > 0) {
 		BSDismemberSkinInstanceRef dismem = DynamicCast<BSDismemberSkinInstance>(shape->GetSkinInstance());
-		if (dismem != NULL)
+		if (dismem != NULL && !skinPartitions.empty() && Exporter::mMultiplePartitions) {
+			// one body part entry per skin partition; only the first of each part
+			//   starts a new bone set
+			vector<BodyPartList> bodyParts;
+			int last = -1;
+			for (size_t i = 0; i < skinPartitions.size(); ++i) {
+				int part = skinPartitions[i].bodyPart;
+				BodyPartList bp = partitions[(part >= 0 && part < int(partitions.size())) ? part : 0];
+				if (part == last)
+					bp.partFlag = (BSPartFlag)(bp.partFlag & ~PF_START_NET_BONESET);
+				bodyParts.push_back(bp);
+				last = part;
+			}
+			dismem->SetPartitions(bodyParts);
+		}
+		else if (dismem != NULL)
 			dismem->SetPartitions(partitions);
-		faceMap = &facePartList[0];
+		if (!facePartList.empty())
+			faceMap = &facePartList[0];
 	}
 	if (Exporter::mNifVersionInt > VER_4_0_0_2)
 	{
-		if (Exporter::mMultiplePartitions)
+		if (!skinPartitions.empty())
+			setSkinPartition();
+		else if (Exporter::mMultiplePartitions)
 			shape->GenHardwareSkinInfo(Exporter::mBonesPerPartition, Exporter::mBonesPerVertex, Exporter::mTriPartStrips, faceMap);
 		else
 			shape->GenHardwareSkinInfo(0, 0, Exporter::mTriPartStrips);
@@ -0,0 +1,148 @@
+#include "pch.h"
+#include "MoppCache.h"
+
+// bump when the entry layout or the native encoder output changes
+static const unsigned int MoppCacheMagic = 0x43504F4D; // "MOPC"
+static const unsigned int MoppCacheVersion = 1;
+
+struct MoppCacheHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	float        origin[3];
+	float        scale;
+	unsigned int size;
+};
+
+static unsigned long long HashBytes(unsigned long long h, const void *data, size_t size)
+{
+	const unsigned char *p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 0x100000001B3ULL;
+	return h;
+}
+
+MoppCacheKey::MoppCacheKey() : h1(0xCBF29CE484222325ULL), h2(0x9E3779B97F4A7C15ULL)
+{
+}
+
+// h1 is FNV-1a; h2 mixes whole bytes through a different multiplier and
+//   rotation so the two halves are independent
+void MoppCacheKey::Add(const void *data, size_t size)
+{
+	h1 = HashBytes(h1, data, size);
+	const unsigned char *p = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i) {
+		h2 = (h2 ^ p[i]) * 0xBF58476D1CE4E5B9ULL;
+		h2 = (h2 << 29) | (h2 >> 35);
+	}
+}
+
+void MoppCacheKey::Add(const MoppGeometry &geom)
+{
+	Add(unsigned(geom.numVerts));
+	Add(geom.verts, geom.numVerts * 3 * sizeof(float));
+	Add(unsigned(geom.numTris));
+	Add(geom.tris, geom.numTris * 3 * sizeof(unsigned short));
+	Add(unsigned(geom.numSubshapes));
+	if (geom.subshapeVerts != NULL)
+		Add(geom.subshapeVerts, geom.numSubshapes * sizeof(int));
+	Add(unsigned(geom.keyedByChunk ? 1 : 0));
+}
+
+tstring MoppCacheKey::ToString() const
+{
+	TCHAR buffer[33];
+	_sntprintf(buffer, _countof(buffer), TEXT("%016llx%016llx"), h1, h2);
+	buffer[32] = 0;
+	return tstring(buffer);
+}
+
+// entries fan out over 256 sub directories named by the first two digits.
+//   returns an empty path if the directory name is too long
+static tstring EntryPath(const tstring &dir, const MoppCacheKey &key, bool create)
+{
+	tstring name = key.ToString();
+	TCHAR path[MAX_PATH];
+	if (dir.size() + name.size() + 16 >= MAX_PATH)
+		return tstring();
+	_tcscpy_s(path, dir.c_str());
+	if (create)
+		CreateDirectory(path, NULL);
+	PathAppend(path, name.substr(0, 2).c_str());
+	if (create)
+		CreateDirectory(path, NULL);
+	PathAppend(path, (name + TEXT(".mopp")).c_str());
+	return tstring(path);
+}
+
+bool MoppCache::Load(const tstring &dir, const MoppCacheKey &key, MoppCode &result)
+{
+	if (dir.empty())
+		return false;
+
+	tstring path = EntryPath(dir, key, false);
+	if (path.empty())
+		return false;
+	FILE *fp = _tfopen(path.c_str(), TEXT("rb"));
+	if (fp == nullptr)
+		return false;
+
+	bool ok = false;
+	MoppCacheHeader header;
+	unsigned long long checksum = 0;
+	if (fread(&header, sizeof(header), 1, fp) == 1
+		&& header.magic == MoppCacheMagic && header.version == MoppCacheVersion && header.size > 0)
+	{
+		result.code.resize(header.size);
+		if (fread(&result.code[0], 1, header.size, fp) == header.size
+			&& fread(&checksum, sizeof(checksum), 1, fp) == 1
+			&& checksum == HashBytes(0xCBF29CE484222325ULL, &result.code[0], header.size))
+		{
+			for (int i = 0; i < 3; ++i)
+				result.origin[i] = header.origin[i];
+			result.scale = header.scale;
+			ok = true;
+		}
+	}
+	fclose(fp);
+	if (!ok)
+		result.code.clear();
+	return ok;
+}
+
+bool MoppCache::Store(const tstring &dir, const MoppCacheKey &key, const MoppCode &result)
+{
+	if (dir.empty() || result.code.empty())
+		return false;
+
+	tstring path = EntryPath(dir, key, true);
+	if (path.empty())
+		return false;
+	tstring temp = FormatText(TEXT("%s.%lu.%lu.tmp"), path.c_str(), GetCurrentProcessId(), GetCurrentThreadId()).data();
+	FILE *fp = _tfopen(temp.c_str(), TEXT("wb"));
+	if (fp == nullptr)
+		return false;
+
+	MoppCacheHeader header;
+	header.magic = MoppCacheMagic;
+	header.version = MoppCacheVersion;
+	for (int i = 0; i < 3; ++i)
+		header.origin[i] = result.origin[i];
+	header.scale = result.scale;
+	header.size = unsigned(result.code.size());
+	unsigned long long checksum = HashBytes(0xCBF29CE484222325ULL, &result.code[0], result.code.size());
+
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(&result.code[0], 1, result.code.size(), fp) == result.code.size()
+		&& fwrite(&checksum, sizeof(checksum), 1, fp) == 1;
+	ok = (fclose(fp) == 0) && ok;
+
+	// another exporter may have published the same key meanwhile; the content
+	//   is identical so replacing it is harmless
+	if (ok)
+		ok = MoveFileEx(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+	if (!ok)
+		DeleteFile(temp.c_str());
+	return ok;
+}
@@ -0,0 +1,35 @@
+#ifndef __MOPPCACHE_H__
+#define __MOPPCACHE_H__
+
+#include "../NifCommon/MoppBuilder.h"
+
+// 128 bit content hash naming a cache entry.  Everything the generated code
+//   depends on must be added before the key is used.
+class MoppCacheKey
+{
+public:
+	MoppCacheKey();
+
+	void Add(const void *data, size_t size);
+	void Add(unsigned int value) { Add(&value, sizeof(value)); }
+	void Add(const MoppGeometry &geom);
+
+	tstring ToString() const;
+
+private:
+	unsigned long long h1, h2;
+};
+
+// On disk store of generated MOPP code shared by all exporter processes.
+//   Entries are written to a private temporary file and renamed into place,
+//   so readers never see a partial entry and concurrent writers of the same
+//   key simply race to publish identical data.
+class MoppCache
+{
+public:
+	// returns false if dir is empty or holds no valid entry for key
+	static bool Load(const tstring &dir, const MoppCacheKey &key, MoppCode &result);
+	static bool Store(const tstring &dir, const MoppCacheKey &key, const MoppCode &result);
+};
+
+#endif
@@ -532,6 +532,7 @@ int NifExport::DoExportInternal(const TCHAR *name, ExpInterface *ei, Interface *
 	TSTR exportInfo = FormatText(TEXT("Niftools 3ds Max Plugins %s"), fileVersion.data());
 	info.exportInfo1 = T2A(exportInfo);
 
+	ExportProfiler::Begin(Exporter::mDebugEnabled);
 	Exporter exp(i, appSettings);
 
 	Ref<NiNode> root = DynamicCast<NiNode>(Niflib::ObjectRegistry::CreateObject(T2AString(Exporter::mRootType)));
@@ -548,35 +549,44 @@ int NifExport::DoExportInternal(const TCHAR *name, ExpInterface *ei, Interface *
 	if (exp.IsFallout4())
 		root->SetName(T2A(filename));
 
-	if (exportType == Exporter::NIF_WO_ANIM || exportType == Exporter::NIF_WITH_MGR)
 	{
-		WriteNifTree(T2AString(path), NiObjectRef(root), info);
-	}
-	else
-	{
-		Niflib::ExportOptions export_type = EXPORT_NIF;
-		switch (exportType) {
-		case Exporter::SINGLE_KF_WITH_NIF: export_type = EXPORT_NIF_KF;       break;
-		case Exporter::SINGLE_KF_WO_NIF:   export_type = EXPORT_KF;           break;
-		case Exporter::MULTI_KF_WITH_NIF:  export_type = EXPORT_NIF_KF_MULTI; break;
-		case Exporter::MULTI_KF_WO_NIF:    export_type = EXPORT_KF_MULTI;     break;
+		ProfileScope profile(ExportProfiler::NifWrite);
+		if (exportType == Exporter::NIF_WO_ANIM || exportType == Exporter::NIF_WITH_MGR)
+		{
+			WriteNifTree(T2AString(path), NiObjectRef(root), info);
 		}
+		else
+		{
+			Niflib::ExportOptions export_type = EXPORT_NIF;
+			switch (exportType) {
+			case Exporter::SINGLE_KF_WITH_NIF: export_type = EXPORT_NIF_KF;       break;
+			case Exporter::SINGLE_KF_WO_NIF:   export_type = EXPORT_KF;           break;
+			case Exporter::MULTI_KF_WITH_NIF:  export_type = EXPORT_NIF_KF_MULTI; break;
+			case Exporter::MULTI_KF_WO_NIF:    export_type = EXPORT_KF_MULTI;     break;
+			}
 
-		Niflib::NifGame game = KF_MW;
-		if (appSettings->Name == TEXT("Dark Age of Camelot")) {
-			game = KF_DAOC;
-		}
-		else if (nifVersion <= VER_4_0_0_2) {
-			game = KF_MW;
-		}
-		else if (nifVersion <= VER_20_0_0_4) {
-			game = KF_FFVT3R;
-		}
-		else {
-			game = KF_CIV4;
+			Niflib::NifGame game = KF_MW;
+			if (appSettings->Name == TEXT("Dark Age of Camelot")) {
+				game = KF_DAOC;
+			}
+			else if (nifVersion <= VER_4_0_0_2) {
+				game = KF_MW;
+			}
+			else if (nifVersion <= VER_20_0_0_4) {
+				game = KF_FFVT3R;
+			}
+			else {
+				game = KF_CIV4;
+			}
+
+			WriteFileGroup(T2AString(path), StaticCast<NiObject>(root), info, export_type, game);
 		}
+	}
 
-		WriteFileGroup(T2AString(path), StaticCast<NiObject>(root), info, export_type, game);
+	if (ExportProfiler::IsEnabled())
+	{
+		tstring profilePath = tstring(path) + TEXT(".profile.json");
+		ExportProfiler::Dump(profilePath.c_str(), T2A(filename));
 	}
 
 	if (Exporter::mStartNifskopeAfterStart)
@@ -8,22 +8,19 @@ namespace NvTriStrip {
 
 ////////////////////////////////////////////////////////////////////////////////////////
 //private data
-static unsigned int cacheSize    = CACHESIZE_GEFORCE1_2;
-static bool bStitchStrips         = true;
-static unsigned int minStripSize = 0;
-static bool bListsOnly            = false;
-static unsigned int restartVal   = 0;
-static bool bRestart              = false;
+//
+// Settings for the legacy context-less interface only
+static StripContext defaultContext;
 
 void EnableRestart(const unsigned int _restartVal)
 {
-	bRestart = true;
-	restartVal = _restartVal;
+	defaultContext.bRestart = true;
+	defaultContext.restartVal = _restartVal;
 }
 
 void DisableRestart()
 {
-	bRestart = false;
+	defaultContext.bRestart = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -35,7 +32,7 @@ void DisableRestart()
 //
 void SetListsOnly(const bool _bListsOnly)
 {
-	bListsOnly = _bListsOnly;
+	defaultContext.bListsOnly = _bListsOnly;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -50,7 +47,7 @@ void SetListsOnly(const bool _bListsOnly)
 //
 void SetCacheSize(const unsigned int _cacheSize)
 {
-	cacheSize = _cacheSize;
+	defaultContext.cacheSize = _cacheSize;
 }
 
 
@@ -66,7 +63,7 @@ void SetCacheSize(const unsigned int _cacheSize)
 //
 void SetStitchStrips(const bool _bStitchStrips)
 {
-	bStitchStrips = _bStitchStrips;
+	defaultContext.bStitchStrips = _bStitchStrips;
 }
 
 
@@ -80,7 +77,7 @@ void SetStitchStrips(const bool _bStitchStrips)
 //
 void SetMinStripSize(const unsigned int _minStripSize)
 {
-	minStripSize = _minStripSize;
+	defaultContext.minStripSize = _minStripSize;
 }
 
 
@@ -213,6 +210,19 @@ bool TestTriangle(const unsigned short v0, const unsigned short v1, const unsign
 bool GenerateStrips(const unsigned short* in_indices, const unsigned int in_numIndices,
 					PrimitiveGroup** primGroups, unsigned short* numGroups, bool validateEnabled)
 {
+	return GenerateStrips(defaultContext, in_indices, in_numIndices, primGroups, numGroups, validateEnabled);
+}
+
+bool GenerateStrips(const StripContext& context, const unsigned short* in_indices, const unsigned int in_numIndices,
+					PrimitiveGroup** primGroups, unsigned short* numGroups, bool validateEnabled)
+{
+	const unsigned int cacheSize = context.cacheSize;
+	const bool bStitchStrips = context.bStitchStrips;
+	const unsigned int minStripSize = context.minStripSize;
+	const bool bListsOnly = context.bListsOnly;
+	const unsigned int restartVal = context.restartVal;
+	const bool bRestart = context.bRestart;
+
 	//put data in format that the stripifier likes
 	WordVec tempIndices;
 	tempIndices.resize(in_numIndices);
@@ -42,6 +42,27 @@ struct PrimitiveGroup
 };
 
 
+////////////////////////////////////////////////////////////////////////////////////////
+// StripContext
+//
+// Holds the stripifier settings for one caller.  The functions taking a context do not
+//  touch any shared state so separate contexts may be used from several threads at once.
+//  The setters below only modify a default context used by the context-less overloads.
+//
+struct StripContext
+{
+	unsigned int cacheSize;
+	bool bStitchStrips;
+	unsigned int minStripSize;
+	bool bListsOnly;
+	unsigned int restartVal;
+	bool bRestart;
+
+	StripContext()
+		: cacheSize(CACHESIZE_GEFORCE1_2), bStitchStrips(true), minStripSize(0)
+		, bListsOnly(false), restartVal(0), bRestart(false) {}
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////
 // EnableRestart()
 //
@@ -122,6 +143,15 @@ void SetListsOnly(const bool bListsOnly);
 bool GenerateStrips(const unsigned short* in_indices, const unsigned int in_numIndices,
 					PrimitiveGroup** primGroups, unsigned short* numGroups, bool validateEnabled = false);
 
+////////////////////////////////////////////////////////////////////////////////////////
+// GenerateStrips()
+//
+// Same as above but uses the settings in context instead of the default context.
+//  Re-entrant.
+//
+bool GenerateStrips(const StripContext& context, const unsigned short* in_indices, const unsigned int in_numIndices,
+					PrimitiveGroup** primGroups, unsigned short* numGroups, bool validateEnabled = false);
+
 
 ////////////////////////////////////////////////////////////////////////////////////////
 // RemapIndices()
@@ -0,0 +1,234 @@
+#include "pch.h"
+#include "SkinPartition.h"
+#include <climits>
+#include <iterator>
+
+namespace {
+
+// sorted shape bone indices
+typedef vector<unsigned short> BoneSet;
+
+// triangles sharing a palette
+struct Cluster
+{
+	BoneSet      bones;
+	vector<int>  tris;
+};
+
+int UnionSize(const BoneSet &a, const BoneSet &b)
+{
+	int n = 0;
+	size_t i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+		if (a[i] < b[j]) ++i;
+		else if (b[j] < a[i]) ++j;
+		else ++i, ++j;
+		++n;
+	}
+	return n + int(a.size() - i) + int(b.size() - j);
+}
+
+void Merge(Cluster &dst, Cluster &src)
+{
+	BoneSet bones;
+	bones.reserve(dst.bones.size() + src.bones.size());
+	std::set_union(dst.bones.begin(), dst.bones.end(), src.bones.begin(), src.bones.end(), std::back_inserter(bones));
+	dst.bones.swap(bones);
+	dst.tris.insert(dst.tris.end(), src.tris.begin(), src.tris.end());
+}
+
+bool LargerCluster(const Cluster &a, const Cluster &b)
+{
+	if (a.bones.size() != b.bones.size())
+		return a.bones.size() > b.bones.size();
+	return a.tris.size() > b.tris.size();
+}
+
+// Best fit of the bone sets, largest first, followed by merging the pairs
+//   of partitions that share the most bones while the union still fits.
+void PackClusters(vector<Cluster> &sets, int limit, vector<Cluster> &parts)
+{
+	std::stable_sort(sets.begin(), sets.end(), LargerCluster);
+	parts.clear();
+	for (size_t i = 0; i < sets.size(); ++i) {
+		int best = -1, bestAdded = INT_MAX, bestSize = INT_MAX;
+		for (size_t p = 0; p < parts.size(); ++p) {
+			int size = UnionSize(parts[p].bones, sets[i].bones);
+			if (size > limit)
+				continue;
+			int added = size - int(parts[p].bones.size());
+			if (added < bestAdded || (added == bestAdded && size < bestSize)) {
+				best = int(p), bestAdded = added, bestSize = size;
+			}
+		}
+		if (best < 0)
+			parts.push_back(Cluster()), best = int(parts.size()) - 1;
+		Merge(parts[best], sets[i]);
+	}
+
+	for (;;) {
+		int bi = -1, bj = -1, bestShared = -1, bestSize = INT_MAX;
+		for (size_t i = 0; i < parts.size(); ++i) {
+			for (size_t j = i + 1; j < parts.size(); ++j) {
+				int size = UnionSize(parts[i].bones, parts[j].bones);
+				if (size > limit)
+					continue;
+				int shared = int(parts[i].bones.size() + parts[j].bones.size()) - size;
+				if (shared > bestShared || (shared == bestShared && size < bestSize)) {
+					bi = int(i), bj = int(j), bestShared = shared, bestSize = size;
+				}
+			}
+		}
+		if (bi < 0)
+			break;
+		Merge(parts[bi], parts[bj]);
+		parts.erase(parts.begin() + bj);
+	}
+}
+
+} // namespace
+
+SkinPartitioner::SkinPartitioner(int bonesPerPartition, int bonesPerVertex)
+	: bonesPerPartition(bonesPerPartition), bonesPerVertex(bonesPerVertex)
+{
+}
+
+bool SkinPartitioner::Build(const Exporter::Triangles &tris, int nverts, const vector<vector<SkinWeight> > &boneWeights
+	, const vector<int> &facePartList, SkinPartitionList &result) const
+{
+	result.clear();
+	const int k = bonesPerVertex;
+	if (k <= 0 || bonesPerPartition < k || nverts <= 0 || boneWeights.empty() || tris.empty())
+		return false;
+
+	// strongest k influences of every vertex, renormalized
+	vector<int> count(nverts, 0);
+	vector<unsigned short> vbones(size_t(nverts) * k, 0);
+	vector<float> vweights(size_t(nverts) * k, 0.0f);
+	for (size_t b = 0; b < boneWeights.size(); ++b) {
+		const vector<SkinWeight> &weights = boneWeights[b];
+		for (size_t i = 0; i < weights.size(); ++i) {
+			int v = weights[i].index;
+			float w = weights[i].weight;
+			if (v >= nverts || !(w > 0.0f))
+				continue;
+			unsigned short *bones = &vbones[size_t(v) * k];
+			float *vw = &vweights[size_t(v) * k];
+			int n = count[v];
+			if (n == k && w <= vw[k - 1])
+				continue;
+			int pos = (n < k) ? n++ : k - 1;
+			for (; pos > 0 && vw[pos - 1] < w; --pos)
+				bones[pos] = bones[pos - 1], vw[pos] = vw[pos - 1];
+			bones[pos] = (unsigned short)b, vw[pos] = w;
+			count[v] = n;
+		}
+	}
+	for (int v = 0; v < nverts; ++v) {
+		float *vw = &vweights[size_t(v) * k];
+		float total = 0.0f;
+		for (int i = 0; i < count[v]; ++i)
+			total += vw[i];
+		if (total > 0.0f)
+			for (int i = 0; i < count[v]; ++i)
+				vw[i] /= total;
+	}
+
+	// group the triangles of each body part by bone set
+	typedef std::map<BoneSet, int> SetIndex;
+	std::map<int, vector<Cluster> > bodyParts;
+	std::map<int, SetIndex> setIndex;
+	BoneSet bones;
+	for (int t = 0; t < int(tris.size()); ++t) {
+		const Triangle &tri = tris[t];
+		bones.clear();
+		for (int j = 0; j < 3; ++j) {
+			int v = tri[j];
+			if (v >= nverts)
+				return false;
+			bones.insert(bones.end(), &vbones[size_t(v) * k], &vbones[size_t(v) * k] + count[v]);
+		}
+		std::sort(bones.begin(), bones.end());
+		bones.erase(std::unique(bones.begin(), bones.end()), bones.end());
+		if (int(bones.size()) > bonesPerPartition)
+			return false;
+
+		// faces missing from every body part go with the first one
+		int part = -1;
+		if (!facePartList.empty())
+			part = (t < int(facePartList.size()) && facePartList[t] >= 0) ? facePartList[t] : 0;
+		vector<Cluster> &sets = bodyParts[part];
+		SetIndex::iterator itr = setIndex[part].insert(SetIndex::value_type(bones, int(sets.size()))).first;
+		if (itr->second == int(sets.size())) {
+			sets.push_back(Cluster());
+			sets.back().bones = bones;
+		}
+		sets[itr->second].tris.push_back(t);
+	}
+	setIndex.clear();
+
+	vector<int> local(nverts, -1);
+	vector<int> newIndex;
+	vector<unsigned short> vertexMap;
+	vector<Cluster> parts;
+	for (std::map<int, vector<Cluster> >::iterator bitr = bodyParts.begin(); bitr != bodyParts.end(); ++bitr) {
+		PackClusters(bitr->second, bonesPerPartition, parts);
+		for (size_t p = 0; p < parts.size(); ++p) {
+			Cluster &part = parts[p];
+			result.push_back(SkinPartitionBlock());
+			SkinPartitionBlock &block = result.back();
+			block.bodyPart = bitr->first;
+			block.weightsPerVertex = k;
+			block.bones = part.bones;
+			if (block.bones.empty())
+				block.bones.push_back(0);
+
+			// local vertices in first use order, then the triangles reordered for the
+			//   post-transform cache and the vertices renumbered to follow them
+			vertexMap.clear();
+			block.triangles.resize(part.tris.size());
+			for (size_t i = 0; i < part.tris.size(); ++i) {
+				const Triangle &tri = tris[part.tris[i]];
+				for (int j = 0; j < 3; ++j) {
+					int v = tri[j];
+					if (local[v] < 0) {
+						local[v] = int(vertexMap.size());
+						vertexMap.push_back((unsigned short)v);
+					}
+					block.triangles[i][j] = (unsigned short)local[v];
+				}
+			}
+			for (size_t i = 0; i < vertexMap.size(); ++i)
+				local[vertexMap[i]] = -1;
+			int nlocal = int(vertexMap.size());
+			Exporter::optimizeTriangleOrder(block.triangles, nlocal);
+
+			newIndex.assign(nlocal, -1);
+			block.vertexMap.resize(nlocal);
+			int next = 0;
+			for (size_t i = 0; i < block.triangles.size(); ++i) {
+				Triangle &tri = block.triangles[i];
+				for (int j = 0; j < 3; ++j) {
+					int v = tri[j];
+					if (newIndex[v] < 0) {
+						newIndex[v] = next++;
+						block.vertexMap[newIndex[v]] = vertexMap[v];
+					}
+					tri[j] = (unsigned short)newIndex[v];
+				}
+			}
+
+			block.weights.assign(size_t(nlocal) * k, 0.0f);
+			block.boneIndices.assign(size_t(nlocal) * k, 0);
+			for (int i = 0; i < nlocal; ++i) {
+				int v = block.vertexMap[i];
+				for (int j = 0; j < count[v]; ++j) {
+					unsigned short bone = vbones[size_t(v) * k + j];
+					block.boneIndices[size_t(i) * k + j] = (unsigned short)(std::lower_bound(block.bones.begin(), block.bones.end(), bone) - block.bones.begin());
+					block.weights[size_t(i) * k + j] = vweights[size_t(v) * k + j];
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#ifndef __SKINPARTITION_H__
+#define __SKINPARTITION_H__
+
+// One hardware skin partition in the layout NiSkinPartition stores it.  Vertex
+//   and triangle indices are local to the partition, bone indices are local to
+//   the palette and the palette holds indices into the shape bone list.
+struct SkinPartitionBlock
+{
+	SkinPartitionBlock() : bodyPart(-1), weightsPerVertex(0) {}
+
+	int                     bodyPart;         // dismember body part or -1
+	int                     weightsPerVertex;
+	vector<unsigned short>  bones;
+	vector<unsigned short>  vertexMap;        // partition vertex -> shape vertex
+	vector<float>           weights;          // weightsPerVertex per vertex
+	vector<unsigned short>  boneIndices;      // weightsPerVertex per vertex
+	Exporter::Triangles     triangles;
+	Exporter::TriStrips     strips;
+};
+typedef vector<SkinPartitionBlock> SkinPartitionList;
+
+// Splits a skinned shape into partitions of at most bonesPerPartition bones.
+//   Triangles with the same bone set are kept together, each bone set is put
+//   into the partition its bones grow the least and partitions are merged
+//   afterwards while their palettes fit.  Faces never leave their dismember
+//   body part.  Only plain data is touched so shapes may be partitioned
+//   concurrently.
+class SkinPartitioner
+{
+public:
+	SkinPartitioner(int bonesPerPartition, int bonesPerVertex);
+
+	// tris and boneWeights are in shape vertex indices.  facePartList gives the
+	//   body part of each triangle and may be empty.  Returns false if a single
+	//   triangle needs more bones than a partition may hold.
+	bool Build(const Exporter::Triangles &tris, int nverts, const vector<vector<SkinWeight> > &boneWeights
+		, const vector<int> &facePartList, SkinPartitionList &result) const;
+
+private:
+	int bonesPerPartition;
+	int bonesPerVertex;
+};
+
+#endif
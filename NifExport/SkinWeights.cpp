@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "iskin.h"
+#include "SkinWeights.h"
+#include "ParallelFor.h"
+
+SkinWeightTable::SkinWeightTable()
+{
+	rowStart.push_back(0);
+}
+
+void SkinWeightTable::Build(ISkinContextData *skinData, int numBones, const vector<int> &vidx, const vector<Vector3> &verts, bool bindUnweighted)
+{
+	int nv = int(vidx.size());
+	rowStart.assign(1, 0);
+	rowStart.reserve(nv + 1);
+	influences.clear();
+	influences.reserve(size_t(nv) * MaxSelected);
+	SkinInfluence none = { 0, 0.0f };
+	selected.assign(size_t(nv) * MaxSelected, none);
+	selectedCount.assign(nv, 0);
+	boneInfluences.assign(numBones, 0);
+	boneSelected.assign(numBones, 0);
+
+	BoundingVolume empty;
+	for (int k = 0; k < 3; ++k) {
+		empty.lows[k] = FLT_MAX;
+		empty.highs[k] = -FLT_MAX;
+		empty.center[k] = 0.0f;
+	}
+	empty.radius = 0.0f;
+	bounds.assign(numBones, empty);
+
+	for (int v = 0; v < nv; ++v) {
+		SkinInfluence *sel = &selected[size_t(v) * MaxSelected];
+		int ns = 0;
+		int nbones = skinData->GetNumAssignedBones(vidx[v]);
+		for (int j = 0; j < nbones; ++j) {
+			SkinInfluence inf;
+			inf.bone = skinData->GetAssignedBone(vidx[v], j);
+			inf.weight = skinData->GetBoneWeight(vidx[v], j);
+			if (inf.bone < 0 || inf.bone >= numBones)
+				continue;
+			influences.push_back(inf);
+			++boneInfluences[inf.bone];
+
+			// insertion into the fixed slots keeps them sorted by weight
+			if (ns == MaxSelected && !(inf.weight > sel[MaxSelected - 1].weight))
+				continue;
+			int pos = (ns < MaxSelected) ? ns++ : MaxSelected - 1;
+			for (; pos > 0 && sel[pos - 1].weight < inf.weight; --pos)
+				sel[pos] = sel[pos - 1];
+			sel[pos] = inf;
+		}
+		rowStart.push_back(int(influences.size()));
+
+		if (ns == 0 && bindUnweighted) {
+			sel[0].bone = 0;
+			sel[0].weight = 1.0f;
+			ns = 1;
+		}
+		float total = 0.0f;
+		for (int j = 0; j < ns; ++j)
+			total += sel[j].weight;
+		if (total > 0.0f) {
+			for (int j = 0; j < ns; ++j)
+				sel[j].weight /= total;
+		}
+		selectedCount[v] = (unsigned char)ns;
+
+		const float *pt = &verts[v].x;
+		for (int j = 0; j < ns; ++j) {
+			int bone = sel[j].bone;
+			if (bone >= numBones)
+				continue;
+			++boneSelected[bone];
+			BoundingVolume &bv = bounds[bone];
+			for (int k = 0; k < 3; ++k) {
+				if (pt[k] < bv.lows[k]) bv.lows[k] = pt[k];
+				if (pt[k] > bv.highs[k]) bv.highs[k] = pt[k];
+			}
+		}
+	}
+
+	// box centers until CalcBoneSpheres replaces them
+	for (int b = 0; b < numBones; ++b) {
+		BoundingVolume &bv = bounds[b];
+		for (int k = 0; k < 3; ++k) {
+			if (boneSelected[b] == 0)
+				bv.lows[k] = bv.highs[k] = 0.0f;
+			bv.center[k] = (bv.lows[k] + bv.highs[k]) / 2.0f;
+		}
+	}
+}
+
+void SkinWeightTable::GetBoneWeights(vector<vector<SkinWeight> > &boneWeights) const
+{
+	int numBones = NumBones();
+	boneWeights.resize(numBones);
+	for (int b = 0; b < numBones; ++b) {
+		boneWeights[b].clear();
+		boneWeights[b].reserve(boneInfluences[b]);
+	}
+	SkinWeight sw;
+	for (int v = 0, nv = NumVertices(); v < nv; ++v) {
+		for (const SkinInfluence *inf = RowBegin(v), *end = RowEnd(v); inf != end; ++inf) {
+			sw.index = v;
+			sw.weight = inf->weight;
+			boneWeights[inf->bone].push_back(sw);
+		}
+	}
+}
+
+void SkinWeightTable::CalcBoneSpheres(const vector<Vector3> &verts)
+{
+	// the selected vertices of all bones in one array, bone after bone
+	int numBones = NumBones();
+	vector<int> start(numBones + 1, 0);
+	for (int b = 0; b < numBones; ++b)
+		start[b + 1] = start[b] + boneSelected[b];
+	if (start[numBones] == 0)
+		return;
+	vector<Vector3> pts(start[numBones]);
+	vector<int> fill(start.begin(), start.end() - 1);
+	for (int v = 0, nv = NumVertices(); v < nv; ++v) {
+		const SkinInfluence *sel = Selected(v);
+		for (int j = 0; j < selectedCount[v]; ++j) {
+			if (sel[j].bone < numBones)
+				pts[fill[sel[j].bone]++] = verts[v];
+		}
+	}
+	ParallelFor(numBones, [&](size_t b) {
+		if (boneSelected[b] > 0)
+			BoundsDetail::CalcSphere(reinterpret_cast<const float*>(&pts[start[b]]), boneSelected[b], bounds[b]);
+	});
+}
@@ -0,0 +1,63 @@
+#ifndef __SKINWEIGHTS_H__
+#define __SKINWEIGHTS_H__
+
+#include "BoundingVolume.h"
+
+class ISkinContextData;
+
+struct SkinInfluence
+{
+	int    bone;
+	float  weight;
+};
+
+// Bone influences of a face group read from the skin modifier in a single
+//   pass.  All influences are stored as compressed rows, one row per vertex.
+//   The strongest MaxSelected influences of each vertex are picked in the
+//   same pass into fixed slots, and the box of the vertices selected for
+//   each bone grows as they are read.
+class SkinWeightTable
+{
+public:
+	enum { MaxSelected = 4 };
+
+	SkinWeightTable();
+
+	// vidx maps each face group vertex to its Max vertex and verts holds its
+	//   position.  With bindUnweighted a vertex without influences selects
+	//   bone 0 at full weight, as BSTriShape vertices need one.
+	void Build(ISkinContextData *skinData, int numBones, const vector<int> &vidx, const vector<Vector3> &verts, bool bindUnweighted);
+
+	int NumVertices() const { return int(selectedCount.size()); }
+	int NumBones() const { return int(boneInfluences.size()); }
+
+	// every influence of vertex v in skin modifier order
+	const SkinInfluence* RowBegin(int v) const { return influences.data() + rowStart[v]; }
+	const SkinInfluence* RowEnd(int v) const { return influences.data() + rowStart[v + 1]; }
+
+	// the strongest influences of vertex v, strongest first and summing to one
+	int NumSelected(int v) const { return selectedCount[v]; }
+	const SkinInfluence* Selected(int v) const { return &selected[size_t(v) * MaxSelected]; }
+
+	// fills one list per bone with every influence on it, vertices in order
+	void GetBoneWeights(vector<vector<SkinWeight> > &boneWeights) const;
+
+	// box of the vertices selected for the bone.  The center is the middle of
+	//   the box and the radius zero until CalcBoneSpheres; bones no vertex
+	//   selects keep empty bounds at the origin.
+	const BoundingVolume& BoneBounds(int bone) const { return bounds[bone]; }
+
+	// minimal spheres of the vertices selected for each bone, bones in parallel
+	void CalcBoneSpheres(const vector<Vector3> &verts);
+
+private:
+	vector<int>            rowStart;
+	vector<SkinInfluence>  influences;
+	vector<SkinInfluence>  selected;        // MaxSelected slots per vertex
+	vector<unsigned char>  selectedCount;
+	vector<int>            boneInfluences;  // influences on each bone
+	vector<int>            boneSelected;    // vertices selecting each bone
+	vector<BoundingVolume> bounds;
+};
+
+#endif
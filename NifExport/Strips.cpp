@@ -2,6 +2,18 @@
 
 #include "NvTriStrip/NvTriStrip.h"
 using namespace NvTriStrip;
+
+// Stripper settings used by the exporter.  Passed explicitly so that several
+//   face groups can be stripped at once.
+static StripContext ExportStripContext()
+{
+	StripContext context;
+	// GF 3+
+	context.cacheSize = CACHESIZE_GEFORCE3;
+	// don't generate hundreds of strips
+	context.bStitchStrips = true;
+	return context;
+}
 /*
 using namespace triangle_stripper;
 
@@ -75,6 +87,7 @@ void Exporter::strippify(TriStrips &strips, vector<Vector3> &verts, vector<Vecto
 */
 void Exporter::strippify(TriStrips &strips, vector<Vector3> &verts, vector<Vector3> &norms, const Triangles &faces)
 {
+	ProfileScope profile(ExportProfiler::Strippify, false);
 	strips.clear();
 	unsigned short *data = (unsigned short *)malloc(faces.size() * 3 * 2);
 
@@ -89,11 +102,7 @@ void Exporter::strippify(TriStrips &strips, vector<Vector3> &verts, vector<Vecto
 	PrimitiveGroup * groups = 0;
 	unsigned short numGroups = 0;
 
-	// GF 3+
-	SetCacheSize(CACHESIZE_GEFORCE3);
-	// don't generate hundreds of strips
-	SetStitchStrips(true);
-	GenerateStrips(data, (unsigned int)faces.size() * 3, &groups, &numGroups);
+	GenerateStrips(ExportStripContext(), data, (unsigned int)faces.size() * 3, &groups, &numGroups);
 	free(data);
 
 	if (!groups)
@@ -114,80 +123,284 @@ void Exporter::strippify(TriStrips &strips, vector<Vector3> &verts, vector<Vecto
 	delete[] groups;
 }
 
-void Exporter::strippify(FaceGroup &grp)
+void Exporter::remapStripVertices(FaceGroup &grp)
 {
-   TriStrips &strips = grp.strips;
-   strips.clear();
-	unsigned short *data = (unsigned short *)malloc(grp.faces.size() * 3 * 2);
-
-	int i;
-	for (i=0; i<grp.faces.size(); i++)
+	// renumber vertices in the order the strips first use them, the same
+	//   numbering RemapIndices produces, and permute the group in place
+	int nv = int(grp.verts.size());
+	vector<int> newIndex(nv, -1);
+	int next = 0;
+	for (TriStrips::const_iterator itr = grp.shapeStrips.begin(); itr != grp.shapeStrips.end(); ++itr)
 	{
-		data[i * 3 + 0] = grp.faces[i][0];
-		data[i * 3 + 1] = grp.faces[i][1];
-		data[i * 3 + 2] = grp.faces[i][2];
+		for (TriStrip::const_iterator s = (*itr).begin(); s != (*itr).end(); ++s)
+		{
+			int &ni = newIndex[*s];
+			if (ni < 0)
+				ni = next++;
+		}
 	}
-	
-   PrimitiveGroup * groups = 0;
-	unsigned short numGroups = 0;
-	
-	// GF 3+
-	SetCacheSize(CACHESIZE_GEFORCE3);
-	// don't generate hundreds of strips
-	SetStitchStrips(true);
-	GenerateStrips(data, (unsigned int)grp.faces.size()*3, &groups, &numGroups);
+	// vertices no strip uses keep their relative order at the end
+	for (int v=0; v<nv; v++)
+	{
+		if (newIndex[v] < 0)
+			newIndex[v] = next++;
+	}
+	remapVertices(grp, newIndex);
+}
 
-	free( data );
-	
-	if (!groups)
-		return;
+// Post-transform cache size used both for optimizing and for the reported statistics
+#define VCACHE_SIZE 32
 
-	if (!mRemapIndices)
-	{
-		for (int g=0; g<numGroups; g++)
-		{
-			if (groups[g].type == PT_STRIP)
-			{
-				strips.push_back(TriStrip(groups[g].numIndices));
-				TriStrip &strip = strips.back();
+// Simulates a FIFO post-transform vertex cache.  ACMR is cache misses per triangle,
+//   ATVR is cache misses per referenced vertex (1.0 is optimal).
+static void CalcVertexCacheStats(const Exporter::Triangles &tris, int nverts, float &acmr, float &atvr)
+{
+	acmr = atvr = 0.0f;
+	if (tris.empty() || nverts <= 0)
+		return;
 
-				for (auto s=0U; s<groups[g].numIndices; s++)
-					strip[s] = groups[g].indices[s];
+	vector<int> stamp(nverts, -VCACHE_SIZE - 1);
+	vector<bool> used(nverts, false);
+	int misses = 0, nused = 0;
+	for (size_t i = 0; i < tris.size(); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			int v = tris[i][j];
+			if (!used[v]) { used[v] = true; ++nused; }
+			// vertex is in the cache if it was inserted less than VCACHE_SIZE misses ago
+			if (misses - stamp[v] > VCACHE_SIZE) {
+				stamp[v] = misses++;
 			}
 		}
-	} else
-	{
-		// remap indices
-		PrimitiveGroup *rmGroups;
-		RemapIndices(groups, (unsigned int)numGroups, (unsigned int)grp.verts.size(), &rmGroups);
+	}
+	acmr = float(misses) / float(tris.size());
+	atvr = (nused > 0) ? float(misses) / float(nused) : 0.0f;
+}
+
+// Tom Forsyth's linear-speed vertex cache optimisation scoring
+static float ForsythVertexScore(int cachePos, int valence)
+{
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
 
-		FaceGroup tmp = grp;
+	if (valence <= 0)
+		return -1.0f;
 
-		for (int g=0; g<numGroups; g++)
-		{
-			if (rmGroups[g].type == PT_STRIP)
-			{
-				strips.push_back(TriStrip(rmGroups[g].numIndices));
-				TriStrip &strip = strips.back();
+	float score = 0.0f;
+	if (cachePos < 0) {
+		// not in the cache
+	} else if (cachePos < 3) {
+		// used by the last triangle; fixed score so the next one is not biased by strip direction
+		score = kLastTriScore;
+	} else {
+		const float scaler = 1.0f / float(VCACHE_SIZE - 3);
+		score = powf(1.0f - float(cachePos - 3) * scaler, kCacheDecayPower);
+	}
+	return score + kValenceBoostScale * powf(float(valence), -kValenceBoostPower);
+}
+
+// Returns the new triangle order.  order[k] is the index of the source triangle emitted k-th.
+static void OptimizeTriangleOrder(const Exporter::Triangles &tris, int nverts, vector<int> &order)
+{
+	int ntris = int(tris.size());
+	order.clear();
+	order.reserve(ntris);
+
+	// vertex to triangle adjacency in compressed rows
+	vector<int> adjStart(nverts + 1, 0), valence(nverts, 0);
+	for (int i = 0; i < ntris; ++i)
+		for (int j = 0; j < 3; ++j)
+			++adjStart[tris[i][j] + 1];
+	for (int v = 0; v < nverts; ++v)
+		adjStart[v + 1] += adjStart[v];
+	vector<int> adj(adjStart[nverts]);
+	for (int i = 0; i < ntris; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			int v = tris[i][j];
+			adj[adjStart[v] + valence[v]++] = i;
+		}
+	}
 
-				for (auto s=0U; s<rmGroups[g].numIndices; s++)
-				{
-					strip[s] = rmGroups[g].indices[s];
+	vector<int> cachePos(nverts, -1);
+	vector<float> vscore(nverts);
+	for (int v = 0; v < nverts; ++v)
+		vscore[v] = ForsythVertexScore(-1, valence[v]);
 
-					unsigned short a = strip[s], b = groups[g].indices[s];
+	vector<float> tscore(ntris);
+	vector<bool> added(ntris, false);
+	for (int i = 0; i < ntris; ++i)
+		tscore[i] = vscore[tris[i][0]] + vscore[tris[i][1]] + vscore[tris[i][2]];
 
-					grp.verts[a] = tmp.verts[b];
-					grp.vnorms[a] = tmp.vnorms[b];
-					if (grp.uvs.size() > 0)
-						grp.uvs[a] = tmp.uvs[b];
-					if (grp.vcolors.size() > 0)
-						grp.vcolors[a] = tmp.vcolors[b];
+	vector<int> cache, newCache;
+	cache.reserve(VCACHE_SIZE + 3);
+	newCache.reserve(VCACHE_SIZE + 3);
+
+	int cursor = 0;
+	int best = -1;
+	while (int(order.size()) < ntris)
+	{
+		if (best < 0) {
+			// nothing useful in the cache so continue with the next unused triangle
+			while (added[cursor]) ++cursor;
+			best = cursor;
+		}
+
+		added[best] = true;
+		order.push_back(best);
+
+		// remove the triangle from the adjacency of its vertices
+		newCache.clear();
+		for (int j = 0; j < 3; ++j) {
+			int v = tris[best][j];
+			int *first = &adj[adjStart[v]], *last = first + valence[v];
+			int *itr = std::find(first, last, best);
+			if (itr != last) {
+				*itr = *(last - 1);
+				--valence[v];
+			}
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+		for (size_t i = 0; i < cache.size(); ++i) {
+			int v = cache[i];
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+				newCache.push_back(v);
+		}
+
+		// update vertex scores for everything touched and find the best candidate
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			int v = newCache[i];
+			cachePos[v] = (int(i) < VCACHE_SIZE) ? int(i) : -1;
+			vscore[v] = ForsythVertexScore(cachePos[v], valence[v]);
+		}
+		for (size_t i = 0; i < newCache.size(); ++i) {
+			int v = newCache[i];
+			for (int k = adjStart[v], n = adjStart[v] + valence[v]; k < n; ++k) {
+				int t = adj[k];
+				const Triangle &tri = tris[t];
+				tscore[t] = vscore[tri[0]] + vscore[tri[1]] + vscore[tri[2]];
+				if (tscore[t] > bestScore) {
+					bestScore = tscore[t];
+					best = t;
 				}
 			}
 		}
-		delete [] rmGroups;
+		if (int(newCache.size()) > VCACHE_SIZE)
+			newCache.resize(VCACHE_SIZE);
+		cache.swap(newCache);
+	}
+}
+
+// Moves v[i] to v[newIndex[i]] in place by following the permutation cycles.
+//   Streams that are not per vertex (e.g. empty vertex colors) are left alone.
+template<typename T>
+static void PermuteVertexStream(vector<T> &v, const vector<int> &newIndex, vector<bool> &done)
+{
+	if (v.size() != newIndex.size())
+		return;
+	done.assign(v.size(), false);
+	for (size_t i = 0; i < v.size(); ++i) {
+		if (done[i])
+			continue;
+		T carry = std::move(v[i]);
+		for (size_t j = i; !done[j]; ) {
+			done[j] = true;
+			size_t k = size_t(newIndex[j]);
+			std::swap(carry, v[k]);
+			j = k;
+		}
+	}
+}
+
+// Applies newIndex (old vertex index -> new vertex index) to every per-vertex stream of
+//   the face group and to all triangles and strips that reference them.
+void Exporter::remapVertices(FaceGroup &grp, const vector<int> &newIndex)
+{
+	vector<bool> done;
+	PermuteVertexStream(grp.verts, newIndex, done);
+	PermuteVertexStream(grp.vnorms, newIndex, done);
+	for (size_t i = 0; i < grp.uvs.size(); ++i)
+		PermuteVertexStream(grp.uvs[i], newIndex, done);
+	PermuteVertexStream(grp.vcolors, newIndex, done);
+	PermuteVertexStream(grp.vidx, newIndex, done);
+	PermuteVertexStream(grp.tangents, newIndex, done);
+	PermuteVertexStream(grp.binormals, newIndex, done);
+
+	for (Triangles::iterator itr = grp.faces.begin(); itr != grp.faces.end(); ++itr) {
+		Triangle &tri = (*itr);
+		tri.Set(newIndex[tri[0]], newIndex[tri[1]], newIndex[tri[2]]);
+	}
+	for (TriStrips::iterator itr = grp.shapeStrips.begin(); itr != grp.shapeStrips.end(); ++itr)
+		for (TriStrip::iterator s = (*itr).begin(); s != (*itr).end(); ++s)
+			*s = newIndex[*s];
+}
+
+void Exporter::optimizeTriangleOrder(Triangles &tris, int nverts)
+{
+	if (tris.size() < 2 || nverts <= 0)
+		return;
+	vector<int> order;
+	OptimizeTriangleOrder(tris, nverts, order);
+	Triangles faces(tris.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		faces[i] = tris[order[i]];
+	tris.swap(faces);
+}
+
+void Exporter::optimizeVertexCache(FaceGroup &grp)
+{
+	int nverts = int(grp.verts.size());
+	int ntris = int(grp.faces.size());
+	if (ntris == 0 || nverts == 0)
+		return;
+
+	// the cache statistics are only reported, so only simulated when printed
+	float acmrBefore = 0.0f, atvrBefore = 0.0f;
+	if (mDebugEnabled)
+		CalcVertexCacheStats(grp.faces, nverts, acmrBefore, atvrBefore);
+
+	// reorder triangles for the post-transform cache
+	vector<int> order;
+	OptimizeTriangleOrder(grp.faces, nverts, order);
+	{
+		Triangles faces(ntris);
+		vector<int> position(ntris);
+		for (int i = 0; i < ntris; ++i) {
+			faces[i] = grp.faces[order[i]];
+			position[order[i]] = i;
+		}
+		grp.faces.swap(faces);
+		for (size_t i = 0; i < grp.fidx.size(); ++i) {
+			if (grp.fidx[i] >= 0)
+				grp.fidx[i] = position[grp.fidx[i]];
+		}
+	}
+
+	// then lay out vertices in first use order for the pre-transform fetch
+	vector<int> newIndex(nverts, -1);
+	int next = 0;
+	for (int i = 0; i < ntris; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			int v = grp.faces[i][j];
+			if (newIndex[v] < 0)
+				newIndex[v] = next++;
+		}
+	}
+	for (int v = 0; v < nverts; ++v) {
+		if (newIndex[v] < 0)
+			newIndex[v] = next++;
+	}
+	remapVertices(grp, newIndex);
+
+	if (mDebugEnabled) {
+		float acmrAfter, atvrAfter;
+		CalcVertexCacheStats(grp.faces, nverts, acmrAfter, atvrAfter);
+		OutputDebugStringA(FormatString("Vertex cache: %d tris, %d verts, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n"
+			, ntris, nverts, acmrBefore, acmrAfter, atvrBefore, atvrAfter).c_str());
 	}
-	delete [] groups;
 }
 
 NiTriStripsDataRef Exporter::makeTriStripsData(const TriStrips &strips)
@@ -12,6 +12,7 @@
 #include <string>
 #include <sstream>
 #include <set>
+#include <unordered_map>
 
 #if __cplusplus >= 201703L
 namespace std {
@@ -92,6 +93,7 @@ struct binary_function {
 #include "NifPlugins.h"
 #include "Exporter.h"
 #include "NifExport.h"
+#include "ExportProfiler.h"
 
 #if VERSION_3DSMAX >= (14000<<16) // Version 14 (2012)
 #define SDK_RESERVED_METHOD(a)
@@ -6,6 +6,8 @@
 #include "NifPlugins.h"
 #include "NifGui.h"
 #include "meshadj.h"
+#include "BoundingVolume.h"
+#include "ConvexSolvers.h"
 
 using namespace std;
 
@@ -124,13 +126,13 @@ void CalcAxisAlignedSphere(Mesh& mesh, Point3& center, float& radius)
 		const Point3 & v = mesh.getVert(i);
 
 		if ( v.x > highs.x ) highs.x = v.x;
-		else if ( v.x < lows.x ) lows.x = v.x;
+		if ( v.x < lows.x ) lows.x = v.x;
 
 		if ( v.y > highs.y ) highs.y = v.y;
-		else if ( v.y < lows.y ) lows.y = v.y;
+		if ( v.y < lows.y ) lows.y = v.y;
 
 		if ( v.z > highs.z ) highs.z = v.z;
-		else if ( v.z < lows.z ) lows.z = v.z;
+		if ( v.z < lows.z ) lows.z = v.z;
 	}
 
 	//Now we know the extent of the shape, so the center will be the average
@@ -167,6 +169,15 @@ void CalcCenteredSphere(Mesh& mesh, Point3& center, float& radius)
 	radius = Sqrt(radsq);
 }
 
+// Calculate the smallest sphere containing all points.  Best fit.
+void CalcMinimalSphere(Mesh& mesh, Point3& center, float& radius)
+{
+	BoundingVolume bv;
+	CalcBoundingVolume(mesh.getVertPtr(0), size_t(mesh.getNumVerts()), bv);
+	center = Point3(bv.center[0], bv.center[1], bv.center[2]);
+	radius = bv.radius;
+}
+
 #define MAKE_QUAD(na,nb,nc,nd,sm,b) {MakeQuad(nverts,&(mesh.faces[nf]),na, nb, nc, nd, sm, b);nf+=2;}
 
 void BuildBox(Mesh&mesh, float l, float w, float h)
@@ -778,136 +789,73 @@ void BuildScubaMesh(Mesh &mesh, int segs, int smooth, int llsegs,
 
 
 
-extern HINSTANCE hInstance;
-class MagicCode
-{
-private:
-	struct Triangle { int a, b, c; };
-	typedef int (__stdcall * fnCalcCapsule)
-	    (int nverts, const Point3 *verts, 
-		Point3& pt1, Point3& pt2, float& r1, float& r2);
-
-	typedef int (__stdcall * fnCalcOrientedBox)
-	    (int nverts, const Point3 *verts,
-		float& udim, float& vdim, float& ndim,
-		Point3& center, Point3& Uaxis, Point3& Vaxis, Point3& Naxis);
-
-	typedef void (__stdcall * fnCalcMassProps)
-	(	int nverts, const Point3* verts, 
-		int ntris, const Triangle* tris,
-		int iBodyCoords, float &rfMass,
-		Point3& rkCenter, Matrix3& rkInertia);
-
-	HMODULE hMagicLib;
-	fnCalcCapsule CalcCapsule;
-	fnCalcOrientedBox CalcOrientedBox;
-	fnCalcMassProps CalcMassProps;
-
-public:
-	MagicCode() : hMagicLib(0), CalcCapsule(0), CalcOrientedBox(0), CalcMassProps(0) {
-	}
-
-	~MagicCode() {
-		if (hMagicLib) FreeLibrary(hMagicLib);
-	}
-
-	bool Initialize()
-	{
-		if (hMagicLib == nullptr)
-		{
-			TCHAR curfile[_MAX_PATH];
-			GetModuleFileName(hInstance, curfile, MAX_PATH);
-			PathRemoveFileSpec(curfile);
-			PathAppend(curfile, TEXT("NifMagic.dll"));
-			hMagicLib = LoadLibrary( curfile );
-			if (hMagicLib == nullptr)
-				hMagicLib = LoadLibrary( TEXT("Nifmagic.dll") );
-			CalcCapsule = (fnCalcCapsule)GetProcAddress( hMagicLib, "CalcCapsule" );
-			CalcOrientedBox = (fnCalcOrientedBox)GetProcAddress( hMagicLib, "CalcOrientedBox" );
-			CalcMassProps = (fnCalcMassProps)GetProcAddress( hMagicLib, "CalcMassProps" );
-		}
-		// Now returns TRUE if ANY of the desired methods are present.
-		// Checks for individual methods will need to check both Initialize() and the appropriate Has...() method.
-		return ( nullptr != CalcCapsule || nullptr != CalcOrientedBox || nullptr != CalcMassProps );
-	}
-
-	bool HasCalcCapsule() {return nullptr != CalcCapsule;}
-	bool HasCalcOrientedBox() {return nullptr != CalcOrientedBox;}
-	bool HasCalcMassProps() {return nullptr != CalcMassProps;}
-	void DoCalcCapsule(Mesh &mesh, Point3& pt1, Point3& pt2, float& r1, float& r2)
-	{
-		if (Initialize() && HasCalcCapsule())
-		{
-			CalcCapsule( mesh.getNumVerts(), &mesh.verts[0], pt1, pt2, r1, r2);
-		}
-	}
-
-	void DoCalcOrientedBox(Mesh &mesh, float& udim, float& vdim, float& ndim, Point3& center, Matrix3& rtm)
-	{
-		if (Initialize() && HasCalcOrientedBox())
-		{
-			Point3 Uaxis, Vaxis, Naxis;
-			CalcOrientedBox(mesh.getNumVerts(), &mesh.verts[0], udim, vdim, ndim, center, Uaxis, Vaxis, Naxis);
-			rtm.Set(Uaxis, Vaxis, Naxis, center);
-		}
-	}
-
-	void DoCalcMassProps( Mesh &mesh,
-		bool bBodyCoords, float &rfMass,
-		Point3& rkCenter, Matrix3& rkInertia)
-	{
-		if (Initialize() && HasCalcMassProps())
-		{
-			vector<Triangle> tris;
-			tris.resize(mesh.getNumFaces());
-			for (int i=0; i<mesh.getNumFaces(); ++i)
-			{
-				Triangle& tri = tris[i];
-				Face& face = mesh.faces[i];
-				tri.a = face.getVert(0);
-				tri.b = face.getVert(1);
-				tri.c = face.getVert(2);
-			}
-			CalcMassProps( mesh.getNumVerts(), &mesh.verts[0]
-				, tris.size(), &tris[0]
-				, bBodyCoords ? 1 : 0, rfMass, rkCenter, rkInertia );
-		}
-	}
-
-} TheMagicCode;
-
+// The solvers are built in, so these are kept only for the dialogs that ask.
 extern bool CanCalcCapsule()
 {
-	return TheMagicCode.Initialize() && TheMagicCode.HasCalcCapsule();
+	return true;
 }
 extern bool CanCalcOrientedBox()
 {
-	return TheMagicCode.Initialize() && TheMagicCode.HasCalcOrientedBox();
+	return true;
 }
 extern bool CanCalcMassProps()
 {
-	return TheMagicCode.Initialize() && TheMagicCode.HasCalcMassProps();
+	return true;
 }
 
 // Calculate capsule from mesh.  While radii on the endcaps is possible we do 
 //   currently calculate then differently.
 extern void CalcCapsule(Mesh &mesh, Point3& pt1, Point3& pt2, float& r1, float& r2)
 {
-	TheMagicCode.DoCalcCapsule(mesh, pt1, pt2, r1, r2);
+	CapsuleFit capsule;
+	if (ComputeCapsule((const float*)mesh.getVertPtr(0), size_t(mesh.getNumVerts()), capsule))
+	{
+		pt1 = Point3(capsule.pt1[0], capsule.pt1[1], capsule.pt1[2]);
+		pt2 = Point3(capsule.pt2[0], capsule.pt2[1], capsule.pt2[2]);
+		r1 = r2 = capsule.radius;
+	}
 }
 
 // Calculate OBB (oriented bounding box) from mesh.  Returns each of the 3 dimensions of the box, 
 // its center, and the rotation matrix necessary to get the orientation.
 extern void CalcOrientedBox(Mesh &mesh, float& udim, float& vdim, float& ndim, Point3& center, Matrix3& rtm)
 {
-	TheMagicCode.DoCalcOrientedBox(mesh, udim, vdim, ndim, center, rtm);
+	OrientedBox box;
+	if (ComputeOrientedBox((const float*)mesh.getVertPtr(0), size_t(mesh.getNumVerts()), box))
+	{
+		udim = box.size[0];
+		vdim = box.size[1];
+		ndim = box.size[2];
+		center = Point3(box.center[0], box.center[1], box.center[2]);
+		rtm.Set(Point3(box.axis[0][0], box.axis[0][1], box.axis[0][2]),
+			Point3(box.axis[1][0], box.axis[1][1], box.axis[1][2]),
+			Point3(box.axis[2][0], box.axis[2][1], box.axis[2][2]), center);
+	}
 }
 
 extern void CalcMassProps( Mesh &mesh,
 							bool bBodyCoords, float &rfMass,
 							Point3& rkCenter, Matrix3& rkInertia)
 {
-	TheMagicCode.DoCalcMassProps(mesh, bBodyCoords, rfMass, rkCenter, rkInertia);
+	vector<int> tris(mesh.getNumFaces() * 3);
+	for (int i=0; i<mesh.getNumFaces(); ++i)
+	{
+		Face& face = mesh.faces[i];
+		tris[i*3 + 0] = face.getVert(0);
+		tris[i*3 + 1] = face.getVert(1);
+		tris[i*3 + 2] = face.getVert(2);
+	}
+	MassProperties props;
+	if (!tris.empty() && ComputeMassProperties((const float*)mesh.getVertPtr(0), size_t(mesh.getNumVerts())
+		, &tris[0], tris.size() / 3, bBodyCoords, props))
+	{
+		rfMass = props.mass;
+		rkCenter = Point3(props.center[0], props.center[1], props.center[2]);
+		rkInertia.SetRow(0, Point3(props.inertia[0][0], props.inertia[0][1], props.inertia[0][2]));
+		rkInertia.SetRow(1, Point3(props.inertia[1][0], props.inertia[1][1], props.inertia[1][2]));
+		rkInertia.SetRow(2, Point3(props.inertia[2][0], props.inertia[2][1], props.inertia[2][2]));
+		rkInertia.SetRow(3, Point3::Origin);
+	}
 }
 
 extern void BuildCapsule(Mesh &mesh, Point3 pt1, Point3 pt2, float r1, float r2)
@@ -5,8 +5,10 @@ extern void CalcAxisAlignedBox(Mesh& mesh, Box3& box);
 extern void CalcAxisAlignedBox(Mesh& mesh, Box3& box, Matrix3* tm);
 extern void CalcAxisAlignedSphere(Mesh& mesh, Point3& center, float& radius);
 extern void CalcCenteredSphere(Mesh& mesh, Point3& center, float& radius);
+extern void CalcMinimalSphere(Mesh& mesh, Point3& center, float& radius);
 extern void CalcCapsule(Mesh &mesh, Point3& pt1, Point3& pt2, float& r1, float& r2);
 extern void CalcOrientedBox(Mesh &mesh, float& udim, float& vdim, float& ndim, Point3& center, Matrix3& rtm);
+extern void CalcMassProps(Mesh &mesh, bool bBodyCoords, float &rfMass, Point3& rkCenter, Matrix3& rkInertia);
 extern bool CanCalcCapsule();
 extern bool CanCalcOrientedBox();
 
@@ -725,7 +725,7 @@ void bhkRigidBodyModifier::BuildColSphere(Mesh& mesh)
 {
 	Point3 center = Point3::Origin;
 	float radius = 0.0f;
-	CalcAxisAlignedSphere(mesh, center, radius);
+	CalcMinimalSphere(mesh, center, radius);
 	BuildSphere(mesh, radius);
 
 	MNMesh mn(mesh);
@@ -14,6 +14,7 @@
 #include "ddsres.h"
 
 #include <stdio.h>
+#include <vector>
 
 #include "dxtlib.h"
 
@@ -98,6 +99,7 @@ BOOL CALLBACK AboutCtrlDlgProc(HWND hWnd,UINT message,WPARAM wParam,LPARAM lPara
 BitmapIO_DDS::BitmapIO_DDS()
 {
   mParams.outFormat  = TF_DXT3 | TF_MIPMAPS;
+  mMipLevel = 0;
 }
 
 BitmapIO_DDS::~BitmapIO_DDS () {}
@@ -266,41 +268,18 @@ BMMRES BitmapIO_DDS::GetImageInfo (BitmapInfo *fbi)
 
   //-- Read File Header --------------------------------
 
-  if (!ReadDDSHeader(file.stream))
+  DdsImage image;
+  unsigned width, height;
+  size_t offset, size;
+
+  if (!ReadDDSHeader(file.stream, image) || !image.GetMipLevel(LoadMipLevel(image), width, height, offset, size))
     return (ProcessImageIOError(fbi,BMMRES_BADFILEHEADER));
 
   //-- Update Bitmap Info ------------------------------
 
-  fbi->SetWidth((WORD)hdr.dwWidth);
-  fbi->SetHeight((WORD)hdr.dwHeight);
-
-  switch (hdr.dwFourCC)
-  {
-    case 0:
-      switch (hdr.dwRGBBitCount)
-      {
-        //case  1: fbi->SetType(BMM_LINE_ART); break;
-        //case  4: fbi->SetType(BMM_BMP_4);    break;
-        //case  8: fbi->SetType(BMM_PALETTED); break;
-        case 16: 
-          if (hdr.dwRGBAlphaBitMask)
-            fbi->SetType(BMM_TRUE_32);  
-          else
-            fbi->SetType(BMM_TRUE_24);  
-          break;
-        case 24: fbi->SetType(BMM_TRUE_24);  break;
-        case 32: fbi->SetType(BMM_TRUE_32);   break;
-        default: fbi->SetType(BMM_NO_TYPE);  break;
-      }
-      break;
-    case 'D'|('X'<<8)|('T'<<16)|('1'<<24):
-    case 'D'|('X'<<8)|('T'<<16)|('2'<<24):
-    case 'D'|('X'<<8)|('T'<<16)|('3'<<24):
-    case 'D'|('X'<<8)|('T'<<16)|('4'<<24):
-    case 'D'|('X'<<8)|('T'<<16)|('5'<<24):
-      fbi->SetType(BMM_TRUE_32);   
-      break;
-  }
+  fbi->SetWidth((WORD)width);
+  fbi->SetHeight((WORD)height);
+  fbi->SetType(image.HasAlpha() ? BMM_TRUE_32 : BMM_TRUE_24);
 
 //  fbi->SetGamma(1.0f);
   fbi->SetAspect(1.0f);
@@ -310,9 +289,6 @@ BMMRES BitmapIO_DDS::GetImageInfo (BitmapInfo *fbi)
   return BMMRES_SUCCESS;
 }
 
-inline WORD Conv4To16(int d) { return (d<<12) | (d<<8) | (d<<4) | d; }
-inline WORD Conv5To16(int d) { return (d<<11) | (d<<6) | (d<<1); }
-inline WORD Conv6To16(int d) { return (d<<10) | (d<<4) | (d>>2); }
 inline WORD Conv8To16(int d) { return (d<<8)  | d; }
 
 //-----------------------------------------------------------------------------
@@ -320,18 +296,7 @@ inline WORD Conv8To16(int d) { return (d<<8)  | d; }
 
 BitmapStorage *BitmapIO_DDS::Load(BitmapInfo *fbi, Bitmap *map, BMMRES *status)
 {
-  RGBQUAD      *rgb = NULL;
-  BMM_Color_48 *pal = NULL;
   BitmapStorage  *s = NULL;
-  BMM_Color_64   *b = NULL;
-  BYTE           *p = NULL;
-
-
-  int pixels = 0;
-  int rows   = 0;
-  int w      = 0;
-  int wb     = 0;
-  int h      = 0;
 
   //-- Initialize Status Optimistically
 
@@ -355,26 +320,39 @@ BitmapStorage *BitmapIO_DDS::Load(BitmapInfo *fbi, Bitmap *map, BMMRES *status)
     return(NULL);
   }
 
-  ghFile = file.stream;
-
-  int width;
-  int height;
-  int planes;
-  int lTotalWidth; 
-  int rowBytes;
-      
   //-- Read File Header --------------------------------
 
-  unsigned char* data = nvDXTdecompress(width, height, planes, lTotalWidth, rowBytes);
+  DdsImage image;
+  unsigned level = 0, width = 0, height = 0;
+  size_t offset = 0, size = 0;
 
-  if (!data)
+  if (ReadDDSHeader(file.stream, image))
+    level = LoadMipLevel(image);
+
+  if (!image.GetMipLevel(level, width, height, offset, size))
   {
     *status = ProcessImageIOError(fbi,BMMRES_BADFILEHEADER);
     return (NULL);
   }
 
-  ghFile = NULL;
- 
+  //-- Read and decode the chosen mip level only -------
+
+  std::vector<unsigned char> data(offset + size);
+  std::vector<unsigned char> rgba;
+
+  fseek(file.stream, 0, SEEK_SET);
+  if (fread(&data[0], 1, data.size(), file.stream) != data.size())
+  {
+    *status = ProcessImageIOError(fbi);
+    return (NULL);
+  }
+  file.Close();
+
+  if (!image.Decode(&data[0], data.size(), level, rgba))
+  {
+    *status = ProcessImageIOError(fbi,BMMRES_BADFILEHEADER);
+    return (NULL);
+  }
 
   //-- Update Bitmap Info ------------------------------
 
@@ -383,30 +361,13 @@ BitmapStorage *BitmapIO_DDS::Load(BitmapInfo *fbi, Bitmap *map, BMMRES *status)
 
   //fbi->SetGamma(1.0f);
   fbi->SetAspect(1.0f);
-
-  switch(planes)
-  {
-    case 3:
-      fbi->SetType(BMM_TRUE_24);
-      break;
-
-    case 4:
-      fbi->SetType(BMM_TRUE_32);
-      break;
-  }
-
+  fbi->SetType(image.HasAlpha() ? BMM_TRUE_32 : BMM_TRUE_24);
   fbi->SetFirstFrame(0);
   fbi->SetLastFrame(0);
 
   //-- Create Image Storage ----------------------------
 
-  switch(planes)
-  {
-    case 3:
-    case 4:
-      s = BMMCreateStorage(map->Manager(),BMM_TRUE_32);
-      break;
-  }
+  s = BMMCreateStorage(map->Manager(),BMM_TRUE_32);
 
   if(!s)
   {
@@ -418,120 +379,44 @@ BitmapStorage *BitmapIO_DDS::Load(BitmapInfo *fbi, Bitmap *map, BMMRES *status)
 
   if (s->Allocate(fbi,map->Manager(),BMM_OPEN_R)==0)
   {
-
-    memory_error_out:
     *status = ProcessImageIOError(fbi,BMMRES_MEMORYERROR);
-    goto bail_out;
-
-    io_error_out:
-    *status = ProcessImageIOError(fbi);
-    bail_out:
-
-    if (s) delete s;
-    if (b) free(b);
-    if (p) free(p);
-    if (rgb) free(rgb);
-    if (pal) free(pal);
-
+    delete s;
     return NULL;
-
   }
 
-  switch (planes)
-  {
-    case 3:
-    {
-      //-- Read Image (24 Bits) ----------------------------
-
-      w    = width;
-      wb   = lTotalWidth*planes; //rowBytes;
-      h    = height;
-
-      b = (BMM_Color_64  *)malloc(width*sizeof(BMM_Color_64));
-      p = (BYTE          *)data;
-
-      if(!b || !p)
-        goto memory_error_out;
+  //-- Copy Image (32 Bits) ----------------------------
 
-      BYTE *ptr;
+  std::vector<BMM_Color_64> b(width);
+  const unsigned char *p = &rgba[0];
+  bool foundalpha = false;
 
-      do
-      {
-        ptr = p;
-        p += wb;
-        for (int x = 0; x < w; x++)
-        {
-          b[x].b = Conv8To16(*ptr++);
-          b[x].g = Conv8To16(*ptr++);
-          b[x].r = Conv8To16(*ptr++);
-        }
-        if (s->PutPixels(0,rows,w,b)!=1)
-          goto io_error_out;
-        rows++;
-        if (rows>=h) break;
-
-        //-- Progress Report
-
-        if (fbi->GetUpdateWindow())
-          SendMessage(fbi->GetUpdateWindow(),BMM_PROGRESS,rows,h);
-
-      } while (true);
-      break;
+  for (unsigned y = 0; y < height; y++)
+  {
+    for (unsigned x = 0; x < width; x++, p += 4)
+    {
+      b[x].r = Conv8To16(p[0]);
+      b[x].g = Conv8To16(p[1]);
+      b[x].b = Conv8To16(p[2]);
+      if (p[3] != 0xFF) foundalpha=true;
+      b[x].a = Conv8To16(p[3]);
     }
-    case 4:
+    if (s->PutPixels(0,y,width,&b[0])!=1)
     {
-      //-- Read Image (32 Bits) ----------------------------
-
-      w    = width;
-      wb   = lTotalWidth*planes; //rowBytes;
-      h    = height;
-
-      b = (BMM_Color_64  *)malloc(width*sizeof(BMM_Color_64));
-      p = (BYTE          *)data;
-
-      if(!b || !p)
-        goto memory_error_out;
-
-      BYTE *ptr;
-
-      bool foundalpha = false;
- 
-      do
-      {
-        ptr = p;
-        p += wb;
-        for (int x = 0; x < w; x++)
-        {
-          b[x].b = Conv8To16(*ptr++);
-          b[x].g = Conv8To16(*ptr++);
-          b[x].r = Conv8To16(*ptr++);
-          if (*ptr != 0xFF) foundalpha=true;
-          b[x].a = Conv8To16(*ptr++);
-        }
-        if (s->PutPixels(0,rows,w,b)!=1)
-          goto io_error_out;
-        rows++;
-        if (rows>=h) break;
-
-        //-- Progress Report
-
-        if (fbi->GetUpdateWindow())
-          SendMessage(fbi->GetUpdateWindow(),BMM_PROGRESS,rows,h);
-
-      } while (true);
-      if (foundalpha)
-  	    fbi->SetFlags(MAP_HAS_ALPHA);
-      else
-        fbi->SetType(BMM_TRUE_24);
-      break;
+      *status = ProcessImageIOError(fbi);
+      delete s;
+      return NULL;
     }
-  }
 
-  //-- Clean Up ----------------------------------------
+    //-- Progress Report
 
-  free(data);
+    if (fbi->GetUpdateWindow())
+      SendMessage(fbi->GetUpdateWindow(),BMM_PROGRESS,y+1,height);
+  }
 
-  if (b) free(b);
+  if (foundalpha)
+    fbi->SetFlags(MAP_HAS_ALPHA);
+  else
+    fbi->SetType(BMM_TRUE_24);
 
   //-- Set the storage's BitmapInfo
 
@@ -680,24 +565,33 @@ int  BitmapIO_DDS::Close(int flag)
 // #> BitmapIO_DDS::ReadDDSHeader()
 //
 
-int  BitmapIO_DDS::ReadDDSHeader(FILE *stream)
+int  BitmapIO_DDS::ReadDDSHeader(FILE *stream, DdsImage &image)
 {
   //-- Read File Header --------------------------------
 
-  int res = fread(&hdr,1,sizeof(DDSFILEHEADER),stream);
+  unsigned char buffer[148];
 
-  if (res != sizeof(DDSFILEHEADER))
-    return 0;
+  size_t res = fread(buffer,1,sizeof(buffer),stream);
 
   //-- Validate ----------------------------------------
 
-  if (hdr.dwMagic != 0x20534444)
+  if (!image.ReadHeader(buffer, res))
     return 0;
 
   //-- Done
   return 1;
 }
 
+//-----------------------------------------------------------------------------
+// #> BitmapIO_DDS::LoadMipLevel()
+//
+
+unsigned BitmapIO_DDS::LoadMipLevel(const DdsImage &image) const
+{
+  unsigned count = image.MipCount();
+  return (mMipLevel < count) ? mMipLevel : count - 1;
+}
+
 #ifdef printf
 #undef printf
 #endif
@@ -9,6 +9,8 @@
 
 #define DLLEXPORT __declspec(dllexport)
 
+#include "DdsDecoder.h"
+
 #define DDS_CLASS_ID Class_ID(0xe3061ca, 0xd2120de)
 
 #pragma pack(push,1)
@@ -80,8 +82,8 @@ class BitmapIO_DDS : public BitmapIO
 
 private:
 
-  DDSFILEHEADER  hdr;
   DDSParams     mParams;
+  unsigned      mMipLevel;
 
 public:
 
@@ -148,7 +150,14 @@ public:
 
   //-- This handler's specialized functions
 
-  int            ReadDDSHeader      (FILE *stream);
+  int            ReadDDSHeader      (FILE *stream, DdsImage &image);
+  unsigned       LoadMipLevel       (const DdsImage &image) const;
+
+  //-- Mip level decoded by Load, clamped to the levels in the file.
+  //   Previews can ask for a smaller level instead of the full image.
+
+  void           SetMipLevel        (unsigned level) { mMipLevel = level; }
+  unsigned       GetMipLevel        () const         { return mMipLevel; }
 
   //-- Dialog Proc for the Image control Dlg box
 
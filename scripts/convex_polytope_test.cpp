@@ -0,0 +1,66 @@
+/**********************************************************************
+*<
+FILE: convex_polytope_test.cpp
+
+DESCRIPTION:	Checks NifCommon/ConvexSolvers on grid snapped boxes, whose
+               coplanar surface points are where merging hull facets into
+               polytope planes goes wrong.  It has no Max dependencies and
+               builds on Linux or Windows:
+
+                 g++ -O2 -std=c++17 -INifCommon \
+                     scripts/convex_polytope_test.cpp NifCommon/ConvexSolvers.cpp \
+                     -o convex_polytope_test
+
+               The surface points of a cube and of a box, in several
+               shuffled orders, must each give their eight corners and
+               exactly six planes.  Exits non zero on the first failure.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "ConvexSolvers.h"
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+int main()
+{
+	const int sizes[2][3] = { { 4, 4, 4 }, { 6, 3, 2 } };
+	int failed = 0;
+	for (int s = 0; s < 2; ++s) {
+		const int *size = sizes[s];
+		std::vector<float> pts;
+		for (int x = 0; x <= size[0]; ++x) {
+			for (int y = 0; y <= size[1]; ++y) {
+				for (int z = 0; z <= size[2]; ++z) {
+					if (x == 0 || x == size[0] || y == 0 || y == size[1] || z == 0 || z == size[2]) {
+						pts.push_back(float(x) * 0.5f - 1.5f);
+						pts.push_back(float(y) * 0.25f);
+						pts.push_back(float(z) * 2.0f + 1.0f);
+					}
+				}
+			}
+		}
+		int failedBefore = failed;
+		std::minstd_rand rng(1);
+		for (int pass = 0; pass < 8; ++pass) {
+			for (size_t i = pts.size() / 3; i > 1; --i) {
+				size_t j = rng() % i;
+				for (int k = 0; k < 3; ++k)
+					std::swap(pts[(i - 1) * 3 + k], pts[j * 3 + k]);
+			}
+			std::vector<float> verts, planes;
+			bool ok = ComputeConvexPolytope(&pts[0], pts.size() / 3, 0, verts, planes);
+			if (!ok || verts.size() != 8 * 3 || planes.size() != 6 * 4) {
+				printf("FAIL %dx%dx%d order %d: %s, %u vertices, %u planes\n", size[0], size[1], size[2], pass,
+					ok ? "built" : "no hull", unsigned(verts.size() / 3), unsigned(planes.size() / 4));
+				++failed;
+			}
+		}
+		if (failed == failedBefore)
+			printf("ok   %dx%dx%d: 8 orders, 8 vertices, 6 planes\n", size[0], size[1], size[2]);
+	}
+	return failed ? 1 : 0;
+}
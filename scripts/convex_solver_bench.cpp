@@ -0,0 +1,417 @@
+/**********************************************************************
+*<
+FILE: convex_solver_bench.cpp
+
+DESCRIPTION:	Times NifCommon/ConvexSolvers on synthetic point clouds and
+               compares the fit with what the plugin produced before them.
+               It has no Max dependencies and builds on Linux or Windows:
+
+                 g++ -O2 -std=c++17 -INifCommon \
+                     scripts/convex_solver_bench.cpp NifCommon/ConvexSolvers.cpp \
+                     -o convex_solver_bench
+
+               convex_solver_bench [-n points] [-r repeats] [-s seed]
+
+               -n  points per cloud (default 20000)
+               -r  run every solver this many times (default 5) and keep
+                   the fastest run
+               -s  seed for the clouds and their rotations (default 1)
+
+               qhull was never in the tree and NifMagic.dll is a closed
+               Windows binary, so neither can run here.  The baselines are
+               what the exporter actually fell back to without them: the
+               input points as the hull, CalcAxisAlignedBox for the box and
+               CalcCenteredSphere where a capsule was wanted.  Mass
+               properties are checked against the exact values of the
+               solid box and against an independent sum over the hull.
+
+               Every polytope, box and capsule must hold all the points and
+               every hull must be closed with Euler characteristic 2; the
+               program exits non zero otherwise.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "ConvexSolvers.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const double Pi = 3.14159265358979323846;
+
+enum CloudKind { CLOUD_SPHERE, CLOUD_BOX, CLOUD_ELLIPSOID, CLOUD_LATTICE, CLOUD_DISK, CLOUD_COUNT };
+
+const char* CloudName(int kind)
+{
+	switch (kind) {
+	case CLOUD_SPHERE: return "sphere surface";
+	case CLOUD_BOX: return "box surface";
+	case CLOUD_ELLIPSOID: return "solid ellipsoid";
+	case CLOUD_LATTICE: return "grid lattice";
+	case CLOUD_DISK: return "flat disk";
+	default: return "unknown";
+	}
+}
+
+// Box cloud half extents, kept for the exact mass properties
+const double BoxHalf[3] = { 3.0, 1.5, 0.5 };
+
+void RandomRotation(std::mt19937& rng, double m[3][3])
+{
+	std::normal_distribution<double> normal;
+	double q[4], len = 0.0;
+	for (int k = 0; k < 4; ++k) {
+		q[k] = normal(rng);
+		len += q[k] * q[k];
+	}
+	len = sqrt(len);
+	double w = q[0] / len, x = q[1] / len, y = q[2] / len, z = q[3] / len;
+	m[0][0] = 1 - 2 * (y * y + z * z); m[0][1] = 2 * (x * y - w * z);     m[0][2] = 2 * (x * z + w * y);
+	m[1][0] = 2 * (x * y + w * z);     m[1][1] = 1 - 2 * (x * x + z * z); m[1][2] = 2 * (y * z - w * x);
+	m[2][0] = 2 * (x * z - w * y);     m[2][1] = 2 * (y * z + w * x);     m[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+// Rotated and offset so no solver gets the coordinate axes for free
+std::vector<float> MakeCloud(int kind, size_t n, std::mt19937& rng)
+{
+	std::uniform_real_distribution<double> uni(-1.0, 1.0);
+	std::normal_distribution<double> normal;
+	std::vector<double> p;
+	p.reserve(n * 3);
+	switch (kind) {
+	case CLOUD_SPHERE:
+		for (size_t i = 0; i < n; ++i) {
+			double v[3] = { normal(rng), normal(rng), normal(rng) };
+			double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+			for (int k = 0; k < 3; ++k)
+				p.push_back(2.0 * v[k] / len);
+		}
+		break;
+	case CLOUD_BOX:
+		// The eight corners, then points on a random face
+		for (int c = 0; c < 8; ++c) {
+			for (int k = 0; k < 3; ++k)
+				p.push_back(((c >> k) & 1) ? BoxHalf[k] : -BoxHalf[k]);
+		}
+		for (size_t i = 8; i < n; ++i) {
+			int face = int(rng() % 6);
+			for (int k = 0; k < 3; ++k)
+				p.push_back((k == face / 2) ? ((face & 1) ? BoxHalf[k] : -BoxHalf[k]) : uni(rng) * BoxHalf[k]);
+		}
+		break;
+	case CLOUD_ELLIPSOID:
+		while (p.size() < n * 3) {
+			double v[3] = { uni(rng), uni(rng), uni(rng) };
+			if (v[0] * v[0] + v[1] * v[1] + v[2] * v[2] <= 1.0) {
+				p.push_back(4.0 * v[0]);
+				p.push_back(1.0 * v[1]);
+				p.push_back(0.5 * v[2]);
+			}
+		}
+		break;
+	case CLOUD_LATTICE: {
+		// Whole lattice of a box, so most points are coplanar with others
+		int side = std::max(2, int(cbrt(double(n))));
+		for (size_t i = 0; i < n; ++i) {
+			size_t x = i % side, y = (i / side) % side, z = (i / side / side) % side;
+			p.push_back(double(x) * 0.25);
+			p.push_back(double(y) * 0.125);
+			p.push_back(double(z) * 0.5);
+		}
+		break;
+	}
+	case CLOUD_DISK:
+		while (p.size() < n * 3) {
+			double x = uni(rng), y = uni(rng);
+			if (x * x + y * y <= 1.0) {
+				p.push_back(3.0 * x);
+				p.push_back(2.0 * y);
+				p.push_back(0.0);
+			}
+		}
+		break;
+	}
+
+	double m[3][3];
+	RandomRotation(rng, m);
+	std::vector<float> pts(n * 3);
+	for (size_t i = 0; i < n; ++i) {
+		const double* v = &p[i * 3];
+		for (int k = 0; k < 3; ++k)
+			pts[i * 3 + k] = float(m[k][0] * v[0] + m[k][1] * v[1] + m[k][2] * v[2] + 10.0 * (k + 1));
+	}
+	return pts;
+}
+
+// Tolerance for containment tests, relative to the cloud size
+double CloudScale(const float* pts, size_t n)
+{
+	double scale = 0.0;
+	for (size_t i = 0; i < n * 3; ++i)
+		scale = std::max(scale, double(fabs(pts[i])));
+	return scale;
+}
+
+// CalcAxisAlignedBox
+void AxisAlignedBox(const float* pts, size_t n, float lo[3], float hi[3])
+{
+	for (int k = 0; k < 3; ++k)
+		lo[k] = hi[k] = pts[k];
+	for (size_t i = 1; i < n; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = std::min(lo[k], pts[i * 3 + k]);
+			hi[k] = std::max(hi[k], pts[i * 3 + k]);
+		}
+	}
+}
+
+// CalcCenteredSphere
+float CenteredSphere(const float* pts, size_t n, float center[3])
+{
+	double sum[3] = { 0.0, 0.0, 0.0 };
+	for (size_t i = 0; i < n; ++i) {
+		for (int k = 0; k < 3; ++k)
+			sum[k] += pts[i * 3 + k];
+	}
+	for (int k = 0; k < 3; ++k)
+		center[k] = float(sum[k] / double(n));
+	float radsq = 0.0f;
+	for (size_t i = 0; i < n; ++i) {
+		float d[3] = { pts[i * 3] - center[0], pts[i * 3 + 1] - center[1], pts[i * 3 + 2] - center[2] };
+		radsq = std::max(radsq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	}
+	return sqrt(radsq);
+}
+
+// Closed two manifold with every edge used once each way, and V - E + F == 2
+bool HullIsClosed(const std::vector<int>& tris, size_t& nverts)
+{
+	std::map<std::pair<int, int>, int> edges;
+	std::vector<int> used;
+	for (size_t t = 0; t < tris.size(); t += 3) {
+		for (int e = 0; e < 3; ++e) {
+			int a = tris[t + e], b = tris[t + (e + 1) % 3];
+			if (++edges[std::make_pair(a, b)] > 1)
+				return false;
+			used.push_back(a);
+		}
+	}
+	for (const auto& e : edges) {
+		if (edges.find(std::make_pair(e.first.second, e.first.first)) == edges.end())
+			return false;
+	}
+	std::sort(used.begin(), used.end());
+	nverts = size_t(std::unique(used.begin(), used.end()) - used.begin());
+	long euler = long(nverts) - long(edges.size() / 2) + long(tris.size() / 3);
+	return euler == 2;
+}
+
+// Largest distance of any point outside the polytope planes
+double PlanesOutside(const float* pts, size_t n, const std::vector<float>& planes)
+{
+	double worst = 0.0;
+	for (size_t f = 0; f < planes.size(); f += 4) {
+		for (size_t i = 0; i < n; ++i) {
+			const float* p = pts + i * 3;
+			double d = double(planes[f]) * p[0] + double(planes[f + 1]) * p[1] + double(planes[f + 2]) * p[2] + planes[f + 3];
+			worst = std::max(worst, d);
+		}
+	}
+	return worst;
+}
+
+// Signed tetrahedra from the origin, independent of the solver's integrals
+double HullVolume(const float* pts, const std::vector<int>& tris)
+{
+	double vol = 0.0;
+	for (size_t t = 0; t < tris.size(); t += 3) {
+		const float* a = pts + tris[t] * 3;
+		const float* b = pts + tris[t + 1] * 3;
+		const float* c = pts + tris[t + 2] * 3;
+		vol += (double(a[0]) * (double(b[1]) * c[2] - double(b[2]) * c[1])
+			- double(a[1]) * (double(b[0]) * c[2] - double(b[2]) * c[0])
+			+ double(a[2]) * (double(b[0]) * c[1] - double(b[1]) * c[0])) / 6.0;
+	}
+	return fabs(vol);
+}
+
+double BoxOutside(const float* pts, size_t n, const OrientedBox& box)
+{
+	double worst = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		double d[3] = { double(pts[i * 3]) - box.center[0], double(pts[i * 3 + 1]) - box.center[1], double(pts[i * 3 + 2]) - box.center[2] };
+		for (int a = 0; a < 3; ++a) {
+			double t = d[0] * box.axis[a][0] + d[1] * box.axis[a][1] + d[2] * box.axis[a][2];
+			worst = std::max(worst, fabs(t) - 0.5 * box.size[a]);
+		}
+	}
+	return worst;
+}
+
+double CapsuleOutside(const float* pts, size_t n, const CapsuleFit& cap)
+{
+	double axis[3] = { double(cap.pt2[0]) - cap.pt1[0], double(cap.pt2[1]) - cap.pt1[1], double(cap.pt2[2]) - cap.pt1[2] };
+	double len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	double worst = 0.0;
+	for (size_t i = 0; i < n; ++i) {
+		double d[3] = { double(pts[i * 3]) - cap.pt1[0], double(pts[i * 3 + 1]) - cap.pt1[1], double(pts[i * 3 + 2]) - cap.pt1[2] };
+		double t = (len2 > 0.0) ? (d[0] * axis[0] + d[1] * axis[1] + d[2] * axis[2]) / len2 : 0.0;
+		t = std::min(1.0, std::max(0.0, t));
+		for (int k = 0; k < 3; ++k)
+			d[k] -= t * axis[k];
+		worst = std::max(worst, sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) - cap.radius);
+	}
+	return worst;
+}
+
+double CapsuleVolume(const CapsuleFit& cap)
+{
+	double d[3] = { double(cap.pt2[0]) - cap.pt1[0], double(cap.pt2[1]) - cap.pt1[1], double(cap.pt2[2]) - cap.pt1[2] };
+	double len = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+	double r = cap.radius;
+	return Pi * r * r * len + 4.0 / 3.0 * Pi * r * r * r;
+}
+
+template <typename Fn>
+double BestOf(int repeats, Fn fn)
+{
+	double best = 0.0;
+	for (int r = 0; r < repeats; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || seconds < best)
+			best = seconds;
+	}
+	return best * 1e3;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t n = 20000;
+	int repeats = 5;
+	unsigned seed = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			n = size_t(std::max(8, atoi(argv[++i])));
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			seed = unsigned(atoi(argv[++i]));
+		else {
+			fprintf(stderr, "usage: %s [-n points] [-r repeats] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	int failed = 0;
+	printf("%u points per cloud, fastest of %d runs, times in ms\n\n", unsigned(n), repeats);
+	printf("%-16s %-8s %9s %9s %12s %12s %9s\n", "cloud", "solver", "ms", "old ms", "volume", "old volume", "outside");
+	for (int kind = 0; kind < CLOUD_COUNT; ++kind) {
+		std::vector<float> pts = MakeCloud(kind, n, rng);
+		const float* p = &pts[0];
+		double eps = CloudScale(p, n) * 1e-5;
+		const char* name = CloudName(kind);
+
+		// Hull: the old fallback handed the input on unchanged.  Its
+		//   containment is checked through the polytope planes, which is what
+		//   havok is given; the planes of single sliver triangles tilt with
+		//   the rounding of their corners and would overstate it
+		std::vector<int> tris;
+		bool hullOk = false;
+		double hullMs = BestOf(repeats, [&] { hullOk = ComputeConvexHull(p, n, tris); });
+		size_t hullVerts = 0;
+		bool closed = hullOk && HullIsClosed(tris, hullVerts);
+		printf("%-16s %-8s %9.2f %9s %12.4f %12s %9s   %u of %u points kept\n", name, "hull", hullMs, "-",
+			hullOk ? HullVolume(p, tris) : 0.0, "-", "-", unsigned(hullVerts), unsigned(n));
+		if (!closed) {
+			printf("FAIL %s: hull %s\n", name, hullOk ? "not closed" : "missing");
+			++failed;
+		}
+
+		std::vector<float> verts, planes;
+		bool polyOk = false;
+		double polyMs = BestOf(repeats, [&] { polyOk = ComputeConvexPolytope(p, n, 0, verts, planes); });
+		double polyOut = PlanesOutside(p, n, planes);
+		printf("%-16s %-8s %9.2f %9s %12s %12s %9.1e   %u vertices, %u planes\n", name, "polytope", polyMs, "-", "-", "-",
+			polyOut, unsigned(verts.size() / 3), unsigned(planes.size() / 4));
+		if (!polyOk || polyOut > eps) {
+			printf("FAIL %s: polytope %s, %.3g outside\n", name, polyOk ? "too small" : "missing", polyOut);
+			++failed;
+		}
+
+		// Box against CalcAxisAlignedBox
+		OrientedBox box = {};
+		bool boxOk = false;
+		double boxMs = BestOf(repeats, [&] { boxOk = ComputeOrientedBox(p, n, box); });
+		float lo[3], hi[3];
+		double aabbMs = BestOf(repeats, [&] { AxisAlignedBox(p, n, lo, hi); });
+		double boxOut = BoxOutside(p, n, box);
+		printf("%-16s %-8s %9.2f %9.2f %12.4f %12.4f %9.1e\n", name, "box", boxMs, aabbMs,
+			double(box.size[0]) * box.size[1] * box.size[2], double(hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]), boxOut);
+		if (!boxOk || boxOut > eps) {
+			printf("FAIL %s: box %s, %.3g outside\n", name, boxOk ? "too small" : "missing", boxOut);
+			++failed;
+		}
+
+		// Capsule against CalcCenteredSphere
+		CapsuleFit cap = {};
+		bool capOk = false;
+		double capMs = BestOf(repeats, [&] { capOk = ComputeCapsule(p, n, cap); });
+		float center[3];
+		float radius = 0.0f;
+		double sphereMs = BestOf(repeats, [&] { radius = CenteredSphere(p, n, center); });
+		double capOut = CapsuleOutside(p, n, cap);
+		printf("%-16s %-8s %9.2f %9.2f %12.4f %12.4f %9.1e\n", name, "capsule", capMs, sphereMs,
+			CapsuleVolume(cap), 4.0 / 3.0 * Pi * radius * radius * radius, capOut);
+		if (!capOk || capOut > eps) {
+			printf("FAIL %s: capsule %s, %.3g outside\n", name, capOk ? "too small" : "missing", capOut);
+			++failed;
+		}
+
+		// Mass properties of the hull against the independent volume, and
+		//   of the box cloud against the solid box
+		if (hullOk) {
+			MassProperties mass = {};
+			bool massOk = false;
+			double massMs = BestOf(repeats, [&] { massOk = ComputeMassProperties(p, n, &tris[0], tris.size() / 3, true, mass); });
+			double ref = HullVolume(p, tris);
+			double relErr = fabs(mass.mass - ref) / ref;
+			printf("%-16s %-8s %9.2f %9s %12.4f %12.4f %9s\n", name, "mass", massMs, "-", mass.mass, ref, "-");
+			if (!massOk || relErr > 1e-4) {
+				printf("FAIL %s: mass %.6g, hull volume %.6g\n", name, mass.mass, ref);
+				++failed;
+			}
+			if (kind == CLOUD_BOX) {
+				// Trace of the inertia tensor is rotation invariant
+				double a = 2.0 * BoxHalf[0], b = 2.0 * BoxHalf[1], c = 2.0 * BoxHalf[2];
+				double vol = a * b * c;
+				double trace = vol / 12.0 * 2.0 * (a * a + b * b + c * c);
+				double got = double(mass.inertia[0][0]) + mass.inertia[1][1] + mass.inertia[2][2];
+				printf("%-16s %-8s %9s %9s %12.4f %12.4f %9s   inertia trace %.4f, exact %.4f\n", name, "exact", "-", "-",
+					mass.mass, vol, "-", got, trace);
+				if (fabs(mass.mass - vol) / vol > 1e-4 || fabs(got - trace) / trace > 1e-3) {
+					printf("FAIL %s: solid box mass properties\n", name);
+					++failed;
+				}
+			}
+		}
+		printf("\n");
+	}
+	if (failed)
+		printf("%d check(s) failed\n", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,178 @@
+/**********************************************************************
+*<
+FILE: dds_decode_bench.cpp
+
+DESCRIPTION:	Times NifCommon/DdsDecoder over a corpus of DDS files and
+               prints the decode rate for each block format.  It has no
+               Max dependencies and builds on Linux or Windows:
+
+                 g++ -O2 -std=c++17 -pthread -INifCommon \
+                     scripts/dds_decode_bench.cpp NifCommon/DdsDecoder.cpp \
+                     -o dds_decode_bench
+
+               Add -DNIF_DDS_NO_SSE to time the plain C++ block decoders.
+
+               dds_decode_bench [-t threads] [-p previewSize] [-r repeats]
+                                file-or-directory...
+
+               -t  workers per image, 0 for all cores (default 1)
+               -p  decode the first mip no larger than this instead of
+                   the full image, as the viewport preview does
+               -r  decode every file this many times (default 5) and
+                   keep the fastest run
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include "DdsDecoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* FormatName(DdsFormat format)
+{
+	switch (format) {
+	case DDS_FMT_BC1: return "BC1";
+	case DDS_FMT_BC2: return "BC2";
+	case DDS_FMT_BC3: return "BC3";
+	case DDS_FMT_BC4: return "BC4";
+	case DDS_FMT_BC4S: return "BC4 snorm";
+	case DDS_FMT_BC5: return "BC5";
+	case DDS_FMT_BC5S: return "BC5 snorm";
+	case DDS_FMT_BC6H: return "BC6H uf16";
+	case DDS_FMT_BC6HS: return "BC6H sf16";
+	case DDS_FMT_BC7: return "BC7";
+	case DDS_FMT_MASKED: return "uncompressed";
+	default: return "unknown";
+	}
+}
+
+struct FormatTotal
+{
+	unsigned files;
+	double pixels;
+	double seconds;
+};
+
+bool HasDdsExtension(const fs::path& path)
+{
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(tolower(c)); });
+	return ext == ".dds";
+}
+
+void CollectFiles(const fs::path& path, std::vector<fs::path>& files)
+{
+	std::error_code ec;
+	if (fs::is_directory(path, ec)) {
+		for (fs::recursive_directory_iterator it(path, ec), end; it != end; it.increment(ec)) {
+			if (it->is_regular_file(ec) && HasDdsExtension(it->path()))
+				files.push_back(it->path());
+		}
+	}
+	else if (fs::is_regular_file(path, ec)) {
+		files.push_back(path);
+	}
+	else {
+		fprintf(stderr, "skipping %s: not found\n", path.string().c_str());
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	int threads = 1, repeats = 5;
+	unsigned previewSize = 0;
+	std::vector<fs::path> files;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			previewSize = unsigned(atoi(argv[++i]));
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = std::max(1, atoi(argv[++i]));
+		else
+			CollectFiles(argv[i], files);
+	}
+	if (files.empty()) {
+		fprintf(stderr, "usage: %s [-t threads] [-p previewSize] [-r repeats] file-or-directory...\n", argv[0]);
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+#ifdef NIF_DDS_NO_SSE
+	printf("block decoders: plain C++\n");
+#else
+	printf("block decoders: SSE2 where available\n");
+#endif
+
+	FormatTotal totals[DDS_FMT_MASKED + 1] = {};
+	std::vector<unsigned char> rgba;
+	unsigned failed = 0;
+	for (const fs::path& path : files) {
+		std::ifstream in(path, std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		DdsImage image;
+		if (data.empty() || !image.ReadHeader(&data[0], data.size())) {
+			fprintf(stderr, "skipping %s: unsupported\n", path.string().c_str());
+			++failed;
+			continue;
+		}
+		unsigned level = previewSize ? image.FindMipLevel(previewSize) : 0;
+		unsigned w, h;
+		size_t offset, size;
+		if (!image.GetMipLevel(level, w, h, offset, size)) {
+			++failed;
+			continue;
+		}
+
+		double best = 0.0;
+		bool ok = true;
+		for (int r = 0; r < repeats && ok; ++r) {
+			auto start = std::chrono::steady_clock::now();
+			ok = image.Decode(&data[0], data.size(), level, rgba, threads);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (r == 0 || seconds < best)
+				best = seconds;
+		}
+		if (!ok) {
+			fprintf(stderr, "skipping %s: truncated\n", path.string().c_str());
+			++failed;
+			continue;
+		}
+		FormatTotal& t = totals[image.Format()];
+		++t.files;
+		t.pixels += double(w) * h;
+		t.seconds += best;
+	}
+
+	printf("%-14s %6s %10s %10s %10s\n", "format", "files", "Mpixels", "ms", "Mpix/s");
+	FormatTotal all = {};
+	for (int f = 0; f <= DDS_FMT_MASKED; ++f) {
+		const FormatTotal& t = totals[f];
+		if (t.files == 0)
+			continue;
+		printf("%-14s %6u %10.2f %10.2f %10.1f\n", FormatName(DdsFormat(f)), t.files, t.pixels / 1e6, t.seconds * 1e3, t.pixels / 1e6 / t.seconds);
+		all.files += t.files;
+		all.pixels += t.pixels;
+		all.seconds += t.seconds;
+	}
+	if (all.files)
+		printf("%-14s %6u %10.2f %10.2f %10.1f\n", "total", all.files, all.pixels / 1e6, all.seconds * 1e3, all.pixels / 1e6 / all.seconds);
+	if (failed)
+		printf("%u file(s) skipped\n", failed);
+	return 0;
+}
@@ -0,0 +1,1332 @@
+/**********************************************************************
+*<
+FILE: material_read_bench.cpp
+
+DESCRIPTION:	Times reading a corpus of BGSM/BGEM material files with the
+               reader and session cache of MtlUtils/mtlutil.cpp against the
+               fread path it replaced, cold and cached, and checks that both
+               decode every binary file the same.  It has no Max
+               dependencies and builds on Linux or Windows:
+
+                 g++ -O2 -std=c++17 -INifCommon -IMtlUtils \
+                     scripts/material_read_bench.cpp -o material_read_bench
+
+               material_read_bench [-r repeats] file-or-directory...
+               material_read_bench -g directory count
+
+               -r  read the corpus this many times per pass (default 5)
+                   and keep the fastest
+               -g  write count synthetic materials into directory: binary
+                   BGSM and BGEM files and json BGSM files
+
+               The passes are
+                 fread    one fread per field, the old path
+                 mapped   whole file mapped copy on write, then the cursor
+                          and in situ json parse
+                 buffer   whole file in one read, then the same decode;
+                          what mtlutil.cpp does
+                 cached   session cache hits, as when many shapes of one
+                          import share their materials
+               Cold passes drop the OS file cache with posix_fadvise first,
+               where that exists, and start with an empty session cache;
+               warm passes only empty the session cache.
+
+               mtlutil.cpp needs the Max SDK and MSVC token pasting, so
+               its readers, cache and json stream are copied below along
+               with the fread path from before them; keep them in step.
+               The old path parsed json files and threw the document
+               away, so only binary files are compared.  Exits non zero
+               when a binary file decodes differently.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+#include "rapidjson/document.h"
+
+namespace fs = std::filesystem;
+
+typedef std::string tstring;
+namespace Niflib {
+struct Color3
+{
+	float r, g, b;
+
+	Color3(float r = 0.0f, float g = 0.0f, float b = 0.0f) : r(r), g(g), b(b) {}
+};
+}
+#include "MtlDefine.h"
+
+AlphaBlendModeType ConvertAlphaBlendMode(bool BlendState, AlphaBlendFunc BlendFunc1, AlphaBlendFunc BlendFunc2)
+{
+	if (BlendState == false && BlendFunc1 == ABF_SRC_ALPHA && BlendFunc2 == ABF_ONE_MINUS_SRC_ALPHA) return ABMT_Unknown;
+	if (BlendState == false && BlendFunc1 == ABF_ONE && BlendFunc2 == ABF_ONE) return ABMT_None;
+	if (BlendState == true && BlendFunc1 == ABF_SRC_ALPHA && BlendFunc2 == ABF_ONE_MINUS_SRC_ALPHA) return ABMT_Standard;
+	if (BlendState == true && BlendFunc1 == ABF_SRC_ALPHA && BlendFunc2 == ABF_ONE) return ABMT_Additive;
+	if (BlendState == true && BlendFunc1 == ABF_DST_COLOR && BlendFunc2 == ABF_ZERO) return ABMT_Multiplicative;
+	return ABMT_None;
+}
+
+void ConvertAlphaBlendMode(AlphaBlendModeType type, bool& BlendState, AlphaBlendFunc& BlendFunc1, AlphaBlendFunc& BlendFunc2)
+{
+	switch (type) {
+	case ABMT_Unknown:	BlendState = false, BlendFunc1 = ABF_SRC_ALPHA, BlendFunc2 = ABF_ONE_MINUS_SRC_ALPHA; break;
+	case ABMT_None:		BlendState = false, BlendFunc1 = ABF_ONE, BlendFunc2 = ABF_ONE; break;
+	case ABMT_Standard:	BlendState = true, BlendFunc1 = ABF_SRC_ALPHA, BlendFunc2 = ABF_ONE_MINUS_SRC_ALPHA; break;
+	case ABMT_Additive:	BlendState = true, BlendFunc1 = ABF_SRC_ALPHA, BlendFunc2 = ABF_ONE; break;
+	case ABMT_Multiplicative:	BlendState = true, BlendFunc1 = ABF_DST_COLOR, BlendFunc2 = ABF_ZERO; break;
+	}
+}
+
+namespace {
+
+const int MAX_PATH_LEN = 260; // MAX_PATH
+const Niflib::Color3 empty_color3(0.0f, 0.0f, 0.0f);
+
+const char* const AlphaBlendModeNames[] = { "Unknown", "None", "Standard", "Additive", "Multiplicative" };
+
+//////////////////////////////////////////////////////////////////////////
+// Binary fields: one fread each on the old path, a bounds checked copy
+//   out of the file in memory on the new
+
+#define READ_VALUE(dst, x)  if (!ReadObject(src, dst.x, #x)) goto error;
+#define SAVE_VALUE(src, x)  if (!SaveObject(dst, src.x, #x)) goto error;
+
+struct MtlReader
+{
+	const char *p;
+	const char *end;
+};
+
+template <typename T>
+bool ReadObject(FILE* file, T& x, const char *) {
+	return (fread(&x, sizeof(x), 1, file) == 1);
+}
+
+bool ReadObject(FILE* src, tstring& x, const char *) {
+	int len = 0;
+	char ptr[MAX_PATH_LEN + 1];
+	if (!ReadObject(src, len, "")) return false;
+	if (len >= MAX_PATH_LEN) return false;
+	if (fread(ptr, 1, len, src) != size_t(len)) return false;
+	ptr[len] = 0;
+	x = ptr;
+	return true;
+}
+
+template <typename T>
+bool ReadObject(MtlReader& src, T& x, const char *) {
+	if (size_t(src.end - src.p) < sizeof(x)) return false;
+	memcpy(&x, src.p, sizeof(x));
+	src.p += sizeof(x);
+	return true;
+}
+
+bool ReadObject(MtlReader& src, tstring& x, const char *) {
+	int len = 0;
+	if (!ReadObject(src, len, "")) return false;
+	if (len < 0 || len >= MAX_PATH_LEN || src.end - src.p < len) return false;
+	x.assign(src.p, strnlen(src.p, len));
+	src.p += len;
+	return true;
+}
+
+template <typename T>
+bool SaveObject(FILE* file, const T& x, const char *) {
+	return (fwrite(&x, sizeof(x), 1, file) == 1);
+}
+
+bool SaveObject(FILE* file, const tstring& x, const char *) {
+	unsigned len = unsigned(x.size() + 1); // include null terminator
+	if (!SaveObject(file, len, "")) return false;
+	return fwrite(x.c_str(), 1, len, file) == len;
+}
+
+template <typename Src>
+bool ReadMtlHeader(Src& src, MaterialHeader& hdr)
+{
+	READ_VALUE(hdr, Signature);
+	READ_VALUE(hdr, Version);
+	return true;
+error: return false;
+}
+
+bool SaveMtlHeader(FILE* dst, MaterialHeader& hdr)
+{
+	SAVE_VALUE(hdr, Signature);
+	SAVE_VALUE(hdr, Version);
+	return true;
+error: return false;
+}
+
+template <typename Src>
+bool ReadBaseMaterial(Src& src, const MaterialHeader&, BaseMaterial& mtl)
+{
+	int tile_uv;
+	if (!ReadObject(src, tile_uv, "")) goto error;
+	mtl.TileU = (tile_uv & 0x1) != 0;
+	mtl.TileV = (tile_uv & 0x2) != 0;
+	READ_VALUE(mtl, UOffset);
+	READ_VALUE(mtl, VOffset);
+	READ_VALUE(mtl, UScale);
+	READ_VALUE(mtl, VScale);
+	READ_VALUE(mtl, Alpha);
+
+	READ_VALUE(mtl, BlendState);
+	READ_VALUE(mtl, BlendFunc1);
+	READ_VALUE(mtl, BlendFunc2);
+	mtl.AlphaBlendMode = ConvertAlphaBlendMode(mtl.BlendState, mtl.BlendFunc1, mtl.BlendFunc2);
+
+	READ_VALUE(mtl, AlphaTestRef);
+	READ_VALUE(mtl, AlphaTest);
+	READ_VALUE(mtl, ZBufferWrite);
+	READ_VALUE(mtl, ZBufferTest);
+	READ_VALUE(mtl, ScreenSpaceReflections);
+	READ_VALUE(mtl, WetnessControlScreenSpaceReflections);
+	READ_VALUE(mtl, Decal);
+	READ_VALUE(mtl, TwoSided);
+	READ_VALUE(mtl, DecalNoFade);
+	READ_VALUE(mtl, NonOccluder);
+	READ_VALUE(mtl, Refraction);
+	READ_VALUE(mtl, RefractionFalloff);
+	READ_VALUE(mtl, RefractionPower);
+	READ_VALUE(mtl, EnvironmentMapping);
+	READ_VALUE(mtl, EnvironmentMappingMaskScale);
+	READ_VALUE(mtl, GrayscaleToPaletteColor);
+	return true;
+error: return false;
+}
+
+bool SaveBaseMaterial(FILE* dst, const MaterialHeader&, const BaseMaterial& mtl)
+{
+	int tile_uv = (mtl.TileU ? 0x1 : 0) | (mtl.TileV ? 0x2 : 0);
+	if (!SaveObject(dst, tile_uv, "")) goto error;
+	SAVE_VALUE(mtl, UOffset);
+	SAVE_VALUE(mtl, VOffset);
+	SAVE_VALUE(mtl, UScale);
+	SAVE_VALUE(mtl, VScale);
+	SAVE_VALUE(mtl, Alpha);
+	SAVE_VALUE(mtl, BlendState);
+	SAVE_VALUE(mtl, BlendFunc1);
+	SAVE_VALUE(mtl, BlendFunc2);
+	SAVE_VALUE(mtl, AlphaTestRef);
+	SAVE_VALUE(mtl, AlphaTest);
+	SAVE_VALUE(mtl, ZBufferWrite);
+	SAVE_VALUE(mtl, ZBufferTest);
+	SAVE_VALUE(mtl, ScreenSpaceReflections);
+	SAVE_VALUE(mtl, WetnessControlScreenSpaceReflections);
+	SAVE_VALUE(mtl, Decal);
+	SAVE_VALUE(mtl, TwoSided);
+	SAVE_VALUE(mtl, DecalNoFade);
+	SAVE_VALUE(mtl, NonOccluder);
+	SAVE_VALUE(mtl, Refraction);
+	SAVE_VALUE(mtl, RefractionFalloff);
+	SAVE_VALUE(mtl, RefractionPower);
+	SAVE_VALUE(mtl, EnvironmentMapping);
+	SAVE_VALUE(mtl, EnvironmentMappingMaskScale);
+	SAVE_VALUE(mtl, GrayscaleToPaletteColor);
+	return true;
+error: return false;
+}
+
+template <typename Src>
+bool ReadBGSM(Src& src, const MaterialHeader& hdr, BGSMFile& mtl)
+{
+	if (!ReadBaseMaterial(src, hdr, mtl)) goto error;
+	READ_VALUE(mtl, DiffuseTexture);
+	READ_VALUE(mtl, NormalTexture);
+	READ_VALUE(mtl, SmoothSpecTexture);
+	READ_VALUE(mtl, GreyscaleTexture);
+	READ_VALUE(mtl, EnvmapTexture);
+	READ_VALUE(mtl, GlowTexture);
+	READ_VALUE(mtl, InnerLayerTexture);
+	READ_VALUE(mtl, WrinklesTexture);
+	READ_VALUE(mtl, DisplacementTexture);
+	READ_VALUE(mtl, EnableEditorAlphaRef);
+	READ_VALUE(mtl, RimLighting);
+	READ_VALUE(mtl, RimPower);
+	READ_VALUE(mtl, BackLightPower);
+	READ_VALUE(mtl, SubsurfaceLighting);
+	READ_VALUE(mtl, SubsurfaceLightingRolloff);
+	READ_VALUE(mtl, SpecularEnabled);
+	READ_VALUE(mtl, SpecularColor);
+	READ_VALUE(mtl, SpecularMult);
+	READ_VALUE(mtl, Smoothness);
+	READ_VALUE(mtl, FresnelPower);
+	READ_VALUE(mtl, WetnessControlSpecScale);
+	READ_VALUE(mtl, WetnessControlSpecPowerScale);
+	READ_VALUE(mtl, WetnessControlSpecMinvar);
+	READ_VALUE(mtl, WetnessControlEnvMapScale);
+	READ_VALUE(mtl, WetnessControlFresnelPower);
+	READ_VALUE(mtl, WetnessControlMetalness);
+
+	READ_VALUE(mtl, RootMaterialPath);
+	READ_VALUE(mtl, AnisoLighting);
+	READ_VALUE(mtl, EmitEnabled);
+	if (mtl.EmitEnabled)
+		READ_VALUE(mtl, EmittanceColor);
+	READ_VALUE(mtl, EmittanceMult);
+	READ_VALUE(mtl, ModelSpaceNormals);
+	READ_VALUE(mtl, ExternalEmittance);
+	READ_VALUE(mtl, BackLighting);
+	READ_VALUE(mtl, ReceiveShadows);
+	READ_VALUE(mtl, HideSecret);
+	READ_VALUE(mtl, CastShadows);
+	READ_VALUE(mtl, DissolveFade);
+	READ_VALUE(mtl, AssumeShadowmask);
+	READ_VALUE(mtl, Glowmap);
+	READ_VALUE(mtl, EnvironmentMappingWindow);
+	READ_VALUE(mtl, EnvironmentMappingEye);
+	READ_VALUE(mtl, Hair);
+	READ_VALUE(mtl, HairTintColor);
+	READ_VALUE(mtl, Tree);
+	READ_VALUE(mtl, Facegen);
+	READ_VALUE(mtl, SkinTint);
+	READ_VALUE(mtl, Tessellate);
+	READ_VALUE(mtl, DisplacementTextureBias);
+	READ_VALUE(mtl, DisplacementTextureScale);
+	READ_VALUE(mtl, TessellationPNScale);
+	READ_VALUE(mtl, TessellationBaseFactor);
+	READ_VALUE(mtl, TessellationFadeDistance);
+	READ_VALUE(mtl, GrayscaleToPaletteScale);
+	if (hdr.Version >= 1) {
+		READ_VALUE(mtl, SkewSpecularAlpha);
+	} else {
+		mtl.SkewSpecularAlpha = 0;
+	}
+	return true;
+error: return false;
+}
+
+bool SaveBGSM(FILE* dst, const MaterialHeader& hdr, const BGSMFile& mtl)
+{
+	if (!SaveBaseMaterial(dst, hdr, mtl)) goto error;
+	SAVE_VALUE(mtl, DiffuseTexture);
+	SAVE_VALUE(mtl, NormalTexture);
+	SAVE_VALUE(mtl, SmoothSpecTexture);
+	SAVE_VALUE(mtl, GreyscaleTexture);
+	SAVE_VALUE(mtl, EnvmapTexture);
+	SAVE_VALUE(mtl, GlowTexture);
+	SAVE_VALUE(mtl, InnerLayerTexture);
+	SAVE_VALUE(mtl, WrinklesTexture);
+	SAVE_VALUE(mtl, DisplacementTexture);
+	SAVE_VALUE(mtl, EnableEditorAlphaRef);
+	SAVE_VALUE(mtl, RimLighting);
+	SAVE_VALUE(mtl, RimPower);
+	SAVE_VALUE(mtl, BackLightPower);
+	SAVE_VALUE(mtl, SubsurfaceLighting);
+	SAVE_VALUE(mtl, SubsurfaceLightingRolloff);
+	SAVE_VALUE(mtl, SpecularEnabled);
+	SAVE_VALUE(mtl, SpecularColor);
+	SAVE_VALUE(mtl, SpecularMult);
+	SAVE_VALUE(mtl, Smoothness);
+	SAVE_VALUE(mtl, FresnelPower);
+	SAVE_VALUE(mtl, WetnessControlSpecScale);
+	SAVE_VALUE(mtl, WetnessControlSpecPowerScale);
+	SAVE_VALUE(mtl, WetnessControlSpecMinvar);
+	SAVE_VALUE(mtl, WetnessControlEnvMapScale);
+	SAVE_VALUE(mtl, WetnessControlFresnelPower);
+	SAVE_VALUE(mtl, WetnessControlMetalness);
+	SAVE_VALUE(mtl, RootMaterialPath);
+	SAVE_VALUE(mtl, AnisoLighting);
+	SAVE_VALUE(mtl, EmitEnabled);
+	if (mtl.EmitEnabled)
+		SAVE_VALUE(mtl, EmittanceColor);
+	SAVE_VALUE(mtl, EmittanceMult);
+	SAVE_VALUE(mtl, ModelSpaceNormals);
+	SAVE_VALUE(mtl, ExternalEmittance);
+	SAVE_VALUE(mtl, BackLighting);
+	SAVE_VALUE(mtl, ReceiveShadows);
+	SAVE_VALUE(mtl, HideSecret);
+	SAVE_VALUE(mtl, CastShadows);
+	SAVE_VALUE(mtl, DissolveFade);
+	SAVE_VALUE(mtl, AssumeShadowmask);
+	SAVE_VALUE(mtl, Glowmap);
+	SAVE_VALUE(mtl, EnvironmentMappingWindow);
+	SAVE_VALUE(mtl, EnvironmentMappingEye);
+	SAVE_VALUE(mtl, Hair);
+	SAVE_VALUE(mtl, HairTintColor);
+	SAVE_VALUE(mtl, Tree);
+	SAVE_VALUE(mtl, Facegen);
+	SAVE_VALUE(mtl, SkinTint);
+	SAVE_VALUE(mtl, Tessellate);
+	SAVE_VALUE(mtl, DisplacementTextureBias);
+	SAVE_VALUE(mtl, DisplacementTextureScale);
+	SAVE_VALUE(mtl, TessellationPNScale);
+	SAVE_VALUE(mtl, TessellationBaseFactor);
+	SAVE_VALUE(mtl, TessellationFadeDistance);
+	SAVE_VALUE(mtl, GrayscaleToPaletteScale);
+	if (hdr.Version >= 1) {
+		SAVE_VALUE(mtl, SkewSpecularAlpha);
+	}
+	return true;
+error: return false;
+}
+
+template <typename Src>
+bool ReadBGEM(Src& src, const MaterialHeader& hdr, BGEMFile& mtl)
+{
+	if (!ReadBaseMaterial(src, hdr, mtl)) goto error;
+	READ_VALUE(mtl, BaseTexture);
+	READ_VALUE(mtl, GrayscaleTexture);
+	READ_VALUE(mtl, EnvmapTexture);
+	READ_VALUE(mtl, NormalTexture);
+	READ_VALUE(mtl, EnvmapMaskTexture);
+	READ_VALUE(mtl, BloodEnabled);
+	READ_VALUE(mtl, EffectLightingEnabled);
+	READ_VALUE(mtl, FalloffEnabled);
+	READ_VALUE(mtl, FalloffColorEnabled);
+	READ_VALUE(mtl, GrayscaleToPaletteAlpha);
+	READ_VALUE(mtl, SoftEnabled);
+	READ_VALUE(mtl, BaseColor);
+	READ_VALUE(mtl, BaseColorScale);
+	READ_VALUE(mtl, FalloffStartAngle);
+	READ_VALUE(mtl, FalloffStopAngle);
+	READ_VALUE(mtl, FalloffStartOpacity);
+	READ_VALUE(mtl, FalloffStopOpacity);
+	READ_VALUE(mtl, LightingInfluence);
+	READ_VALUE(mtl, EnvmapMinLOD);
+	READ_VALUE(mtl, SoftDepth);
+	return true;
+error: return false;
+}
+
+bool SaveBGEM(FILE* dst, const MaterialHeader& hdr, const BGEMFile& mtl)
+{
+	if (!SaveBaseMaterial(dst, hdr, mtl)) goto error;
+	SAVE_VALUE(mtl, BaseTexture);
+	SAVE_VALUE(mtl, GrayscaleTexture);
+	SAVE_VALUE(mtl, EnvmapTexture);
+	SAVE_VALUE(mtl, NormalTexture);
+	SAVE_VALUE(mtl, EnvmapMaskTexture);
+	SAVE_VALUE(mtl, BloodEnabled);
+	SAVE_VALUE(mtl, EffectLightingEnabled);
+	SAVE_VALUE(mtl, FalloffEnabled);
+	SAVE_VALUE(mtl, FalloffColorEnabled);
+	SAVE_VALUE(mtl, GrayscaleToPaletteAlpha);
+	SAVE_VALUE(mtl, SoftEnabled);
+	SAVE_VALUE(mtl, BaseColor);
+	SAVE_VALUE(mtl, BaseColorScale);
+	SAVE_VALUE(mtl, FalloffStartAngle);
+	SAVE_VALUE(mtl, FalloffStopAngle);
+	SAVE_VALUE(mtl, FalloffStartOpacity);
+	SAVE_VALUE(mtl, FalloffStopOpacity);
+	SAVE_VALUE(mtl, LightingInfluence);
+	SAVE_VALUE(mtl, EnvmapMinLOD);
+	SAVE_VALUE(mtl, SoftDepth);
+	return true;
+error: return false;
+}
+
+#undef READ_VALUE
+#undef SAVE_VALUE
+
+//////////////////////////////////////////////////////////////////////////
+// Json fields, new path only
+
+template <typename T>
+bool ReadObject(const rapidjson::Value&, T&, const char *) {
+	return false;
+}
+
+template <typename T, typename Get>
+bool ReadJsonMember(const rapidjson::Value& value, T& x, const char *name, Get get) {
+	if (name == nullptr || name[0] == 0)
+		return get(value, x);
+	rapidjson::Value::ConstMemberIterator itr = value.FindMember(name);
+	return itr != value.MemberEnd() && get((*itr).value, x);
+}
+
+bool ReadObject(const rapidjson::Value& value, float& x, const char *name) {
+	return ReadJsonMember(value, x, name, [](const rapidjson::Value& v, float& x) { if (!v.IsNumber()) return false; x = float(v.GetDouble()); return true; });
+}
+
+bool ReadObject(const rapidjson::Value& value, bool& x, const char *name) {
+	return ReadJsonMember(value, x, name, [](const rapidjson::Value& v, bool& x) { if (!v.IsBool()) return false; x = v.GetBool(); return true; });
+}
+
+bool ReadObject(const rapidjson::Value& value, tstring& x, const char *name) {
+	return ReadJsonMember(value, x, name, [](const rapidjson::Value& v, tstring& x) { if (!v.IsString()) return false; x = v.GetString(); return true; });
+}
+
+bool ReadObject(const rapidjson::Value& value, Niflib::Color3& x, const char *name) {
+	return ReadJsonMember(value, x, name, [](const rapidjson::Value& v, Niflib::Color3& x) {
+		const char *str = v.IsString() ? v.GetString() : nullptr;
+		if (!str || str[0] != '#') return false;
+		int ival = int(strtol(str + 1, nullptr, 16));
+		x.r = float((ival & 0xFF0000) >> 16) / 255.0f;
+		x.g = float((ival & 0x00FF00) >> 8) / 255.0f;
+		x.b = float((ival & 0x0000FF) >> 0) / 255.0f;
+		return true;
+	});
+}
+
+bool ReadObject(const rapidjson::Value& value, AlphaBlendModeType& x, const char *name) {
+	tstring temp;
+	if (!ReadObject(value, temp, name)) return false;
+	x = ABMT_Unknown;
+	for (int i = 0; i <= ABMT_Multiplicative; ++i) {
+		if (temp == AlphaBlendModeNames[i])
+			x = AlphaBlendModeType(i);
+	}
+	return true;
+}
+
+#define READ_FLOAT(dst, x, def)  if (!ReadObject(src, dst.x, "f" #x)) dst.x = def;
+#define READ_STRING(dst, x, def) if (!ReadObject(src, dst.x, "s" #x)) dst.x = def;
+#define READ_BOOL(dst, x, def)   if (!ReadObject(src, dst.x, "b" #x)) dst.x = def;
+#define READ_ENUM(dst, x, def)   if (!ReadObject(src, dst.x, "e" #x)) dst.x = def;
+#define READ_BYTE(dst, x, def)   if (!ReadObject(src, dst.x, "f" #x)) dst.x = def;
+#define READ_COLOR(dst, x, def)  if (!ReadObject(src, dst.x, "c" #x)) dst.x = def;
+
+bool ReadBaseMaterial(rapidjson::Value& src, const MaterialHeader&, BaseMaterial& mtl)
+{
+	READ_BOOL(mtl, TileU, false);
+	READ_BOOL(mtl, TileV, false);
+	READ_FLOAT(mtl, UOffset, 0.0f);
+	READ_FLOAT(mtl, VOffset, 0.0f);
+	READ_FLOAT(mtl, UScale, 1.0f);
+	READ_FLOAT(mtl, VScale, 1.0f);
+	READ_FLOAT(mtl, Alpha, 1.0f);
+	READ_ENUM(mtl, AlphaBlendMode, ABMT_Unknown);
+	ConvertAlphaBlendMode(mtl.AlphaBlendMode, mtl.BlendState, mtl.BlendFunc1, mtl.BlendFunc2);
+	READ_BYTE(mtl, AlphaTestRef, '\0');
+	READ_BOOL(mtl, AlphaTest, false);
+	READ_BOOL(mtl, ZBufferWrite, true);
+	READ_BOOL(mtl, ZBufferTest, true);
+	READ_BOOL(mtl, ScreenSpaceReflections, false);
+	READ_BOOL(mtl, WetnessControlScreenSpaceReflections, false);
+	READ_BOOL(mtl, Decal, false);
+	READ_BOOL(mtl, TwoSided, false);
+	READ_BOOL(mtl, DecalNoFade, false);
+	READ_BOOL(mtl, NonOccluder, false);
+	READ_BOOL(mtl, Refraction, false);
+	READ_BOOL(mtl, RefractionFalloff, false);
+	READ_FLOAT(mtl, RefractionPower, 0.0f);
+	READ_BOOL(mtl, EnvironmentMapping, false);
+	READ_FLOAT(mtl, EnvironmentMappingMaskScale, 1.0f);
+	READ_BOOL(mtl, GrayscaleToPaletteColor, false);
+	return true;
+}
+
+bool ReadBGEM(rapidjson::Value& src, const MaterialHeader& hdr, BGEMFile& mtl)
+{
+	ReadBaseMaterial(src, hdr, mtl);
+	READ_STRING(mtl, BaseTexture, "");
+	READ_STRING(mtl, GrayscaleTexture, "");
+	READ_STRING(mtl, EnvmapTexture, "");
+	READ_STRING(mtl, NormalTexture, "");
+	READ_STRING(mtl, EnvmapMaskTexture, "");
+	READ_BOOL(mtl, BloodEnabled, false);
+	READ_BOOL(mtl, EffectLightingEnabled, false);
+	READ_BOOL(mtl, FalloffEnabled, false);
+	READ_BOOL(mtl, FalloffColorEnabled, false);
+	READ_BOOL(mtl, GrayscaleToPaletteAlpha, false);
+	READ_BOOL(mtl, SoftEnabled, false);
+	READ_COLOR(mtl, BaseColor, empty_color3);
+	READ_FLOAT(mtl, BaseColorScale, 1.0f);
+	READ_FLOAT(mtl, FalloffStartAngle, 0.0f);
+	READ_FLOAT(mtl, FalloffStopAngle, 0.0f);
+	READ_FLOAT(mtl, FalloffStartOpacity, 0.0f);
+	READ_FLOAT(mtl, FalloffStopOpacity, 0.0f);
+	READ_FLOAT(mtl, LightingInfluence, 1.0f);
+	READ_BYTE(mtl, EnvmapMinLOD, '\x0');
+	READ_FLOAT(mtl, SoftDepth, 100.0f);
+	return true;
+}
+
+bool ReadBGSM(rapidjson::Value& src, const MaterialHeader& hdr, BGSMFile& mtl)
+{
+	ReadBaseMaterial(src, hdr, mtl);
+	READ_STRING(mtl, DiffuseTexture, "");
+	READ_STRING(mtl, NormalTexture, "");
+	READ_STRING(mtl, SmoothSpecTexture, "");
+	READ_STRING(mtl, GreyscaleTexture, "");
+	READ_STRING(mtl, EnvmapTexture, "");
+	READ_STRING(mtl, GlowTexture, "");
+	READ_STRING(mtl, InnerLayerTexture, "");
+	READ_STRING(mtl, WrinklesTexture, "");
+	READ_STRING(mtl, DisplacementTexture, "");
+	READ_BOOL(mtl, EnableEditorAlphaRef, false);
+	READ_BOOL(mtl, RimLighting, false);
+	READ_FLOAT(mtl, RimPower, 0.0f);
+	READ_FLOAT(mtl, BackLightPower, 0.0f);
+	READ_BOOL(mtl, SubsurfaceLighting, false);
+	READ_FLOAT(mtl, SubsurfaceLightingRolloff, 0.0f);
+	READ_BOOL(mtl, SpecularEnabled, false);
+	READ_COLOR(mtl, SpecularColor, empty_color3);
+	READ_FLOAT(mtl, SpecularMult, 0.0f);
+	READ_FLOAT(mtl, Smoothness, 0.0f);
+	READ_FLOAT(mtl, FresnelPower, 0.0f);
+	READ_FLOAT(mtl, WetnessControlSpecScale, 0.0f);
+	READ_FLOAT(mtl, WetnessControlSpecPowerScale, 0.0f);
+	READ_FLOAT(mtl, WetnessControlSpecMinvar, 0.0f);
+	READ_FLOAT(mtl, WetnessControlEnvMapScale, 0.0f);
+	READ_FLOAT(mtl, WetnessControlFresnelPower, 0.0f);
+	READ_FLOAT(mtl, WetnessControlMetalness, 0.0f);
+	READ_STRING(mtl, RootMaterialPath, "");
+	READ_BOOL(mtl, AnisoLighting, false);
+	READ_BOOL(mtl, EmitEnabled, false);
+	READ_COLOR(mtl, EmittanceColor, empty_color3);
+	READ_FLOAT(mtl, EmittanceMult, 0.0f);
+	READ_BOOL(mtl, ModelSpaceNormals, false);
+	READ_BOOL(mtl, ExternalEmittance, false);
+	READ_BOOL(mtl, BackLighting, false);
+	READ_BOOL(mtl, ReceiveShadows, false);
+	READ_BOOL(mtl, HideSecret, false);
+	READ_BOOL(mtl, CastShadows, false);
+	READ_BOOL(mtl, DissolveFade, false);
+	READ_BOOL(mtl, AssumeShadowmask, false);
+	READ_BOOL(mtl, Glowmap, false);
+	READ_BOOL(mtl, EnvironmentMappingWindow, false);
+	READ_BOOL(mtl, EnvironmentMappingEye, false);
+	READ_BOOL(mtl, Hair, false);
+	READ_COLOR(mtl, HairTintColor, empty_color3);
+	READ_BOOL(mtl, Tree, false);
+	READ_BOOL(mtl, Facegen, false);
+	READ_BOOL(mtl, SkinTint, false);
+	READ_BOOL(mtl, Tessellate, false);
+	READ_FLOAT(mtl, DisplacementTextureBias, 0.0f);
+	READ_FLOAT(mtl, DisplacementTextureScale, 0.0f);
+	READ_FLOAT(mtl, TessellationPNScale, 0.0f);
+	READ_FLOAT(mtl, TessellationBaseFactor, 0.0f);
+	READ_FLOAT(mtl, TessellationFadeDistance, 0.0f);
+	READ_FLOAT(mtl, GrayscaleToPaletteScale, 0.0f);
+	READ_BOOL(mtl, SkewSpecularAlpha, false);
+	READ_BOOL(mtl, GrayscaleToPaletteColor, false);
+	return true;
+}
+
+#undef READ_FLOAT
+#undef READ_STRING
+#undef READ_BOOL
+#undef READ_ENUM
+#undef READ_BYTE
+#undef READ_COLOR
+
+// ReadBGSMFile and ReadBGEMFile differ only in these and the signatures
+template <typename Src>
+bool ReadMaterial(Src& src, const MaterialHeader& hdr, BGSMFile& mtl) { return ReadBGSM(src, hdr, mtl); }
+
+template <typename Src>
+bool ReadMaterial(Src& src, const MaterialHeader& hdr, BGEMFile& mtl) { return ReadBGEM(src, hdr, mtl); }
+
+//////////////////////////////////////////////////////////////////////////
+// Old path: ReadBGSMFile and ReadBGEMFile before the session cache
+
+long FileSize(const char *filename)
+{
+	struct stat filestat;
+	return (stat(filename, &filestat) == 0) ? long(filestat.st_size) : -1;
+}
+
+template <typename T>
+bool OldReadMaterialFile(const tstring& filename, const char *signature, const char *other, T& mtl)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == nullptr) return false;
+
+	bool result = false;
+	MaterialHeader hdr;
+	if (!ReadMtlHeader(file, hdr)) goto error;
+	if (strncmp(hdr.Signature, signature, 4) == 0) {
+		if (!ReadMaterial(file, hdr, mtl)) goto error;
+		result = true;
+	}
+	else if (strncmp(hdr.Signature, other, 4) == 0) {
+		fclose(file);
+		return false;
+	} else {
+		// read as JSON files; the document was never used
+		fseek(file, 0, SEEK_SET);
+		long size = FileSize(filename.c_str());
+		char *json = static_cast<char*>(malloc(size + 1));
+		if (size >= 0 && fread(json, sizeof(char), size, file) == size_t(size)) {
+			json[size] = 0;
+			rapidjson::Document d;
+			d.Parse(json);
+		}
+		result = true;
+		free(json);
+	}
+	goto exit;
+error:
+	result = false;
+exit:
+	fclose(file);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// New path: whole file in memory, in situ json and session cache
+
+// Whole file mapped copy on write, as 07ca91c did
+class MappedMaterialFile
+{
+public:
+	explicit MappedMaterialFile(const tstring& filename) : data(nullptr), size(0)
+	{
+#ifdef _WIN32
+		hMap = nullptr;
+		hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER fileSize;
+		if (hFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart <= 0 || fileSize.QuadPart > 0x1000000)
+			return;
+		hMap = CreateFileMapping(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if (hMap != nullptr)
+			data = static_cast<char*>(MapViewOfFile(hMap, FILE_MAP_COPY, 0, 0, 0));
+		if (data != nullptr)
+			size = size_t(fileSize.QuadPart);
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= 0x1000000) {
+			void *view = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (view != MAP_FAILED) {
+				data = static_cast<char*>(view);
+				size = size_t(st.st_size);
+			}
+		}
+		close(fd);
+#endif
+	}
+	~MappedMaterialFile()
+	{
+#ifdef _WIN32
+		if (data != nullptr) UnmapViewOfFile(data);
+		if (hMap != nullptr) CloseHandle(hMap);
+		if (hFile != INVALID_HANDLE_VALUE) CloseHandle(hFile);
+#else
+		if (data != nullptr) munmap(data, size);
+#endif
+	}
+
+	char *Data() const { return data; }
+	size_t Size() const { return size; }
+	MtlReader Reader() const { MtlReader src = { data, data + size }; return src; }
+
+private:
+	MappedMaterialFile(const MappedMaterialFile&);
+	MappedMaterialFile& operator=(const MappedMaterialFile&);
+
+#ifdef _WIN32
+	HANDLE hFile;
+	HANDLE hMap;
+#endif
+	char *data;
+	size_t size;
+};
+
+// Whole file read into a private buffer, as mtlutil.cpp does now
+class MaterialFileData
+{
+public:
+	explicit MaterialFileData(const tstring& filename)
+	{
+#ifdef _WIN32
+		LARGE_INTEGER fileSize;
+		HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE)
+			return;
+		if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart <= 0x1000000) {
+			DWORD bytesRead = 0;
+			buffer.resize(size_t(fileSize.QuadPart));
+			if (!ReadFile(hFile, &buffer[0], DWORD(buffer.size()), &bytesRead, nullptr) || bytesRead != buffer.size())
+				buffer.clear();
+		}
+		CloseHandle(hFile);
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= 0x1000000) {
+			buffer.resize(size_t(st.st_size));
+			if (read(fd, &buffer[0], buffer.size()) != ssize_t(buffer.size()))
+				buffer.clear();
+		}
+		close(fd);
+#endif
+	}
+
+	char *Data() { return buffer.empty() ? nullptr : &buffer[0]; }
+	size_t Size() const { return buffer.size(); }
+	MtlReader Reader() { MtlReader src = { Data(), Data() + buffer.size() }; return src; }
+
+private:
+	std::vector<char> buffer;
+};
+
+struct MaterialInsituStream
+{
+	typedef char Ch;
+
+	MaterialInsituStream(char *src, size_t len) : src_(src), dst_(nullptr), head_(src), end_(src + len) {}
+
+	Ch Peek() const { return src_ < end_ ? *src_ : '\0'; }
+	Ch Take() { return src_ < end_ ? *src_++ : '\0'; }
+	size_t Tell() const { return static_cast<size_t>(src_ - head_); }
+
+	void Put(Ch c) { *dst_++ = c; }
+	Ch* PutBegin() { return dst_ = src_; }
+	size_t PutEnd(Ch* begin) { return static_cast<size_t>(dst_ - begin); }
+	void Flush() {}
+
+	Ch* src_;
+	Ch* dst_;
+	Ch* head_;
+	Ch* end_;
+};
+
+// Size and last write time, from stat instead of GetFileAttributesEx
+struct MaterialStamp
+{
+	unsigned long long writeTime;
+	unsigned long long size;
+
+	bool operator==(const MaterialStamp& rhs) const { return writeTime == rhs.writeTime && size == rhs.size; }
+};
+
+bool GetMaterialStamp(const tstring& filename, MaterialStamp& stamp)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0 || (st.st_mode & S_IFMT) == S_IFDIR)
+		return false;
+	stamp.writeTime = (unsigned long long)st.st_mtime;
+	stamp.size = (unsigned long long)st.st_size;
+	return true;
+}
+
+template <typename T>
+class MaterialCache
+{
+public:
+	bool Find(const tstring& filename, const MaterialStamp& stamp, T& mtl)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		typename EntryMap::const_iterator itr = entries.find(filename);
+		if (itr == entries.end() || !(itr->second.stamp == stamp))
+			return false;
+		mtl = itr->second.mtl;
+		return true;
+	}
+	void Store(const tstring& filename, const MaterialStamp& stamp, const T& mtl)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		Entry& entry = entries[filename];
+		entry.stamp = stamp;
+		entry.mtl = mtl;
+	}
+	void Clear()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		entries.clear();
+	}
+
+private:
+	struct Entry
+	{
+		MaterialStamp stamp;
+		T mtl;
+	};
+	typedef std::map<tstring, Entry> EntryMap;
+
+	std::mutex lock;
+	EntryMap entries;
+};
+
+MaterialCache<BGSMFile> BGSMCache;
+MaterialCache<BGEMFile> BGEMCache;
+
+MaterialCache<BGSMFile>& CacheOf(BGSMFile&) { return BGSMCache; }
+MaterialCache<BGEMFile>& CacheOf(BGEMFile&) { return BGEMCache; }
+
+template <typename File>
+bool ParseJsonMaterial(File& file, rapidjson::Document& d)
+{
+	MaterialInsituStream json(file.Data(), file.Size());
+	d.ParseStream<rapidjson::kParseInsituFlag>(json);
+	return !d.HasParseError() && d.IsObject();
+}
+
+template <typename File, typename T>
+bool NewReadMaterialFile(const tstring& filename, const char *signature, const char *other, T& mtl)
+{
+	MaterialStamp stamp;
+	if (!GetMaterialStamp(filename, stamp)) return false;
+	if (CacheOf(mtl).Find(filename, stamp, mtl)) return true;
+
+	File file(filename);
+	if (file.Data() == nullptr) return false;
+
+	bool result = false;
+	MaterialHeader hdr;
+	MtlReader src = file.Reader();
+	if (!ReadMtlHeader(src, hdr)) return false;
+	if (strncmp(hdr.Signature, signature, 4) == 0) {
+		result = ReadMaterial(src, hdr, mtl);
+	}
+	else if (strncmp(hdr.Signature, other, 4) == 0) {
+		return false;
+	}
+	else {
+		rapidjson::Document d;
+		if (ParseJsonMaterial(file, d)) {
+			memcpy(hdr.Signature, signature, 4);
+			hdr.Version = 1;
+			result = ReadMaterial(static_cast<rapidjson::Value&>(d), hdr, mtl);
+		}
+	}
+	if (result)
+		CacheOf(mtl).Store(filename, stamp, mtl);
+	return result;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Synthetic corpus
+
+void RandomBase(std::mt19937& rng, BaseMaterial& mtl)
+{
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	mtl.TileU = (rng() & 1) != 0;
+	mtl.TileV = (rng() & 1) != 0;
+	mtl.UOffset = uni(rng);
+	mtl.VOffset = uni(rng);
+	mtl.UScale = 1.0f + uni(rng);
+	mtl.VScale = 1.0f + uni(rng);
+	mtl.Alpha = uni(rng);
+	mtl.AlphaBlendMode = AlphaBlendModeType(rng() % 5);
+	ConvertAlphaBlendMode(mtl.AlphaBlendMode, mtl.BlendState, mtl.BlendFunc1, mtl.BlendFunc2);
+	mtl.AlphaBlendMode = ConvertAlphaBlendMode(mtl.BlendState, mtl.BlendFunc1, mtl.BlendFunc2);
+	mtl.AlphaTestRef = (unsigned char)(rng() & 0xFF);
+	bool* flags[] = { &mtl.AlphaTest, &mtl.ZBufferWrite, &mtl.ZBufferTest, &mtl.ScreenSpaceReflections,
+		&mtl.WetnessControlScreenSpaceReflections, &mtl.Decal, &mtl.TwoSided, &mtl.DecalNoFade, &mtl.NonOccluder,
+		&mtl.Refraction, &mtl.RefractionFalloff, &mtl.EnvironmentMapping, &mtl.GrayscaleToPaletteColor };
+	for (bool* flag : flags)
+		*flag = (rng() & 1) != 0;
+	mtl.RefractionPower = uni(rng);
+	mtl.EnvironmentMappingMaskScale = uni(rng);
+}
+
+tstring RandomTexture(std::mt19937& rng, const char *suffix)
+{
+	static const char* const folders[] = { "Architecture", "Clutter", "Actors", "Armor", "Landscape", "Weapons" };
+	char name[128];
+	snprintf(name, sizeof(name), "Textures/%s/Set%03u/Item%04u%s.dds", folders[rng() % 6], unsigned(rng() % 1000), unsigned(rng() % 10000), suffix);
+	return name;
+}
+
+Niflib::Color3 RandomColor(std::mt19937& rng)
+{
+	return Niflib::Color3(float(rng() & 0xFF) / 255.0f, float(rng() & 0xFF) / 255.0f, float(rng() & 0xFF) / 255.0f);
+}
+
+void RandomBGSM(std::mt19937& rng, BGSMFile& mtl)
+{
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	mtl = BGSMFile();
+	RandomBase(rng, mtl);
+	mtl.DiffuseTexture = RandomTexture(rng, "_d");
+	mtl.NormalTexture = RandomTexture(rng, "_n");
+	mtl.SmoothSpecTexture = RandomTexture(rng, "_s");
+	mtl.GreyscaleTexture = (rng() & 3) ? "" : RandomTexture(rng, "_g");
+	mtl.EnvmapTexture = (rng() & 1) ? "" : RandomTexture(rng, "_e");
+	mtl.GlowTexture = (rng() & 3) ? "" : RandomTexture(rng, "_glow");
+	mtl.RootMaterialPath = (rng() & 1) ? "" : "Materials/Template/Base.bgsm";
+	bool* flags[] = { &mtl.EnableEditorAlphaRef, &mtl.RimLighting, &mtl.SubsurfaceLighting, &mtl.SpecularEnabled,
+		&mtl.AnisoLighting, &mtl.EmitEnabled, &mtl.ModelSpaceNormals, &mtl.ExternalEmittance, &mtl.BackLighting,
+		&mtl.ReceiveShadows, &mtl.HideSecret, &mtl.CastShadows, &mtl.DissolveFade, &mtl.AssumeShadowmask,
+		&mtl.Glowmap, &mtl.EnvironmentMappingWindow, &mtl.EnvironmentMappingEye, &mtl.Hair, &mtl.Tree,
+		&mtl.Facegen, &mtl.SkinTint, &mtl.Tessellate, &mtl.SkewSpecularAlpha };
+	for (bool* flag : flags)
+		*flag = (rng() & 1) != 0;
+	float* values[] = { &mtl.RimPower, &mtl.BackLightPower, &mtl.SubsurfaceLightingRolloff, &mtl.SpecularMult,
+		&mtl.Smoothness, &mtl.FresnelPower, &mtl.WetnessControlSpecScale, &mtl.WetnessControlSpecPowerScale,
+		&mtl.WetnessControlSpecMinvar, &mtl.WetnessControlEnvMapScale, &mtl.WetnessControlFresnelPower,
+		&mtl.WetnessControlMetalness, &mtl.EmittanceMult, &mtl.DisplacementTextureBias, &mtl.DisplacementTextureScale,
+		&mtl.TessellationPNScale, &mtl.TessellationBaseFactor, &mtl.TessellationFadeDistance, &mtl.GrayscaleToPaletteScale };
+	for (float* value : values)
+		*value = uni(rng);
+	mtl.SpecularColor = RandomColor(rng);
+	mtl.EmittanceColor = mtl.EmitEnabled ? RandomColor(rng) : empty_color3;
+	mtl.HairTintColor = RandomColor(rng);
+}
+
+void RandomBGEM(std::mt19937& rng, BGEMFile& mtl)
+{
+	std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+	mtl = BGEMFile();
+	RandomBase(rng, mtl);
+	mtl.BaseTexture = RandomTexture(rng, "_d");
+	mtl.GrayscaleTexture = (rng() & 1) ? "" : RandomTexture(rng, "_g");
+	mtl.EnvmapTexture = (rng() & 1) ? "" : RandomTexture(rng, "_e");
+	mtl.NormalTexture = RandomTexture(rng, "_n");
+	mtl.EnvmapMaskTexture = (rng() & 1) ? "" : RandomTexture(rng, "_m");
+	bool* flags[] = { &mtl.BloodEnabled, &mtl.EffectLightingEnabled, &mtl.FalloffEnabled, &mtl.FalloffColorEnabled,
+		&mtl.GrayscaleToPaletteAlpha, &mtl.SoftEnabled };
+	for (bool* flag : flags)
+		*flag = (rng() & 1) != 0;
+	mtl.BaseColor = RandomColor(rng);
+	mtl.BaseColorScale = 1.0f + uni(rng);
+	mtl.FalloffStartAngle = uni(rng);
+	mtl.FalloffStopAngle = uni(rng);
+	mtl.FalloffStartOpacity = uni(rng);
+	mtl.FalloffStopOpacity = uni(rng);
+	mtl.LightingInfluence = uni(rng);
+	mtl.EnvmapMinLOD = (unsigned char)(rng() % 8);
+	mtl.SoftDepth = 100.0f * uni(rng);
+}
+
+// Json writer for the members ReadBGSM reads from a document
+struct JsonOut
+{
+	FILE *file;
+	bool first;
+
+	void Key(const char *prefix, const char *name) { fprintf(file, "%s\n  \"%s%s\": ", first ? "{" : ",", prefix, name); first = false; }
+	void Bool(const char *name, bool x) { Key("b", name); fputs(x ? "true" : "false", file); }
+	void Float(const char *name, float x) { Key("f", name); fprintf(file, "%.9g", x); }
+	void String(const char *name, const tstring& x) { Key("s", name); fprintf(file, "\"%s\"", x.c_str()); }
+	void Color(const char *name, const Niflib::Color3& x) { Key("c", name); fprintf(file, "\"#%02X%02X%02X\"", int(x.r * 255.0f + 0.5f), int(x.g * 255.0f + 0.5f), int(x.b * 255.0f + 0.5f)); }
+	void Enum(const char *name, int x) { Key("e", name); fprintf(file, "\"%s\"", AlphaBlendModeNames[x]); }
+};
+
+bool SaveBGSMJson(const char *filename, const BGSMFile& mtl)
+{
+	FILE *file = fopen(filename, "wb");
+	if (file == nullptr) return false;
+	JsonOut out = { file, true };
+	out.Bool("TileU", mtl.TileU);
+	out.Bool("TileV", mtl.TileV);
+	out.Float("UOffset", mtl.UOffset);
+	out.Float("VOffset", mtl.VOffset);
+	out.Float("UScale", mtl.UScale);
+	out.Float("VScale", mtl.VScale);
+	out.Float("Alpha", mtl.Alpha);
+	out.Enum("AlphaBlendMode", mtl.AlphaBlendMode);
+	out.Bool("AlphaTest", mtl.AlphaTest);
+	out.Bool("ZBufferWrite", mtl.ZBufferWrite);
+	out.Bool("ZBufferTest", mtl.ZBufferTest);
+	out.Bool("TwoSided", mtl.TwoSided);
+	out.Bool("Decal", mtl.Decal);
+	out.Float("RefractionPower", mtl.RefractionPower);
+	out.Float("EnvironmentMappingMaskScale", mtl.EnvironmentMappingMaskScale);
+	out.String("DiffuseTexture", mtl.DiffuseTexture);
+	out.String("NormalTexture", mtl.NormalTexture);
+	out.String("SmoothSpecTexture", mtl.SmoothSpecTexture);
+	out.String("GreyscaleTexture", mtl.GreyscaleTexture);
+	out.String("EnvmapTexture", mtl.EnvmapTexture);
+	out.String("GlowTexture", mtl.GlowTexture);
+	out.String("RootMaterialPath", mtl.RootMaterialPath);
+	out.Bool("SpecularEnabled", mtl.SpecularEnabled);
+	out.Color("SpecularColor", mtl.SpecularColor);
+	out.Float("SpecularMult", mtl.SpecularMult);
+	out.Float("Smoothness", mtl.Smoothness);
+	out.Float("FresnelPower", mtl.FresnelPower);
+	out.Bool("EmitEnabled", mtl.EmitEnabled);
+	out.Color("EmittanceColor", mtl.EmittanceColor);
+	out.Float("EmittanceMult", mtl.EmittanceMult);
+	out.Bool("ReceiveShadows", mtl.ReceiveShadows);
+	out.Bool("CastShadows", mtl.CastShadows);
+	out.Bool("Hair", mtl.Hair);
+	out.Color("HairTintColor", mtl.HairTintColor);
+	out.Bool("SkinTint", mtl.SkinTint);
+	out.Float("GrayscaleToPaletteScale", mtl.GrayscaleToPaletteScale);
+	fputs("\n}\n", file);
+	return fclose(file) == 0;
+}
+
+template <typename T, typename Save>
+bool SaveBinary(const char *filename, const char *signature, const T& mtl, Save save)
+{
+	FILE *file = fopen(filename, "wb");
+	if (file == nullptr) return false;
+	MaterialHeader hdr;
+	memcpy(hdr.Signature, signature, 4);
+	hdr.Version = 1;
+	bool ok = SaveMtlHeader(file, hdr) && save(file, hdr, mtl);
+	return (fclose(file) == 0) && ok;
+}
+
+int GenerateCorpus(const char *dir, int count)
+{
+	std::error_code ec;
+	fs::create_directories(dir, ec);
+	std::mt19937 rng(1);
+	for (int i = 0; i < count; ++i) {
+		char name[64];
+		bool ok;
+		if (i % 5 == 4) {
+			BGEMFile mtl;
+			RandomBGEM(rng, mtl);
+			snprintf(name, sizeof(name), "effect%05d.bgem", i);
+			ok = SaveBinary((fs::path(dir) / name).string().c_str(), "BGEM", mtl, SaveBGEM);
+		}
+		else {
+			BGSMFile mtl;
+			RandomBGSM(rng, mtl);
+			if (i % 5 == 3) {
+				snprintf(name, sizeof(name), "json%05d.bgsm", i);
+				ok = SaveBGSMJson((fs::path(dir) / name).string().c_str(), mtl);
+			}
+			else {
+				snprintf(name, sizeof(name), "material%05d.bgsm", i);
+				ok = SaveBinary((fs::path(dir) / name).string().c_str(), "BGSM", mtl, SaveBGSM);
+			}
+		}
+		if (!ok) {
+			fprintf(stderr, "cannot write %s in %s\n", name, dir);
+			return 1;
+		}
+	}
+	printf("wrote %d materials to %s\n", count, dir);
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Passes over the corpus
+
+struct MaterialFile
+{
+	tstring path;
+	bool bgem;
+};
+
+bool HasMaterialExtension(const fs::path& path, bool& bgem)
+{
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(tolower(c)); });
+	bgem = (ext == ".bgem");
+	return bgem || ext == ".bgsm";
+}
+
+void CollectFiles(const fs::path& path, std::vector<MaterialFile>& files)
+{
+	std::error_code ec;
+	bool bgem = false;
+	if (fs::is_directory(path, ec)) {
+		for (fs::recursive_directory_iterator it(path, ec), end; it != end; it.increment(ec)) {
+			if (it->is_regular_file(ec) && HasMaterialExtension(it->path(), bgem))
+				files.push_back(MaterialFile{ it->path().string(), bgem });
+		}
+	}
+	else if (fs::is_regular_file(path, ec) && HasMaterialExtension(path, bgem)) {
+		files.push_back(MaterialFile{ path.string(), bgem });
+	}
+	else {
+		fprintf(stderr, "skipping %s: not a material file or directory\n", path.string().c_str());
+	}
+}
+
+// Drops the file from the OS cache where the system allows it
+void DropFileCache(const tstring& path)
+{
+#if defined(POSIX_FADV_DONTNEED)
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+#else
+	(void)path;
+#endif
+}
+
+bool ReadOld(const MaterialFile& f)
+{
+	if (f.bgem) {
+		BGEMFile mtl = BGEMFile();
+		return OldReadMaterialFile(f.path, "BGEM", "BGSM", mtl);
+	}
+	BGSMFile mtl = BGSMFile();
+	return OldReadMaterialFile(f.path, "BGSM", "BGEM", mtl);
+}
+
+template <typename File>
+bool ReadNew(const MaterialFile& f)
+{
+	if (f.bgem) {
+		BGEMFile mtl = BGEMFile();
+		return NewReadMaterialFile<File>(f.path, "BGEM", "BGSM", mtl);
+	}
+	BGSMFile mtl = BGSMFile();
+	return NewReadMaterialFile<File>(f.path, "BGSM", "BGEM", mtl);
+}
+
+// Binary files must decode to the same bytes on both paths
+template <typename T, typename Save>
+bool SameDecode(const T& a, const T& b, Save save)
+{
+	FILE *fa = tmpfile(), *fb = tmpfile();
+	bool same = false;
+	if (fa && fb) {
+		MaterialHeader hdr;
+		memcpy(hdr.Signature, "BGSM", 4);
+		hdr.Version = 1;
+		save(fa, hdr, a);
+		save(fb, hdr, b);
+		long na = ftell(fa), nb = ftell(fb);
+		if (na == nb) {
+			std::vector<char> ba(na), bb(nb);
+			rewind(fa);
+			rewind(fb);
+			same = fread(ba.data(), 1, na, fa) == size_t(na) && fread(bb.data(), 1, nb, fb) == size_t(nb) && ba == bb;
+		}
+	}
+	if (fa) fclose(fa);
+	if (fb) fclose(fb);
+	return same;
+}
+
+bool IsBinary(const MaterialFile& f)
+{
+	FILE *file = fopen(f.path.c_str(), "rb");
+	char sig[4] = {};
+	bool binary = file && fread(sig, 1, 4, file) == 4 && (memcmp(sig, "BGSM", 4) == 0 || memcmp(sig, "BGEM", 4) == 0);
+	if (file) fclose(file);
+	return binary;
+}
+
+template <typename File>
+bool CompareDecode(const MaterialFile& f)
+{
+	BGSMCache.Clear();
+	BGEMCache.Clear();
+	if (f.bgem) {
+		BGEMFile a = BGEMFile(), b = BGEMFile();
+		bool oa = OldReadMaterialFile(f.path, "BGEM", "BGSM", a), ob = NewReadMaterialFile<File>(f.path, "BGEM", "BGSM", b);
+		return oa == ob && (!oa || SameDecode(a, b, SaveBGEM));
+	}
+	BGSMFile a = BGSMFile(), b = BGSMFile();
+	bool oa = OldReadMaterialFile(f.path, "BGSM", "BGEM", a), ob = NewReadMaterialFile<File>(f.path, "BGSM", "BGEM", b);
+	return oa == ob && (!oa || SameDecode(a, b, SaveBGSM));
+}
+
+template <typename Fn>
+double BestOf(int repeats, Fn fn)
+{
+	double best = 0.0;
+	for (int r = 0; r < repeats; ++r) {
+		double seconds = fn();
+		if (r == 0 || seconds < best)
+			best = seconds;
+	}
+	return best;
+}
+
+template <typename Read>
+double TimePass(const std::vector<MaterialFile>& files, bool dropCache, bool clearSession, Read read, unsigned& failed)
+{
+	if (dropCache) {
+		for (const MaterialFile& f : files)
+			DropFileCache(f.path);
+	}
+	if (clearSession) {
+		BGSMCache.Clear();
+		BGEMCache.Clear();
+	}
+	failed = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (const MaterialFile& f : files) {
+		if (!read(f))
+			++failed;
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	int repeats = 5;
+	std::vector<MaterialFile> files;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-g") == 0 && i + 2 < argc)
+			return GenerateCorpus(argv[i + 1], atoi(argv[i + 2]));
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = std::max(1, atoi(argv[++i]));
+		else
+			CollectFiles(argv[i], files);
+	}
+	if (files.empty()) {
+		fprintf(stderr, "usage: %s [-r repeats] file-or-directory...\n       %s -g directory count\n", argv[0], argv[0]);
+		return 1;
+	}
+	std::sort(files.begin(), files.end(), [](const MaterialFile& a, const MaterialFile& b) { return a.path < b.path; });
+
+	std::vector<MaterialFile> byFormat[2];
+	unsigned mismatched = 0;
+	double bytes[2] = {};
+	for (const MaterialFile& f : files) {
+		bool binary = IsBinary(f);
+		long size = FileSize(f.path.c_str());
+		bytes[binary] += (size > 0) ? double(size) : 0.0;
+		byFormat[binary].push_back(f);
+		if (binary && !(CompareDecode<MappedMaterialFile>(f) && CompareDecode<MaterialFileData>(f))) {
+			printf("DIFFER %s\n", f.path.c_str());
+			++mismatched;
+		}
+	}
+	printf("%u binary files, %.1f KB; %u json files, %.1f KB; fastest of %d passes\n", unsigned(byFormat[1].size()),
+		bytes[1] / 1024.0, unsigned(byFormat[0].size()), bytes[0] / 1024.0, repeats);
+
+	typedef bool (*ReadFn)(const MaterialFile&);
+	struct Pass
+	{
+		const char *name;
+		ReadFn read;
+		bool dropCache, clearSession;
+	};
+	const Pass passes[] = {
+		{ "fread cold", ReadOld, true, true },
+		{ "fread warm", ReadOld, false, true },
+		{ "mapped cold", ReadNew<MappedMaterialFile>, true, true },
+		{ "mapped warm", ReadNew<MappedMaterialFile>, false, true },
+		{ "buffer cold", ReadNew<MaterialFileData>, true, true },
+		{ "buffer warm", ReadNew<MaterialFileData>, false, true },
+		{ "cached", ReadNew<MaterialFileData>, false, false },
+	};
+	printf("%-12s %12s %12s %8s\n", "pass", "binary us", "json us", "failed");
+	for (const Pass& p : passes) {
+		double usPerFile[2] = {};
+		unsigned failedTotal = 0;
+		for (int binary = 1; binary >= 0; --binary) {
+			const std::vector<MaterialFile>& set = byFormat[binary];
+			if (set.empty())
+				continue;
+			unsigned failed = 0;
+			if (!p.clearSession)
+				TimePass(set, false, true, p.read, failed);
+			double seconds = BestOf(repeats, [&] { return TimePass(set, p.dropCache, p.clearSession, p.read, failed); });
+			usPerFile[binary] = seconds * 1e6 / double(set.size());
+			failedTotal += failed;
+		}
+		printf("%-12s %12.2f %12.2f %8u\n", p.name, usPerFile[1], usPerFile[0], failedTotal);
+	}
+	if (mismatched)
+		printf("%u binary file(s) decoded differently\n", mismatched);
+	return mismatched ? 1 : 0;
+}
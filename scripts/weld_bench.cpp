@@ -0,0 +1,482 @@
+/**********************************************************************
+*<
+FILE: weld_bench.cpp
+
+DESCRIPTION:	Welds synthetic meshes the way Exporter::addVertex does,
+               once with the linear VertexCompare scan the exporter used
+               to run and once through the WeldGrid spatial hash, checks
+               that both give the same vertex and index streams and prints
+               the time each took.  It has no Max dependencies and builds
+               on Linux or Windows:
+
+                 g++ -O2 -std=c++17 scripts/weld_bench.cpp -o weld_bench
+
+               weld_bench [-s size] [-r repeats] [-w weldThresh]
+                          [-n normThresh] [-u uvwThresh]
+
+               -s  quads per side of the generated meshes (default 100)
+               -r  weld every mesh this many times (default 3) and keep
+                   the fastest run
+               -w -n -u  the WeldVertexThresh, WeldNormThresh and
+                   WeldUVWThresh export settings (default 0.01 each)
+
+               WeldGrid, FindWeldedVertex and the parts of VertexCompare
+               that addVertex uses are copied from NifExport/Mesh.cpp and
+               Exporter.h, which need the Max SDK; keep them in step.
+               Exits non zero when the two paths disagree.
+
+HISTORY:
+
+*>	Copyright (c) 2026, All Rights Reserved.
+**********************************************************************/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using std::vector;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////
+// Stand ins for the Max and niflib types addVertex works with
+
+struct Point3
+{
+	float x, y, z;
+
+	Point3() : x(0.0f), y(0.0f), z(0.0f) {}
+	Point3(float x, float y, float z) : x(x), y(y), z(z) {}
+	float operator[](int i) const { return (&x)[i]; }
+};
+
+struct Vector3
+{
+	float x, y, z;
+
+	Vector3(const Point3 &p) : x(p.x), y(p.y), z(p.z) {}
+};
+
+struct TexCoord
+{
+	float u, v;
+
+	TexCoord() : u(0.0f), v(0.0f) {}
+	TexCoord(float u, float v) : u(u), v(v) {}
+};
+typedef vector<TexCoord> TexCoords;
+
+struct Color4
+{
+	float r, g, b, a;
+
+	Color4(float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f) : r(r), g(g), b(b), a(a) {}
+};
+
+struct VertexGroup
+{
+	int        idx;
+	Point3     pt;
+	Point3     norm;
+	TexCoords  uvs;
+	Color4     color;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Exporter::WeldGrid
+
+struct WeldGrid
+{
+	typedef unsigned long long CellKey;
+
+	WeldGrid() : cellSize(0.0f), invCellSize(0.0f) {}
+
+	void init(float thresh)
+	{
+		cellSize = std::max(thresh * 2.0f, 1.0e-4f);
+		invCellSize = 1.0f / cellSize;
+		cells.clear();
+		next.clear();
+	}
+
+	void cellOf(const Point3 &pt, long long cell[3]) const
+	{
+		const double limit = 1.0e15;
+		for (int i = 0; i < 3; ++i) {
+			double d = floor(double(pt[i]) * double(invCellSize));
+			if (!(d == d)) d = 0.0;
+			cell[i] = (long long)((d < -limit) ? -limit : (d > limit) ? limit : d);
+		}
+	}
+
+	static CellKey keyOf(long long x, long long y, long long z)
+	{
+		const CellKey mask = (1ULL << 21) - 1;
+		return ((CellKey(x) & mask) << 42) | ((CellKey(y) & mask) << 21) | (CellKey(z) & mask);
+	}
+
+	int first(CellKey key) const
+	{
+		std::unordered_map<CellKey, int>::const_iterator itr = cells.find(key);
+		return (itr != cells.end()) ? (*itr).second : -1;
+	}
+
+	void insert(const Point3 &pt, int idx)
+	{
+		long long cell[3];
+		cellOf(pt, cell);
+		CellKey key = keyOf(cell[0], cell[1], cell[2]);
+		if (int(next.size()) <= idx)
+			next.resize(idx + 1, -1);
+		std::unordered_map<CellKey, int>::iterator itr = cells.find(key);
+		if (itr == cells.end()) {
+			next[idx] = -1;
+			cells.insert(std::make_pair(key, idx));
+		} else {
+			next[idx] = (*itr).second;
+			(*itr).second = idx;
+		}
+	}
+
+	float                            cellSize;
+	float                            invCellSize;
+	std::unordered_map<CellKey, int> cells;
+	vector<int>                      next;
+};
+
+// The attribute streams of Exporter::FaceGroup that welding touches
+struct FaceGroup
+{
+	vector<Vector3>   verts;
+	vector<Vector3>   vnorms;
+	vector<TexCoords> uvs;
+	vector<Color4>    vcolors;
+	vector<int>       vidx;
+	WeldGrid          weld;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// VertexCompare, as far as addVertex uses it
+
+inline bool equals(float a, float b, float thresh)
+{
+	return (fabsf(a - b) <= thresh);
+}
+
+struct VertexCompare
+{
+	VertexCompare(FaceGroup& g, float pt, float nt, float vt)
+		: grp(g), thresh(pt), normthresh(nt), vthresh(vt) {
+		if (normthresh > thresh)
+			normthresh = thresh;
+		if (vthresh > thresh)
+			vthresh = thresh;
+	}
+
+	inline int compare(float a, float b, float thresh) const {
+		if (equals(a, b, thresh)) return 0;
+		return std::less<float>()(a, b) ? -1 : 1;
+	}
+	inline int compare(const Vector3 &a, const Point3 &b, float thresh) const {
+		int d;
+		if ((d = compare(a.x, b.x, thresh)) != 0) return d;
+		if ((d = compare(a.y, b.y, thresh)) != 0) return d;
+		if ((d = compare(a.z, b.z, thresh)) != 0) return d;
+		return 0;
+	}
+	inline int compare(const TexCoord& lhs, const TexCoord& rhs, float thresh) const {
+		int d;
+		if ((d = compare(lhs.u, rhs.u, thresh)) != 0) return d;
+		if ((d = compare(lhs.v, rhs.v, thresh)) != 0) return d;
+		return 0;
+	}
+	inline int compare(const Color4 &a, const Color4 &b, float thresh) const {
+		int d;
+		if ((d = compare(a.r, b.r, thresh)) != 0) return d;
+		if ((d = compare(a.g, b.g, thresh)) != 0) return d;
+		if ((d = compare(a.b, b.b, thresh)) != 0) return d;
+		return 0;
+	}
+	inline int compare(int lhs, const VertexGroup& rhs) const {
+		int d;
+		if ((d = compare(grp.verts[lhs], rhs.pt, thresh)) != 0) return d;
+		if ((d = compare(grp.vnorms[lhs], rhs.norm, normthresh)) != 0) return d;
+		if ((d = compare(grp.vcolors[lhs], rhs.color, vthresh)) != 0) return d;
+		if ((d = int(grp.uvs.size()) - int(rhs.uvs.size())) != 0) return d;
+		for (size_t i = 0; i < rhs.uvs.size(); ++i) {
+			if ((d = compare(grp.uvs[i][lhs], rhs.uvs[i], vthresh)) != 0) return d;
+		}
+		return 0;
+	}
+	inline int compare(const VertexGroup& lhs, int rhs) const {
+		return -compare(rhs, lhs);
+	}
+	FaceGroup& grp;
+	float thresh, normthresh, vthresh;
+};
+
+int FindWeldedVertex(const WeldGrid &weld, const VertexCompare &vc, const VertexGroup &vg)
+{
+	long long cell[3];
+	weld.cellOf(vg.pt, cell);
+	int best = -1;
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dz = -1; dz <= 1; ++dz) {
+				WeldGrid::CellKey key = WeldGrid::keyOf(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+				for (int i = weld.first(key); i >= 0; i = weld.next[i]) {
+					if ((best < 0 || i < best) && vc.compare(vg, i) == 0)
+						best = i;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// The tail of Exporter::addVertex, with either search
+
+struct Thresholds
+{
+	float weld, norm, uvw;
+};
+
+int AddVertex(FaceGroup &grp, const VertexGroup &vg, const Thresholds &t, bool linear)
+{
+	VertexCompare vc(grp, t.weld, t.norm, t.uvw);
+	int n = int(grp.verts.size());
+	if (linear) {
+		for (int i = 0; i < n; i++) {
+			if (vc.compare(vg, i) == 0)
+				return i;
+		}
+	}
+	else {
+		if (grp.weld.cellSize <= 0.0f)
+			grp.weld.init(t.weld);
+		int match = FindWeldedVertex(grp.weld, vc, vg);
+		if (match >= 0)
+			return match;
+		grp.weld.insert(vg.pt, n);
+	}
+	grp.vidx.push_back(vg.idx);
+	grp.verts.push_back(Vector3(vg.pt));
+	grp.vnorms.push_back(Vector3(vg.norm));
+	for (size_t i = 0; i < grp.uvs.size(); ++i)
+		grp.uvs[i].push_back(vg.uvs[i]);
+	grp.vcolors.push_back(vg.color);
+	return n;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Synthetic meshes, as the face corners addVertex is called with
+
+struct Corners
+{
+	const char* name;
+	int uvSets;
+	vector<VertexGroup> corners;
+};
+
+VertexGroup Corner(int idx, const Point3 &pt, const Point3 &norm, float u, float v)
+{
+	VertexGroup vg;
+	vg.idx = idx;
+	vg.pt = pt;
+	vg.norm = norm;
+	vg.uvs.assign(1, TexCoord(u, v));
+	vg.color = Color4();
+	return vg;
+}
+
+// Quads as two triangles in the order Max lists mesh faces
+template <typename Fn>
+void AddQuads(vector<VertexGroup> &out, int cols, int rows, Fn corner)
+{
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < cols; ++x) {
+			const int quad[6][2] = { { x, y }, { x + 1, y }, { x + 1, y + 1 }, { x, y }, { x + 1, y + 1 }, { x, y + 1 } };
+			for (int k = 0; k < 6; ++k)
+				out.push_back(corner(quad[k][0], quad[k][1]));
+		}
+	}
+}
+
+// Smooth plane; every inner vertex is shared by six corners
+Corners MakePlane(int size)
+{
+	Corners c = { "plane", 1, {} };
+	AddQuads(c.corners, size, size, [&](int x, int y) {
+		return Corner(y * (size + 1) + x, Point3(x * 0.5f, y * 0.5f, 0.0f), Point3(0.0f, 0.0f, 1.0f), float(x) / size, float(y) / size);
+	});
+	return c;
+}
+
+// Latitude longitude sphere; the seam and the poles repeat positions
+//   with different uvs, so they must not weld
+Corners MakeSphere(int size)
+{
+	Corners c = { "uv sphere", 1, {} };
+	const float Pi = 3.14159265f;
+	int cols = size * 2, rows = size;
+	AddQuads(c.corners, cols, rows, [&](int x, int y) {
+		float theta = Pi * y / rows, phi = 2.0f * Pi * (x % cols) / cols;
+		Point3 n(sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta));
+		return Corner(y * (cols + 1) + x, Point3(n.x * 20.0f, n.y * 20.0f, n.z * 20.0f), n, float(x) / cols, float(y) / rows);
+	});
+	return c;
+}
+
+// Six subdivided faces with flat normals; edge positions repeat with a
+//   different normal on each face
+Corners MakeBox(int size)
+{
+	Corners c = { "hard box", 1, {} };
+	int side = std::max(1, size / 3);
+	for (int f = 0; f < 6; ++f) {
+		int axis = f / 2;
+		float sign = (f & 1) ? 1.0f : -1.0f;
+		AddQuads(c.corners, side, side, [&](int x, int y) {
+			float p[3], n[3] = { 0.0f, 0.0f, 0.0f };
+			p[axis] = sign * 10.0f;
+			p[(axis + 1) % 3] = x * 20.0f / side - 10.0f;
+			p[(axis + 2) % 3] = y * 20.0f / side - 10.0f;
+			n[axis] = sign;
+			return Corner(f * (side + 1) * (side + 1) + y * (side + 1) + x, Point3(p[0], p[1], p[2]),
+				Point3(n[0], n[1], n[2]), float(x) / side, float(y) / side);
+		});
+	}
+	return c;
+}
+
+// Triangles over a small pool of points, every corner moved by up to one
+//   and a half weld thresholds.  Chains of near matches straddle the grid
+//   cells and only the lowest index rule keeps the two searches in step
+Corners MakeJitter(int size, float thresh, std::mt19937 &rng)
+{
+	Corners c = { "jittered soup", 1, {} };
+	std::uniform_real_distribution<float> pos(0.0f, 30.0f), jitter(-1.5f * thresh, 1.5f * thresh);
+	vector<Point3> pool(size_t(size) * size / 2);
+	for (size_t i = 0; i < pool.size(); ++i)
+		pool[i] = Point3(pos(rng), pos(rng), pos(rng));
+	size_t corners = size_t(size) * size * 6;
+	for (size_t i = 0; i < corners; ++i) {
+		int idx = int(rng() % pool.size());
+		const Point3 &p = pool[idx];
+		c.corners.push_back(Corner(idx, Point3(p.x + jitter(rng), p.y + jitter(rng), p.z + jitter(rng)),
+			Point3(0.0f, 0.0f, 1.0f), 0.0f, 0.0f));
+	}
+	return c;
+}
+
+// A few positions shared by many corners that differ only in uv, which
+//   leaves the grid no better than the scan
+Corners MakeStacked(int size)
+{
+	Corners c = { "stacked uvs", 1, {} };
+	int count = std::max(1, size * size / 8);
+	for (int i = 0; i < count * 3; ++i) {
+		int uv = i % count;
+		c.corners.push_back(Corner(i % 3, Point3(float(i % 3), 0.0f, 0.0f), Point3(0.0f, 0.0f, 1.0f),
+			float(uv % 97) * 0.05f, float(uv / 97) * 0.05f));
+	}
+	return c;
+}
+
+struct WeldResult
+{
+	vector<int> indices;
+	FaceGroup group;
+};
+
+void Weld(const Corners &mesh, const Thresholds &t, bool linear, WeldResult &result)
+{
+	result.indices.clear();
+	result.group = FaceGroup();
+	result.group.uvs.resize(mesh.uvSets);
+	result.indices.reserve(mesh.corners.size());
+	for (size_t i = 0; i < mesh.corners.size(); ++i)
+		result.indices.push_back(AddVertex(result.group, mesh.corners[i], t, linear));
+}
+
+bool SameStreams(const WeldResult &a, const WeldResult &b)
+{
+	if (a.indices != b.indices || a.group.vidx != b.group.vidx || a.group.verts.size() != b.group.verts.size())
+		return false;
+	for (size_t i = 0; i < a.group.verts.size(); ++i) {
+		const Vector3 &p = a.group.verts[i], &q = b.group.verts[i];
+		if (p.x != q.x || p.y != q.y || p.z != q.z)
+			return false;
+	}
+	return true;
+}
+
+template <typename Fn>
+double BestOf(int repeats, Fn fn)
+{
+	double best = 0.0;
+	for (int r = 0; r < repeats; ++r) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || seconds < best)
+			best = seconds;
+	}
+	return best * 1e3;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	int size = 100, repeats = 3;
+	Thresholds t = { 0.01f, 0.01f, 0.01f };
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			size = std::max(2, atoi(argv[++i]));
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeats = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			t.weld = float(atof(argv[++i]));
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			t.norm = float(atof(argv[++i]));
+		else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+			t.uvw = float(atof(argv[++i]));
+		else {
+			fprintf(stderr, "usage: %s [-s size] [-r repeats] [-w weldThresh] [-n normThresh] [-u uvwThresh]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(1);
+	vector<Corners> meshes;
+	meshes.push_back(MakePlane(size));
+	meshes.push_back(MakeSphere(size));
+	meshes.push_back(MakeBox(size));
+	meshes.push_back(MakeJitter(size, t.weld, rng));
+	meshes.push_back(MakeStacked(size));
+
+	printf("weld %g, normal %g, uvw %g, fastest of %d runs\n", t.weld, t.norm, t.uvw, repeats);
+	printf("%-14s %8s %8s %10s %10s %8s  %s\n", "mesh", "corners", "verts", "linear ms", "grid ms", "speedup", "streams");
+	int failed = 0;
+	WeldResult linear, grid;
+	for (size_t m = 0; m < meshes.size(); ++m) {
+		const Corners &mesh = meshes[m];
+		double linearMs = BestOf(repeats, [&] { Weld(mesh, t, true, linear); });
+		double gridMs = BestOf(repeats, [&] { Weld(mesh, t, false, grid); });
+		bool same = SameStreams(linear, grid);
+		if (!same)
+			++failed;
+		printf("%-14s %8u %8u %10.2f %10.2f %7.1fx  %s\n", mesh.name, unsigned(mesh.corners.size()),
+			unsigned(linear.group.verts.size()), linearMs, gridMs, linearMs / gridMs, same ? "identical" : "DIFFER");
+	}
+	if (failed)
+		printf("%d mesh(es) welded differently\n", failed);
+	return failed ? 1 : 0;
+}